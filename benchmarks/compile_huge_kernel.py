@@ -0,0 +1,34 @@
+import time
+
+import taichi as ti
+
+# Compile time of one generated kernel of about 50k statements before
+# simplification, where the simplification passes of full_simplify take most
+# of the time. Every unrolled step leaves work for constant folding, CSE and
+# dead instruction elimination.
+NUM_STEPS = 4000
+
+
+def benchmark_compile_huge_kernel():
+    ti.init(arch=ti.cpu)
+    x = ti.field(ti.f32, shape=64)
+    y = ti.field(ti.f32, shape=())
+
+    @ti.kernel
+    def huge():
+        for _ in range(1):
+            s = 0.0
+            for j in ti.static(range(NUM_STEPS)):
+                a = x[j % 64] * (j % 7 + 1)
+                b = x[j % 64] * (j % 7 + 1)
+                unused = a * b + j
+                s = s * 0.5 + (a + b) * 0.25
+            y[None] = s
+
+    t = time.perf_counter()
+    huge()
+    ti.sync()
+    elapsed_ms = (time.perf_counter() - t) * 1000
+    ti.stat_write('compile_huge_kernel_ms', elapsed_ms)
+    ti.reset()
+    return elapsed_ms
@@ -0,0 +1,53 @@
+import time
+
+import taichi as ti
+
+# A 27-point stencil gathered from a sparse grid on CPU, with and without the
+# neighborhoods of its blocks cached in block-local storage.
+N = 256
+BLOCK_SIZE = 8
+NUM_STEPS = 20
+
+
+def run(use_bls):
+    ti.init(arch=ti.cpu)
+    x = ti.field(ti.f32)
+    y = ti.field(ti.f32)
+    for f in [x, y]:
+        ti.root.pointer(ti.ijk, N // BLOCK_SIZE).dense(ti.ijk,
+                                                       BLOCK_SIZE).place(f)
+
+    @ti.kernel
+    def populate():
+        for I in ti.grouped(ti.ndrange((1, N - 1), (1, N - 1), (1, N - 1))):
+            x[I] = I.sum() % 7
+
+    neighborhood = [(-1, 2)] * 3
+
+    @ti.kernel
+    def stencil():
+        if ti.static(use_bls):
+            ti.block_local(x)
+        for I in ti.grouped(x):
+            s = 0.0
+            for offset in ti.static(ti.grouped(ti.ndrange(*neighborhood))):
+                s += x[I + offset]
+            y[I] = s / 27
+
+    populate()
+    stencil()
+    ti.sync()
+    t = time.perf_counter()
+    for _ in range(NUM_STEPS):
+        stencil()
+    ti.sync()
+    ms = (time.perf_counter() - t) * 1000 / NUM_STEPS
+    ti.stat_write('bls_ms' if use_bls else 'no_bls_ms', ms)
+    ti.reset()
+    return ms
+
+
+def benchmark_cpu_bls_stencil():
+    no_bls_ms = run(False)
+    bls_ms = run(True)
+    return no_bls_ms / bls_ms
@@ -0,0 +1,31 @@
+import taichi as ti
+
+# Tiny kernels, so that the time is dominated by handing the offloaded tasks
+# to the CPU thread pool rather than by the loop bodies.
+N = 1024
+
+
+def launch_tiny_kernel():
+    a = ti.field(dtype=ti.i32, shape=N)
+
+    @ti.kernel
+    def tiny():
+        for i in a:
+            a[i] += 1
+
+    return ti.benchmark(tiny, repeat=10000)
+
+
+@ti.test(arch=ti.cpu, cpu_work_stealing=False)
+def benchmark_tiny_kernel_thread_pool():
+    return launch_tiny_kernel()
+
+
+@ti.test(arch=ti.cpu, cpu_work_stealing=True)
+def benchmark_tiny_kernel_work_stealing():
+    return launch_tiny_kernel()
+
+
+@ti.test(arch=ti.cpu, cpu_work_stealing=True, cpu_numa_aware=True)
+def benchmark_tiny_kernel_work_stealing_numa():
+    return launch_tiny_kernel()
@@ -0,0 +1,57 @@
+import time
+
+import taichi as ti
+
+# The memory_bound.py kernels on a range-for and a dense struct-for, with the
+# CPU loop bodies called per index and looped over per block.
+N = 1024**2 * 64
+NUM_STEPS = 20
+
+
+def run(vectorize, stat_prefix):
+    ti.init(arch=ti.cpu, cpu_loop_vectorize=vectorize)
+    x = ti.field(ti.f32, shape=N)
+    y = ti.field(ti.f32, shape=N)
+    z = ti.field(ti.f32, shape=N)
+    idx = ti.field(ti.i32, shape=N)
+
+    @ti.kernel
+    def fill():
+        for i in range(N):
+            x[i] = 1.0
+
+    @ti.kernel
+    def saxpy(a: ti.f32):
+        for i in x:
+            z[i] = a * x[i] + y[i]
+
+    @ti.kernel
+    def gather():
+        for i in range(N):
+            z[i] = x[idx[i]]
+
+    @ti.kernel
+    def init_idx():
+        for i in idx:
+            idx[i] = (i * 7919) % N
+
+    init_idx()
+    results = {}
+    for name, launch in [('fill', fill), ('saxpy', lambda: saxpy(2.0)),
+                         ('gather', gather)]:
+        launch()
+        ti.sync()
+        t = time.perf_counter()
+        for _ in range(NUM_STEPS):
+            launch()
+        ti.sync()
+        ms = (time.perf_counter() - t) * 1000 / NUM_STEPS
+        ti.stat_write(f'{stat_prefix}_{name}_ms', ms)
+        results[name] = ms
+    ti.reset()
+    return results['saxpy']
+
+
+def benchmark_cpu_loop_vectorize():
+    run(False, 'per_index')
+    return run(True, 'block')
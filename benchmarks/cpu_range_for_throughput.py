@@ -0,0 +1,51 @@
+import time
+
+import numpy as np
+
+import taichi as ti
+
+# Elementwise range-fors over large fields, whose throughput is bounded by the
+# memory bandwidth that a memcpy of the same size reaches.
+N = 1024**2 * 64
+NUM_STEPS = 20
+
+
+def measure(launch, num_bytes, sync=ti.sync):
+    launch()
+    sync()
+    t = time.perf_counter()
+    for _ in range(NUM_STEPS):
+        launch()
+    sync()
+    return num_bytes * NUM_STEPS / (time.perf_counter() - t) / 1e9
+
+
+def benchmark_cpu_range_for_throughput():
+    src = np.ones(N, dtype=np.float32)
+    dst = np.empty_like(src)
+    memcpy_gbps = measure(lambda: np.copyto(dst, src),
+                          2 * src.nbytes,
+                          sync=lambda: None)
+
+    ti.init(arch=ti.cpu, cpu_loop_vectorize=True, cpu_range_for_tasks=True)
+    ti.stat_write('memcpy_gbps', memcpy_gbps)
+    a = ti.field(ti.f32, shape=N)
+    b = ti.field(ti.f32, shape=N)
+
+    @ti.kernel
+    def fill():
+        for i in range(N):
+            a[i] = 1.0
+
+    @ti.kernel
+    def copy():
+        for i in range(N):
+            b[i] = a[i]
+
+    fill_gbps = measure(fill, src.nbytes)
+    copy_gbps = measure(copy, 2 * src.nbytes)
+    ti.stat_write('fill_gbps', fill_gbps)
+    ti.stat_write('copy_gbps', copy_gbps)
+    ti.stat_write('copy_to_memcpy_ratio', copy_gbps / memcpy_gbps)
+    ti.reset()
+    return copy_gbps / memcpy_gbps
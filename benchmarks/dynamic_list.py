@@ -0,0 +1,31 @@
+import taichi as ti
+
+# Appends to and random reads from long dynamic lists, e.g. per-cell particle
+# lists in P2G.
+
+
+@ti.archs_support_sparse
+def benchmark_long_list_append_and_read():
+    n = 256
+    max_len = 1 << 16
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32, shape=())
+
+    ti.root.dense(ti.i, n).dynamic(ti.j, max_len, chunk_size=64).place(x)
+
+    @ti.kernel
+    def append():
+        for i, k in ti.ndrange(n, max_len // 2):
+            ti.append(x.parent(), i, k)
+
+    @ti.kernel
+    def read():
+        for i, k in ti.ndrange(n, max_len // 2):
+            s[None] += x[i, (k * 40503) % (max_len // 2)]
+
+    def task():
+        x.parent().deactivate_all()
+        append()
+        read()
+
+    return ti.benchmark(task, repeat=10)
@@ -122,3 +122,19 @@ def benchmark_root_listgen():
             a[i, j] = 2.0
 
     return ti.benchmark(fill, repeat=800)
+
+
+@ti.test(arch=ti.cpu,
+         cpu_range_for_tasks=True,
+         cpu_nontemporal_store=True)
+def benchmark_flat_range_nontemporal_store():
+    # benchmark_flat_range with non-temporal stores
+    N = 4096
+    a = ti.field(dtype=ti.f32, shape=(N, N))
+
+    @ti.kernel
+    def fill():
+        for i, j in ti.ndrange(N, N):
+            a[i, j] = 2.0
+
+    return ti.benchmark(fill, repeat=700)
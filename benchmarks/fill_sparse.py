@@ -40,3 +40,61 @@ def benchmark_nested_struct_fill_and_clear():
         clear()
 
     return ti.benchmark(task, repeat=30)
+
+
+@ti.test(arch=ti.cpu,
+         cpu_range_for_tasks=True,
+         cpu_nontemporal_store=True)
+def benchmark_nested_struct_fill_and_clear_nontemporal_store():
+    # benchmark_nested_struct_fill_and_clear with non-temporal stores
+    a = ti.field(dtype=ti.f32)
+    N = 512
+
+    ti.root.pointer(ti.ij, [N, N]).dense(ti.ij, [8, 8]).place(a)
+
+    @ti.kernel
+    def fill():
+        for i, j in ti.ndrange(N * 8, N * 8):
+            a[i, j] = 2.0
+
+    @ti.kernel
+    def clear():
+        for i, j in a.parent():
+            ti.deactivate(a.parent().parent(), [i, j])
+
+    def task():
+        fill()
+        clear()
+
+    return ti.benchmark(task, repeat=30)
+
+
+def scale_nested_struct():
+    a = ti.field(dtype=ti.f32)
+    N = 512
+
+    ti.root.pointer(ti.ij, [N, N]).dense(ti.ij, [8, 8]).place(a)
+
+    @ti.kernel
+    def fill():
+        for i, j in ti.ndrange(N * 8, N * 8):
+            a[i, j] = 2.0
+
+    @ti.kernel
+    def scale():
+        for i, j in a:
+            a[i, j] *= 0.5
+
+    fill()
+
+    return ti.benchmark(scale)
+
+
+@ti.test(arch=ti.cpu, cpu_struct_for_prefetch=True)
+def benchmark_nested_struct_scale():
+    return scale_nested_struct()
+
+
+@ti.test(arch=ti.cpu, cpu_struct_for_prefetch=False)
+def benchmark_nested_struct_scale_no_prefetch():
+    return scale_nested_struct()
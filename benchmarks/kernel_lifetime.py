@@ -0,0 +1,47 @@
+import os
+
+import psutil
+
+import taichi as ti
+
+# Creates, launches and deletes kernels, as a long-running service that
+# generates kernels from user templates would. Deleting a kernel releases its
+# JIT module, so the RSS must level off instead of growing with the number of
+# cycles.
+NUM_CYCLES = 100000
+REPORT_EVERY = 10000
+
+
+def get_rss_mb():
+    return psutil.Process(os.getpid()).memory_info().rss / (1 << 20)
+
+
+@ti.test(arch=ti.cpu)
+def benchmark_kernel_create_destroy_soak():
+    x = ti.field(ti.f32, shape=16)
+
+    def cycle(k):
+        @ti.kernel
+        def scale():
+            for i in x:
+                x[i] = x[i] * 0.5 + k
+
+        scale()
+        ti.delete_kernel(scale)
+
+    # Warm up the JIT session and the LLVM contexts
+    for k in range(100):
+        cycle(k)
+    rss_start = get_rss_mb()
+    rss = rss_start
+    for k in range(NUM_CYCLES):
+        cycle(k)
+        if (k + 1) % REPORT_EVERY == 0:
+            rss = get_rss_mb()
+            print(f'{k + 1} cycles: RSS {rss:.1f} MB '
+                  f'(+{rss - rss_start:.1f} MB)')
+    rss_growth = rss - rss_start
+    ti.stat_write('kernel_soak_rss_growth_mb', rss_growth)
+    ti.stat_write('kernel_soak_rss_growth_kb_per_kernel',
+                  rss_growth * 1024 / NUM_CYCLES)
+    return rss_growth
@@ -0,0 +1,42 @@
+import os
+
+import psutil
+
+import taichi as ti
+
+# Repeatedly creates and destroys ndarrays and SNode trees, as a long-running
+# service would. Freed memory goes back to the host memory pool and its pages
+# to the OS, so the RSS must not keep growing with the number of rounds.
+N = 1 << 22
+
+
+def get_rss_mb():
+    return psutil.Process(os.getpid()).memory_info().rss / (1 << 20)
+
+
+@ti.test(arch=ti.cpu)
+def benchmark_ndarray_and_snode_tree_churn():
+    @ti.kernel
+    def touch(x: ti.any_arr()):
+        for i in x:
+            x[i] = i
+
+    def churn():
+        # Different sizes so that blocks are split and merged in the pool
+        for k in range(1, 5):
+            x = ti.ndarray(ti.f32, N // k)
+            touch(x)
+            del x
+        fb = ti.FieldsBuilder()
+        a = ti.field(ti.f32)
+        fb.dense(ti.i, N).place(a)
+        fb.finalize().destroy()
+
+    churn()
+    rss_before = get_rss_mb()
+    result = ti.benchmark(churn, repeat=20)
+    rss_growth = get_rss_mb() - rss_before
+    ti.stat_write('rss_growth_mb', rss_growth)
+    # A single round touches about 50 MB
+    assert rss_growth < 64, f'RSS grew by {rss_growth:.1f} MB'
+    return result
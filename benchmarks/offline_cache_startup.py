@@ -0,0 +1,41 @@
+import tempfile
+import time
+
+import taichi as ti
+
+# Startup of a program with many kernels: the time to compile and launch each
+# of them once. The second run loads every kernel from the offline cache
+# filled by the first run.
+NUM_KERNELS = 100
+
+
+def compile_kernels(cache_path, stat_key):
+    ti.init(arch=ti.cpu,
+            offline_cache=True,
+            offline_cache_file_path=cache_path)
+    x = ti.field(ti.f32, shape=1024)
+
+    def make_kernel(k):
+        # k is a compile-time constant, so that every kernel is different.
+        @ti.kernel
+        def step():
+            for i in x:
+                x[i] = ti.sin(x[i]) * k + ti.sqrt(ti.abs(x[i]) + k)
+
+        return step
+
+    kernels = [make_kernel(k) for k in range(NUM_KERNELS)]
+    t = time.perf_counter()
+    for step in kernels:
+        step()
+    ti.sync()
+    elapsed_ms = (time.perf_counter() - t) * 1000
+    ti.stat_write(stat_key, elapsed_ms)
+    ti.reset()
+    return elapsed_ms
+
+
+def benchmark_startup_with_offline_cache():
+    with tempfile.TemporaryDirectory() as cache_path:
+        compile_kernels(cache_path, 'first_run_ms')
+        return compile_kernels(cache_path, 'second_run_ms')
@@ -0,0 +1,33 @@
+import multiprocessing
+import time
+
+import taichi as ti
+
+# Compile time of one kernel with many offloaded tasks, compiled on one
+# thread and on all the cores.
+NUM_OFFLOADS = 24
+
+
+def compile_large_kernel(num_compile_threads, stat_key):
+    ti.init(arch=ti.cpu, num_compile_threads=num_compile_threads)
+    x = ti.field(ti.f32, shape=(NUM_OFFLOADS, 1024))
+
+    @ti.kernel
+    def large():
+        for k in ti.static(range(NUM_OFFLOADS)):
+            for i in range(1024):
+                x[k, i] = ti.sin(x[k, i]) * k + ti.sqrt(ti.abs(x[k, i]) + k)
+
+    t = time.perf_counter()
+    large()
+    ti.sync()
+    elapsed_ms = (time.perf_counter() - t) * 1000
+    ti.stat_write(stat_key, elapsed_ms)
+    ti.reset()
+    return elapsed_ms
+
+
+def benchmark_parallel_compile():
+    compile_large_kernel(1, 'serial_compile_ms')
+    return compile_large_kernel(multiprocessing.cpu_count(),
+                                'parallel_compile_ms')
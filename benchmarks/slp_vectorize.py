@@ -0,0 +1,53 @@
+import time
+
+import taichi as ti
+
+# 3x3 SVDs and polar decompositions, the scalarized matrix math of FEM and MPM
+# kernels, with and without the SLP vectorizer.
+N = 1 << 16
+NUM_STEPS = 20
+
+
+def run(slp, stat_prefix):
+    ti.init(arch=ti.cpu, slp_vectorize=slp)
+    F = ti.Matrix.field(3, 3, ti.f32, shape=N)
+    R = ti.Matrix.field(3, 3, ti.f32, shape=N)
+
+    @ti.kernel
+    def init():
+        for i in F:
+            F[i] = ti.Matrix.identity(ti.f32, 3)
+            for j, k in ti.static(ti.ndrange(3, 3)):
+                F[i][j, k] += ti.random() * 0.1
+
+    @ti.kernel
+    def svd():
+        for i in F:
+            U, sig, V = ti.svd(F[i])
+            R[i] = U @ V.transpose() + sig
+
+    @ti.kernel
+    def polar():
+        for i in F:
+            r, s = ti.polar_decompose(F[i])
+            R[i] = r @ s
+
+    init()
+    results = {}
+    for name, kernel in [('svd', svd), ('polar', polar)]:
+        kernel()
+        ti.sync()
+        t = time.perf_counter()
+        for _ in range(NUM_STEPS):
+            kernel()
+        ti.sync()
+        ms = (time.perf_counter() - t) * 1000 / NUM_STEPS
+        ti.stat_write(f'{stat_prefix}_{name}_ms', ms)
+        results[name] = ms
+    ti.reset()
+    return results['svd']
+
+
+def benchmark_slp_vectorize():
+    run(False, 'scalar')
+    return run(True, 'slp')
@@ -0,0 +1,39 @@
+import taichi as ti
+
+# Latency of rebuilding a field layout, as done when a simulation domain is
+# resized: the old SNode tree is destroyed and a slightly different one is
+# created in its place.
+N = 1 << 22
+
+
+def rebuild():
+    state = {'round': 0, 'tree': None}
+
+    def task():
+        if state['tree'] is not None:
+            state['tree'].destroy()
+        # Alternate between close domain sizes
+        n = N + (state['round'] % 4) * 4096
+        state['round'] += 1
+        fb = ti.FieldsBuilder()
+        a = ti.field(ti.f32)
+        fb.dense(ti.i, n).place(a)
+        state['tree'] = fb.finalize()
+
+    return ti.benchmark(task, repeat=50)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def benchmark_rebuild():
+    return rebuild()
+
+
+# On CPUs the roots go back to the memory pool, which zero-fills them itself
+@ti.test(arch=ti.cuda, snode_tree_buffer_prezero=True)
+def benchmark_rebuild_prezero():
+    return rebuild()
+
+
+@ti.test(arch=ti.cuda, snode_tree_buffer_rezero=False)
+def benchmark_rebuild_no_rezero():
+    return rebuild()
@@ -0,0 +1,40 @@
+import taichi as ti
+
+# Activation throughput of pointer cells from all CPU threads. Each round
+# deactivates everything, so allocation is served from recycled nodes as well
+# as fresh ones.
+N = 1024
+
+
+def activate_and_clear():
+    a = ti.field(dtype=ti.f32)
+
+    blk = ti.root.pointer(ti.ij, [N, N])
+    blk.place(a)
+
+    @ti.kernel
+    def activate():
+        for i, j in ti.ndrange(N, N):
+            if (i + j) % 2 == 0:
+                a[i, j] = 1.0
+
+    def task():
+        activate()
+        blk.deactivate_all()
+
+    return ti.benchmark(task, repeat=10)
+
+
+@ti.test(arch=ti.cpu, cpu_max_num_threads=1)
+def benchmark_activate_1_thread():
+    return activate_and_clear()
+
+
+@ti.test(arch=ti.cpu, cpu_max_num_threads=4)
+def benchmark_activate_4_threads():
+    return activate_and_clear()
+
+
+@ti.test(arch=ti.cpu)
+def benchmark_activate_all_threads():
+    return activate_and_clear()
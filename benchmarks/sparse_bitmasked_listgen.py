@@ -0,0 +1,63 @@
+import taichi as ti
+
+# Struct-fors over a field with wide bitmasked nodes, sweeping the fraction of
+# active cells. Inactive cells are skipped a mask word at a time, both in
+# listgen and in the struct-for over the bitmasked leaves.
+N = 1024 * 1024
+
+
+# Total time (ms) of the recorded listgen tasks
+def listgen_time():
+    prog = ti.lang.impl.get_runtime().prog
+    prog.sync_kernel_profiler()
+    return sum(r.kernel_time for r in prog.get_kernel_profiler_records()
+               if 'listgen' in r.name)
+
+
+def struct_for_with_occupancy(occupancy):
+    x = ti.field(ti.f32)
+    ti.root.pointer(ti.i, N // 4096 // 16).bitmasked(ti.i, 4096).bitmasked(
+        ti.i, 16).place(x)
+
+    stride = int(1 / occupancy)
+
+    @ti.kernel
+    def activate():
+        for i in range(N // stride):
+            x[i * stride] = 1.0
+
+    @ti.kernel
+    def inc():
+        for i in x:
+            x[i] += 1.0
+
+    activate()
+    # ti.benchmark clears the profiler records after warming up
+    result = ti.benchmark(inc, repeat=20)
+    ti.stat_write('listgen_time_ms', listgen_time() / 20)
+    return result
+
+
+@ti.test(arch=ti.cpu, kernel_profiler=True)
+def benchmark_occupancy_0_01_percent():
+    return struct_for_with_occupancy(0.0001)
+
+
+@ti.test(arch=ti.cpu, kernel_profiler=True)
+def benchmark_occupancy_0_1_percent():
+    return struct_for_with_occupancy(0.001)
+
+
+@ti.test(arch=ti.cpu, kernel_profiler=True)
+def benchmark_occupancy_1_percent():
+    return struct_for_with_occupancy(0.01)
+
+
+@ti.test(arch=ti.cpu, kernel_profiler=True)
+def benchmark_occupancy_10_percent():
+    return struct_for_with_occupancy(0.1)
+
+
+@ti.test(arch=ti.cpu, kernel_profiler=True)
+def benchmark_occupancy_50_percent():
+    return struct_for_with_occupancy(0.5)
@@ -0,0 +1,30 @@
+import taichi as ti
+
+# Deactivate/reactivate throughput of pointer blocks, e.g. an adaptive grid
+# clearing and refilling most of its blocks every frame.
+
+
+@ti.archs_support_sparse
+def benchmark_deactivate_reactivate():
+    a = ti.field(dtype=ti.f32)
+    N = 256
+
+    blk = ti.root.pointer(ti.ij, [N, N])
+    blk.dense(ti.ij, [4, 4]).place(a)
+
+    @ti.kernel
+    def activate():
+        for i, j in ti.ndrange(N, N):
+            a[i * 4, j * 4] = 1.0
+
+    @ti.kernel
+    def deactivate():
+        for i, j in blk:
+            ti.deactivate(blk, [i, j])
+
+    def task():
+        activate()
+        deactivate()
+
+    activate()
+    return ti.benchmark(task, repeat=30)
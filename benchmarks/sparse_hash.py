@@ -0,0 +1,41 @@
+import taichi as ti
+
+# Hash and pointer SNodes at the same occupancy: 1/64 of the blocks active.
+N = 1024
+num_active = N * N // 64
+
+
+def fill_and_sum(a):
+    @ti.kernel
+    def fill():
+        for t in range(num_active):
+            i = t * 64 // N
+            j = t * 64 % N
+            a[i * 8, j * 8] = 1.0
+
+    @ti.kernel
+    def reduce() -> ti.f32:
+        r = 0.0
+        for i, j in a:
+            r += a[i, j]
+        return r
+
+    def task():
+        fill()
+        reduce()
+
+    return task
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def benchmark_pointer_fill_and_sum():
+    a = ti.field(dtype=ti.f32)
+    ti.root.pointer(ti.ij, [N, N]).dense(ti.ij, [8, 8]).place(a)
+    return ti.benchmark(fill_and_sum(a), repeat=10)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def benchmark_hash_fill_and_sum():
+    a = ti.field(dtype=ti.f32)
+    ti.root.hash(ti.ij, [N, N]).dense(ti.ij, [8, 8]).place(a)
+    return ti.benchmark(fill_and_sum(a), repeat=10)
@@ -0,0 +1,71 @@
+import taichi as ti
+
+# Struct-fors over a large sparse field whose structure barely changes between
+# steps: only a few leaf blocks are toggled every step, or none at all. Element
+# lists whose structure has not changed are not regenerated, and on CPUs the
+# list of the leaf blocks is updated from the toggled blocks, so listgen_time
+# grows with the churn instead of the number of blocks.
+N = 2048
+
+
+# Total time (ms) of the recorded listgen tasks
+def listgen_time():
+    prog = ti.lang.impl.get_runtime().prog
+    prog.sync_kernel_profiler()
+    return sum(r.kernel_time for r in prog.get_kernel_profiler_records()
+               if 'listgen' in r.name)
+
+
+def struct_for_with_churn(num_toggled_blocks):
+    x = ti.field(ti.f32)
+    ti.root.pointer(ti.ij, 32).pointer(ti.ij, 8).dense(ti.ij, 8).place(x)
+
+    @ti.kernel
+    def activate():
+        for i, j in ti.ndrange(N, N):
+            if (i // 8 + j // 8) % 3 == 0:
+                x[i, j] = 1.0
+
+    @ti.kernel
+    def toggle(step: ti.i32):
+        for k in range(num_toggled_blocks):
+            i = (k * 97 + step * 13) % (N // 8) * 8
+            j = (k * 31) % (N // 8) * 8
+            if ti.is_active(x.parent(), [i // 8, j // 8]):
+                ti.deactivate(x.parent(), [i // 8, j // 8])
+            else:
+                x[i, j] = 1.0
+
+    @ti.kernel
+    def inc():
+        for i, j in x:
+            x[i, j] += 1.0
+
+    activate()
+    state = {'step': 0}
+
+    def step():
+        if num_toggled_blocks:
+            toggle(state['step'])
+        state['step'] += 1
+        inc()
+
+    result = ti.benchmark(step, repeat=20)
+    ti.stat_write('listgen_time_ms', listgen_time() / 20)
+    return result
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], kernel_profiler=True)
+def benchmark_listgen_static_structure():
+    return struct_for_with_churn(0)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], kernel_profiler=True)
+def benchmark_listgen_1_percent_churn():
+    # 1% of the 256x256 leaf blocks
+    return struct_for_with_churn(655)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], kernel_profiler=True)
+def benchmark_listgen_10_percent_churn():
+    return struct_for_with_churn(6554)
@@ -0,0 +1,48 @@
+import taichi as ti
+
+# Element list generation of a deep sparse hierarchy. Besides the end-to-end
+# time, the time spent in listgen tasks alone is taken from the kernel
+# profiler.
+N = 2048
+
+
+# Total time (ms) of the recorded listgen tasks
+def listgen_time():
+    prog = ti.lang.impl.get_runtime().prog
+    prog.sync_kernel_profiler()
+    return sum(r.kernel_time for r in prog.get_kernel_profiler_records()
+               if 'listgen' in r.name)
+
+
+def struct_for_deep_hierarchy():
+    x = ti.field(ti.f32)
+    ti.root.pointer(ti.ij, 32).pointer(ti.ij, 8).pointer(ti.ij,
+                                                         4).dense(ti.ij,
+                                                                  2).place(x)
+
+    @ti.kernel
+    def activate():
+        for i, j in ti.ndrange(N, N):
+            if (i // 8 + j // 8) % 3 == 0:
+                x[i, j] = 1.0
+
+    @ti.kernel
+    def inc():
+        for i, j in x:
+            x[i, j] += 1.0
+
+    activate()
+    # ti.benchmark clears the profiler records after warming up
+    result = ti.benchmark(inc, repeat=20)
+    ti.stat_write('listgen_time_ms', listgen_time() / 20)
+    return result
+
+
+@ti.test(arch=ti.cpu, cpu_max_num_threads=1, kernel_profiler=True)
+def benchmark_listgen_1_thread():
+    return struct_for_deep_hierarchy()
+
+
+@ti.test(arch=ti.cpu, kernel_profiler=True)
+def benchmark_listgen_all_threads():
+    return struct_for_deep_hierarchy()
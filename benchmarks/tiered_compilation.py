@@ -0,0 +1,45 @@
+import time
+
+import taichi as ti
+
+# Tiered compilation on a notebook-like workload: the startup of many kernels
+# that run once, and a steady-state loop of one hot kernel, with and without
+# the unoptimized first tier.
+NUM_KERNELS = 50
+NUM_STEPS = 2000
+
+
+def run(tiered, stat_prefix):
+    ti.init(arch=ti.cpu, tiered_compilation=tiered)
+    x = ti.field(ti.f32, shape=1 << 16)
+
+    def make_kernel(k):
+        @ti.kernel
+        def step():
+            for i in x:
+                x[i] = ti.sin(x[i]) * k + ti.sqrt(ti.abs(x[i]) + k)
+
+        return step
+
+    kernels = [make_kernel(k) for k in range(NUM_KERNELS)]
+    t = time.perf_counter()
+    for step in kernels:
+        step()
+    ti.sync()
+    startup_ms = (time.perf_counter() - t) * 1000
+    ti.stat_write(f'{stat_prefix}_startup_ms', startup_ms)
+
+    hot = kernels[0]
+    t = time.perf_counter()
+    for _ in range(NUM_STEPS):
+        hot()
+    ti.sync()
+    steady_ms = (time.perf_counter() - t) * 1000
+    ti.stat_write(f'{stat_prefix}_steady_state_ms', steady_ms)
+    ti.reset()
+    return startup_ms
+
+
+def benchmark_tiered_compilation():
+    run(False, 'optimized')
+    return run(True, 'tiered')
@@ -7,6 +7,7 @@ file(GLOB_RECURSE TAICHI_EXAMPLES_SOURCE
 "cpp_examples/run_snode.cpp"
 "cpp_examples/autograd.cpp"
 "cpp_examples/aot_save.cpp"
+"cpp_examples/aot_load_cpu.cpp"
 )
 
 include_directories(
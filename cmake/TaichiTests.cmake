@@ -17,6 +17,7 @@ file(GLOB_RECURSE TAICHI_TESTS_SOURCE
         "tests/cpp/ir/*.cpp"
         "tests/cpp/program/*.cpp"
         "tests/cpp/struct/*.cpp"
+        "tests/cpp/system/*.cpp"
         "tests/cpp/transforms/*.cpp")
 
 include_directories(
@@ -0,0 +1,22 @@
+#include "taichi/backends/cpu/aot_module_loader.h"
+
+void aot_load_cpu(const std::string &module_dir) {
+  using namespace taichi;
+  using namespace lang;
+  // Runs the kernels that aot_save() compiled for x64, without a Program.
+  cpu::AotModuleLoader loader(module_dir);
+
+  RuntimeContext ctx{};
+  loader.launch_kernel("init", ctx);
+  loader.launch_kernel("ret", ctx);
+  std::cout << "sum = "
+            << loader.fetch_result<int32>(taichi_result_buffer_ret_value_id)
+            << std::endl;
+
+  const auto *place = loader.get_field("place");
+  auto *data = (uint8 *)loader.get_field_ptr("place");
+  for (int i = 0; i < place->shape[0]; i++) {
+    std::cout << *(int32 *)(data + i * place->element_stride) << " ";
+  }
+  std::cout << std::endl;
+}
@@ -4,11 +4,14 @@
 
 void run_snode();
 void autograd();
-void aot_save();
+void aot_save(taichi::lang::Arch arch, const std::string &output_dir);
+void aot_load_cpu(const std::string &module_dir);
 
 int main() {
   run_snode();
   autograd();
-  aot_save();
+  aot_save(taichi::lang::Arch::vulkan, ".");
+  aot_save(taichi::lang::Arch::x64, "aot_cpu");
+  aot_load_cpu("aot_cpu");
   return 0;
 }
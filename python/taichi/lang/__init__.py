@@ -16,7 +16,7 @@ import taichi.lang.linalg_impl
 import taichi.lang.meta
 from taichi.core.util import locale_encode
 from taichi.core.util import ti_core as _ti_core
-from taichi.lang import impl
+from taichi.lang import impl, kernel_impl
 from taichi.lang._ndarray import ScalarNdarray
 from taichi.lang.any_array import AnyArray, AnyArrayAccess
 from taichi.lang.enums import Layout
@@ -333,6 +333,121 @@ def print_memory_profile_info():
     impl.get_runtime().prog.print_memory_profiler_info()
 
 
+def precompile(*kernels):
+    """Compiles kernels on background threads before they are first called.
+
+    A launch only waits for the kernel it runs, so the compilation overlaps
+    with the Python code in between, e.g. loading data. Only the CPU backends
+    compile in the background; the others compile the kernels right away.
+    The kernels are compiled on ``num_compile_threads`` threads, see
+    :func:`~taichi.lang.init`.
+
+    Args:
+        *kernels: Each one is either a function decorated by ``@ti.kernel``,
+            or a tuple of such a function and example arguments, which pick
+            the instantiation to compile like a call with them would.
+
+    Example::
+
+        >>> ti.precompile(substep, (fill, x, 1.0))
+        >>> data = load_data()
+        >>> fill(x, 1.0)  # only waits for `fill` if it is still compiling
+    """
+    runtime = impl.get_runtime()
+    runtime.materialize()
+    kernels_cpp = []
+    for kernel_fn in kernels:
+        args = ()
+        if isinstance(kernel_fn, tuple):
+            kernel_fn, *args = kernel_fn
+        kernel = kernel_fn._primal
+        assert isinstance(kernel, kernel_impl.Kernel)
+        instance_id, _ = kernel.mapper.lookup(args)
+        if (kernel.func, instance_id) in kernel.compiled_functions:
+            # Compiled or being compiled already
+            continue
+        kernel.ensure_compiled(*args)
+        kernels_cpp.append(kernel.kernel_cpp)
+    runtime.prog.precompile(kernels_cpp)
+
+
+def delete_kernel(kernel_fn):
+    """Deletes the compiled instances of a kernel, releasing their code.
+
+    Long-running programs that keep generating kernels can call this on the
+    kernels they no longer need. The kernel is compiled again if it is called
+    later. See also the ``max_compiled_kernels`` option of :func:`init`.
+
+    Args:
+        kernel_fn (Function): A function decorated by ``@ti.kernel``.
+    """
+    kernel_fn._primal.delete()
+    kernel_fn._adjoint.delete()
+
+
+def query_precompile_info():
+    """Waits for :func:`precompile` and reports where the time went.
+
+    Returns:
+        List[dict]: For each kernel passed to :func:`precompile`, its
+        ``name``, the seconds it waited for a worker (``queue_wait``), the
+        seconds it took to compile (``compile_time``), and the seconds its
+        first launch blocked on the compilation (``launch_wait``).
+    """
+    return [{
+        'name': name,
+        'queue_wait': timing.queue_wait,
+        'compile_time': timing.compile_time,
+        'launch_wait': timing.launch_wait
+    } for name, timing in impl.get_runtime().prog.query_precompile_info()]
+
+
+def query_compile_profile():
+    """Reports the passes that lowered each kernel, in the order they ran.
+
+    To enable this profiler, set ``compile_profiler=True`` in ``ti.init()``.
+    With ``timeline=True`` as well, :func:`timeline_save` also shows the
+    passes in a Chrome trace.
+
+    Returns:
+        List[dict]: For each pass, the ``kernel_name``, the ``pass_name``, the
+        seconds it took (``time``), and the numbers of IR statements before
+        and after it (``num_statements_before``, ``num_statements_after``).
+        The passes that ``full_simplify`` runs are named
+        ``full_simplify/<pass>``, and ``iteration`` is the fixed-point
+        iteration that ran them, starting from 1. It is 0 for the other
+        passes.
+
+    Example::
+
+        >>> ti.init(ti.cpu, compile_profiler=True)
+        >>> substep()
+        >>> slowest = max(ti.query_compile_profile(), key=lambda r: r['time'])
+    """
+    return [{
+        'kernel_name': r.kernel_name,
+        'pass_name': r.pass_name,
+        'time': r.time,
+        'num_statements_before': r.num_statements_before,
+        'num_statements_after': r.num_statements_after,
+        'iteration': r.iteration
+    } for r in impl.get_runtime().prog.get_compile_profiler_records()]
+
+
+def clear_compile_profile():
+    """Clears the records of :func:`query_compile_profile`."""
+    impl.get_runtime().prog.compile_profiler_clear()
+
+
+def save_compile_profile(filename):
+    """Saves the records of :func:`query_compile_profile` as a JSON list.
+
+    Args:
+        filename (str): The path of the JSON file.
+    """
+    impl.get_runtime().prog.compile_profiler_save(filename)
+
+
 extension = _ti_core.Extension
 
 
@@ -521,6 +636,7 @@ def init(arch=None,
             https://github.com/taichi-dev/taichi/blob/master/taichi/program/compile_config.h.
 
             * ``cpu_max_num_threads`` (int): Sets the number of threads used by the CPU thread pool.
+            * ``num_compile_threads`` (int): Sets the number of threads that compile the offloaded tasks of a CPU kernel in parallel, and that ``ti.precompile`` uses. Defaults to 1, which compiles on the calling thread.
             * ``debug`` (bool): Enables the debug mode, under which Taichi does a few more things like boundary checks.
             * ``print_ir`` (bool): Prints the CHI IR of the Taichi kernels.
             * ``packed`` (bool): Enables the packed memory layout. See https://docs.taichi.graphics/lang/articles/advanced/layout.
@@ -1,4 +1,5 @@
 import numbers
+import weakref
 from types import FunctionType, MethodType
 from typing import Iterable
 
@@ -310,7 +311,8 @@ class PyTaichi:
         self.default_ip = i32
         self.target_tape = None
         self.grad_replaced = False
-        self.kernels = kernels or []
+        # Only the kernels still in use are reset with the runtime.
+        self.kernels = kernels or weakref.WeakSet()
         self._signal_handler_registry = None
 
     def get_num_compiled_functions(self):
@@ -359,7 +359,7 @@ class Kernel:
                 self.template_slot_locations.append(i)
         self.mapper = TaichiCallableTemplateMapper(
             self.argument_annotations, self.template_slot_locations)
-        impl.get_runtime().kernels.append(self)
+        impl.get_runtime().kernels.add(self)
         self.reset()
         self.kernel_cpp = None
 
@@ -369,6 +369,20 @@ class Kernel:
             self.compiled_functions = self.runtime.compiled_grad_functions
         else:
             self.compiled_functions = self.runtime.compiled_functions
+        # The C++ kernels of the compiled instances, keyed like
+        # compiled_functions.
+        self.kernels_cpp = {}
+
+    def delete(self):
+        """Deletes the compiled instances and releases their machine code.
+
+        The kernel is compiled again if it is called later.
+        """
+        for key, kernel_cpp in self.kernels_cpp.items():
+            del self.compiled_functions[key]
+            self.runtime.prog.delete_kernel(kernel_cpp)
+        self.kernels_cpp = {}
+        self.kernel_cpp = None
 
     def extract_arguments(self):
         sig = inspect.signature(self.func)
@@ -464,6 +478,7 @@ class Kernel:
                                                kernel_name, self.is_grad)
 
         self.kernel_cpp = taichi_kernel
+        self.kernels_cpp[key] = taichi_kernel
 
         assert key not in self.compiled_functions
         self.compiled_functions[key] = self.get_function_body(taichi_kernel)
@@ -57,15 +57,26 @@ class SNode:
             self.ptr.pointer(axes, dimensions,
                              impl.current_cfg().packed))
 
-    @staticmethod
-    def hash(axes, dimensions):
-        # original code is #def hash(self,axes, dimensions) without #@staticmethod   before fix pylint R0201
-        """Not supported."""
-        raise RuntimeError('hash not yet supported')
-        # if isinstance(dimensions, int):
-        #     dimensions = [dimensions] * len(axes)
-        # return SNode(self.ptr.hash(axes, dimensions,
-        #                            impl.current_cfg().packed))
+    def hash(self, axes, dimensions):
+        """Adds a hash SNode as a child component of `self`.
+
+        A hash SNode only allocates memory for its active cells, which makes it
+        suitable for very large and very sparse index spaces. It must be a
+        direct child of the root, and is only supported on the LLVM backends
+        (CPU and CUDA).
+
+        Args:
+            axes (List[Axis]): Axes to activate.
+            dimensions (Union[List[int], int]): Shape of each axis.
+
+        Returns:
+            The added :class:`~taichi.lang.SNode` instance.
+        """
+        if isinstance(dimensions, int):
+            dimensions = [dimensions] * len(axes)
+        return SNode(
+            self.ptr.hash(axes, dimensions,
+                          impl.current_cfg().packed))
 
     def dynamic(self, axis, dimension, chunk_size=None):
         """Adds a dynamic SNode as a child component of `self`.
@@ -285,7 +296,8 @@ class SNode:
         for c in ch:
             c.deactivate_all()
         SNodeType = _ti_core.SNodeType
-        if self.ptr.type == SNodeType.pointer or self.ptr.type == SNodeType.bitmasked:
+        if self.ptr.type in (SNodeType.pointer, SNodeType.hash,
+                             SNodeType.bitmasked):
             taichi.lang.meta.snode_deactivate(self)
         if self.ptr.type == SNodeType.dynamic:
             # Note that dynamic nodes are different from other sparse nodes:
@@ -0,0 +1,144 @@
+#include "taichi/ir/ir.h"
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/visitors.h"
+
+#include <unordered_map>
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+// The position of each statement type in statements.inc.h. Unlike
+// std::type_info::hash_code(), it is the same in every process.
+enum class StmtTypeId : int {
+#define PER_STATEMENT(x) x,
+#include "taichi/inc/statements.inc.h"
+#undef PER_STATEMENT
+};
+
+class StmtTypeIdVisitor : public IRVisitor {
+ public:
+  int type_id{-1};
+
+#define PER_STATEMENT(x)          \
+  void visit(x *stmt) override {  \
+    type_id = (int)StmtTypeId::x; \
+  }
+#include "taichi/inc/statements.inc.h"
+#undef PER_STATEMENT
+};
+
+}  // namespace
+
+// Hash the structure of an IRNode: the types, fields and operands of the
+// statements and how they are nested. Unlike printing the IR, this does not
+// depend on the statement ids.
+class IRHasher : public BasicStmtVisitor {
+ private:
+  std::size_t hash_;
+  // The position of each statement in the traversal, used to hash the
+  // operands defined inside the root.
+  std::unordered_map<Stmt *, int> position_;
+
+  IRHasher() : hash_(0) {
+    allow_undefined_visitor = true;
+    invoke_default_visitor = true;
+  }
+
+  void combine(std::size_t value) {
+    hash_ = hash_combine(hash_, value);
+  }
+
+  void hash_stmt(Stmt *stmt) {
+    StmtTypeIdVisitor type_id;
+    stmt->accept(&type_id);
+    combine(type_id.type_id);
+    combine(stmt->field_manager.hash());
+    combine(stmt->num_operands());
+    for (int i = 0; i < stmt->num_operands(); i++) {
+      auto *operand = stmt->operand(i);
+      if (operand == nullptr) {
+        combine(-1);
+        continue;
+      }
+      auto it = position_.find(operand);
+      if (it != position_.end()) {
+        combine(it->second);
+      } else {
+        // Defined outside the root: compare by id as same_statements() does.
+        combine(-2);
+        combine(operand->id);
+      }
+    }
+    position_[stmt] = (int)position_.size();
+  }
+
+  void hash_block(Block *block) {
+    // Tell apart a missing block and an empty one.
+    if (block == nullptr) {
+      combine(0);
+      return;
+    }
+    block->accept(this);
+  }
+
+ public:
+  using BasicStmtVisitor::visit;
+
+  void preprocess_container_stmt(Stmt *stmt) override {
+    hash_stmt(stmt);
+  }
+
+  void visit(Stmt *stmt) override {
+    hash_stmt(stmt);
+  }
+
+  void visit(Block *stmt_list) override {
+    // The size marks where the block ends.
+    combine(stmt_list->size() + 1);
+    for (auto &stmt : stmt_list->statements) {
+      stmt->accept(this);
+    }
+  }
+
+  void visit(IfStmt *if_stmt) override {
+    preprocess_container_stmt(if_stmt);
+    hash_block(if_stmt->true_statements.get());
+    hash_block(if_stmt->false_statements.get());
+  }
+
+  void visit(OffloadedStmt *stmt) override {
+    preprocess_container_stmt(stmt);
+    // Not registered as fields
+    combine(stmt->tls_size);
+    combine(stmt->bls_size);
+    if (stmt->task_type == OffloadedStmt::TaskType::mesh_for) {
+      combine(hash_field_value(stmt->mesh));
+      combine(hash_field_value(stmt->major_from_type));
+      combine(hash_field_value(stmt->major_to_types));
+      combine(hash_field_value(stmt->minor_relation_types));
+    }
+    hash_block(stmt->tls_prologue.get());
+    hash_block(stmt->mesh_prologue.get());
+    hash_block(stmt->bls_prologue.get());
+    hash_block(stmt->body.get());
+    hash_block(stmt->bls_epilogue.get());
+    hash_block(stmt->tls_epilogue.get());
+  }
+
+  static uint64 run(IRNode *root) {
+    IRHasher hasher;
+    root->accept(&hasher);
+    return (uint64)hasher.hash_;
+  }
+};
+
+namespace irpass::analysis {
+uint64 hash_ir(IRNode *root) {
+  TI_ASSERT(root);
+  return IRHasher::run(root);
+}
+}  // namespace irpass::analysis
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "taichi/common/core.h"
+#include "taichi/common/serialization.h"
+
+namespace taichi {
+namespace lang {
+namespace cpu {
+
+struct CompiledSNodeData {
+  int id{0};
+  // SNodeType
+  int type{0};
+  std::size_t cell_size_bytes{0};
+  int chunk_size{0};
+
+  TI_IO_DEF(id, type, cell_size_bytes, chunk_size);
+};
+
+// What the runtime needs to allocate and initialize an SNode tree
+struct CompiledSNodeTreeData {
+  int tree_id{0};
+  int root_id{0};
+  std::size_t root_size{0};
+  // Whether the struct-fors over the tree can be demoted to range-fors
+  bool all_dense{false};
+  // All the SNodes of the tree, including the root
+  std::vector<CompiledSNodeData> snodes;
+
+  TI_IO_DEF(tree_id, root_id, root_size, all_dense, snodes);
+};
+
+struct CompiledFieldData {
+  std::string field_name;
+  std::string dtype_name;
+  int snode_tree_id{0};
+  // Offset of the first element in the root buffer of the SNode tree
+  std::size_t mem_offset_in_parent{0};
+  // Distance between two consecutive elements
+  std::size_t element_stride{0};
+  std::vector<int> shape;
+  bool is_scalar{false};
+  int row_num{0};
+  int column_num{0};
+
+  TI_IO_DEF(field_name,
+            dtype_name,
+            snode_tree_id,
+            mem_offset_in_parent,
+            element_stride,
+            shape,
+            is_scalar,
+            row_num,
+            column_num);
+};
+
+struct CompiledArgData {
+  std::string dtype_name;
+  bool is_external_array{false};
+
+  TI_IO_DEF(dtype_name, is_external_array);
+};
+
+struct CompiledKernelData {
+  std::string kernel_name;
+  // Names of the offloaded task functions, in launch order
+  std::vector<std::string> tasks;
+  std::vector<CompiledArgData> args;
+  std::vector<std::string> ret_dtype_names;
+
+  TI_IO_DEF(kernel_name, tasks, args, ret_dtype_names);
+};
+
+/**
+ * AOT module data for the CPU backend.
+ *
+ * The machine code of all the kernels and of the runtime functions they need
+ * is linked into one shared library. This is the metadata to load it.
+ */
+struct AotData {
+  std::unordered_map<std::string, CompiledKernelData> kernels;
+  std::unordered_map<std::string, CompiledKernelData> kernel_tmpls;
+  std::vector<CompiledFieldData> fields;
+  std::vector<CompiledSNodeTreeData> snode_trees;
+  // File name of the shared library, relative to the module directory
+  std::string library;
+
+  TI_IO_DEF(kernels, kernel_tmpls, fields, snode_trees, library);
+};
+
+}  // namespace cpu
+}  // namespace lang
+}  // namespace taichi
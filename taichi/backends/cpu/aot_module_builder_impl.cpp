@@ -0,0 +1,169 @@
+#include "taichi/backends/cpu/aot_module_builder_impl.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <unordered_set>
+
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include "taichi/backends/cpu/codegen_cpu.h"
+#include "taichi/llvm/llvm_program.h"
+#include "taichi/struct/struct_llvm.h"
+
+namespace taichi {
+namespace lang {
+namespace cpu {
+
+namespace {
+constexpr char kLibraryName[] = "taichi_aot_module";
+}  // namespace
+
+AotModuleBuilderImpl::AotModuleBuilderImpl(LlvmProgramImpl *prog)
+    : prog_(prog), tlctx_(prog->get_llvm_context(host_arch())) {
+  // The runtime of the loader does not set up the kernel profiler.
+  TI_ERROR_IF(prog_->config->kernel_profiler,
+              "AOT: kernel_profiler is not supported on cpu");
+}
+
+AotModuleBuilderImpl::~AotModuleBuilderImpl() = default;
+
+void AotModuleBuilderImpl::dump(const std::string &output_dir,
+                                const std::string &filename) const {
+  TI_WARN_IF(!filename.empty(), "Filename prefix is ignored on cpu backend.");
+  std::unordered_set<std::string> task_names;
+  for (const auto *kernels : {&aot_data_.kernels, &aot_data_.kernel_tmpls}) {
+    for (const auto &k : *kernels) {
+      task_names.insert(k.second.tasks.begin(), k.second.tasks.end());
+    }
+  }
+  std::unique_ptr<llvm::Module> module;
+  if (module_) {
+    module = llvm::CloneModule(*module_);
+  } else if (!prog_->get_compiled_snode_trees().empty()) {
+    module = tlctx_->clone_struct_module();
+  } else {
+    module = tlctx_->clone_runtime_module();
+  }
+  // Besides the tasks, keep the runtime functions that the loader calls to
+  // initialize the runtime and the SNode trees.
+  TaichiLLVMContext::eliminate_unused_functions(
+      module.get(), [&](const std::string &func_name) {
+        return task_names.count(func_name) > 0 ||
+               starts_with(func_name, "runtime_") ||
+               starts_with(func_name, "LLVMRuntime_");
+      });
+  const auto object_code = tlctx_->jit->compile_to_object(
+      std::move(module), prog_->config->cpu_aot_target);
+
+  const std::string obj_path =
+      fmt::format("{}/{}.o", output_dir, kLibraryName);
+  {
+    std::ofstream fs(obj_path, std::ios_base::binary | std::ios::trunc);
+    fs.write(object_code.data(), object_code.size());
+  }
+  AotData aot_data = aot_data_;
+  aot_data.library = fmt::format("{}.so", kLibraryName);
+  aot_data.snode_trees = prog_->get_compiled_snode_trees();
+  const auto cmd = fmt::format(prog_->config->cc_link_cmd,
+                               fmt::format("{}/{}", output_dir,
+                                           aot_data.library),
+                               obj_path);
+  TI_TRACE("Executing command: {}", cmd);
+  TI_ERROR_IF(std::system(cmd.c_str()) != 0,
+              "AOT: failed to link the shared library with \"{}\"", cmd);
+
+  const std::string bin_path = fmt::format("{}/metadata.tcb", output_dir);
+  write_to_binary_file(aot_data, bin_path);
+
+  const std::string txt_path = fmt::format("{}/metadata.json", output_dir);
+  TextSerializer ts;
+  ts.serialize_to_json("aot_data", aot_data);
+  ts.write_to_file(txt_path);
+}
+
+CompiledKernelData AotModuleBuilderImpl::compile_kernel(Kernel *kernel) {
+  auto module_info = CodeGenCPU(kernel).modulegen(std::move(module_));
+  module_ = std::move(module_info->module);
+
+  CompiledKernelData compiled;
+  compiled.kernel_name = kernel->name;
+  compiled.tasks = module_info->name_list;
+  for (const auto &arg : kernel->args) {
+    compiled.args.push_back({arg.dt->to_string(), arg.is_external_array});
+  }
+  for (const auto &ret : kernel->rets) {
+    compiled.ret_dtype_names.push_back(ret.dt->to_string());
+  }
+  return compiled;
+}
+
+void AotModuleBuilderImpl::add_per_backend(const std::string &identifier,
+                                           Kernel *kernel) {
+  aot_data_.kernels.insert(std::make_pair(identifier, compile_kernel(kernel)));
+}
+
+size_t AotModuleBuilderImpl::get_snode_base_address(const SNode *snode) const {
+  if (snode->type == SNodeType::root)
+    return 0;
+  auto *cell_type = llvm::cast<llvm::StructType>(
+      StructCompilerLLVM::get_llvm_element_type(
+          tlctx_->get_this_thread_struct_module(),
+          const_cast<SNode *>(snode->parent)));
+  auto choff = tlctx_->get_data_layout()
+                   .getStructLayout(cell_type)
+                   ->getElementOffset(find_children_id(snode));
+  return choff + get_snode_base_address(snode->parent);
+}
+
+void AotModuleBuilderImpl::add_field_per_backend(const std::string &identifier,
+                                                 const SNode *rep_snode,
+                                                 bool is_scalar,
+                                                 DataType dt,
+                                                 std::vector<int> shape,
+                                                 int row_num,
+                                                 int column_num) {
+  // Note that currently we only support adding dense fields in AOT for all
+  // backends.
+  TI_ERROR_IF(!all_fields_are_dense_in_container(rep_snode->parent),
+              "AOT: only supports dense field");
+  const auto *root = rep_snode->parent->parent;
+  // The loader addresses each field from the root buffer of its tree, with
+  // one stride per element.
+  TI_ERROR_IF(root == nullptr || root->type != SNodeType::root,
+              "AOT: field '{}' is not placed in a dense SNode directly under "
+              "the root, which the CPU backend does not support",
+              identifier);
+  int snode_tree_id = -1;
+  for (const auto &tree : prog_->get_compiled_snode_trees()) {
+    if (tree.root_id == root->id) {
+      snode_tree_id = tree.tree_id;
+    }
+  }
+  TI_ASSERT(snode_tree_id >= 0);
+
+  CompiledFieldData field_data;
+  field_data.field_name = identifier;
+  field_data.dtype_name = dt.to_string();
+  field_data.snode_tree_id = snode_tree_id;
+  field_data.mem_offset_in_parent = get_snode_base_address(rep_snode);
+  field_data.element_stride = rep_snode->parent->cell_size_bytes;
+  field_data.shape = shape;
+  field_data.is_scalar = is_scalar;
+  field_data.row_num = row_num;
+  field_data.column_num = column_num;
+  aot_data_.fields.push_back(field_data);
+}
+
+void AotModuleBuilderImpl::add_per_backend_tmpl(const std::string &identifier,
+                                                const std::string &key,
+                                                Kernel *kernel) {
+  aot_data_.kernel_tmpls.insert(
+      std::make_pair(identifier + "|" + key, compile_kernel(kernel)));
+}
+
+}  // namespace cpu
+}  // namespace lang
+}  // namespace taichi
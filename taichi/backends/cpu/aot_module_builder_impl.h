@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "taichi/program/aot_module_builder.h"
+#include "taichi/backends/cpu/aot_data.h"
+#include "taichi/llvm/llvm_fwd.h"
+
+namespace taichi {
+namespace lang {
+
+class LlvmProgramImpl;
+class TaichiLLVMContext;
+
+namespace cpu {
+
+class AotModuleBuilderImpl : public AotModuleBuilder {
+ public:
+  explicit AotModuleBuilderImpl(LlvmProgramImpl *prog);
+
+  ~AotModuleBuilderImpl() override;
+
+  // Writes the metadata, and the shared library that the kernels are linked
+  // into with CompileConfig::cc_link_cmd.
+  void dump(const std::string &output_dir,
+            const std::string &filename) const override;
+
+ protected:
+  void add_per_backend(const std::string &identifier, Kernel *kernel) override;
+
+  void add_field_per_backend(const std::string &identifier,
+                             const SNode *rep_snode,
+                             bool is_scalar,
+                             DataType dt,
+                             std::vector<int> shape,
+                             int row_num,
+                             int column_num) override;
+
+  void add_per_backend_tmpl(const std::string &identifier,
+                            const std::string &key,
+                            Kernel *kernel) override;
+
+ private:
+  // Generates |kernel| into module_.
+  CompiledKernelData compile_kernel(Kernel *kernel);
+
+  size_t get_snode_base_address(const SNode *snode) const;
+
+  LlvmProgramImpl *prog_;
+  TaichiLLVMContext *tlctx_;
+  // All the kernels share one module, and one copy of the runtime functions.
+  std::unique_ptr<llvm::Module> module_{nullptr};
+  AotData aot_data_;
+};
+
+}  // namespace cpu
+}  // namespace lang
+}  // namespace taichi
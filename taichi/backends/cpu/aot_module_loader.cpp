@@ -0,0 +1,130 @@
+#include "taichi/backends/cpu/aot_module_loader.h"
+
+#include <cstdio>
+#include <thread>
+
+#include "taichi/backends/cpu/cpu_device.h"
+#include "taichi/llvm/runtime_snodes.h"
+#include "taichi/math/arithmetic.h"
+#include "taichi/system/memory_pool.h"
+#include "taichi/system/threading.h"
+
+namespace taichi {
+namespace lang {
+namespace cpu {
+
+namespace {
+void assert_failed_host(const char *msg) {
+  TI_ERROR("Assertion failure: {}", msg);
+}
+
+void *taichi_allocate_aligned(MemoryPool *memory_pool,
+                              std::size_t size,
+                              std::size_t alignment) {
+  return memory_pool->allocate(size, alignment);
+}
+}  // namespace
+
+AotModuleLoader::AotModuleLoader(const std::string &module_dir,
+                                 int num_threads) {
+  const std::string bin_path = fmt::format("{}/metadata.tcb", module_dir);
+  read_from_binary_file(aot_data_, bin_path);
+  const std::string library_path =
+      fmt::format("{}/{}", module_dir, aot_data_.library);
+  library_ = std::make_unique<DynamicLoader>(library_path);
+  TI_ERROR_IF(!library_->loaded(), "AOT: could not load shared object: {}",
+              library_path);
+
+  if (num_threads <= 0) {
+    num_threads = std::thread::hardware_concurrency();
+  }
+  device_ = std::make_unique<CpuDevice>();
+  memory_pool_ = std::make_unique<MemoryPool>(Arch::x64, device_.get());
+  thread_pool_ = std::make_unique<ThreadPool>(num_threads);
+  materialize_runtime(num_threads);
+  for (const auto &tree : aot_data_.snode_trees) {
+    initialize_snode_tree(tree);
+  }
+
+  for (const auto *kernels : {&aot_data_.kernels, &aot_data_.kernel_tmpls}) {
+    for (const auto &k : *kernels) {
+      auto &tasks = kernels_[k.first];
+      for (const auto &task : k.second.tasks) {
+        tasks.push_back((TaskFunc)library_->load_function(task));
+      }
+    }
+  }
+}
+
+AotModuleLoader::~AotModuleLoader() = default;
+
+void AotModuleLoader::materialize_runtime(int num_threads) {
+  result_buffer_ = (uint64 *)memory_pool_->allocate(
+      sizeof(uint64) * taichi_result_buffer_entries, 8);
+  // The same as LlvmProgramImpl::materialize_runtime() on CPU, with the
+  // default random seed.
+  call<void *, void *, std::size_t, void *, int, int, void *, void *, void *>(
+      "runtime_initialize", result_buffer_, memory_pool_.get(),
+      (std::size_t)0, nullptr, 0, num_threads,
+      (void *)&taichi_allocate_aligned, (void *)std::printf,
+      (void *)std::vsnprintf);
+  llvm_runtime_ = fetch_result<void *>(taichi_result_buffer_ret_value_id);
+
+  call<void *>("runtime_get_mem_req_queue", llvm_runtime_);
+  memory_pool_->set_queue((MemRequestQueue *)fetch_result<void *>(
+      taichi_result_buffer_ret_value_id));
+
+  call<void *, void *, void *>("LLVMRuntime_initialize_thread_pool",
+                               llvm_runtime_, thread_pool_.get(),
+                               (void *)ThreadPool::static_run);
+  call<void *, void *>("LLVMRuntime_set_assert_failed", llvm_runtime_,
+                       (void *)assert_failed_host);
+}
+
+void AotModuleLoader::initialize_snode_tree(
+    const CompiledSNodeTreeData &tree) {
+  const std::size_t rounded_size =
+      taichi::iroundup(tree.root_size, taichi_page_size);
+  call<void *, std::size_t, std::size_t>("runtime_memory_allocate_aligned",
+                                         llvm_runtime_, rounded_size,
+                                         taichi_page_size);
+  auto *root_buffer =
+      fetch_result<uint8 *>(taichi_result_buffer_runtime_query_id);
+  roots_[tree.tree_id] = root_buffer;
+  initialize_runtime_snodes(this, llvm_runtime_, tree, rounded_size,
+                            root_buffer);
+}
+
+bool AotModuleLoader::has_kernel(const std::string &name) const {
+  return kernels_.find(name) != kernels_.end();
+}
+
+void AotModuleLoader::launch_kernel(const std::string &name,
+                                    RuntimeContext &context) {
+  auto it = kernels_.find(name);
+  TI_ERROR_IF(it == kernels_.end(), "AOT: kernel \"{}\" not found", name);
+  context.runtime = (LLVMRuntime *)llvm_runtime_;
+  for (auto task : it->second) {
+    task(&context);
+  }
+}
+
+const CompiledFieldData *AotModuleLoader::get_field(
+    const std::string &name) const {
+  for (const auto &field : aot_data_.fields) {
+    if (field.field_name == name) {
+      return &field;
+    }
+  }
+  return nullptr;
+}
+
+void *AotModuleLoader::get_field_ptr(const std::string &name) {
+  const auto *field = get_field(name);
+  TI_ERROR_IF(field == nullptr, "AOT: field \"{}\" not found", name);
+  return roots_.at(field->snode_tree_id) + field->mem_offset_in_parent;
+}
+
+}  // namespace cpu
+}  // namespace lang
+}  // namespace taichi
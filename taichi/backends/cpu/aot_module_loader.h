@@ -0,0 +1,107 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "taichi/backends/cpu/aot_data.h"
+#include "taichi/system/dynamic_loader.h"
+#define TI_RUNTIME_HOST
+#include "taichi/program/context.h"
+#undef TI_RUNTIME_HOST
+
+namespace taichi {
+
+class ThreadPool;
+
+namespace lang {
+
+class MemoryPool;
+
+namespace cpu {
+
+class CpuDevice;
+
+/**
+ * Runs the kernels of a CPU AOT module, without LLVM or a Program.
+ *
+ * The runtime functions linked into the shared library of the module
+ * initialize the runtime and the SNode trees, like LlvmProgramImpl does with
+ * the JIT compiled runtime.
+ */
+class AotModuleLoader {
+ public:
+  /**
+   * @param module_dir The directory that AotModuleBuilder::dump() wrote the
+   * module to.
+   * @param num_threads The number of threads that run parallel loops. Uses
+   * all the cores if not positive.
+   */
+  explicit AotModuleLoader(const std::string &module_dir, int num_threads = 0);
+
+  ~AotModuleLoader();
+
+  /**
+   * Whether the module has a kernel. Kernel template instances are named
+   * "identifier|key".
+   */
+  bool has_kernel(const std::string &name) const;
+
+  /**
+   * Launches a kernel and waits for it to finish.
+   *
+   * @param name The identifier that the kernel was added with.
+   * @param context The arguments of the kernel. Its runtime is set here.
+   */
+  void launch_kernel(const std::string &name, RuntimeContext &context);
+
+  template <typename T>
+  T fetch_result(int i) {
+    return taichi_union_cast_with_different_sizes<T>(result_buffer_[i]);
+  }
+
+  /**
+   * Calls a runtime function in the shared library.
+   */
+  template <typename... Args>
+  void call(const std::string &name, Args... args) {
+    using FuncT = void (*)(Args...);
+    auto func = (FuncT)library_->load_function(name);
+    func(args...);
+  }
+
+  /**
+   * Returns the metadata of a field, or nullptr if there is no such field.
+   */
+  const CompiledFieldData *get_field(const std::string &name) const;
+
+  /**
+   * Returns the address of the first element of a field. The following
+   * elements are CompiledFieldData::element_stride bytes apart, in row-major
+   * order.
+   */
+  void *get_field_ptr(const std::string &name);
+
+ private:
+  using TaskFunc = int32 (*)(void *);
+
+  void materialize_runtime(int num_threads);
+
+  void initialize_snode_tree(const CompiledSNodeTreeData &tree);
+
+  AotData aot_data_;
+  std::unique_ptr<DynamicLoader> library_;
+  std::unique_ptr<CpuDevice> device_;
+  std::unique_ptr<MemoryPool> memory_pool_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+  uint64 *result_buffer_{nullptr};
+  void *llvm_runtime_{nullptr};
+  // Root buffers of the SNode trees, by tree id
+  std::unordered_map<int, uint8 *> roots_;
+  std::unordered_map<std::string, std::vector<TaskFunc>> kernels_;
+};
+
+}  // namespace cpu
+}  // namespace lang
+}  // namespace taichi
@@ -1,22 +1,59 @@
 #include "taichi/backends/cpu/codegen_cpu.h"
 
+#include <condition_variable>
+#include <mutex>
+
+#include "llvm/IR/IntrinsicsX86.h"
+
 #include "taichi/codegen/codegen_llvm.h"
 #include "taichi/llvm/llvm_program.h"
+#include "taichi/program/async_engine.h"
 #include "taichi/common/core.h"
 #include "taichi/util/io.h"
 #include "taichi/lang_util.h"
 #include "taichi/program/program.h"
+#include "taichi/ir/analysis.h"
 #include "taichi/ir/ir.h"
 #include "taichi/ir/statements.h"
 #include "taichi/util/statistics.h"
 
 TLANG_NAMESPACE_BEGIN
 
+namespace {
+
+// Whether |block| may read RuntimeContext::cpu_thread_id, e.g. to pick the
+// random states or the node allocator magazines of the thread. Only the
+// statements below are known not to, so any other statement may.
+bool may_read_thread_id(Block *block) {
+  return !irpass::analysis::gather_statements(block, [](Stmt *s) {
+            if (auto *lookup = s->cast<SNodeLookupStmt>()) {
+              return lookup->activate;
+            }
+            return !(s->is<ConstStmt>() || s->is<AllocaStmt>() ||
+                     s->is<LocalLoadStmt>() || s->is<LocalStoreStmt>() ||
+                     s->is<ArgLoadStmt>() || s->is<LoopIndexStmt>() ||
+                     s->is<UnaryOpStmt>() || s->is<BinaryOpStmt>() ||
+                     s->is<TernaryOpStmt>() || s->is<GlobalPtrStmt>() ||
+                     s->is<GlobalLoadStmt>() || s->is<GlobalStoreStmt>() ||
+                     s->is<GlobalTemporaryStmt>() || s->is<AtomicOpStmt>() ||
+                     s->is<GetRootStmt>() || s->is<GetChStmt>() ||
+                     s->is<LinearizeStmt>() || s->is<IntegerOffsetStmt>() ||
+                     s->is<BitExtractStmt>() || s->is<ExternalPtrStmt>() ||
+                     s->is<PtrOffsetStmt>() || s->is<ThreadLocalPtrStmt>() ||
+                     s->is<ContinueStmt>() || s->is<WhileControlStmt>());
+          }).empty();
+}
+
+}  // namespace
+
 class CodeGenLLVMCPU : public CodeGenLLVM {
  public:
   using IRVisitor::visit;
 
-  CodeGenLLVMCPU(Kernel *kernel, IRNode *ir) : CodeGenLLVM(kernel, ir) {
+  CodeGenLLVMCPU(Kernel *kernel,
+                 IRNode *ir,
+                 std::unique_ptr<llvm::Module> &&module = nullptr)
+      : CodeGenLLVM(kernel, ir, std::move(module)) {
     TI_AUTO_PROF
   }
 
@@ -30,6 +67,15 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
       step = -1;
     }
 
+    if (step == 1 && prog->config.cpu_range_for_tasks) {
+      create_offload_range_for_tasks(stmt);
+      return;
+    }
+    if (step == 1 && prog->config.cpu_loop_vectorize) {
+      create_offload_range_for_blocks(stmt);
+      return;
+    }
+
     auto *tls_prologue = create_xlogue(stmt->tls_prologue);
 
     // The loop body
@@ -58,6 +104,170 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
          tls_prologue, body, epilogue, tlctx->get_constant(stmt->tls_size)});
   }
 
+  // Creates the loop body as a function of a block of indices [begin, end),
+  // which loops over them itself. Unlike calls to a function of a single
+  // index, the loop can be vectorized by LLVM; the indices that do not fill a
+  // vector are left to its scalar remainder loop.
+  llvm::Function *create_range_for_block_body(OffloadedStmt *stmt) {
+    auto guard = get_function_creation_guard(
+        {llvm::PointerType::get(get_runtime_type("RuntimeContext"), 0),
+         llvm::Type::getInt8PtrTy(*llvm_context), tlctx->get_data_type<int>(),
+         tlctx->get_data_type<int>()});
+
+    const bool vectorize = prog->config.cpu_loop_vectorize;
+    if (vectorize) {
+      hoist_loop_invariants(stmt->body.get());
+    }
+
+    auto loop_var = create_entry_block_alloca(PrimitiveType::i32);
+    loop_vars_llvm[stmt].push_back(loop_var);
+    builder->CreateStore(get_arg(2), loop_var);
+
+    auto loop_test = llvm::BasicBlock::Create(*llvm_context, "loop_test", func);
+    auto loop_body = llvm::BasicBlock::Create(*llvm_context, "loop_body", func);
+    auto loop_inc = llvm::BasicBlock::Create(*llvm_context, "loop_inc", func);
+    auto func_exit = llvm::BasicBlock::Create(*llvm_context, "func_exit", func);
+    builder->CreateBr(loop_test);
+
+    builder->SetInsertPoint(loop_test);
+    auto cond = builder->CreateICmp(llvm::CmpInst::Predicate::ICMP_SLT,
+                                    builder->CreateLoad(loop_var), get_arg(3));
+    builder->CreateCondBr(cond, loop_body, func_exit);
+
+    builder->SetInsertPoint(loop_body);
+    // A continue stmt of the range-for skips to the next index.
+    current_loop_reentry = loop_inc;
+    stmt->body->accept(this);
+    current_loop_reentry = nullptr;
+    builder->CreateBr(loop_inc);
+
+    builder->SetInsertPoint(loop_inc);
+    create_increment(loop_var, tlctx->get_constant(1));
+    auto latch = builder->CreateBr(loop_test);
+    if (vectorize) {
+      mark_loop_vectorizable(latch);
+    }
+
+    builder->SetInsertPoint(func_exit);
+    return guard.body;
+  }
+
+  // Runs the block-level loop body through cpu_parallel_range_for_blocks().
+  void create_offload_range_for_blocks(OffloadedStmt *stmt) {
+    auto *tls_prologue = create_xlogue(stmt->tls_prologue);
+    auto *body = create_range_for_block_body(stmt);
+    auto *tls_epilogue = create_xlogue(stmt->tls_epilogue);
+    auto [begin, end] = get_range_for_bounds(stmt);
+    create_call("cpu_parallel_range_for_blocks",
+                {get_arg(0), tlctx->get_constant(stmt->num_cpu_threads), begin,
+                 end, tlctx->get_constant(stmt->block_dim), tls_prologue, body,
+                 tls_epilogue, tlctx->get_constant(stmt->tls_size)});
+  }
+
+  // Generates the task function that cpu_parallel_range_for_tasks() runs on
+  // the thread pool for each block of indices. It calls the loop body and the
+  // TLS xlogues directly, so that LLVM inlines them.
+  void create_offload_range_for_tasks(OffloadedStmt *stmt) {
+    nontemporal_snodes = get_nontemporal_snodes(stmt);
+    auto *tls_prologue = create_xlogue(stmt->tls_prologue);
+    auto *body = create_range_for_block_body(stmt);
+    auto *tls_epilogue = create_xlogue(stmt->tls_epilogue);
+
+    llvm::Function *task;
+    {
+      auto guard = get_function_creation_guard(
+          {llvm::Type::getInt8PtrTy(*llvm_context),
+           tlctx->get_data_type<int>(), tlctx->get_data_type<int>()});
+      auto thread_id = get_arg(1);
+      auto task_id = get_arg(2);
+      RuntimeObject task_context("RangeForTaskContext", this, builder.get(),
+                                 get_arg(0));
+      auto context = task_context.get("context");
+
+      auto tls_buffer = create_entry_block_alloca(
+          llvm::ArrayType::get(llvm::Type::getInt8Ty(*llvm_context),
+                               std::max<std::size_t>(stmt->tls_size, 1)),
+          8);
+      auto tls_ptr = builder->CreateBitCast(tls_buffer, get_tls_buffer_type());
+      if (stmt->tls_prologue) {
+        create_call(tls_prologue, {context, tls_ptr});
+      }
+
+      // The kernel context is only copied for the bodies that read the
+      // thread id from it.
+      auto thread_context = context;
+      if (may_read_thread_id(stmt->body.get())) {
+        thread_context =
+            create_entry_block_alloca(get_runtime_type("RuntimeContext"));
+        create_call("RuntimeContext_copy_for_thread",
+                    {thread_context, context, thread_id});
+      }
+
+      auto block_size = task_context.get("block_size");
+      auto end = task_context.get("end");
+      auto block_start = builder->CreateAdd(
+          task_context.get("begin"), builder->CreateMul(task_id, block_size));
+      auto block_end = builder->CreateAdd(block_start, block_size);
+      block_end = builder->CreateSelect(
+          builder->CreateICmpSLT(block_end, end), block_end, end);
+      create_call(body, {thread_context, tls_ptr, block_start, block_end});
+
+      if (stmt->tls_epilogue) {
+        create_call(tls_epilogue, {context, tls_ptr});
+      }
+      // Non-temporal stores are weakly ordered, so they are fenced before the
+      // thread pool learns that the task is done.
+      if (!nontemporal_snodes.empty()) {
+        builder->CreateIntrinsic(llvm::Intrinsic::x86_sse_sfence, {}, {});
+      }
+      task = guard.body;
+    }
+    nontemporal_snodes.clear();
+
+    auto [begin, end] = get_range_for_bounds(stmt);
+    create_call("cpu_parallel_range_for_tasks",
+                {get_arg(0), tlctx->get_constant(stmt->num_cpu_threads), begin,
+                 end, tlctx->get_constant(stmt->block_dim), task});
+  }
+
+  // The fields that |stmt| writes without reading and that are too large to
+  // stay in the caches, which it stores to with non-temporal stores.
+  std::unordered_set<SNode *> get_nontemporal_snodes(OffloadedStmt *stmt) {
+    std::unordered_set<SNode *> snodes;
+    if (!prog->config.cpu_nontemporal_store || current_arch() != Arch::x64) {
+      return snodes;
+    }
+    for (auto *snode : stmt->mem_access_opt.get_snodes_with_flag(
+             SNodeAccessFlag::write_only)) {
+      if (!snode->dt->is<PrimitiveType>()) {
+        continue;
+      }
+      auto num_bytes = snode->get_total_num_elements_towards_root() *
+                       data_type_size(snode->dt);
+      if (num_bytes >= (int64)taichi_cpu_nontemporal_store_min_bytes) {
+        snodes.insert(snode);
+      }
+    }
+    return snodes;
+  }
+
+  void visit(GlobalStoreStmt *stmt) override {
+    auto *get_ch = stmt->dest->cast<GetChStmt>();
+    if (!get_ch || !nontemporal_snodes.count(get_ch->output_snode) ||
+        stmt->dest->ret_type->as<PointerType>()->is_bit_pointer()) {
+      CodeGenLLVM::visit(stmt);
+      return;
+    }
+    auto store =
+        builder->CreateStore(llvm_val[stmt->val], llvm_val[stmt->dest]);
+    store->setMetadata(
+        llvm::LLVMContext::MD_nontemporal,
+        llvm::MDNode::get(*llvm_context,
+                          {llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(
+                              llvm::Type::getInt32Ty(*llvm_context), 1))}));
+    stat.add("codegen_nontemporal_stores");
+  }
+
   void create_offload_mesh_for(OffloadedStmt *stmt) override {
     auto *tls_prologue = create_mesh_xlogue(stmt->tls_prologue);
 
@@ -127,24 +337,20 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
                  epilogue, tlctx->get_constant(stmt->tls_size)});
   }
 
-  void create_bls_buffer(OffloadedStmt *stmt) {
-    auto type = llvm::ArrayType::get(llvm::Type::getInt8Ty(*llvm_context),
-                                     stmt->bls_size);
-    bls_buffer = new llvm::GlobalVariable(
-        *module, type, false, llvm::GlobalValue::ExternalLinkage, nullptr,
-        "bls_buffer", nullptr, llvm::GlobalVariable::LocalExecTLSModel, 0);
-    bls_buffer->setAlignment(llvm::MaybeAlign(8));
-    // initialize the variable with an undef value to ensure it is added to the
-    // symbol table
-    bls_buffer->setInitializer(llvm::UndefValue::get(type));
+  void visit(BlockLocalPtrStmt *stmt) override {
+    // The BLS buffers are in the TLS buffer of the thread, at the offsets
+    // that make_block_local() assigned.
+    TI_ASSERT(stmt->width() == 1);
+    auto ptr = builder->CreateGEP(get_tls_base_ptr(), llvm_val[stmt->offset]);
+    auto ptr_type = llvm::PointerType::get(
+        tlctx->get_data_type(stmt->ret_type.ptr_removed()), 0);
+    llvm_val[stmt] = builder->CreatePointerCast(ptr, ptr_type);
   }
 
   void visit(OffloadedStmt *stmt) override {
     stat.add("codegen_offloaded_tasks");
     TI_ASSERT(current_offload == nullptr);
     current_offload = stmt;
-    if (stmt->bls_size > 0)
-      create_bls_buffer(stmt);
     using Type = OffloadedStmt::TaskType;
     auto offloaded_task_name = init_offloaded_task_function(stmt);
     if (prog->config.kernel_profiler && arch_is_cpu(prog->config.arch)) {
@@ -159,8 +365,6 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
     } else if (stmt->task_type == Type::mesh_for) {
       create_offload_mesh_for(stmt);
     } else if (stmt->task_type == Type::struct_for) {
-      stmt->block_dim = std::min(stmt->snode->parent->max_num_elements(),
-                                 (int64)stmt->block_dim);
       create_offload_struct_for(stmt);
     } else if (stmt->task_type == Type::listgen) {
       emit_list_gen(stmt);
@@ -187,11 +391,132 @@ class CodeGenLLVMCPU : public CodeGenLLVM {
       TI_NOT_IMPLEMENTED
     }
   }
+
+ private:
+  // The fields of the range-for being generated that get non-temporal stores
+  std::unordered_set<SNode *> nontemporal_snodes;
 };
 
+namespace {
+
+// Compiles |ir| at |llvm_opt_level|, or loads it from the offline cache.
+std::vector<OffloadedTask> compile_or_load(Kernel *kernel,
+                                           IRNode *ir,
+                                           bool emit_object_code,
+                                           int llvm_opt_level) {
+  auto *llvm_prog = kernel->program->get_llvm_program_impl();
+  auto *cache = llvm_prog->get_offline_cache();
+  std::string key;
+  if (cache) {
+    key = LlvmOfflineCache::make_key(kernel, ir);
+  }
+  LlvmOfflineCache::KernelCacheData data;
+  if (!key.empty() && cache->load(key, ir, data)) {
+    stat.add("offline_cache_hits");
+    auto *tlctx = llvm_prog->get_llvm_context(kernel->arch);
+    auto jit_module =
+        tlctx->jit->make_module_handle(tlctx->add_object(data.object_code));
+    std::vector<OffloadedTask> offloaded_tasks;
+    for (auto &name : data.offloaded_task_names) {
+      OffloadedTask task(nullptr);
+      task.begin(name);
+      task.compile(jit_module);
+      offloaded_tasks.push_back(task);
+    }
+    return offloaded_tasks;
+  }
+  CodeGenLLVMCPU gen(kernel, ir);
+  if (!key.empty()) {
+    stat.add("offline_cache_misses");
+    if (llvm_opt_level == 3) {
+      // Only optimized code is stored.
+      gen.offline_cache_key = key;
+      gen.offline_cache_ir = LlvmOfflineCache::print_ir(ir);
+    }
+  }
+  gen.llvm_opt_level = llvm_opt_level;
+  gen.emit_to_module();
+  return gen.compile_module(emit_object_code);
+}
+
+}  // namespace
+
 FunctionType CodeGenCPU::codegen() {
   TI_AUTO_PROF
-  return CodeGenLLVMCPU(kernel, ir).gen();
+  auto *workers = prog->get_llvm_program_impl()->get_compilation_workers();
+  auto *block = ir->cast<Block>();
+  // The LLVM IR files are numbered in compilation order.
+  if (workers && block && block->size() > 1 &&
+      !prog->config.print_kernel_llvm_ir &&
+      !prog->config.print_kernel_llvm_ir_optimized) {
+    return codegen_offloads_in_parallel(workers, block);
+  }
+  return CodeGenLLVM::create_cpu_kernel_launcher(
+      kernel, kernel->name + "_kernel",
+      compile_or_load(kernel, ir, /*emit_object_code=*/false,
+                      get_llvm_opt_level()));
+}
+
+std::unique_ptr<ModuleGenValue> CodeGenCPU::modulegen(
+    std::unique_ptr<llvm::Module> &&module) {
+  TI_AUTO_PROF
+  CodeGenLLVMCPU gen(kernel, ir, std::move(module));
+  gen.emit_to_module();
+  std::vector<std::string> name_list;
+  for (auto &task : gen.offloaded_tasks) {
+    name_list.push_back(task.name);
+  }
+  return std::make_unique<ModuleGenValue>(std::move(gen.module), name_list);
+}
+
+int CodeGenCPU::get_llvm_opt_level() const {
+  // The first tier of tiered compilation
+  return kernel->in_fast_tier() ? 0 : 3;
+}
+
+FunctionType CodeGenCPU::codegen_offloads_in_parallel(ParallelExecutor *workers,
+                                                      Block *block) {
+  const int num_offloads = block->size();
+  const int llvm_opt_level = get_llvm_opt_level();
+  std::vector<std::vector<OffloadedTask>> tasks(num_offloads);
+  std::vector<std::exception_ptr> errors(num_offloads);
+  // |workers| is shared by every thread that compiles a kernel, e.g. the
+  // precompile workers, so wait only for the tasks enqueued here instead of
+  // flushing the whole queue.
+  std::mutex mut;
+  std::condition_variable done_cv;
+  int num_pending = num_offloads;
+  for (int i = 0; i < num_offloads; i++) {
+    TI_ASSERT(block->statements[i]->is<OffloadedStmt>());
+    workers->enqueue([&, i]() {
+      try {
+        // Each worker has its own LLVM context. Generate the machine code on
+        // the worker, instead of when the JIT session looks up the tasks.
+        tasks[i] = compile_or_load(kernel, block->statements[i].get(),
+                                   /*emit_object_code=*/true, llvm_opt_level);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+      std::lock_guard<std::mutex> _(mut);
+      if (--num_pending == 0) {
+        done_cv.notify_one();
+      }
+    });
+  }
+  {
+    std::unique_lock<std::mutex> lock(mut);
+    done_cv.wait(lock, [&]() { return num_pending == 0; });
+  }
+  std::vector<OffloadedTask> offloaded_tasks;
+  for (int i = 0; i < num_offloads; i++) {
+    if (errors[i]) {
+      std::rethrow_exception(errors[i]);
+    }
+    offloaded_tasks.insert(offloaded_tasks.end(), tasks[i].begin(),
+                           tasks[i].end());
+  }
+  return CodeGenLLVM::create_cpu_kernel_launcher(
+      kernel, kernel->name + "_kernel", offloaded_tasks);
 }
 
 TLANG_NAMESPACE_END
@@ -6,12 +6,29 @@
 
 TLANG_NAMESPACE_BEGIN
 
+class ParallelExecutor;
+
 class CodeGenCPU : public KernelCodeGen {
  public:
   CodeGenCPU(Kernel *kernel, IRNode *ir = nullptr) : KernelCodeGen(kernel, ir) {
   }
 
   FunctionType codegen() override;
+
+#ifdef TI_WITH_LLVM
+  // Generates the kernel into |module| for AOT, instead of JIT compiling it.
+  // If |module| is null, a new module is created.
+  std::unique_ptr<ModuleGenValue> modulegen(
+      std::unique_ptr<llvm::Module> &&module);
+#endif
+
+ private:
+  int get_llvm_opt_level() const;
+
+  // Compiles each offloaded task in |block| as a separate module on
+  // |workers|.
+  FunctionType codegen_offloads_in_parallel(ParallelExecutor *workers,
+                                            Block *block);
 };
 
 TLANG_NAMESPACE_END
@@ -1,4 +1,6 @@
 #include "taichi/backends/cpu/cpu_device.h"
+#include "taichi/inc/constants.h"
+#include "taichi/system/memory_pool.h"
 
 namespace taichi {
 namespace lang {
@@ -31,9 +33,9 @@ DeviceAllocation CpuDevice::allocate_memory_runtime(
     const LlvmRuntimeAllocParams &params) {
   AllocInfo info;
   info.ptr = allocate_llvm_runtime_memory_jit(params);
-  // TODO: Add caching allocator
   info.size = params.size;
   info.use_cached = params.use_cached;
+  info.from_runtime = true;
   DeviceAllocation alloc;
   alloc.alloc_id = allocations_.size();
   alloc.device = this;
@@ -48,7 +50,14 @@ void CpuDevice::dealloc_memory(DeviceAllocation handle) {
   if (info.ptr == nullptr) {
     TI_ERROR("the DeviceAllocation is already deallocated");
   }
-  if (!info.use_cached) {
+  if (info.from_runtime) {
+    // On CPU the runtime allocates from the MemoryPool, which caches the
+    // memory for reuse and returns its pages to the OS.
+    if (memory_pool_) {
+      memory_pool_->release(info.ptr, info.size, taichi_page_size);
+    }
+    info.ptr = nullptr;
+  } else if (!info.use_cached) {
     // Use at() to ensure that the memory is allocated, and not imported
     virtual_memories_.at(handle.alloc_id).reset();
     info.ptr = nullptr;
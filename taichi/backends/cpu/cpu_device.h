@@ -10,6 +10,9 @@
 
 namespace taichi {
 namespace lang {
+
+class MemoryPool;
+
 namespace cpu {
 
 class CpuResourceBinder : public ResourceBinder {
@@ -81,6 +84,7 @@ class CpuDevice : public Device {
     void *ptr{nullptr};
     size_t size{0};
     bool use_cached{false};
+    bool from_runtime{false};
   };
 
   AllocInfo get_alloc_info(DeviceAllocation handle);
@@ -106,6 +110,12 @@ class CpuDevice : public Device {
 
   DeviceAllocation import_memory(void *ptr, size_t size);
 
+  // The pool backing the LLVM runtime allocator. Runtime allocations are
+  // returned to it in dealloc_memory().
+  void set_memory_pool(MemoryPool *memory_pool) {
+    memory_pool_ = memory_pool;
+  }
+
   void memcpy_internal(DevicePtr dst, DevicePtr src, uint64_t size) override{
       TI_NOT_IMPLEMENTED};
 
@@ -115,6 +125,7 @@ class CpuDevice : public Device {
   std::vector<AllocInfo> allocations_;
   std::unordered_map<int, std::unique_ptr<VirtualMemoryAllocator>>
       virtual_memories_;
+  MemoryPool *memory_pool_{nullptr};
 
   void validate_device_alloc(DeviceAllocation alloc) {
     if (allocations_.size() <= alloc.alloc_id) {
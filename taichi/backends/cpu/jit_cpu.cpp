@@ -1,5 +1,6 @@
 // A LLVM JIT compiler for CPU archs wrapper
 
+#include <algorithm>
 #include <memory>
 
 #ifdef TI_WITH_LLVM
@@ -24,11 +25,14 @@
 #include "llvm/IR/Verifier.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Support/DynamicLibrary.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/IPO/AlwaysInliner.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Scalar.h"
@@ -76,14 +80,52 @@ class JITModuleCPU : public JITModule {
  private:
   JITSessionCPU *session_;
   JITDylib *dylib_;
+  // The symbols the module defines in |dylib_|
+  SymbolNameSet symbols_;
+  // Each module has its own layers so that removing it releases its code.
+  std::unique_ptr<RTDyldObjectLinkingLayer> object_layer_;
+  std::unique_ptr<IRCompileLayer> compile_layer_;
+  // Filled by |object_layer_| as it links the module
+  std::shared_ptr<std::vector<SectionMemoryManager *>> memory_managers_;
 
  public:
-  JITModuleCPU(JITSessionCPU *session, JITDylib *dylib)
-      : session_(session), dylib_(dylib) {
+  JITModuleCPU(JITSessionCPU *session,
+               JITDylib *dylib,
+               SymbolNameSet symbols,
+               std::unique_ptr<RTDyldObjectLinkingLayer> object_layer,
+               std::shared_ptr<std::vector<SectionMemoryManager *>>
+                   memory_managers)
+      : session_(session),
+        dylib_(dylib),
+        symbols_(std::move(symbols)),
+        object_layer_(std::move(object_layer)),
+        memory_managers_(std::move(memory_managers)) {
+  }
+
+  ~JITModuleCPU() override {
+    for (auto *memory_manager : *memory_managers_) {
+      memory_manager->deregisterEHFrames();
+    }
   }
 
   void *lookup_function(const std::string &name) override;
 
+  JITDylib *get_dylib() const {
+    return dylib_;
+  }
+
+  const SymbolNameSet &get_symbols() const {
+    return symbols_;
+  }
+
+  RTDyldObjectLinkingLayer &get_object_layer() {
+    return *object_layer_;
+  }
+
+  void set_compile_layer(std::unique_ptr<IRCompileLayer> compile_layer) {
+    compile_layer_ = std::move(compile_layer);
+  }
+
   bool direct_dispatch() const override {
     return true;
   }
@@ -92,40 +134,27 @@ class JITModuleCPU : public JITModule {
 class JITSessionCPU : public JITSession {
  private:
   ExecutionSession es_;
-  RTDyldObjectLinkingLayer object_layer_;
-  IRCompileLayer compile_layer_;
+  JITTargetMachineBuilder jtmb_;
   DataLayout dl_;
   MangleAndInterner mangle_;
   std::mutex mut_;
   std::vector<llvm::orc::JITDylib *> all_libs_;
+  // ORC cannot destroy a JITDylib, so those of removed modules are reused.
+  std::vector<llvm::orc::JITDylib *> free_libs_;
   int module_counter_;
-  SectionMemoryManager *memory_manager_;
 
  public:
   JITSessionCPU(JITTargetMachineBuilder JTMB, DataLayout DL)
-      : object_layer_(es_,
-                      [&]() {
-                        auto smgr = std::make_unique<SectionMemoryManager>();
-                        memory_manager_ = smgr.get();
-                        return smgr;
-                      }),
-        compile_layer_(es_,
-                       object_layer_,
-                       std::make_unique<ConcurrentIRCompiler>(JTMB)),
+      : jtmb_(std::move(JTMB)),
         dl_(DL),
         mangle_(es_, this->dl_),
-        module_counter_(0),
-        memory_manager_(nullptr) {
-    if (JTMB.getTargetTriple().isOSBinFormatCOFF()) {
-      object_layer_.setOverrideObjectFlagsWithResponsibilityFlags(true);
-      object_layer_.setAutoClaimResponsibilityForObjectSymbols(true);
-    }
+        module_counter_(0) {
   }
 
   ~JITSessionCPU() override {
     std::lock_guard<std::mutex> _(mut_);
-    if (memory_manager_)
-      memory_manager_->deregisterEHFrames();
+    // The layers of the modules refer to |es_|.
+    modules.clear();
   }
 
   DataLayout get_data_layout() override {
@@ -140,24 +169,81 @@ class JITSessionCPU : public JITSession {
     TI_ASSERT(max_reg == 0);  // No need to specify max_reg on CPUs
     TI_ASSERT(M);
     global_optimize_module_cpu(M.get());
+    SymbolNameSet symbols;
+    for (auto &global : M->global_values()) {
+      // The same globals as IRMaterializationUnit defines
+      if (global.hasName() && !global.isDeclaration() &&
+          !global.hasLocalLinkage() &&
+          !global.hasAvailableExternallyLinkage() &&
+          !global.hasAppendingLinkage()) {
+        symbols.insert(mangle_(global.getName()));
+      }
+    }
     std::lock_guard<std::mutex> _(mut_);
-    auto &dylib = es_.createJITDylib(fmt::format("{}", module_counter_));
-    dylib.addGenerator(
-        cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
-            dl_.getGlobalPrefix())));
+    auto &dylib = create_dylib();
+    auto *module = create_module(dylib, std::move(symbols));
+    auto compile_layer = std::make_unique<IRCompileLayer>(
+        es_, module->get_object_layer(),
+        std::make_unique<ConcurrentIRCompiler>(jtmb_));
     auto *thread_safe_context = get_current_program()
                                     .get_llvm_program_impl()
                                     ->get_llvm_context(host_arch())
                                     ->get_this_thread_thread_safe_context();
-    cantFail(compile_layer_.add(
+    cantFail(compile_layer->add(
         dylib,
         llvm::orc::ThreadSafeModule(std::move(M), *thread_safe_context)));
-    all_libs_.push_back(&dylib);
-    auto new_module = std::make_unique<JITModuleCPU>(this, &dylib);
-    auto new_module_raw_ptr = new_module.get();
-    modules.push_back(std::move(new_module));
-    module_counter_++;
-    return new_module_raw_ptr;
+    module->set_compile_layer(std::move(compile_layer));
+    return module;
+  }
+
+  JITModule *add_module_as_object(std::unique_ptr<llvm::Module> M,
+                                  std::string &object_code,
+                                  int opt_level = 3) override {
+    TI_ASSERT(M);
+    global_optimize_module_cpu(M.get(), &object_code, opt_level);
+    return add_object(object_code);
+  }
+
+  std::string compile_to_object(std::unique_ptr<llvm::Module> M,
+                                const std::string &target_cpu) override {
+    TI_ASSERT(M);
+    std::string object_code;
+    global_optimize_module_cpu(M.get(), &object_code, /*opt_level=*/3,
+                               target_cpu);
+    return object_code;
+  }
+
+  JITModule *add_object(const std::string &object_code) override {
+    auto symbols = get_object_symbols(object_code);
+    std::lock_guard<std::mutex> _(mut_);
+    auto &dylib = create_dylib();
+    auto *module = create_module(dylib, std::move(symbols));
+    cantFail(module->get_object_layer().add(
+        dylib, llvm::MemoryBuffer::getMemBufferCopy(object_code)));
+    return module;
+  }
+
+  void remove_module(JITModule *module) override {
+    std::lock_guard<std::mutex> _(mut_);
+    auto it = std::find_if(
+        modules.begin(), modules.end(),
+        [&](const std::unique_ptr<JITModule> &m) { return m.get() == module; });
+    TI_ASSERT(it != modules.end());
+    auto *cpu_module = static_cast<JITModuleCPU *>(module);
+    auto *dylib = cpu_module->get_dylib();
+    all_libs_.erase(std::find(all_libs_.begin(), all_libs_.end(), dylib));
+    // Keeps the symbols that the process search generator has added, which
+    // stay valid.
+    if (auto err = dylib->remove(cpu_module->get_symbols())) {
+      // Not reused, so that the stale symbols are never looked up.
+      TI_WARN("Failed to remove the symbols of a JIT module: {}",
+              llvm::toString(std::move(err)));
+    } else {
+      free_libs_.push_back(dylib);
+    }
+    modules.erase(it);
+    // The names of the removed symbols are not freed otherwise.
+    es_.getSymbolStringPool()->clearDeadEntries();
   }
 
   void *lookup(const std::string Name) override {
@@ -185,15 +271,87 @@ class JITSessionCPU : public JITSession {
   }
 
  private:
-  static void global_optimize_module_cpu(llvm::Module *module);
+  // Creates the JITDylib of a new module. mut_ must be held.
+  JITDylib &create_dylib() {
+    if (!free_libs_.empty()) {
+      auto *dylib = free_libs_.back();
+      free_libs_.pop_back();
+      return *dylib;
+    }
+    auto &dylib = es_.createJITDylib(fmt::format("{}", module_counter_));
+    dylib.addGenerator(
+        cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            dl_.getGlobalPrefix())));
+    return dylib;
+  }
+
+  // mut_ must be held.
+  JITModuleCPU *create_module(JITDylib &dylib, SymbolNameSet symbols) {
+    all_libs_.push_back(&dylib);
+    auto memory_managers =
+        std::make_shared<std::vector<SectionMemoryManager *>>();
+    auto object_layer = std::make_unique<RTDyldObjectLinkingLayer>(
+        es_, [memory_managers]() {
+          auto smgr = std::make_unique<SectionMemoryManager>();
+          memory_managers->push_back(smgr.get());
+          return smgr;
+        });
+    if (jtmb_.getTargetTriple().isOSBinFormatCOFF()) {
+      object_layer->setOverrideObjectFlagsWithResponsibilityFlags(true);
+      object_layer->setAutoClaimResponsibilityForObjectSymbols(true);
+    }
+    auto new_module = std::make_unique<JITModuleCPU>(
+        this, &dylib, std::move(symbols), std::move(object_layer),
+        memory_managers);
+    auto new_module_raw_ptr = new_module.get();
+    modules.push_back(std::move(new_module));
+    module_counter_++;
+    return new_module_raw_ptr;
+  }
+
+  // The symbols that the object layer defines for |object_code|
+  SymbolNameSet get_object_symbols(const std::string &object_code) {
+    auto object = cantFail(object::ObjectFile::createObjectFile(
+        llvm::MemoryBufferRef(object_code, "")));
+    SymbolNameSet symbols;
+    for (auto &symbol : object->symbols()) {
+      auto flags = symbol.getFlags();
+      if ((flags & object::BasicSymbolRef::SF_Undefined) ||
+          !(flags & object::BasicSymbolRef::SF_Global)) {
+        continue;
+      }
+      symbols.insert(es_.intern(cantFail(symbol.getName())));
+    }
+    return symbols;
+  }
+
+  // Also emits the object code of the module if object_code is not null.
+  // |opt_level| is the LLVM optimization level, from 0 to 3. |target_cpu| is
+  // the LLVM CPU name to compile for, or "native" for the host CPU.
+  static void global_optimize_module_cpu(
+      llvm::Module *module,
+      std::string *object_code = nullptr,
+      int opt_level = 3,
+      const std::string &target_cpu = "native");
 };
 
+namespace {
+// Indexed by the LLVM optimization level
+constexpr CodeGenOpt::Level kCodeGenOptLevels[] = {
+    CodeGenOpt::None, CodeGenOpt::Less, CodeGenOpt::Default,
+    CodeGenOpt::Aggressive};
+}  // namespace
+
 void *JITModuleCPU::lookup_function(const std::string &name) {
   return session_->lookup_in_module(dylib_, name);
 }
 
-void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
+void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module,
+                                               std::string *object_code,
+                                               int opt_level,
+                                               const std::string &target_cpu) {
   TI_AUTO_PROF
+  TI_ASSERT(0 <= opt_level && opt_level <= 3);
   if (llvm::verifyModule(*module, &llvm::errs())) {
     module->print(llvm::errs(), nullptr);
     TI_ERROR("Module broken");
@@ -228,10 +386,12 @@ void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
   legacy::FunctionPassManager function_pass_manager(module);
   legacy::PassManager module_pass_manager;
 
-  llvm::StringRef mcpu = llvm::sys::getHostCPUName();
+  const std::string mcpu = target_cpu == "native"
+                              ? llvm::sys::getHostCPUName().str()
+                              : target_cpu;
   std::unique_ptr<TargetMachine> target_machine(target->createTargetMachine(
-      triple.str(), mcpu.str(), "", options, llvm::Reloc::PIC_,
-      llvm::CodeModel::Small, CodeGenOpt::Aggressive));
+      triple.str(), mcpu, "", options, llvm::Reloc::PIC_,
+      llvm::CodeModel::Small, kCodeGenOptLevels[opt_level]));
 
   TI_ERROR_UNLESS(target_machine.get(), "Could not allocate target machine!");
 
@@ -243,10 +403,14 @@ void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
       target_machine->getTargetIRAnalysis()));
 
   PassManagerBuilder b;
-  b.OptLevel = 3;
-  b.Inliner = createFunctionInliningPass(b.OptLevel, 0, false);
-  b.LoopVectorize = true;
-  b.SLPVectorize = true;
+  b.OptLevel = opt_level;
+  if (opt_level == 0) {
+    b.Inliner = createAlwaysInlinerLegacyPass();
+  } else {
+    b.Inliner = createFunctionInliningPass(b.OptLevel, 0, false);
+  }
+  b.LoopVectorize = opt_level > 1;
+  b.SLPVectorize = opt_level > 1;
 
   target_machine->adjustPassManager(b);
 
@@ -277,6 +441,18 @@ void JITSessionCPU::global_optimize_module_cpu(llvm::Module *module) {
         "optimized LLVM IR (CPU)");
     writer.write(module);
   }
+
+  if (object_code) {
+    TI_PROFILER("llvm_emit_object");
+    llvm::SmallVector<char, 0> buffer;
+    llvm::raw_svector_ostream ostream(buffer);
+    legacy::PassManager emit_pass_manager;
+    bool fail = target_machine->addPassesToEmitFile(
+        emit_pass_manager, ostream, nullptr, llvm::CGFT_ObjectFile);
+    TI_ERROR_IF(fail, "Failed to set up passes to emit object code");
+    emit_pass_manager.run(*module);
+    *object_code = std::string(buffer.begin(), buffer.end());
+  }
 }
 
 std::unique_ptr<JITSession> create_llvm_jit_session_cpu(Arch arch) {
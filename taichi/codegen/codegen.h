@@ -4,6 +4,10 @@
 
 #include "taichi/program/program.h"
 
+#ifdef TI_WITH_LLVM
+#include "llvm/IR/Module.h"
+#endif
+
 TLANG_NAMESPACE_BEGIN
 
 class KernelCodeGen {
@@ -24,4 +28,18 @@ class KernelCodeGen {
   virtual FunctionType codegen() = 0;
 };
 
+#ifdef TI_WITH_LLVM
+// The LLVM module of kernels generated for AOT, and the names of the functions
+// it exports
+class ModuleGenValue {
+ public:
+  ModuleGenValue(std::unique_ptr<llvm::Module> module,
+                 const std::vector<std::string> &name_list)
+      : module(std::move(module)), name_list(name_list) {
+  }
+  std::unique_ptr<llvm::Module> module;
+  std::vector<std::string> name_list;
+};
+#endif
+
 TLANG_NAMESPACE_END
@@ -1,9 +1,12 @@
 #ifdef TI_WITH_LLVM
 #include "taichi/codegen/codegen_llvm.h"
 
+#include "taichi/ir/analysis.h"
 #include "taichi/ir/statements.h"
+#include "taichi/llvm/llvm_offline_cache.h"
 #include "taichi/struct/struct_llvm.h"
 #include "taichi/util/file_sequence_writer.h"
+#include "taichi/util/statistics.h"
 
 #include "llvm/IR/Module.h"
 #include "llvm/Bitcode/BitcodeReader.h"
@@ -32,9 +35,13 @@ void OffloadedTask::operator()(RuntimeContext *context) {
   func(context);
 }
 
-void OffloadedTask::compile() {
+void OffloadedTask::compile(const std::shared_ptr<JITModule> &module) {
   TI_ASSERT(!func);
-  auto kernel_symbol = codegen->tlctx->lookup_function_pointer(name);
+  this->module = module;
+  // Look up in the module of the kernel only. Kernels loaded from the offline
+  // cache may have been compiled with task names that are also used in this
+  // process.
+  auto kernel_symbol = module->lookup_function(name);
   TI_ASSERT_INFO(kernel_symbol, "Function not found");
 
   func = (task_fp_type)kernel_symbol;
@@ -125,11 +132,13 @@ CodeGenStmtGuard make_while_after_loop_guard(CodeGenLLVM *cg) {
 
 // CodeGenLLVM
 
-uint64 CodeGenLLVM::task_counter = 0;
+std::atomic<uint64> CodeGenLLVM::task_counter = 0;
 
 void CodeGenLLVM::visit(Block *stmt_list) {
   for (auto &stmt : stmt_list->statements) {
-    stmt->accept(this);
+    if (hoisted_stmts.find(stmt.get()) == hoisted_stmts.end()) {
+      stmt->accept(this);
+    }
   }
 }
 
@@ -247,10 +256,33 @@ std::unique_ptr<RuntimeObject> CodeGenLLVM::emit_struct_meta_object(
     meta = std::make_unique<RuntimeObject>("DynamicMeta", this, builder.get());
     emit_struct_meta_base("Dynamic", meta->ptr, snode);
     meta->call("set_chunk_size", tlctx->get_constant(snode->chunk_size));
+    // Directory pages have the same size as the chunks, see node_dynamic.h
+    // and initialize_runtime_snodes()
+    auto chunk_bytes = std::max<std::size_t>(
+        sizeof(void *) + snode->cell_size_bytes * snode->chunk_size,
+        2 * sizeof(void *));
+    int64 fanout = chunk_bytes / sizeof(void *);
+    int64 num_chunks =
+        (snode->max_num_elements() + snode->chunk_size - 1) / snode->chunk_size;
+    int64 top_span = 1;
+    while (top_span * fanout < num_chunks - 2) {
+      top_span *= fanout;
+    }
+    meta->call("set_directory_fanout", tlctx->get_constant((int)fanout));
+    meta->call("set_directory_top_span", tlctx->get_constant((int)top_span));
   } else if (snode->type == SNodeType::bitmasked) {
     meta =
         std::make_unique<RuntimeObject>("BitmaskedMeta", this, builder.get());
     emit_struct_meta_base("Bitmasked", meta->ptr, snode);
+  } else if (snode->type == SNodeType::hash) {
+    meta = std::make_unique<RuntimeObject>("HashMeta", this, builder.get());
+    emit_struct_meta_base("Hash", meta->ptr, snode);
+    // The first slot table is sized after the index space, so that small
+    // hashes do not allocate more slots than they can ever use.
+    auto table_size =
+        std::min((int)bit::least_pot_bound(snode->max_num_elements()),
+                 taichi_hash_initial_table_size);
+    meta->call("set_table_size", tlctx->get_constant(table_size));
   } else {
     TI_P(snode_type_name(snode->type));
     TI_NOT_IMPLEMENTED;
@@ -268,7 +300,8 @@ void CodeGenLLVM::emit_struct_meta_base(const std::string &name,
         StructCompilerLLVM::get_llvm_body_type(module.get(), snode);
     auto element_ty = body_type->getArrayElementType();
     element_size = tlctx->get_type_size(element_ty);
-  } else if (snode->type == SNodeType::pointer) {
+  } else if (snode->type == SNodeType::pointer ||
+             snode->type == SNodeType::hash) {
     auto element_ty = StructCompilerLLVM::get_llvm_node_type(
         module.get(), snode->ch[0].get());
     element_size = tlctx->get_type_size(element_ty);
@@ -287,6 +320,7 @@ void CodeGenLLVM::emit_struct_meta_base(const std::string &name,
   uint8 *(*lookup_element)(uint8 *, int i);
   uint8 *(*from_parent_element)(uint8 *);
   bool (*is_active)(uint8 *, int i);
+  int (*find_next_active)(uint8 *, int begin, int end);
   int (*get_num_elements)(uint8 *);
   void (*refine_coordinates)(PhysicalCoordinates *inp_coord,
                              PhysicalCoordinates *refined_coord,
@@ -294,7 +328,7 @@ void CodeGenLLVM::emit_struct_meta_base(const std::string &name,
                              */
 
   std::vector<std::string> functions = {"lookup_element", "is_active",
-                                        "get_num_elements"};
+                                        "find_next_active", "get_num_elements"};
 
   for (auto const &f : functions)
     common.set(f, get_runtime_function(fmt::format("{}_{}", name, f)));
@@ -454,6 +488,33 @@ void CodeGenLLVM::visit(BinaryOpStmt *stmt) {
   auto op = stmt->op_type;
   auto ret_type = stmt->ret_type;
 
+  if (auto *vec = ret_type->cast<VectorType>()) {
+    // Only the operations that irpass::slp_vectorize() packs
+    auto *lhs = llvm_val[stmt->lhs];
+    auto *rhs = llvm_val[stmt->rhs];
+    const bool real = is_real(vec->get_element_type());
+    if (op == BinaryOpType::add) {
+      llvm_val[stmt] =
+          real ? builder->CreateFAdd(lhs, rhs) : builder->CreateAdd(lhs, rhs);
+    } else if (op == BinaryOpType::sub) {
+      llvm_val[stmt] =
+          real ? builder->CreateFSub(lhs, rhs) : builder->CreateSub(lhs, rhs);
+    } else if (op == BinaryOpType::mul) {
+      llvm_val[stmt] =
+          real ? builder->CreateFMul(lhs, rhs) : builder->CreateMul(lhs, rhs);
+    } else if (op == BinaryOpType::div && real) {
+      llvm_val[stmt] = builder->CreateFDiv(lhs, rhs);
+    } else if (op == BinaryOpType::max && real) {
+      llvm_val[stmt] = builder->CreateMaxNum(lhs, rhs);
+    } else if (op == BinaryOpType::min && real) {
+      llvm_val[stmt] = builder->CreateMinNum(lhs, rhs);
+    } else {
+      TI_P(binary_op_type_name(op));
+      TI_NOT_IMPLEMENTED
+    }
+    return;
+  }
+
   if (op == BinaryOpType::add) {
     if (is_real(stmt->ret_type)) {
       llvm_val[stmt] =
@@ -888,7 +949,8 @@ void CodeGenLLVM::visit(ContinueStmt *stmt) {
     }
     return false;
   };
-  if (stmt_in_off_range_for()) {
+  if (stmt_in_off_range_for() && current_loop_reentry == nullptr) {
+    // The loop body is a function of a single index.
     builder->CreateRetVoid();
   } else {
     TI_ASSERT(current_loop_reentry != nullptr);
@@ -937,6 +999,13 @@ void CodeGenLLVM::emit_list_gen(OffloadedStmt *listgen) {
     // Since there's only one container to expand, we need a special kernel for
     // more parallelism.
     call("element_listgen_root", get_runtime(), meta_parent, meta_child);
+  } else if (snode_parent->type == SNodeType::hash) {
+    // Hash containers are listed in slot space.
+    call("element_listgen_hash", get_runtime(), meta_parent, meta_child);
+  } else if (arch_is_cpu(prog->config.arch)) {
+    // Split the parent elements among the CPU threads.
+    call("element_listgen_nonroot_cpu", get_runtime(), meta_parent, meta_child,
+         tlctx->get_constant(prog->config.cpu_max_num_threads));
   } else {
     call("element_listgen_nonroot", get_runtime(), meta_parent, meta_child);
   }
@@ -944,7 +1013,8 @@ void CodeGenLLVM::emit_list_gen(OffloadedStmt *listgen) {
 
 void CodeGenLLVM::emit_gc(OffloadedStmt *stmt) {
   auto snode = stmt->snode->id;
-  call("node_gc", get_runtime(), tlctx->get_constant(snode));
+  call("gc_parallel_cpu", get_context(), tlctx->get_constant(snode),
+       tlctx->get_constant(prog->config.cpu_max_num_threads));
 }
 
 llvm::Value *CodeGenLLVM::create_call(llvm::Value *func,
@@ -1095,7 +1165,7 @@ void CodeGenLLVM::visit(ReturnStmt *stmt) {
     auto extended = builder->CreateZExt(
         builder->CreateBitCast(llvm_val[stmt->value], intermediate_type),
         dest_ty);
-    create_call("LLVMRuntime_store_result", {get_runtime(), extended});
+    create_call("RuntimeContext_store_result", {get_context(), extended});
   }
 }
 
@@ -1361,6 +1431,20 @@ void CodeGenLLVM::visit(GlobalLoadStmt *stmt) {
   }
 }
 
+void CodeGenLLVM::visit(VectorPackStmt *stmt) {
+  llvm::Value *vec =
+      llvm::UndefValue::get(tlctx->get_data_type(stmt->ret_type));
+  for (int i = 0; i < (int)stmt->values.size(); i++) {
+    vec = builder->CreateInsertElement(vec, llvm_val[stmt->values[i]], i);
+  }
+  llvm_val[stmt] = vec;
+}
+
+void CodeGenLLVM::visit(VectorExtractStmt *stmt) {
+  llvm_val[stmt] =
+      builder->CreateExtractElement(llvm_val[stmt->input], stmt->index);
+}
+
 void CodeGenLLVM::visit(ElementShuffleStmt *stmt){
     TI_NOT_IMPLEMENTED
     /*
@@ -1508,7 +1592,8 @@ void CodeGenLLVM::visit(SNodeLookupStmt *stmt) {
   } else if (snode->type == SNodeType::dense ||
              snode->type == SNodeType::pointer ||
              snode->type == SNodeType::dynamic ||
-             snode->type == SNodeType::bitmasked) {
+             snode->type == SNodeType::bitmasked ||
+             snode->type == SNodeType::hash) {
     if (stmt->activate) {
       call(snode, llvm_val[stmt->input_snode], "activate",
            {llvm_val[stmt->input_index]});
@@ -1607,9 +1692,9 @@ std::string CodeGenLLVM::init_offloaded_task_function(OffloadedStmt *stmt,
       llvm::FunctionType::get(llvm::Type::getVoidTy(*llvm_context),
                               {llvm::PointerType::get(context_ty, 0)}, false);
 
-  auto task_kernel_name = fmt::format("{}_{}_{}{}", kernel_name, task_counter,
-                                      stmt->task_name(), suffix);
-  task_counter += 1;
+  auto task_kernel_name =
+      fmt::format("{}_{}_{}{}", kernel_name, task_counter++, stmt->task_name(),
+                  suffix);
   func = llvm::Function::Create(task_function_type,
                                 llvm::Function::ExternalLinkage,
                                 task_kernel_name, module.get());
@@ -1696,6 +1781,11 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
     }
   }
 
+  // Cells of a hash leaf block are not laid out by their indices, so there is
+  // no block corner to cache from.
+  TI_ERROR_IF(leaf_block->type == SNodeType::hash && stmt->bls_prologue,
+              "Block local storage is not supported on hash SNodes");
+
   {
     // Create the loop body function
     auto guard = get_function_creation_guard({
@@ -1717,6 +1807,7 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
      *   goto loop_test
      *
      * loop_test:
+     *   (CPU, bitmasked) loop_index = next active voxel >= loop_index
      *   if (loop_index < upper_bound)
      *     goto loop_body
      *   else
@@ -1774,6 +1865,16 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
       call("block_barrier");  // "__syncthreads()"
     }
 
+    // The cells of a dense leaf block are visited in index order, with
+    // bounds checks that LLVM turns into masks, so the loop over them can be
+    // vectorized like the one of a range-for.
+    const bool vectorize = !spmd && arch_is_cpu(current_arch()) &&
+                           prog->config.cpu_loop_vectorize &&
+                           leaf_block->type == SNodeType::dense;
+    if (vectorize) {
+      hoist_loop_invariants(stmt->body.get());
+    }
+
     llvm::Value *thread_idx = nullptr, *block_dim = nullptr;
 
     if (spmd) {
@@ -1808,6 +1909,14 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
       //     goto func_exit
 
       builder->SetInsertPoint(loop_test_bb);
+      if (!spmd && leaf_block->type == SNodeType::bitmasked) {
+        // A single thread walks the whole block, so it can jump over the
+        // inactive voxels a mask word at a time.
+        auto next_active =
+            call(leaf_block, element.get("element"), "find_next_active",
+                 {builder->CreateLoad(loop_index), upper_bound});
+        builder->CreateStore(next_active, loop_index);
+      }
       auto cond =
           builder->CreateICmp(llvm::CmpInst::Predicate::ICMP_SLT,
                               builder->CreateLoad(loop_index), upper_bound);
@@ -1821,8 +1930,15 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
     // initialize the coordinates
     auto new_coordinates = create_entry_block_alloca(physical_coordinate_ty);
 
-    create_call(refine, {parent_coordinates, new_coordinates,
-                         builder->CreateLoad(loop_index)});
+    // Hash leaf blocks are looped over in slot space. Translate the slot
+    // into the index of the cell stored there.
+    llvm::Value *cell_index = builder->CreateLoad(loop_index);
+    if (leaf_block->type == SNodeType::hash) {
+      cell_index = call(leaf_block, element.get("element"), "slot_get_index",
+                        {cell_index});
+    }
+
+    create_call(refine, {parent_coordinates, new_coordinates, cell_index});
 
     // One more refine step is needed for bit_arrays to make final coordinates
     // non-consecutive, since each thread will process multiple
@@ -1874,7 +1990,7 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
       }
     }
 
-    if (snode->type == SNodeType::bitmasked ||
+    if ((snode->type == SNodeType::bitmasked && spmd) ||
         snode->type == SNodeType::pointer) {
       // test whether the current voxel is active or not
       auto is_active = call(snode, element.get("element"), "is_active",
@@ -1882,6 +1998,12 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
       is_active =
           builder->CreateTrunc(is_active, llvm::Type::getInt1Ty(*llvm_context));
       exec_cond = builder->CreateAnd(exec_cond, is_active);
+    } else if (snode->type == SNodeType::hash) {
+      auto is_active = call(snode, element.get("element"), "slot_is_active",
+                            {builder->CreateLoad(loop_index)});
+      is_active =
+          builder->CreateTrunc(is_active, llvm::Type::getInt1Ty(*llvm_context));
+      exec_cond = builder->CreateAnd(exec_cond, is_active);
     }
 
     builder->CreateCondBr(exec_cond, struct_for_body_bb, body_tail_bb);
@@ -1904,7 +2026,10 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
       } else {
         create_increment(loop_index, tlctx->get_constant(1));
       }
-      builder->CreateBr(loop_test_bb);
+      auto latch = builder->CreateBr(loop_test_bb);
+      if (vectorize) {
+        mark_loop_vectorizable(latch);
+      }
 
       builder->SetInsertPoint(func_exit);
     }
@@ -1920,9 +2045,21 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
     }
   }
 
-  int list_element_size = std::min(leaf_block->max_num_elements(),
+  // Hash leaf blocks are iterated in slot space, which outgrows the index
+  // space once slot tables are chained, so their list elements are full size.
+  int64 num_leaf_elements = leaf_block->type == SNodeType::hash
+                                ? (int64)taichi_listgen_max_element_size
+                                : leaf_block->max_num_elements();
+  int list_element_size = std::min(num_leaf_elements,
                                    (int64)taichi_listgen_max_element_size);
-  int num_splits = std::max(1, list_element_size / stmt->block_dim);
+  // Not written back to |stmt|: the IR may be shared with other threads, e.g.
+  // kernel launches while a compile worker tiers the kernel up.
+  int block_dim = stmt->block_dim;
+  if (arch_is_cpu(current_arch())) {
+    block_dim =
+        std::min(stmt->snode->parent->max_num_elements(), (int64)block_dim);
+  }
+  int num_splits = std::max(1, list_element_size / block_dim);
 
   auto struct_for_func = get_runtime_function("parallel_struct_for");
 
@@ -1964,13 +2101,27 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
 
     struct_for_func = patched_struct_for_func;
   }
+
+  // The bytes of the container of each list element that the CPU threads
+  // prefetch before they visit the element
+  int prefetch_bytes = 0;
+  if (arch_is_cpu(current_arch()) && prog->config.cpu_struct_for_prefetch) {
+    prefetch_bytes = (int)std::min<int64>(
+        leaf_block->cell_size_bytes * leaf_block->max_num_elements(),
+        taichi_cpu_struct_for_max_prefetch_bytes);
+    if (prefetch_bytes > 0) {
+      stat.add("codegen_struct_for_prefetches");
+    }
+  }
+
   // Loop over nodes in the element list, in parallel
   create_call(
       struct_for_func,
       {get_context(), tlctx->get_constant(leaf_block->id),
        tlctx->get_constant(list_element_size), tlctx->get_constant(num_splits),
        body, tlctx->get_constant(stmt->tls_size),
-       tlctx->get_constant(stmt->num_cpu_threads)});
+       tlctx->get_constant(stmt->num_cpu_threads),
+       tlctx->get_constant(prefetch_bytes)});
   // TODO: why do we need num_cpu_threads on GPUs?
 
   current_coordinates = nullptr;
@@ -1978,6 +2129,30 @@ void CodeGenLLVM::create_offload_struct_for(OffloadedStmt *stmt, bool spmd) {
   block_corner_coordinates = nullptr;
 }
 
+void CodeGenLLVM::hoist_loop_invariants(Block *body) {
+  auto invariants = irpass::analysis::gather_statements(body, [](Stmt *s) {
+    return s->is<ArgLoadStmt>() || s->is<ExternalTensorShapeAlongAxisStmt>() ||
+           s->is<GetRootStmt>();
+  });
+  for (auto *s : invariants) {
+    s->accept(this);
+    hoisted_stmts.insert(s);
+  }
+}
+
+void CodeGenLLVM::mark_loop_vectorizable(llvm::BranchInst *latch) {
+  // A loop ID is a distinct node whose first operand is itself.
+  auto placeholder = llvm::MDNode::getTemporary(*llvm_context, llvm::None);
+  llvm::Metadata *enable[] = {
+      llvm::MDString::get(*llvm_context, "llvm.loop.vectorize.enable"),
+      llvm::ConstantAsMetadata::get(builder->getTrue())};
+  llvm::Metadata *ops[] = {placeholder.get(),
+                           llvm::MDNode::get(*llvm_context, enable)};
+  auto loop_id = llvm::MDNode::getDistinct(*llvm_context, ops);
+  loop_id->replaceOperandWith(0, loop_id);
+  latch->setMetadata(llvm::LLVMContext::MD_loop, loop_id);
+}
+
 void CodeGenLLVM::visit(LoopIndexStmt *stmt) {
   if (stmt->loop->is<OffloadedStmt>() &&
       stmt->loop->as<OffloadedStmt>()->task_type ==
@@ -2071,7 +2246,23 @@ void CodeGenLLVM::visit(ClearListStmt *stmt) {
   auto snode_parent = stmt->snode->parent;
   auto meta_child = cast_pointer(emit_struct_meta(snode_child), "StructMeta");
   auto meta_parent = cast_pointer(emit_struct_meta(snode_parent), "StructMeta");
-  call("clear_list", get_runtime(), meta_parent, meta_child);
+  // The loop bounds of the list elements depend on the number of cells of the
+  // child containers, which only changes for dynamic and hash SNodes.
+  bool child_size_varies = snode_child->type == SNodeType::dynamic ||
+                           snode_child->type == SNodeType::hash;
+  // On CPUs, the cells toggled in pointer and bitmasked SNodes are logged, and
+  // element_listgen_nonroot_cpu applies them to the lists of their children.
+  auto logs_cells = [&](SNode *snode) {
+    return arch_is_cpu(prog->config.arch) &&
+           (snode->type == SNodeType::pointer ||
+            snode->type == SNodeType::bitmasked);
+  };
+  bool update_incrementally = logs_cells(snode_parent) && !child_size_varies;
+  bool index_list = update_incrementally || logs_cells(snode_child);
+  call("clear_list", get_runtime(), meta_parent, meta_child,
+       tlctx->get_constant((int)child_size_varies),
+       tlctx->get_constant((int)update_incrementally),
+       tlctx->get_constant((int)index_list));
 }
 
 void CodeGenLLVM::visit(InternalFuncStmt *stmt) {
@@ -2232,18 +2423,42 @@ void CodeGenLLVM::eliminate_unused_functions() {
 
 FunctionType CodeGenLLVM::compile_module_to_executable() {
   TI_AUTO_PROF
+  return create_cpu_kernel_launcher(kernel, kernel_name, compile_module());
+}
+
+std::vector<OffloadedTask> CodeGenLLVM::compile_module(bool emit_object_code) {
   eliminate_unused_functions();
 
-  tlctx->add_module(std::move(module));
+  JITModule *jit_module = nullptr;
+  if (offline_cache_key.empty() && !emit_object_code && llvm_opt_level == 3) {
+    jit_module = tlctx->add_module(std::move(module));
+  } else {
+    LlvmOfflineCache::KernelCacheData data;
+    jit_module = tlctx->add_module_as_object(std::move(module),
+                                             data.object_code, llvm_opt_level);
+    if (!offline_cache_key.empty() && llvm_opt_level == 3) {
+      for (auto &task : offloaded_tasks) {
+        data.offloaded_task_names.push_back(task.name);
+      }
+      prog->get_llvm_program_impl()->get_offline_cache()->store(
+          offline_cache_key, offline_cache_ir, std::move(data));
+    }
+  }
 
+  // Removes the module once the kernel no longer needs it.
+  auto module_handle = tlctx->jit->make_module_handle(jit_module);
   for (auto &task : offloaded_tasks) {
-    task.compile();
+    task.compile(module_handle);
   }
-  auto offloaded_tasks_local = offloaded_tasks;
-  auto kernel_name_ = kernel_name;
-  return [offloaded_tasks_local, kernel_name_,
-          kernel = this->kernel](RuntimeContext &context) {
-    TI_TRACE("Launching kernel {}", kernel_name_);
+  return offloaded_tasks;
+}
+
+FunctionType CodeGenLLVM::create_cpu_kernel_launcher(
+    Kernel *kernel,
+    const std::string &kernel_name,
+    const std::vector<OffloadedTask> &offloaded_tasks) {
+  return [offloaded_tasks, kernel_name, kernel](RuntimeContext &context) {
+    TI_TRACE("Launching kernel {}", kernel_name);
     auto args = kernel->args;
     // For taichi ndarrays, context.args saves pointer to its
     // |DeviceAllocation|, CPU backend actually want to use the raw ptr here.
@@ -2258,7 +2473,7 @@ FunctionType CodeGenLLVM::compile_module_to_executable() {
         context.set_device_allocation(i, false);
       }
     }
-    for (auto task : offloaded_tasks_local) {
+    for (auto task : offloaded_tasks) {
       task(&context);
     }
   };
@@ -2,8 +2,10 @@
 #pragma once
 #ifdef TI_WITH_LLVM
 
+#include <atomic>
 #include <set>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "taichi/ir/ir.h"
 #include "taichi/program/program.h"
@@ -19,6 +21,7 @@ class OffloadedTask {
   CodeGenLLVM *codegen;
   using task_fp_type = int32 (*)(void *);
   task_fp_type func;
+  std::shared_ptr<JITModule> module;
 
   int block_dim;
   int grid_dim;
@@ -29,7 +32,9 @@ class OffloadedTask {
 
   void end();
 
-  void compile();
+  // Looks up the task function in the JIT module, and keeps the module alive
+  // as long as the task. See JITSession::make_module_handle().
+  void compile(const std::shared_ptr<JITModule> &module);
 
   void operator()(RuntimeContext *context);
 };
@@ -49,7 +54,8 @@ class FunctionCreationGuard {
 
 class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
  public:
-  static uint64 task_counter;
+  // Offloaded tasks of different kernels may be compiled concurrently.
+  static std::atomic<uint64> task_counter;
 
   Kernel *kernel;
   IRNode *ir;
@@ -72,10 +78,20 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
   OffloadedStmt *current_offload{nullptr};
   std::unique_ptr<OffloadedTask> current_task;
   std::vector<OffloadedTask> offloaded_tasks;
+  // If not empty, the object code of the kernel is stored in the offline
+  // cache under this key, along with the printed IR.
+  std::string offline_cache_key;
+  std::string offline_cache_ir;
+  // The LLVM optimization level that compile_module() uses on CPUs. Code
+  // compiled below level 3 is not stored in the offline cache.
+  int llvm_opt_level{3};
   llvm::BasicBlock *func_body_bb;
   std::set<std::string> linked_modules;
 
   std::unordered_map<const Stmt *, std::vector<llvm::Value *>> loop_vars_llvm;
+  // Statements emitted before the loop of their offload, see
+  // hoist_loop_invariants()
+  std::unordered_set<Stmt *> hoisted_stmts;
 
   using IRVisitor::visit;
   using LLVMModuleBuilder::call;
@@ -124,6 +140,23 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   virtual FunctionType compile_module_to_executable();
 
+  /**
+   * Optimizes and JIT compiles the module on CPUs.
+   *
+   * @param emit_object_code Whether to generate the machine code in this
+   * thread. Otherwise, it is generated when the tasks are looked up, which
+   * holds the lock of the JIT session.
+   * @return The compiled offloaded tasks.
+   */
+  std::vector<OffloadedTask> compile_module(bool emit_object_code = false);
+
+  // Creates the function that launches the compiled offloaded tasks of a
+  // kernel on CPUs.
+  static FunctionType create_cpu_kernel_launcher(
+      Kernel *kernel,
+      const std::string &kernel_name,
+      const std::vector<OffloadedTask> &offloaded_tasks);
+
   virtual FunctionType gen();
 
   // For debugging only
@@ -274,6 +307,10 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   void visit(ElementShuffleStmt *stmt) override;
 
+  void visit(VectorPackStmt *stmt) override;
+
+  void visit(VectorExtractStmt *stmt) override;
+
   void visit(GetRootStmt *stmt) override;
 
   void visit(BitExtractStmt *stmt) override;
@@ -318,6 +355,15 @@ class CodeGenLLVM : public IRVisitor, public LLVMModuleBuilder {
 
   void create_offload_struct_for(OffloadedStmt *stmt, bool spmd = false);
 
+  // Emits the statements of |body| that only read the kernel arguments or the
+  // roots of the SNode trees, which no iteration writes, before the loop over
+  // the iterations. LLVM cannot tell that the stores of the loop do not alias
+  // them, which keeps it from vectorizing the loop.
+  void hoist_loop_invariants(Block *body);
+
+  // Asks LLVM to vectorize the loop whose back edge is |latch|.
+  void mark_loop_vectorizable(llvm::BranchInst *latch);
+
   void visit(LoopIndexStmt *stmt) override;
 
   void visit(LoopLinearIndexStmt *stmt) override;
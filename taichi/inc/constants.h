@@ -26,6 +26,25 @@ constexpr std::size_t taichi_result_buffer_runtime_query_id = 2;
 
 constexpr int taichi_listgen_max_element_size = 1024;
 
+// The BLS buffers of CPU struct-fors start at this alignment in the TLS
+// buffers, which are aligned to it.
+constexpr std::size_t taichi_cpu_bls_alignment = 64;
+// The TLS buffers of CPU tasks live on the stacks of the thread pool workers,
+// so BLS buffers that would make them larger than this are not used.
+constexpr std::size_t taichi_cpu_max_tls_buffer_size = 128 << 10;
+
+constexpr int taichi_cpu_cache_line_size = 64;
+// CPU range-fors store to the write-only fields of at least this size, which
+// would not stay in the caches anyway, with non-temporal stores.
+constexpr std::size_t taichi_cpu_nontemporal_store_min_bytes = 32 << 20;
+// CPU struct-fors prefetch up to this many bytes of the containers of the
+// list elements that they are about to visit.
+constexpr int taichi_cpu_struct_for_max_prefetch_bytes = 1024;
+
+// Hash SNodes grow by chaining slot tables of doubling capacities.
+constexpr int taichi_hash_max_num_tables = 24;
+constexpr int taichi_hash_initial_table_size = 4096;
+
 template <typename T, typename G>
 T taichi_union_cast_with_different_sizes(G g) {
   union {
@@ -69,6 +69,8 @@ PER_STATEMENT(GetChStmt)
 PER_STATEMENT(LocalLoadStmt)
 PER_STATEMENT(GlobalPtrStmt)
 PER_STATEMENT(ElementShuffleStmt)
+PER_STATEMENT(VectorPackStmt)
+PER_STATEMENT(VectorExtractStmt)
 
 // Offloaded
 PER_STATEMENT(OffloadedStmt)
@@ -128,6 +128,25 @@ void get_meta_input_value_states(IRNode *root, TaskMeta *meta, IRBank *ir_bank);
 Stmt *get_store_data(Stmt *store_stmt);
 std::vector<Stmt *> get_store_destination(Stmt *store_stmt);
 bool has_store_or_atomic(IRNode *root, const std::vector<Stmt *> &vars);
+
+/**
+ * Hashes the structure of an IRNode, without printing it.
+ * Roots that are same_statements() have the same hash. It does not depend on
+ * the statement ids, so re_id() is not needed before hashing.
+ *
+ * The hash is computed from scratch on every call. Callers such as IRBank
+ * cache it per root. Passes modify the fields and operands of statements in
+ * place, without any notification, so a per-statement cache could not be
+ * invalidated reliably.
+ *
+ * @param root
+ *   The root to hash.
+ *
+ * @return
+ *   The hash. It is the same in all processes running the same build, unless
+ *   the IR refers to process-specific objects such as external functions.
+ */
+uint64 hash_ir(IRNode *root);
 std::pair<bool, Stmt *> last_store_or_atomic(IRNode *root, Stmt *var);
 
 /**
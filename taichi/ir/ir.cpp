@@ -1,5 +1,7 @@
 #include "taichi/ir/ir.h"
 
+#include <algorithm>
+#include <cstring>
 #include <numeric>
 #include <thread>
 #include <unordered_map>
@@ -7,6 +9,8 @@
 // #include "taichi/ir/analysis.h"
 #include "taichi/ir/statements.h"
 #include "taichi/ir/transforms.h"
+#include "taichi/ir/type_utils.h"
+#include "taichi/program/function.h"
 
 namespace taichi {
 namespace lang {
@@ -18,6 +22,8 @@ std::string snode_access_flag_name(SNodeAccessFlag type) {
     return "read_only";
   } else if (type == SNodeAccessFlag::mesh_local) {
     return "mesh_local";
+  } else if (type == SNodeAccessFlag::write_only) {
+    return "write_only";
   } else {
     TI_ERROR("Undefined SNode AccessType (value={})", int(type));
   }
@@ -83,6 +89,64 @@ class StatementTypeNameVisitor : public IRVisitor {
 #undef PER_STATEMENT
 };
 
+std::size_t hash_field_value(const DataType &dt) {
+  if (auto primitive = dt->cast<PrimitiveType>()) {
+    return (std::size_t)primitive->type;
+  } else if (auto pointer = dt->cast<PointerType>()) {
+    return hash_combine(
+        10007, hash_field_value(DataType(pointer->get_pointee_type())));
+  } else {
+    // DataType::hash() does not support the compound types yet.
+    return std::hash<std::string>{}(dt->to_string());
+  }
+}
+
+std::size_t hash_field_value(const TypedConstant &value) {
+  auto ret = hash_field_value(value.dt);
+  if (!value.dt->is<PrimitiveType>()) {
+    return ret;
+  }
+  // The bits above the size of the type may be uninitialized.
+  int size = data_type_size(value.dt);
+  if (size > 0) {
+    uint64 bits = 0;
+    std::memcpy(&bits, &value.value_bits, std::min(size, (int)sizeof(bits)));
+    ret = hash_combine(ret, (std::size_t)bits);
+  }
+  return ret;
+}
+
+std::size_t hash_field_value(Function *func) {
+  if (func == nullptr) {
+    return 0;
+  }
+  return std::hash<std::string>{}(func->get_name());
+}
+
+std::size_t hash_field_value(mesh::Mesh *mesh) {
+  if (mesh == nullptr) {
+    return 0;
+  }
+  std::size_t ret = hash_combine(0, mesh->num_patches);
+  for (auto type : {mesh::MeshElementType::Vertex, mesh::MeshElementType::Edge,
+                    mesh::MeshElementType::Face, mesh::MeshElementType::Cell}) {
+    auto num_elements = mesh->num_elements.find(type);
+    auto owned_offset = mesh->owned_offset.find(type);
+    ret = hash_combine(ret, num_elements == mesh->num_elements.end()
+                                ? -1
+                                : num_elements->second);
+    ret = hash_combine(ret, owned_offset == mesh->owned_offset.end()
+                                ? -1
+                                : StmtFieldSNode::get_snode_id(
+                                      owned_offset->second));
+  }
+  for (auto &[conv, snode] : mesh->index_mapping) {
+    ret = hash_combine(ret, (int)conv.first * 16 + (int)conv.second);
+    ret = hash_combine(ret, StmtFieldSNode::get_snode_id(snode));
+  }
+  return ret;
+}
+
 int StmtFieldSNode::get_snode_id(SNode *snode) {
   if (snode == nullptr)
     return -1;
@@ -98,6 +162,10 @@ bool StmtFieldSNode::equal(const StmtField *other_generic) const {
   }
 }
 
+std::size_t StmtFieldSNode::hash() const {
+  return hash_field_value(get_snode_id(snode_));
+}
+
 bool StmtFieldMemoryAccessOptions::equal(const StmtField *other_generic) const {
   if (auto other =
           dynamic_cast<const StmtFieldMemoryAccessOptions *>(other_generic)) {
@@ -108,6 +176,15 @@ bool StmtFieldMemoryAccessOptions::equal(const StmtField *other_generic) const {
   }
 }
 
+std::size_t StmtFieldMemoryAccessOptions::hash() const {
+  std::size_t ret = 0;
+  for (auto &[snode, flags] : opt_.get_all()) {
+    ret += hash_combine(StmtFieldSNode::get_snode_id(snode),
+                        hash_field_value(flags));
+  }
+  return ret;
+}
+
 bool StmtFieldManager::equal(StmtFieldManager &other) const {
   if (fields.size() != other.fields.size()) {
     return false;
@@ -121,6 +198,14 @@ bool StmtFieldManager::equal(StmtFieldManager &other) const {
   return true;
 }
 
+std::size_t StmtFieldManager::hash() const {
+  std::size_t ret = fields.size();
+  for (auto &field : fields) {
+    ret = hash_combine(ret, field->hash());
+  }
+  return ret;
+}
+
 std::atomic<int> Stmt::instance_id_counter(0);
 
 Stmt::Stmt() : field_manager(this), fields_registered(false) {
@@ -262,6 +347,20 @@ void Block::erase(Stmt *stmt) {
   }
 }
 
+void Block::erase(const std::unordered_set<Stmt *> &stmts) {
+  std::vector<std::unique_ptr<Stmt>> remaining;
+  remaining.reserve(statements.size());
+  for (auto &stmt : statements) {
+    if (stmts.find(stmt.get()) != stmts.end()) {
+      stmt->erased = true;
+      trash_bin.push_back(std::move(stmt));
+    } else {
+      remaining.push_back(std::move(stmt));
+    }
+  }
+  statements = std::move(remaining);
+}
+
 std::unique_ptr<Stmt> Block::extract(int location) {
   auto stmt = std::move(statements[location]);
   statements.erase(statements.begin() + location);
@@ -510,8 +609,19 @@ bool DelayedIRModifier::modify_ir() {
     i.first->parent->insert_after(i.first, std::move(i.second));
   }
   to_insert_after_.clear();
+  // Searching the block for each statement would be quadratic in the size
+  // of the block.
+  std::vector<Block *> erase_from;
+  std::unordered_map<Block *, std::unordered_set<Stmt *>> stmts_to_erase;
   for (auto &stmt : to_erase_) {
-    stmt->parent->erase(stmt);
+    auto &stmts = stmts_to_erase[stmt->parent];
+    if (stmts.empty()) {
+      erase_from.push_back(stmt->parent);
+    }
+    stmts.insert(stmt);
+  }
+  for (auto *block : erase_from) {
+    block->erase(stmts_to_erase[block]);
   }
   to_erase_.clear();
   for (auto &i : to_replace_with_) {
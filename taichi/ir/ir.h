@@ -3,6 +3,8 @@
 #pragma once
 
 #include <atomic>
+#include <cstring>
+#include <set>
 #include <unordered_set>
 #include <unordered_map>
 #include <variant>
@@ -26,9 +28,19 @@ using pStmt = std::unique_ptr<Stmt>;
 class SNode;
 
 class Kernel;
+class Function;
 struct CompileConfig;
 
-enum class SNodeAccessFlag : int { block_local, read_only, mesh_local };
+namespace mesh {
+class Mesh;
+}  // namespace mesh
+
+enum class SNodeAccessFlag : int {
+  block_local,
+  read_only,
+  mesh_local,
+  write_only
+};
 std::string snode_access_flag_name(SNodeAccessFlag type);
 
 class MemoryAccessOptions {
@@ -383,12 +395,50 @@ struct LaneAttribute {
   }
 };
 
+inline std::size_t hash_combine(std::size_t seed, std::size_t value) {
+  return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+// Hashes of statement field values. Apart from the other pointers, they do not
+// depend on the process, so that they can be used in on-disk cache keys.
+std::size_t hash_field_value(const DataType &dt);
+std::size_t hash_field_value(const TypedConstant &value);
+// By the name of the function
+std::size_t hash_field_value(Function *func);
+// By the shape of the mesh and the ids of its SNodes
+std::size_t hash_field_value(mesh::Mesh *mesh);
+
+template <typename T>
+std::size_t hash_field_value(const T &value) {
+  if constexpr (std::is_enum_v<T> || std::is_integral_v<T> ||
+                std::is_pointer_v<T>) {
+    return (std::size_t)value;
+  } else if constexpr (std::is_floating_point_v<T>) {
+    uint64 bits = 0;
+    std::memcpy(&bits, &value, sizeof(T));
+    return (std::size_t)bits;
+  } else if constexpr (is_specialization<T, std::unordered_set>::value ||
+                       is_specialization<T, std::set>::value) {
+    // Independent of the iteration order
+    std::size_t ret = value.size();
+    for (auto &element : value) {
+      ret += hash_combine(0, hash_field_value(element));
+    }
+    return ret;
+  } else {
+    return std::hash<T>{}(value);
+  }
+}
+
 class StmtField {
  public:
   StmtField() = default;
 
   virtual bool equal(const StmtField *other) const = 0;
 
+  // Fields that are equal have the same hash.
+  virtual std::size_t hash() const = 0;
+
   virtual ~StmtField() = default;
 };
 
@@ -423,6 +473,14 @@ class StmtFieldNumeric final : public StmtField {
       return false;
     }
   }
+
+  std::size_t hash() const override {
+    if (std::holds_alternative<T *>(value_)) {
+      return hash_field_value(*std::get<T *>(value_));
+    } else {
+      return hash_field_value(std::get<T>(value_));
+    }
+  }
 };
 
 class StmtFieldSNode final : public StmtField {
@@ -436,6 +494,8 @@ class StmtFieldSNode final : public StmtField {
   static int get_snode_id(SNode *snode);
 
   bool equal(const StmtField *other_generic) const override;
+
+  std::size_t hash() const override;
 };
 
 class StmtFieldMemoryAccessOptions final : public StmtField {
@@ -448,6 +508,8 @@ class StmtFieldMemoryAccessOptions final : public StmtField {
   }
 
   bool equal(const StmtField *other_generic) const override;
+
+  std::size_t hash() const override;
 };
 
 class StmtFieldManager {
@@ -475,6 +537,8 @@ class StmtFieldManager {
   }
 
   bool equal(StmtFieldManager &other) const;
+
+  std::size_t hash() const;
 };
 
 #define TI_STMT_DEF_FIELDS(...) TI_IO_DEF(__VA_ARGS__)
@@ -623,6 +687,8 @@ class Block : public IRNode {
   int locate(Stmt *stmt);
   void erase(int location);
   void erase(Stmt *stmt);
+  // Erases |stmts| in a single pass over the block.
+  void erase(const std::unordered_set<Stmt *> &stmts);
   std::unique_ptr<Stmt> extract(int location);
   std::unique_ptr<Stmt> extract(Stmt *stmt);
 
@@ -947,6 +947,50 @@ class ElementShuffleStmt : public Stmt {
   TI_DEFINE_ACCEPT_AND_CLONE
 };
 
+/**
+ * Packs scalars into the lanes of a vector. Only irpass::slp_vectorize()
+ * creates vectors, right before codegen.
+ */
+class VectorPackStmt : public Stmt {
+ public:
+  std::vector<Stmt *> values;
+
+  explicit VectorPackStmt(const std::vector<Stmt *> &values) : values(values) {
+    TI_ASSERT(values.size() > 1);
+    ret_type = TypeFactory::get_instance().get_vector_type(values.size(),
+                                                           values[0]->ret_type);
+    TI_STMT_REG_FIELDS;
+  }
+
+  bool has_global_side_effect() const override {
+    return false;
+  }
+
+  TI_STMT_DEF_FIELDS(ret_type, values);
+  TI_DEFINE_ACCEPT_AND_CLONE
+};
+
+/**
+ * Extracts the |index|-th lane of a vector.
+ */
+class VectorExtractStmt : public Stmt {
+ public:
+  Stmt *input;
+  int index;
+
+  VectorExtractStmt(Stmt *input, int index) : input(input), index(index) {
+    ret_type = input->ret_type->as<VectorType>()->get_element_type();
+    TI_STMT_REG_FIELDS;
+  }
+
+  bool has_global_side_effect() const override {
+    return false;
+  }
+
+  TI_STMT_DEF_FIELDS(ret_type, input, index);
+  TI_DEFINE_ACCEPT_AND_CLONE
+};
+
 // TODO: remove this (replace with input + ConstStmt(offset))
 class IntegerOffsetStmt : public Stmt {
  public:
@@ -55,7 +55,7 @@ bool inlining(IRNode *root,
               const InliningPass::Args &args);
 void loop_vectorize(IRNode *root, const CompileConfig &config);
 void bit_loop_vectorize(IRNode *root);
-void slp_vectorize(IRNode *root);
+bool slp_vectorize(IRNode *root, const CompileConfig &config);
 void vector_split(IRNode *root, int max_width, bool serial_schedule);
 void replace_all_usages_with(IRNode *root, Stmt *old_stmt, Stmt *new_stmt);
 bool check_out_of_bound(IRNode *root,
@@ -77,6 +77,9 @@ void demote_mesh_statements(IRNode *root,
                             const DemoteMeshStatements::Args &args);
 bool remove_loop_unique(IRNode *root);
 bool remove_range_assumption(IRNode *root);
+// Replaces the loads of the scalar arguments in |values| with constants.
+bool specialize_args(IRNode *root,
+                     const std::unordered_map<int, TypedConstant> &values);
 bool lower_access(IRNode *root,
                   const CompileConfig &config,
                   const LowerAccessPass::Args &args);
@@ -122,7 +125,7 @@ void demote_dense_struct_fors(IRNode *root, bool packed);
 void demote_no_access_mesh_fors(IRNode *root);
 bool demote_atomics(IRNode *root, const CompileConfig &config);
 void reverse_segments(IRNode *root);  // for autograd
-void detect_read_only(IRNode *root);
+void detect_read_only(IRNode *root, const CompileConfig &config);
 void optimize_bit_struct_stores(IRNode *root,
                                 const CompileConfig &config,
                                 AnalysisManager *amgr);
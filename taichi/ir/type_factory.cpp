@@ -23,6 +23,7 @@ Type *TypeFactory::get_primitive_type(PrimitiveTypeID id) {
 }
 
 Type *TypeFactory::get_vector_type(int num_elements, Type *element) {
+  std::lock_guard<std::mutex> _(mut_);
   auto key = std::make_pair(num_elements, element);
   if (vector_types_.find(key) == vector_types_.end()) {
     vector_types_[key] = std::make_unique<VectorType>(num_elements, element);
@@ -27,6 +27,15 @@ std::unique_ptr<JITSession> JITSession::create(Arch arch) {
 #endif
 }
 
+std::shared_ptr<JITModule> JITSession::make_module_handle(JITModule *module) {
+  std::weak_ptr<bool> alive = alive_;
+  return std::shared_ptr<JITModule>(module, [this, alive](JITModule *module) {
+    if (alive.lock()) {
+      remove_module(module);
+    }
+  });
+}
+
 #ifdef TI_WITH_LLVM
 std::size_t JITSession::get_type_size(llvm::Type *type) {
   return get_data_layout().getTypeAllocSize(type);
@@ -22,7 +22,37 @@ class JITSession {
   virtual JITModule *add_module(std::unique_ptr<llvm::Module> M,
                                 int max_reg = 0) = 0;
 
-  // virtual void remove_module(JITModule *module) = 0;
+  // Compiles the module to object code like add_module does, and also returns
+  // the object code so that it can be added again with add_object.
+  // |opt_level| (0-3) trades the speed of the code for that of compilation.
+  virtual JITModule *add_module_as_object(std::unique_ptr<llvm::Module> M,
+                                          std::string &object_code,
+                                          int opt_level = 3) {
+    TI_NOT_IMPLEMENTED
+  }
+
+  // Optimizes the module and compiles it to object code for the LLVM CPU
+  // |target_cpu|, without adding it.
+  virtual std::string compile_to_object(std::unique_ptr<llvm::Module> M,
+                                        const std::string &target_cpu) {
+    TI_NOT_IMPLEMENTED
+  }
+
+  // Adds object code returned by add_module_as_object, possibly in another
+  // process.
+  virtual JITModule *add_object(const std::string &object_code) {
+    TI_NOT_IMPLEMENTED
+  }
+
+  // Removes |module| and releases its code. The functions looked up in it
+  // must no longer be called. Backends that cannot unload code keep it until
+  // the session is destroyed.
+  virtual void remove_module(JITModule *module) {
+  }
+
+  // Returns a handle that removes |module| once its last copy is destroyed,
+  // unless the session has been destroyed by then.
+  std::shared_ptr<JITModule> make_module_handle(JITModule *module);
 
   virtual void *lookup(const std::string Name) {
     TI_NOT_IMPLEMENTED
@@ -38,6 +68,10 @@ class JITSession {
   }
 
   virtual ~JITSession() = default;
+
+ private:
+  // Expires with the session
+  std::shared_ptr<bool> alive_{std::make_shared<bool>(true)};
 };
 
 TLANG_NAMESPACE_END
@@ -123,6 +123,13 @@ llvm::Type *TaichiLLVMContext::get_data_type(DataType dt) {
     return llvm::Type::getInt64Ty(*ctx);
   } else if (dt->is_primitive(PrimitiveTypeID::f16)) {
     return llvm::Type::getHalfTy(*ctx);
+  } else if (auto *vec = dt->cast<VectorType>()) {
+    auto *element = get_data_type(vec->get_element_type());
+#if LLVM_VERSION_MAJOR >= 11
+    return llvm::FixedVectorType::get(element, vec->get_num_elements());
+#else
+    return llvm::VectorType::get(element, vec->get_num_elements());
+#endif
   } else {
     TI_INFO(data_type_name(dt));
     TI_NOT_IMPLEMENTED
@@ -456,6 +463,9 @@ void TaichiLLVMContext::set_struct_module(
   }
   // TODO: Move this after ``if (!arch_is_cpu(arch))``.
   data->struct_module = llvm::CloneModule(*module);
+  if (data == main_thread_data_) {
+    data->struct_module_version = ++struct_module_version_;
+  }
 }
 
 template <typename T>
@@ -571,6 +581,17 @@ JITModule *TaichiLLVMContext::add_module(std::unique_ptr<llvm::Module> module) {
   return jit->add_module(std::move(module));
 }
 
+JITModule *TaichiLLVMContext::add_module_as_object(
+    std::unique_ptr<llvm::Module> module,
+    std::string &object_code,
+    int opt_level) {
+  return jit->add_module_as_object(std::move(module), object_code, opt_level);
+}
+
+JITModule *TaichiLLVMContext::add_object(const std::string &object_code) {
+  return jit->add_object(object_code);
+}
+
 void TaichiLLVMContext::insert_nvvm_annotation(llvm::Function *func,
                                                std::string key,
                                                int val) {
@@ -666,9 +687,12 @@ TaichiLLVMContext::get_this_thread_thread_safe_context() {
 
 llvm::Module *TaichiLLVMContext::get_this_thread_struct_module() {
   ThreadLocalData *data = get_this_thread_data();
-  if (!data->struct_module) {
+  if (!data->struct_module ||
+      data->struct_module_version != struct_module_version_) {
+    auto version = struct_module_version_.load();
     data->struct_module = clone_module_to_this_thread_context(
         main_thread_data_->struct_module.get());
+    data->struct_module_version = version;
   }
   return data->struct_module.get();
 }
@@ -5,6 +5,7 @@
 // and invoking compiled functions (kernels).
 // Designed to be multithreaded for parallel compilation.
 
+#include <atomic>
 #include <mutex>
 #include <functional>
 #include <thread>
@@ -30,6 +31,8 @@ class TaichiLLVMContext {
         nullptr};
     std::unique_ptr<llvm::Module> runtime_module{nullptr};
     std::unique_ptr<llvm::Module> struct_module{nullptr};
+    // The struct_module_version_ that struct_module is cloned from
+    int struct_module_version{0};
   };
 
  public:
@@ -79,6 +82,12 @@ class TaichiLLVMContext {
 
   JITModule *add_module(std::unique_ptr<llvm::Module> module);
 
+  JITModule *add_module_as_object(std::unique_ptr<llvm::Module> module,
+                                  std::string &object_code,
+                                  int opt_level = 3);
+
+  JITModule *add_object(const std::string &object_code);
+
   virtual void *lookup_function_pointer(const std::string &name) {
     return jit->lookup(name);
   }
@@ -151,6 +160,9 @@ class TaichiLLVMContext {
 
   std::thread::id main_thread_id_;
   ThreadLocalData *main_thread_data_{nullptr};
+  // Bumped when the struct module of the main thread is updated, so that the
+  // other threads clone it again.
+  std::atomic<int> struct_module_version_{0};
   std::mutex mut_;
   std::mutex thread_map_mut_;
 };
@@ -0,0 +1,226 @@
+#include "taichi/llvm/llvm_offline_cache.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <functional>
+#include <thread>
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Host.h"
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/snode.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/program/kernel.h"
+#include "taichi/program/program.h"
+
+namespace taichi {
+namespace lang {
+namespace {
+
+namespace fs = std::filesystem;
+
+// FNV-1a, for the file names of the entries
+uint64 fnv1a_hash(const std::string &s) {
+  uint64 ret = 14695981039346656037UL;
+  for (char c : s) {
+    ret = (ret ^ (uint8)c) * 1099511628211UL;
+  }
+  return ret;
+}
+
+void describe_snode(SNode *snode, std::string &out) {
+  out += fmt::format("{} n={} chunk={} bits={}@{} morton={} [",
+                     snode->get_node_type_name_hinted(),
+                     snode->num_cells_per_container, snode->chunk_size,
+                     snode->total_num_bits, snode->bit_offset, snode->_morton);
+  for (auto &ch : snode->ch) {
+    describe_snode(ch.get(), out);
+  }
+  out += "]";
+}
+
+std::string host_cpu_description() {
+  std::string ret = llvm::sys::getHostCPUName().str();
+  llvm::StringMap<bool> features;
+  if (llvm::sys::getHostCPUFeatures(features)) {
+    std::vector<std::string> enabled;
+    for (auto &f : features) {
+      if (f.getValue()) {
+        enabled.push_back(f.getKey().str());
+      }
+    }
+    std::sort(enabled.begin(), enabled.end());
+    for (auto &f : enabled) {
+      ret += "," + f;
+    }
+  }
+  return ret;
+}
+
+}  // namespace
+
+LlvmOfflineCache::LlvmOfflineCache(const std::string &path,
+                                   std::size_t max_size_bytes)
+    : path_(path), max_size_bytes_(max_size_bytes) {
+  std::error_code ec;
+  fs::create_directories(path_, ec);
+  TI_WARN_IF(ec, "Cannot create the offline cache directory {}: {}", path_,
+             ec.message());
+}
+
+std::string LlvmOfflineCache::make_key(Kernel *kernel, IRNode *ir) {
+  auto *prog = kernel->program;
+  const auto &config = prog->config;
+  if (config.print_kernel_llvm_ir || config.print_kernel_llvm_ir_optimized) {
+    // The LLVM IR is only printed when it is compiled.
+    return "";
+  }
+  // External functions are called through their address in this process.
+  // The IR of the functions that are called is not part of the key.
+  if (!irpass::analysis::gather_statements(ir, [](Stmt *s) {
+         return s->is<ExternalFuncCallStmt>() || s->is<FuncCallStmt>();
+       }).empty()) {
+    return "";
+  }
+  std::vector<OffloadedStmt *> offloads;
+  if (auto *block = ir->cast<Block>()) {
+    for (auto &s : block->statements) {
+      if (auto *offload = s->cast<OffloadedStmt>()) {
+        offloads.push_back(offload);
+      }
+    }
+  } else if (auto *offload = ir->cast<OffloadedStmt>()) {
+    offloads.push_back(offload);
+  }
+  for (auto *offload : offloads) {
+    if (offload->task_type == OffloadedStmt::TaskType::mesh_for) {
+      return "";
+    }
+  }
+
+  static const std::string host = host_cpu_description();
+  std::string key = fmt::format(
+      "taichi={} commit={} llvm={} host={}\n", get_version_string(),
+      get_commit_hash(), LLVM_VERSION_STRING, host);
+  key += fmt::format(
+      "arch={} debug={} fast_math={} packed={} kernel_profiler={} "
+      "cpu_max_num_threads={} quant_opt_atomic_demotion={} "
+      "cpu_loop_vectorize={} cpu_range_for_tasks={} "
+      "cpu_nontemporal_store={} cpu_struct_for_prefetch={}\n",
+      arch_name(kernel->arch), config.debug, config.fast_math, config.packed,
+      config.kernel_profiler, config.cpu_max_num_threads,
+      config.quant_opt_atomic_demotion, config.cpu_loop_vectorize,
+      config.cpu_range_for_tasks, config.cpu_nontemporal_store,
+      config.cpu_struct_for_prefetch);
+  for (int i = 0; i < prog->get_snode_tree_size(); i++) {
+    describe_snode(prog->get_snode_root(i), key);
+    key += "\n";
+  }
+  if (config.kernel_profiler) {
+    // The profiler records the task names, which contain the kernel name.
+    key += kernel->name + "\n";
+  }
+  key += fmt::format("ir={:016x}", irpass::analysis::hash_ir(ir));
+  return key;
+}
+
+std::string LlvmOfflineCache::get_file_path(const std::string &key) const {
+  return fmt::format("{}/{:016x}.tcb", path_, fnv1a_hash(key));
+}
+
+std::string LlvmOfflineCache::print_ir(IRNode *ir) {
+  auto copy = ir->clone();
+  irpass::re_id(copy.get());
+  std::string ret;
+  irpass::print(copy.get(), &ret);
+  return ret;
+}
+
+bool LlvmOfflineCache::load(const std::string &key,
+                            IRNode *ir,
+                            KernelCacheData &data) {
+  std::lock_guard<std::mutex> _(mut_);
+  auto file_path = get_file_path(key);
+  std::error_code ec;
+  if (!fs::exists(file_path, ec)) {
+    return false;
+  }
+  read_from_binary_file(data, file_path);
+  if (data.key != key || data.ir != print_ir(ir)) {
+    return false;
+  }
+  // Entries are evicted by last use.
+  fs::last_write_time(file_path, fs::file_time_type::clock::now(), ec);
+  TI_TRACE("Loaded kernel from the offline cache: {}", file_path);
+  return true;
+}
+
+void LlvmOfflineCache::store(const std::string &key,
+                             const std::string &ir,
+                             KernelCacheData data) {
+  std::lock_guard<std::mutex> _(mut_);
+  data.key = key;
+  data.ir = ir;
+  auto file_path = get_file_path(key);
+  // Other processes may share the cache. Write to a temporary file and
+  // rename it, so that they never see a partially written entry. The name
+  // of the temporary file is unique across processes and their threads.
+  auto tmp_path = fmt::format(
+      "{}.{}.{:x}.tmp.tcb", file_path, PID::get_pid(),
+      std::hash<std::thread::id>()(std::this_thread::get_id()));
+  write_to_binary_file(data, tmp_path);
+  std::error_code ec;
+  fs::rename(tmp_path, file_path, ec);
+  if (ec) {
+    TI_WARN("Cannot write {} to the offline cache: {}", file_path,
+            ec.message());
+    fs::remove(tmp_path, ec);
+    return;
+  }
+  evict();
+}
+
+void LlvmOfflineCache::evict() {
+  struct Entry {
+    fs::path path;
+    fs::file_time_type last_use;
+    std::uintmax_t size;
+  };
+  std::vector<Entry> entries;
+  std::uintmax_t total_size = 0;
+  std::error_code ec;
+  for (auto &f : fs::directory_iterator(path_, ec)) {
+    auto path = f.path();
+    if (path.extension() != ".tcb" ||
+        path.filename().string().find(".tmp.") != std::string::npos) {
+      continue;
+    }
+    Entry entry{path, f.last_write_time(ec), f.file_size(ec)};
+    if (ec) {
+      // Removed by another process in the meantime
+      continue;
+    }
+    total_size += entry.size;
+    entries.push_back(entry);
+  }
+  if (total_size <= max_size_bytes_) {
+    return;
+  }
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) {
+              return a.last_use < b.last_use;
+            });
+  for (auto &entry : entries) {
+    if (total_size <= max_size_bytes_) {
+      break;
+    }
+    fs::remove(entry.path, ec);
+    total_size -= entry.size;
+  }
+}
+
+}  // namespace lang
+}  // namespace taichi
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "taichi/common/core.h"
+#include "taichi/common/serialization.h"
+
+namespace taichi {
+namespace lang {
+
+class IRNode;
+class Kernel;
+
+/**
+ * On-disk cache of the object code of LLVM-compiled CPU kernels.
+ *
+ * A new process can load the object code that an earlier process compiled for
+ * a kernel, instead of running LLVM codegen and optimization again. Each entry
+ * is a file in the cache directory. Once the files take more space than the
+ * size limit, the least recently used ones are deleted.
+ */
+class LlvmOfflineCache {
+ public:
+  struct KernelCacheData {
+    // The full key and the printed IR, to tell apart the kernels whose keys
+    // or file names collide
+    std::string key;
+    std::string ir;
+    // Names of the offloaded task functions, in launch order
+    std::vector<std::string> offloaded_task_names;
+    std::string object_code;
+
+    TI_IO_DEF(key, ir, offloaded_task_names, object_code);
+  };
+
+  LlvmOfflineCache(const std::string &path, std::size_t max_size_bytes);
+
+  /**
+   * Computes the cache key of a kernel.
+   *
+   * The key covers the hash of the lowered CHI IR, the compile options that
+   * affect codegen, the layout of all SNode trees, the Taichi and LLVM versions
+   * and the host CPU.
+   *
+   * @param kernel The kernel to compile.
+   * @param ir The lowered IR to compile, either the whole kernel or one of its
+   * offloaded tasks.
+   * @return The key, or an empty string if the kernel cannot be cached.
+   */
+  static std::string make_key(Kernel *kernel, IRNode *ir);
+
+  /**
+   * Prints the IR with statement ids that only depend on its structure. An
+   * entry is only loaded for the same printed IR, so that the 64-bit IR hash
+   * in the key never selects the object code of another kernel.
+   */
+  static std::string print_ir(IRNode *ir);
+
+  /**
+   * Loads the entry of a key.
+   *
+   * The IR is only printed when an entry with the same key is found.
+   *
+   * @param ir The lowered IR that the key was computed from.
+   * @return Whether the entry is found.
+   */
+  bool load(const std::string &key, IRNode *ir, KernelCacheData &data);
+
+  void store(const std::string &key,
+             const std::string &ir,
+             KernelCacheData data);
+
+ private:
+  std::string get_file_path(const std::string &key) const;
+
+  // Deletes the least recently used entries until the cache fits in
+  // max_size_bytes_. mut_ must be held.
+  void evict();
+
+  std::string path_;
+  std::size_t max_size_bytes_;
+  std::mutex mut_;
+};
+
+}  // namespace lang
+}  // namespace taichi
@@ -8,8 +8,11 @@
 #include "taichi/runtime/llvm/mem_request.h"
 #include "taichi/util/str.h"
 #include "taichi/codegen/codegen.h"
+#include "taichi/program/async_engine.h"
 #include "taichi/ir/statements.h"
 #include "taichi/backends/cpu/cpu_device.h"
+#include "taichi/backends/cpu/aot_module_builder_impl.h"
+#include "taichi/llvm/runtime_snodes.h"
 #include "taichi/backends/cuda/cuda_device.h"
 
 #include "taichi/backends/cuda/cuda_device.h"
@@ -58,7 +61,13 @@ LlvmProgramImpl::LlvmProgramImpl(CompileConfig &config_,
 
   snode_tree_buffer_manager_ = std::make_unique<SNodeTreeBufferManager>(this);
 
-  thread_pool_ = std::make_unique<ThreadPool>(config->cpu_max_num_threads);
+  if (config->cpu_work_stealing) {
+    work_stealing_thread_pool_ = std::make_unique<WorkStealingThreadPool>(
+        config->cpu_max_num_threads, config->cpu_spin_count,
+        config->cpu_numa_aware);
+  } else {
+    thread_pool_ = std::make_unique<ThreadPool>(config->cpu_max_num_threads);
+  }
 
   preallocated_device_buffer_ = nullptr;
   llvm_runtime_ = nullptr;
@@ -90,6 +99,18 @@ LlvmProgramImpl::LlvmProgramImpl(CompileConfig &config_,
   if (arch_is_cpu(config->arch)) {
     config_.max_block_dim = 1024;
     device_ = std::make_shared<cpu::CpuDevice>();
+    if (config->offline_cache) {
+      auto path = config->offline_cache_file_path;
+      if (path.empty()) {
+        path = get_repo_dir() + "ticache/llvm";
+      }
+      offline_cache_ = std::make_unique<LlvmOfflineCache>(
+          path, (std::size_t)config->offline_cache_max_size_mb << 20);
+    }
+    if (config->num_compile_threads > 1) {
+      compilation_workers_ = std::make_unique<ParallelExecutor>(
+          "compile_worker", config->num_compile_threads);
+    }
   }
 
   if (config->kernel_profiler && runtime_mem_info_) {
@@ -149,9 +170,9 @@ LlvmProgramImpl::clone_struct_compiler_initial_context(
   return tlctx->clone_runtime_module();
 }
 
-void LlvmProgramImpl::initialize_llvm_runtime_snodes(const SNodeTree *tree,
-                                                     StructCompiler *scomp,
-                                                     uint64 *result_buffer) {
+void LlvmProgramImpl::initialize_llvm_runtime_snodes(
+    const cpu::CompiledSNodeTreeData &tree,
+    uint64 *result_buffer) {
   TaichiLLVMContext *tlctx = nullptr;
   if (config->arch == Arch::cuda) {
 #if defined(TI_WITH_CUDA)
@@ -164,17 +185,12 @@ void LlvmProgramImpl::initialize_llvm_runtime_snodes(const SNodeTree *tree,
   }
 
   auto *const runtime_jit = tlctx->runtime_jit_module;
-  // By the time this creator is called, "this" is already destroyed.
-  // Therefore it is necessary to capture members by values.
-  const auto snodes = scomp->snodes;
-  const int root_id = tree->root()->id;
 
-  TI_TRACE("Allocating data structure of size {} bytes", scomp->root_size);
-  std::size_t rounded_size =
-      taichi::iroundup(scomp->root_size, taichi_page_size);
+  TI_TRACE("Allocating data structure of size {} bytes", tree.root_size);
+  std::size_t rounded_size = taichi::iroundup(tree.root_size, taichi_page_size);
 
   Ptr root_buffer = snode_tree_buffer_manager_->allocate(
-      runtime_jit, llvm_runtime_, rounded_size, taichi_page_size, tree->id(),
+      runtime_jit, llvm_runtime_, rounded_size, taichi_page_size, tree.tree_id,
       result_buffer);
 
   DeviceAllocation alloc{kDeviceNullAllocation};
@@ -189,45 +205,10 @@ void LlvmProgramImpl::initialize_llvm_runtime_snodes(const SNodeTree *tree,
     alloc = cpu_device()->import_memory(root_buffer, rounded_size);
   }
 
-  snode_tree_allocs_[tree->id()] = alloc;
+  snode_tree_allocs_[tree.tree_id] = alloc;
 
-  bool all_dense = config->demote_dense_struct_fors;
-  for (int i = 0; i < (int)snodes.size(); i++) {
-    if (snodes[i]->type != SNodeType::dense &&
-        snodes[i]->type != SNodeType::place &&
-        snodes[i]->type != SNodeType::root) {
-      all_dense = false;
-      break;
-    }
-  }
-
-  runtime_jit->call<void *, std::size_t, int, int, int, std::size_t, Ptr>(
-      "runtime_initialize_snodes", llvm_runtime_, scomp->root_size, root_id,
-      (int)snodes.size(), tree->id(), rounded_size, root_buffer, all_dense);
-
-  for (int i = 0; i < (int)snodes.size(); i++) {
-    if (is_gc_able(snodes[i]->type)) {
-      const auto snode_id = snodes[i]->id;
-      std::size_t node_size;
-      auto element_size = snodes[i]->cell_size_bytes;
-      if (snodes[i]->type == SNodeType::pointer) {
-        // pointer. Allocators are for single elements
-        node_size = element_size;
-      } else {
-        // dynamic. Allocators are for the chunks
-        node_size = sizeof(void *) + element_size * snodes[i]->chunk_size;
-      }
-      TI_TRACE("Initializing allocator for snode {} (node size {})", snode_id,
-               node_size);
-      auto rt = llvm_runtime_;
-      runtime_jit->call<void *, int, std::size_t>(
-          "runtime_NodeAllocator_initialize", rt, snode_id, node_size);
-      TI_TRACE("Allocating ambient element for snode {} (node size {})",
-               snode_id, node_size);
-      runtime_jit->call<void *, int>("runtime_allocate_ambient", rt, snode_id,
-                                     node_size);
-    }
-  }
+  initialize_runtime_snodes(runtime_jit, llvm_runtime_, tree, rounded_size,
+                            root_buffer);
 }
 
 void LlvmProgramImpl::compile_snode_tree_types(
@@ -248,6 +229,21 @@ void LlvmProgramImpl::compile_snode_tree_types(
         Arch::cuda, this, std::move(device_module));
   }
   struct_compiler_->run(*root);
+
+  cpu::CompiledSNodeTreeData tree_data;
+  tree_data.tree_id = tree->id();
+  tree_data.root_id = root->id;
+  tree_data.root_size = struct_compiler_->root_size;
+  tree_data.all_dense = config->demote_dense_struct_fors;
+  for (auto *snode : struct_compiler_->snodes) {
+    if (snode->type != SNodeType::dense && snode->type != SNodeType::place &&
+        snode->type != SNodeType::root) {
+      tree_data.all_dense = false;
+    }
+    tree_data.snodes.push_back({snode->id, (int)snode->type,
+                                snode->cell_size_bytes, snode->chunk_size});
+  }
+  compiled_snode_trees_.push_back(std::move(tree_data));
 }
 
 void LlvmProgramImpl::materialize_snode_tree(
@@ -255,7 +251,7 @@ void LlvmProgramImpl::materialize_snode_tree(
     std::vector<std::unique_ptr<SNodeTree>> &snode_trees_,
     uint64 *result_buffer) {
   compile_snode_tree_types(tree, snode_trees_);
-  initialize_llvm_runtime_snodes(tree, struct_compiler_.get(), result_buffer);
+  initialize_llvm_runtime_snodes(compiled_snode_trees_.back(), result_buffer);
 }
 
 uint64 LlvmProgramImpl::fetch_result_uint64(int i, uint64 *result_buffer) {
@@ -285,11 +281,8 @@ std::size_t LlvmProgramImpl::get_snode_num_dynamically_allocated(
   auto node_allocator =
       runtime_query<void *>("LLVMRuntime_get_node_allocators", result_buffer,
                             llvm_runtime_, snode->id);
-  auto data_list = runtime_query<void *>("NodeManager_get_data_list",
-                                         result_buffer, node_allocator);
-
-  return (std::size_t)runtime_query<int32>("ListManager_get_num_elements",
-                                           result_buffer, data_list);
+  return (std::size_t)runtime_query<int32>("NodeManager_get_num_allocated",
+                                           result_buffer, node_allocator);
 }
 
 void LlvmProgramImpl::print_list_manager_info(void *list_manager,
@@ -356,8 +349,10 @@ void LlvmProgramImpl::materialize_runtime(MemoryPool *memory_pool,
   } else {
     *result_buffer_ptr = (uint64 *)memory_pool->allocate(
         sizeof(uint64) * taichi_result_buffer_entries, 8);
+    cpu_device()->set_memory_pool(memory_pool);
     tlctx = llvm_context_host_.get();
   }
+  memory_pool_ = memory_pool;
   auto *const runtime_jit = tlctx->runtime_jit_module;
 
   // Starting random state for the program calculated using the random seed.
@@ -402,9 +397,16 @@ void LlvmProgramImpl::materialize_runtime(MemoryPool *memory_pool,
   }
 
   if (arch_use_host_memory(config->arch)) {
-    runtime_jit->call<void *, void *, void *>(
-        "LLVMRuntime_initialize_thread_pool", llvm_runtime_, thread_pool_.get(),
-        (void *)ThreadPool::static_run);
+    if (work_stealing_thread_pool_) {
+      runtime_jit->call<void *, void *, void *>(
+          "LLVMRuntime_initialize_thread_pool", llvm_runtime_,
+          work_stealing_thread_pool_.get(),
+          (void *)WorkStealingThreadPool::static_run);
+    } else {
+      runtime_jit->call<void *, void *, void *>(
+          "LLVMRuntime_initialize_thread_pool", llvm_runtime_,
+          thread_pool_.get(), (void *)ThreadPool::static_run);
+    }
 
     runtime_jit->call<void *, void *>("LLVMRuntime_set_assert_failed",
                                       llvm_runtime_,
@@ -423,6 +425,13 @@ void LlvmProgramImpl::materialize_runtime(MemoryPool *memory_pool,
   }
 }
 
+std::unique_ptr<AotModuleBuilder> LlvmProgramImpl::make_aot_module_builder() {
+  if (arch_is_cpu(config->arch)) {
+    return std::make_unique<cpu::AotModuleBuilderImpl>(this);
+  }
+  TI_NOT_IMPLEMENTED;
+}
+
 void LlvmProgramImpl::check_runtime_error(uint64 *result_buffer) {
   synchronize();
   auto tlctx = llvm_context_host_.get();
@@ -471,6 +480,8 @@ void LlvmProgramImpl::check_runtime_error(uint64 *result_buffer) {
   }
 }
 
+LlvmProgramImpl::~LlvmProgramImpl() = default;
+
 void LlvmProgramImpl::finalize() {
   if (runtime_mem_info_)
     runtime_mem_info_->set_profiler(nullptr);
@@ -551,6 +562,23 @@ void LlvmProgramImpl::print_memory_profiler_info(
   fmt::print(
       "Total requested dynamic memory (excluding alignment padding): {:n} B\n",
       total_requested_memory);
+
+  if (memory_pool_) {
+    auto stats = memory_pool_->get_stats();
+    fmt::print("Host memory pool:\n");
+    fmt::print("  arenas={:n}; reserved={:n} B\n", stats.num_arenas,
+               stats.reserved_bytes);
+    fmt::print("  in use={:n} B; peak in use={:n} B\n", stats.used_bytes,
+               stats.peak_used_bytes);
+    fmt::print(
+        "  cached in size classes={:n} B; cached pages={:n} B; kept "
+        "committed={:n} B\n",
+        stats.cached_small_bytes, stats.cached_large_bytes,
+        stats.committed_cache_bytes);
+    fmt::print(
+        "  allocations={:n}; releases={:n}; decommitted to OS={:n} B\n",
+        stats.num_allocations, stats.num_releases, stats.decommitted_bytes);
+  }
 }
 
 cuda::CudaDevice *LlvmProgramImpl::cuda_device() {
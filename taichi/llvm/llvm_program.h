@@ -4,6 +4,7 @@
 #include "taichi/program/compile_config.h"
 #include "taichi/common/logging.h"
 #include "taichi/llvm/llvm_context.h"
+#include "taichi/llvm/llvm_offline_cache.h"
 #include "taichi/runtime/runtime.h"
 #include "taichi/system/threading.h"
 #include "taichi/struct/struct.h"
@@ -11,6 +12,7 @@
 #include "taichi/program/snode_expr_utils.h"
 #include "taichi/system/memory_pool.h"
 #include "taichi/program/program_impl.h"
+#include "taichi/backends/cpu/aot_data.h"
 #define TI_RUNTIME_HOST
 #include "taichi/program/context.h"
 #undef TI_RUNTIME_HOST
@@ -24,6 +26,7 @@ class Module;
 namespace taichi {
 namespace lang {
 class StructCompiler;
+class ParallelExecutor;
 
 namespace cuda {
 class CudaDevice;
@@ -37,6 +40,8 @@ class LlvmProgramImpl : public ProgramImpl {
  public:
   LlvmProgramImpl(CompileConfig &config, KernelProfilerBase *profiler);
 
+  ~LlvmProgramImpl() override;
+
   void initialize_host();
 
   /**
@@ -54,6 +59,31 @@ class LlvmProgramImpl : public ProgramImpl {
     }
   }
 
+  /**
+   * Returns the offline cache of compiled kernels, or nullptr if it is
+   * disabled.
+   */
+  LlvmOfflineCache *get_offline_cache() {
+    return offline_cache_.get();
+  }
+
+  /**
+   * Returns the threads that compile the offloaded tasks of CPU kernels in
+   * parallel, or nullptr if they are compiled on the calling thread.
+   */
+  ParallelExecutor *get_compilation_workers() {
+    return compilation_workers_.get();
+  }
+
+  /**
+   * Returns the layout of the SNode trees compiled so far, which the runtime
+   * and AOT modules need to initialize them.
+   */
+  const std::vector<cpu::CompiledSNodeTreeData> &get_compiled_snode_trees()
+      const {
+    return compiled_snode_trees_;
+  }
+
   LLVMRuntime *get_llvm_runtime() {
     return static_cast<LLVMRuntime *>(llvm_runtime_);
   }
@@ -90,6 +120,10 @@ class LlvmProgramImpl : public ProgramImpl {
     snode_tree_buffer_manager_->destroy(snode_tree);
   }
 
+  MemoryPool *get_memory_pool() {
+    return memory_pool_;
+  }
+
   void print_memory_profiler_info(
       std::vector<std::unique_ptr<SNodeTree>> &snode_trees_,
       uint64 *result_buffer);
@@ -115,8 +149,7 @@ class LlvmProgramImpl : public ProgramImpl {
   /**
    * Initializes the SNodes for LLVM based backends.
    */
-  void initialize_llvm_runtime_snodes(const SNodeTree *tree,
-                                      StructCompiler *scomp,
+  void initialize_llvm_runtime_snodes(const cpu::CompiledSNodeTreeData &tree,
                                       uint64 *result_buffer);
 
   uint64 fetch_result_uint64(int i, uint64 *result_buffer);
@@ -141,9 +174,7 @@ class LlvmProgramImpl : public ProgramImpl {
 
   void print_list_manager_info(void *list_manager, uint64 *result_buffer);
 
-  std::unique_ptr<AotModuleBuilder> make_aot_module_builder() override {
-    TI_NOT_IMPLEMENTED;
-  }
+  std::unique_ptr<AotModuleBuilder> make_aot_module_builder() override;
 
   Device *get_compute_device() override {
     return device_.get();
@@ -155,15 +186,22 @@ class LlvmProgramImpl : public ProgramImpl {
   std::unique_ptr<TaichiLLVMContext> llvm_context_host_{nullptr};
   std::unique_ptr<TaichiLLVMContext> llvm_context_device_{nullptr};
   std::unique_ptr<ThreadPool> thread_pool_{nullptr};
+  std::unique_ptr<WorkStealingThreadPool> work_stealing_thread_pool_{nullptr};
   std::unique_ptr<Runtime> runtime_mem_info_{nullptr};
   std::unique_ptr<SNodeTreeBufferManager> snode_tree_buffer_manager_{nullptr};
   std::unique_ptr<StructCompiler> struct_compiler_{nullptr};
+  std::unique_ptr<LlvmOfflineCache> offline_cache_{nullptr};
+  // Declared after the LLVM contexts, so that the workers stop before their
+  // per-thread LLVM contexts are destroyed.
+  std::unique_ptr<ParallelExecutor> compilation_workers_{nullptr};
   void *llvm_runtime_{nullptr};
+  MemoryPool *memory_pool_{nullptr};
   void *preallocated_device_buffer_{nullptr};  // TODO: move to memory allocator
 
   DeviceAllocation preallocated_device_buffer_alloc_{kDeviceNullAllocation};
 
   std::unordered_map<int, DeviceAllocation> snode_tree_allocs_;
+  std::vector<cpu::CompiledSNodeTreeData> compiled_snode_trees_;
 
   std::shared_ptr<Device> device_{nullptr};
   cuda::CudaDevice *cuda_device();
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+
+#include "taichi/backends/cpu/aot_data.h"
+#include "taichi/common/core.h"
+#include "taichi/ir/snode_types.h"
+
+namespace taichi {
+namespace lang {
+
+/**
+ * Initializes an SNode tree in the LLVM runtime, once its root buffer has been
+ * allocated: the root, the node allocators, ambient elements and hash
+ * compaction lists of the gc-able SNodes, and the cell logs of the pointer and
+ * bitmasked SNodes.
+ *
+ * Shared by LlvmProgramImpl, which calls the JIT compiled runtime, and
+ * cpu::AotModuleLoader, which calls the runtime linked into an AOT module.
+ *
+ * @param module Has a call<Args...>(name, args...) that calls the runtime
+ * function |name|.
+ * @param runtime The LLVMRuntime.
+ * @param tree The SNode tree.
+ * @param rounded_size Size of the root buffer.
+ * @param root_buffer The root buffer.
+ */
+template <typename Module>
+void initialize_runtime_snodes(Module *module,
+                               void *runtime,
+                               const cpu::CompiledSNodeTreeData &tree,
+                               std::size_t rounded_size,
+                               uint8 *root_buffer) {
+  module->template call<void *, std::size_t, int, int, int, std::size_t,
+                        uint8 *, bool>(
+      "runtime_initialize_snodes", runtime, tree.root_size, tree.root_id,
+      (int)tree.snodes.size(), tree.tree_id, rounded_size, root_buffer,
+      tree.all_dense);
+
+  for (const auto &snode : tree.snodes) {
+    const auto type = (SNodeType)snode.type;
+    if (type == SNodeType::pointer || type == SNodeType::bitmasked) {
+      module->template call<void *, int>("runtime_initialize_cell_log",
+                                         runtime, snode.id);
+    }
+    if (!is_gc_able(type)) {
+      continue;
+    }
+    std::size_t node_size;
+    if (type == SNodeType::pointer || type == SNodeType::hash) {
+      // pointer and hash. Allocators are for single elements
+      node_size = snode.cell_size_bytes;
+    } else {
+      // dynamic. Allocators are for the chunks and the chunk directory
+      // pages, which must hold at least two pointers.
+      node_size =
+          std::max(sizeof(void *) + snode.cell_size_bytes * snode.chunk_size,
+                   2 * sizeof(void *));
+    }
+    TI_TRACE("Initializing allocator for snode {} (node size {})", snode.id,
+             node_size);
+    module->template call<void *, int, std::size_t>(
+        "runtime_NodeAllocator_initialize", runtime, snode.id, node_size);
+    TI_TRACE("Allocating ambient element for snode {} (node size {})",
+             snode.id, node_size);
+    module->template call<void *, int>("runtime_allocate_ambient", runtime,
+                                       snode.id, node_size);
+    if (type == SNodeType::hash) {
+      module->template call<void *, int>("runtime_Hash_initialize", runtime,
+                                         snode.id);
+    }
+  }
+}
+
+}  // namespace lang
+}  // namespace taichi
@@ -113,7 +113,8 @@ void ParallelExecutor::worker_loop() {
     }
     if (notify_flush_cv) {
       // It is fine to notify |flush_cv_| while nobody is waiting on it.
-      flush_cv_.notify_one();
+      // There may be several threads flushing at once.
+      flush_cv_.notify_all();
     }
   }
 }
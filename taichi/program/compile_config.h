@@ -33,6 +33,8 @@ struct CompileConfig {
   bool verbose_kernel_launches;
   bool kernel_profiler;
   bool timeline{false};
+  // Record the passes that lower each kernel, see CompileProfiler.
+  bool compile_profiler{false};
   bool verbose;
   bool fast_math;
   bool async_mode;
@@ -43,6 +45,13 @@ struct CompileConfig {
   bool detect_read_only;
   bool ndarray_use_torch;
   bool ndarray_use_cached_allocator;
+  // Zero-fill the freed root buffers of SNode trees when they are destroyed,
+  // so that rebuilding a tree does not need to wait for it. CUDA only: on
+  // CPUs the roots are returned to the memory pool.
+  bool snode_tree_buffer_prezero{false};
+  // Zero-fill reused root buffers that are not pre-zeroed. Turn this off when
+  // new SNode trees are always fully overwritten before being read. CUDA only.
+  bool snode_tree_buffer_rezero{true};
   DataType default_fp;
   DataType default_ip;
   std::string extra_flags;
@@ -59,7 +68,64 @@ struct CompileConfig {
   int cpu_max_num_threads;
   int random_seed;
 
+  // CPU thread pool options:
+  bool cpu_work_stealing{false};
+  bool cpu_numa_aware{false};
+  // Number of spins before an idle worker parks itself
+  int cpu_spin_count{16384};
+
   // LLVM backend options:
+  // Keep the object code of compiled CPU kernels on disk, and load it instead
+  // of compiling the same kernel again in later runs.
+  bool offline_cache{false};
+  // Defaults to ~/.taichi/ticache/llvm when empty
+  std::string offline_cache_file_path;
+  // Least recently used kernels are deleted beyond this total size.
+  int offline_cache_max_size_mb{1024};
+  // The offloaded tasks of a CPU kernel are compiled as separate modules on
+  // this many threads, each with its own LLVM context. 1 compiles each kernel
+  // as a single module on the calling thread. Also the number of threads of
+  // ti.precompile() and of tiered compilation.
+  int num_compile_threads{1};
+  // Only the machine code of this many most recently launched kernels is
+  // kept; the others are compiled again on their next launch. 0 keeps all.
+  int max_compiled_kernels{0};
+  // Compile CPU kernels without LLVM optimizations for their first launches,
+  // and recompile the ones launched tiered_compilation_threshold times with
+  // full optimizations on the precompile workers.
+  bool tiered_compilation{false};
+  int tiered_compilation_threshold{8};
+  // Compile a variant of each kernel for the values of its integer arguments,
+  // which are folded as constants. Beyond max_arg_specializations variants,
+  // the other values launch the generic kernel. Only the arguments that kept
+  // their value over the first arg_specialization_threshold launches are
+  // specialized, so that counters and indices do not create new variants.
+  bool arg_specialization{false};
+  int max_arg_specializations{8};
+  int arg_specialization_threshold{2};
+  // Pack isomorphic scalar operations of CPU kernels into vector instructions
+  // of up to simd_width 32-bit lanes, e.g. 16 for AVX-512.
+  bool slp_vectorize{false};
+  // Emit the bodies of CPU range-fors and dense struct-fors as loops over
+  // blocks of indices, which LLVM vectorizes across iterations.
+  bool cpu_loop_vectorize{false};
+  // Run the bodies of CPU range-fors with step 1 from a task function that
+  // codegen generates per offload, instead of through the runtime's loop
+  // driver, so that LLVM inlines the body and the TLS xlogues into it. The
+  // kernel context is only copied per thread if the body may read the thread
+  // id.
+  bool cpu_range_for_tasks{false};
+  // Store to the large fields that a CPU range-for writes without reading
+  // with non-temporal stores, which bypass the caches. Only pays off when the
+  // data is not read back soon. Needs cpu_range_for_tasks and
+  // detect_read_only.
+  bool cpu_nontemporal_store{false};
+  // Prefetch the containers of the upcoming list elements of CPU struct-fors.
+  bool cpu_struct_for_prefetch{false};
+  // The LLVM CPU name that CPU AOT modules are compiled for, e.g. "skylake".
+  // "generic" runs on any CPU of the host architecture, and "native" is the
+  // host CPU.
+  std::string cpu_aot_target{"generic"};
   bool print_struct_llvm_ir;
   bool print_kernel_llvm_ir;
   bool print_kernel_llvm_ir_optimized;
@@ -0,0 +1,96 @@
+#include "taichi/program/compile_profiler.h"
+
+#include <fstream>
+
+#include "taichi/ir/analysis.h"
+#include "taichi/system/timeline.h"
+#include "taichi/util/str.h"
+
+TLANG_NAMESPACE_BEGIN
+
+std::string CompilePassRecord::to_json() const {
+  std::string json{"{"};
+  json += fmt::format("\"kernel_name\":{},", json_quoted(kernel_name));
+  json += fmt::format("\"pass_name\":{},", json_quoted(pass_name));
+  json += fmt::format("\"time\":{},", time);
+  json += fmt::format("\"num_statements_before\":{},", num_statements_before);
+  json += fmt::format("\"num_statements_after\":{},", num_statements_after);
+  json += fmt::format("\"iteration\":{}", iteration);
+  json += "}";
+  return json;
+}
+
+void CompileProfiler::insert_records(
+    const std::vector<CompilePassRecord> &records) {
+  std::lock_guard<std::mutex> _(mut_);
+  records_.insert(records_.end(), records.begin(), records.end());
+}
+
+std::vector<CompilePassRecord> CompileProfiler::get_records() {
+  std::lock_guard<std::mutex> _(mut_);
+  return records_;
+}
+
+void CompileProfiler::clear() {
+  std::lock_guard<std::mutex> _(mut_);
+  records_.clear();
+}
+
+void CompileProfiler::save(const std::string &filename) {
+  std::lock_guard<std::mutex> _(mut_);
+  if (!ends_with(filename, ".json")) {
+    TI_WARN("Compile profile filename {} should end with '.json'.", filename);
+  }
+  std::ofstream fout(filename);
+  fout << "[";
+  bool first = true;
+  for (const auto &r : records_) {
+    if (first) {
+      first = false;
+    } else {
+      fout << ",";
+    }
+    fout << r.to_json() << std::endl;
+  }
+  fout << "]";
+}
+
+CompilePassRecorder::CompilePassRecorder(const std::string &kernel_name,
+                                         IRNode *ir,
+                                         CompileProfiler *profiler)
+    : kernel_name_(kernel_name), ir_(ir), profiler_(profiler) {
+  if (profiler_) {
+    num_statements_ = irpass::analysis::count_statements(ir_);
+  }
+}
+
+CompilePassRecorder::~CompilePassRecorder() {
+  if (profiler_) {
+    profiler_->insert_records(records_);
+  }
+}
+
+void CompilePassRecorder::begin() {
+  begin_ = Time::get_time();
+}
+
+void CompilePassRecorder::end(const std::string &pass_name) {
+  const float64 end = Time::get_time();
+  CompilePassRecord r;
+  r.kernel_name = kernel_name_;
+  r.pass_name = pass_name;
+  r.time = end - begin_;
+  r.num_statements_before = num_statements_;
+  // Counted outside of the timed region
+  r.num_statements_after = irpass::analysis::count_statements(ir_);
+  r.iteration = iteration_;
+  records_.push_back(r);
+  num_statements_ = r.num_statements_after;
+
+  auto &timeline = Timeline::get_this_thread_instance();
+  const auto name = fmt::format("[{}] {}", kernel_name_, pass_name);
+  timeline.insert_event({name, true, begin_, timeline.get_name()});
+  timeline.insert_event({name, false, end, timeline.get_name()});
+}
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "taichi/lang_util.h"
+
+TLANG_NAMESPACE_BEGIN
+
+class IRNode;
+
+struct CompilePassRecord {
+  std::string kernel_name;
+  std::string pass_name;
+  // Wall time in seconds
+  float64 time{0.0};
+  int num_statements_before{0};
+  int num_statements_after{0};
+  // For the passes that full_simplify runs, the fixed-point iteration that
+  // ran the pass, starting from 1. 0 for the other passes.
+  int iteration{0};
+
+  std::string to_json() const;
+};
+
+/**
+ * Collects the passes that compile_to_offloads() and offload_to_executable()
+ * ran on each kernel. Enabled by CompileConfig::compile_profiler.
+ *
+ * The passes are also inserted into the Timeline of the compiling thread, so
+ * that Timelines::save() shows them in a Chrome trace when
+ * CompileConfig::timeline is on.
+ */
+class CompileProfiler {
+ public:
+  // Thread safe, since kernels can be compiled on the precompile workers.
+  void insert_records(const std::vector<CompilePassRecord> &records);
+
+  std::vector<CompilePassRecord> get_records();
+
+  void clear();
+
+  // Saves the records as a JSON list.
+  void save(const std::string &filename);
+
+ private:
+  std::mutex mut_;
+  std::vector<CompilePassRecord> records_;
+};
+
+/**
+ * Times the passes run on the IR of one kernel, and inserts them into a
+ * CompileProfiler when destroyed. Does nothing if the profiler is nullptr.
+ */
+class CompilePassRecorder {
+ public:
+  CompilePassRecorder(const std::string &kernel_name,
+                      IRNode *ir,
+                      CompileProfiler *profiler);
+
+  ~CompilePassRecorder();
+
+  // Runs |pass| and records it as |pass_name|. Returns what |pass| returns.
+  template <typename Func>
+  auto run(const std::string &pass_name, Func &&pass) -> decltype(pass()) {
+    if (!profiler_) {
+      return pass();
+    }
+    begin();
+    if constexpr (std::is_void_v<decltype(pass())>) {
+      pass();
+      end(pass_name);
+    } else {
+      auto ret = pass();
+      end(pass_name);
+      return ret;
+    }
+  }
+
+  // Sets CompilePassRecord::iteration of the passes recorded next.
+  void set_iteration(int iteration) {
+    iteration_ = iteration;
+  }
+
+ private:
+  void begin();
+
+  void end(const std::string &pass_name);
+
+  std::string kernel_name_;
+  IRNode *ir_;
+  CompileProfiler *profiler_;
+  float64 begin_{0.0};
+  int num_statements_{0};
+  int iteration_{0};
+  std::vector<CompilePassRecord> records_;
+};
+
+TLANG_NAMESPACE_END
@@ -22,6 +22,10 @@ struct RuntimeContext {
   uint64 args[taichi_max_num_args_total];
   int32 extra_args[taichi_max_num_args_extra][taichi_max_num_indices];
   int32 cpu_thread_id;
+  // If not nullptr, the return value is written here instead of the result
+  // buffer of the runtime, e.g. by the JIT evaluators of ConstantFold, which
+  // may run on another thread than the kernel launches. Host memory only.
+  uint64 *result_buffer{nullptr};
   // |is_device_allocation| is true iff args[i] is a DeviceAllocation*.
   bool is_device_allocation[taichi_max_num_args_total]{false};
 
@@ -13,21 +13,13 @@ namespace {
 
 uint64 hash(IRNode *stmt) {
   TI_ASSERT(stmt);
-  // TODO: upgrade this using IR comparisons
-  std::string serialized;
-  irpass::re_id(stmt);
-  irpass::print(stmt, &serialized);
+  auto ret = irpass::analysis::hash_ir(stmt);
 
   // TODO: separate kernel from IR template
   auto *kernel = stmt->get_kernel();
   if (!kernel->args.empty()) {
     // We need to record the kernel's name if it has arguments.
-    serialized += stmt->get_kernel()->name;
-  }
-
-  uint64 ret = 0;
-  for (uint64 i = 0; i < serialized.size(); i++) {
-    ret = ret * 100000007UL + (uint64)serialized[i];
+    ret = hash_combine(ret, std::hash<std::string>{}(kernel->name));
   }
   return ret;
 }
@@ -115,9 +107,6 @@ IRHandle IRBank::fuse(IRHandle handle_a, IRHandle handle_b, Kernel *kernel) {
 
   irpass::full_simplify(task_a, kernel->program->config,
                         {/*after_lower_access=*/false, kernel->program});
-  // For now, re_id is necessary for the hash to be correct.
-  irpass::re_id(task_a);
-
   auto h = get_hash(task_a);
   result = IRHandle(task_a, h);
   insert(std::move(cloned_task_a), h);
@@ -3,6 +3,7 @@
 #include "taichi/backends/cuda/cuda_driver.h"
 #include "taichi/codegen/codegen.h"
 #include "taichi/common/task.h"
+#include "taichi/ir/analysis.h"
 #include "taichi/ir/statements.h"
 #include "taichi/ir/transforms.h"
 #include "taichi/program/async_engine.h"
@@ -19,6 +20,33 @@ TLANG_NAMESPACE_BEGIN
 
 class Function;
 
+namespace {
+
+// Reads an integer argument that LaunchContextBuilder::set_arg_int() has set.
+int64 get_int_arg(RuntimeContext &ctx, DataType dt, int arg_id) {
+  if (dt->is_primitive(PrimitiveTypeID::i32)) {
+    return ctx.get_arg<int32>(arg_id);
+  } else if (dt->is_primitive(PrimitiveTypeID::i64)) {
+    return ctx.get_arg<int64>(arg_id);
+  } else if (dt->is_primitive(PrimitiveTypeID::i8)) {
+    return ctx.get_arg<int8>(arg_id);
+  } else if (dt->is_primitive(PrimitiveTypeID::i16)) {
+    return ctx.get_arg<int16>(arg_id);
+  } else if (dt->is_primitive(PrimitiveTypeID::u8)) {
+    return ctx.get_arg<uint8>(arg_id);
+  } else if (dt->is_primitive(PrimitiveTypeID::u16)) {
+    return ctx.get_arg<uint16>(arg_id);
+  } else if (dt->is_primitive(PrimitiveTypeID::u32)) {
+    return ctx.get_arg<uint32>(arg_id);
+  } else if (dt->is_primitive(PrimitiveTypeID::u64)) {
+    return (int64)ctx.get_arg<uint64>(arg_id);
+  } else {
+    TI_NOT_IMPLEMENTED
+  }
+}
+
+}  // namespace
+
 Kernel::Kernel(Program &program,
                const std::function<void()> &func,
                const std::string &primal_name,
@@ -84,16 +112,213 @@ Kernel::Kernel(Program &program,
 }
 
 void Kernel::compile() {
+  if (precompiled_.valid()) {
+    // Being compiled by a worker; wait for it instead.
+    auto start_t = Time::get_time();
+    compiled_ = precompiled_.get();
+    precompile_timing_.launch_wait = Time::get_time() - start_t;
+    stat.add("precompile_launch_wait", precompile_timing_.launch_wait);
+    return;
+  }
   CurrentCallableGuard _(program, this);
+  fast_tier_ = uses_tiered_compilation();
+  num_fast_tier_launches_ = 0;
   compiled_ = program->compile(*this);
 }
 
+bool Kernel::uses_tiered_compilation() const {
+  const auto &config = program->config;
+  // Only the LLVM CPU backends compile in the background. Evaluators and
+  // accessors are tiny and launched by the runtime itself.
+  return config.tiered_compilation && !config.async_mode &&
+         arch_uses_llvm(arch) && arch_is_cpu(arch) && !is_evaluator &&
+         !is_accessor;
+}
+
+void Kernel::tier_up() {
+  fast_tier_ = false;
+  auto promise = std::make_shared<std::promise<FunctionType>>();
+  optimized_ = promise->get_future();
+  TI_TRACE("Tiering up kernel {} after {} launches", get_name(),
+           num_fast_tier_launches_);
+  program->get_precompile_workers()->enqueue([this, promise]() {
+    try {
+      CurrentCallableGuard _(program, this);
+      promise->set_value(program->compile(*this));
+    } catch (...) {
+      promise->set_exception(std::current_exception());
+    }
+  });
+}
+
+bool Kernel::wait_for_tier_up() {
+  if (!optimized_.valid()) {
+    return false;
+  }
+  optimized_.wait();
+  return true;
+}
+
+bool Kernel::uses_arg_specialization() const {
+  const auto &config = program->config;
+  // The AST must still be there to be lowered separately, and the backend must
+  // start the compilation from Kernel::lower(). Accessors and evaluators are
+  // launched with many different indices.
+  return config.arg_specialization && config.max_arg_specializations > 0 &&
+         !config.async_mode && supports_lowering(arch) && ir_is_ast_ &&
+         !lowered_ && !compiled_ && !precompiled_.valid() && !grad &&
+         !is_evaluator && !is_accessor;
+}
+
+void Kernel::prepare_arg_specialization() {
+  for (int i = 0; i < (int)args.size(); i++) {
+    if (!args[i].is_external_array && is_integral(args[i].dt)) {
+      arg_specialization_candidates_.emplace_back(i, 0);
+    }
+  }
+  if (arg_specialization_candidates_.empty()) {
+    return;
+  }
+  CurrentCallableGuard _(program, this);
+  // The same as the beginning of irpass::compile_to_offloads(). The generic
+  // kernel continues from here.
+  irpass::lower_ast(ir.get());
+  irpass::type_check(ir.get(), program->config);
+  ir_is_ast_ = false;
+  unspecialized_ir_ = irpass::analysis::clone(ir.get());
+}
+
+std::vector<Kernel *> Kernel::get_specialized_variants() const {
+  std::vector<Kernel *> variants;
+  for (const auto &v : specialized_variants_) {
+    variants.push_back(v.second.get());
+  }
+  return variants;
+}
+
+Kernel *Kernel::get_specialized_variant(RuntimeContext &ctx) {
+  const int threshold =
+      std::max(program->config.arg_specialization_threshold, 1);
+  if (num_observed_launches_ < threshold) {
+    // Drops the arguments whose value changed
+    std::vector<std::pair<int, int64>> unchanged;
+    for (const auto &[arg_id, value] : arg_specialization_candidates_) {
+      const auto current = get_int_arg(ctx, args[arg_id].dt, arg_id);
+      if (num_observed_launches_ == 0 || current == value) {
+        unchanged.emplace_back(arg_id, current);
+      }
+    }
+    arg_specialization_candidates_ = std::move(unchanged);
+    if (++num_observed_launches_ < threshold) {
+      return nullptr;
+    }
+    for (const auto &candidate : arg_specialization_candidates_) {
+      specialized_arg_ids_.push_back(candidate.first);
+    }
+    if (specialized_arg_ids_.empty()) {
+      TI_TRACE("The integer arguments of kernel {} change between launches, "
+               "not specializing it",
+               get_name());
+      unspecialized_ir_.reset();
+      return nullptr;
+    }
+  }
+  std::vector<int64> values;
+  for (int arg_id : specialized_arg_ids_) {
+    values.push_back(get_int_arg(ctx, args[arg_id].dt, arg_id));
+  }
+  auto it = specialized_variants_.find(values);
+  if (it != specialized_variants_.end()) {
+    return it->second.get();
+  }
+  if ((int)specialized_variants_.size() >=
+      program->config.max_arg_specializations) {
+    stat.add("arg_specialization_fallbacks", 1);
+    return nullptr;
+  }
+
+  std::unordered_map<int, TypedConstant> constants;
+  for (int i = 0; i < (int)specialized_arg_ids_.size(); i++) {
+    const int arg_id = specialized_arg_ids_[i];
+    constants.emplace(arg_id, TypedConstant(args[arg_id].dt, values[i]));
+  }
+  auto specialized_ir = irpass::analysis::clone(unspecialized_ir_.get());
+  irpass::specialize_args(specialized_ir.get(), constants);
+  auto variant = std::make_unique<Kernel>(
+      *program, std::move(specialized_ir),
+      fmt::format("{}_s{}", name, specialized_variants_.size()));
+  variant->args = args;
+  variant->rets = rets;
+  TI_TRACE("Specializing kernel {} as {}", get_name(), variant->get_name());
+  stat.add("arg_specializations", 1);
+  auto *ret = variant.get();
+  specialized_variants_[values] = std::move(variant);
+  return ret;
+}
+
+void Kernel::precompile(ParallelExecutor *workers) {
+  if (compiled_ || precompiled_.valid())
+    return;
+  if (workers == nullptr) {
+    compile();
+    return;
+  }
+  // std::function must be copyable, hence the shared_ptr.
+  auto promise = std::make_shared<std::promise<FunctionType>>();
+  precompiled_ = promise->get_future();
+  auto enqueue_t = Time::get_time();
+  workers->enqueue([this, promise, enqueue_t]() {
+    auto start_t = Time::get_time();
+    FunctionType compiled;
+    std::exception_ptr error;
+    try {
+      // |current_callable| is thread local, so this does not affect the
+      // kernels being built on the main thread.
+      CurrentCallableGuard _(program, this);
+      compiled = program->compile(*this);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    // Must be written before the launch is unblocked.
+    precompile_timing_.queue_wait = start_t - enqueue_t;
+    precompile_timing_.compile_time = Time::get_time() - start_t;
+    stat.add("precompile_queue_wait", precompile_timing_.queue_wait);
+    stat.add("precompile_compile_time", precompile_timing_.compile_time);
+    TI_TRACE("Precompiled kernel {}: waited {:.2f} ms, compiled in {:.2f} ms",
+             get_name(), precompile_timing_.queue_wait * 1000,
+             precompile_timing_.compile_time * 1000);
+    if (error) {
+      promise->set_exception(error);
+    } else {
+      promise->set_value(std::move(compiled));
+    }
+  });
+}
+
+void Kernel::release_compiled() {
+  TI_ASSERT(!precompiled_.valid());
+  if (optimized_.valid()) {
+    // Would otherwise be swapped in by the next launch.
+    optimized_.wait();
+    optimized_ = std::future<FunctionType>();
+  }
+  fast_tier_ = false;
+  // Destroying the launcher releases the JIT modules it holds.
+  compiled_ = nullptr;
+}
+
 void Kernel::lower(bool to_executable) {
   TI_ASSERT(!lowered_);
   TI_ASSERT(supports_lowering(arch));
 
   CurrentCallableGuard _(program, this);
   auto config = program->config;
+  if (is_evaluator) {
+    // Evaluators are not constant folded themselves.
+    config.advanced_optimization = false;
+    config.constant_folding = false;
+    config.external_optimization_level = 0;
+  }
   bool verbose = config.print_ir;
   if ((is_accessor && !config.print_accessor_ir) ||
       (is_evaluator && !config.print_evaluator_ir))
@@ -128,9 +353,33 @@ void Kernel::lower(bool to_executable) {
 
 void Kernel::operator()(LaunchContextBuilder &ctx_builder) {
   if (!program->config.async_mode || this->is_evaluator) {
+    if (uses_arg_specialization()) {
+      prepare_arg_specialization();
+    }
+    if (specializes_args()) {
+      if (auto *variant = get_specialized_variant(ctx_builder.get_context())) {
+        (*variant)(ctx_builder);
+        return;
+      }
+    }
+    if (optimized_.valid() && optimized_.wait_for(std::chrono::seconds(0)) ==
+                                  std::future_status::ready) {
+      // Launches on CPUs are synchronous, so the first tier is not running.
+      // Rethrows the errors of tier_up().
+      compiled_ = optimized_.get();
+      stat.add("tiered_compilation_swaps", 1);
+    }
     if (!compiled_) {
       compile();
     }
+    if (fast_tier_ && ++num_fast_tier_launches_ >=
+                          program->config.tiered_compilation_threshold) {
+      tier_up();
+    }
+    // Evaluators are tiny and kept alive by the JIT evaluator cache.
+    if (program->config.max_compiled_kernels > 0 && !is_evaluator) {
+      program->touch_compiled_kernel(this);
+    }
 
     for (auto &offloaded : ir->as<Block>()->statements) {
       account_for_offloaded(offloaded->as<OffloadedStmt>());
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <future>
+#include <map>
+
 #include "taichi/lang_util.h"
 #include "taichi/ir/snode.h"
 #include "taichi/ir/ir.h"
@@ -9,6 +12,7 @@
 TLANG_NAMESPACE_BEGIN
 
 class Program;
+class ParallelExecutor;
 
 class Kernel : public Callable {
  public:
@@ -67,12 +71,66 @@ class Kernel : public Callable {
          const std::string &name = "",
          bool grad = false);
 
+  // Where the time of a compilation started by precompile() went, in seconds.
+  struct PrecompileTiming {
+    // From precompile() until a worker picked up the kernel
+    float64 queue_wait{0.0};
+    float64 compile_time{0.0};
+    // How long the first launch blocked on the compilation
+    float64 launch_wait{0.0};
+  };
+
   bool lowered() const {
     return lowered_;
   }
 
   void compile();
 
+  /**
+   * Compiles the kernel on one of the |workers|. The first launch waits for
+   * the compilation and rethrows its errors. Does nothing if the kernel has
+   * been compiled or is being compiled.
+   *
+   * @param workers: The executor to compile on. Compiles the kernel right
+   * away if nullptr.
+   */
+  void precompile(ParallelExecutor *workers);
+
+  /**
+   * Drops the machine code of the kernel, which releases it on the backends
+   * that can unload code. The next launch compiles the kernel again.
+   */
+  void release_compiled();
+
+  // Only valid after the first launch, or after the workers have been flushed
+  const PrecompileTiming &get_precompile_timing() const {
+    return precompile_timing_;
+  }
+
+  // Whether the kernel is being compiled as the quick, unoptimized first tier
+  // of CompileConfig::tiered_compilation.
+  bool in_fast_tier() const {
+    return fast_tier_;
+  }
+
+  /**
+   * Waits until the optimized code of tiered compilation is ready to be
+   * swapped in by the next launch.
+   *
+   * @return: False if the kernel is not being tiered up.
+   */
+  bool wait_for_tier_up();
+
+  // Whether the launches compile variants of the kernel for the values of its
+  // integer arguments. See CompileConfig::arg_specialization.
+  bool specializes_args() const {
+    return unspecialized_ir_ != nullptr;
+  }
+
+  // The variants that arg specialization created. They are owned by this
+  // kernel.
+  std::vector<Kernel *> get_specialized_variants() const;
+
   /**
    * Lowers |ir| to CHI IR level
    *
@@ -103,6 +161,24 @@ class Kernel : public Callable {
   static bool supports_lowering(Arch arch);
 
  private:
+  bool uses_tiered_compilation() const;
+
+  // Recompiles the kernel with full optimizations on the precompile workers.
+  // A later launch swaps the result into |compiled_|.
+  void tier_up();
+
+  bool uses_arg_specialization() const;
+
+  // Lowers the AST to CHI IR, and keeps a copy of it from which the variants
+  // are specialized. Does nothing if the kernel has no integer arguments.
+  void prepare_arg_specialization();
+
+  // Returns the variant for the argument values in |ctx|, which is created on
+  // the first launch with these values. Returns nullptr if the generic kernel
+  // should be launched instead: while the arguments are being observed, or
+  // if there are too many variants already.
+  Kernel *get_specialized_variant(RuntimeContext &ctx);
+
   // True if |ir| is a frontend AST. False if it's already offloaded to CHI IR.
   bool ir_is_ast_{false};
   // The closure that, if invoked, lauches the backend kernel (shader)
@@ -111,6 +187,27 @@ class Kernel : public Callable {
   // lower inital AST all the way down to a bunch of
   // OffloadedStmt for async execution
   bool lowered_{false};
+  // The result of precompile() before the first launch
+  std::future<FunctionType> precompiled_;
+  PrecompileTiming precompile_timing_;
+  // Whether |compiled_| is the first tier, which has not been tiered up yet
+  bool fast_tier_{false};
+  // Launches of the first tier
+  int num_fast_tier_launches_{0};
+  // The result of tier_up() before it is swapped in
+  std::future<FunctionType> optimized_;
+  // The type-checked CHI IR before any optimization, with the loads of the
+  // arguments not yet replaced
+  std::unique_ptr<IRNode> unspecialized_ir_;
+  // The integer arguments that have kept their value so far, with that value.
+  // Observed over the first CompileConfig::arg_specialization_threshold
+  // launches.
+  std::vector<std::pair<int, int64>> arg_specialization_candidates_;
+  int num_observed_launches_{0};
+  // The integer arguments that the variants are specialized for
+  std::vector<int> specialized_arg_ids_;
+  // By the values of the arguments in |specialized_arg_ids_|
+  std::map<std::vector<int64>, std::unique_ptr<Kernel>> specialized_variants_;
 };
 
 TLANG_NAMESPACE_END
@@ -42,6 +42,7 @@ namespace taichi {
 namespace lang {
 Program *current_program = nullptr;
 std::atomic<int> Program::num_instances_;
+thread_local Callable *Program::current_callable = nullptr;
 
 Program::Program(Arch desired_arch)
     : snode_rw_accessors_bank_(this), ndarray_rw_accessors_bank_(this) {
@@ -71,6 +72,9 @@ Program::Program(Arch desired_arch)
     config.check_out_of_bound = true;
 
   profiler = make_profiler(config.arch, config.kernel_profiler);
+  if (config.compile_profiler) {
+    compile_profiler = std::make_unique<CompileProfiler>();
+  }
   if (arch_uses_llvm(config.arch)) {
 #ifdef TI_WITH_LLVM
     program_impl_ = std::make_unique<LlvmProgramImpl>(config, profiler.get());
@@ -143,6 +147,14 @@ Program::Program(Arch desired_arch)
     }
   }
 
+  // Only the CPU JIT session can unload the modules of released kernels.
+  if (config.max_compiled_kernels > 0 &&
+      !(arch_uses_llvm(config.arch) && arch_is_cpu(config.arch))) {
+    TI_WARN("max_compiled_kernels is not supported on arch={}",
+            arch_name(config.arch));
+    config.max_compiled_kernels = 0;
+  }
+
   stat.clear();
 
   Timelines::get_instance().set_enabled(config.timeline);
@@ -171,10 +183,95 @@ FunctionType Program::compile(Kernel &kernel, OffloadedStmt *offloaded) {
   TI_AUTO_PROF;
   auto ret = program_impl_->compile(&kernel, offloaded);
   TI_ASSERT(ret);
+  std::lock_guard<std::mutex> _(compilation_time_mut_);
   total_compilation_time_ += Time::get_time() - start_t;
   return ret;
 }
 
+void Program::precompile(const std::vector<Kernel *> &kernels) {
+  if (config.async_mode) {
+    TI_WARN("precompile() has no effect in async mode.");
+    return;
+  }
+  // The other backends are not safe to compile off the main thread.
+  auto *workers = arch_uses_llvm(config.arch) && arch_is_cpu(config.arch)
+                      ? get_precompile_workers()
+                      : nullptr;
+  for (auto *kernel : kernels) {
+    TI_ASSERT(kernel->program == this);
+    kernel->precompile(workers);
+    precompiled_kernels_.push_back(kernel);
+  }
+}
+
+ParallelExecutor *Program::get_precompile_workers() {
+  if (!precompile_workers_) {
+    precompile_workers_ = std::make_unique<ParallelExecutor>(
+        "precompile_worker", std::max(config.num_compile_threads, 1));
+  }
+  return precompile_workers_.get();
+}
+
+void Program::delete_kernel(Kernel *kernel) {
+  TI_ERROR_IF(config.async_mode, "Kernels cannot be deleted in async mode.");
+  auto it = std::find_if(
+      kernels.begin(), kernels.end(),
+      [&](const std::unique_ptr<Kernel> &k) { return k.get() == kernel; });
+  TI_ASSERT_INFO(it != kernels.end(), "Kernel {} is not owned by the program",
+                 kernel->get_name());
+  // A worker may still be compiling it.
+  if (precompile_workers_) {
+    precompile_workers_->flush();
+  }
+  // The code may still be running.
+  synchronize();
+  // The variants are launched and destroyed with the kernel.
+  auto deleted = kernel->get_specialized_variants();
+  deleted.push_back(kernel);
+  for (auto *k : deleted) {
+    precompiled_kernels_.erase(std::remove(precompiled_kernels_.begin(),
+                                           precompiled_kernels_.end(), k),
+                               precompiled_kernels_.end());
+    if (auto pos = compiled_kernel_positions_.find(k);
+        pos != compiled_kernel_positions_.end()) {
+      compiled_kernels_.erase(pos->second);
+      compiled_kernel_positions_.erase(pos);
+    }
+  }
+  kernels.erase(it);
+}
+
+void Program::touch_compiled_kernel(Kernel *kernel) {
+  auto pos = compiled_kernel_positions_.find(kernel);
+  if (pos != compiled_kernel_positions_.end()) {
+    compiled_kernels_.splice(compiled_kernels_.begin(), compiled_kernels_,
+                             pos->second);
+    return;
+  }
+  compiled_kernels_.push_front(kernel);
+  compiled_kernel_positions_[kernel] = compiled_kernels_.begin();
+  while ((int)compiled_kernels_.size() > config.max_compiled_kernels) {
+    auto *victim = compiled_kernels_.back();
+    TI_TRACE("Releasing the machine code of kernel {}", victim->get_name());
+    synchronize();
+    victim->release_compiled();
+    compiled_kernel_positions_.erase(victim);
+    compiled_kernels_.pop_back();
+  }
+}
+
+std::vector<std::pair<std::string, Kernel::PrecompileTiming>>
+Program::query_precompile_info() {
+  if (precompile_workers_) {
+    precompile_workers_->flush();
+  }
+  std::vector<std::pair<std::string, Kernel::PrecompileTiming>> ret;
+  for (auto *kernel : precompiled_kernels_) {
+    ret.emplace_back(kernel->get_name(), kernel->get_precompile_timing());
+  }
+  return ret;
+}
+
 void Program::materialize_runtime() {
   program_impl_->materialize_runtime(memory_pool_.get(), profiler.get(),
                                      &result_buffer);
@@ -182,11 +279,18 @@ void Program::materialize_runtime() {
 
 void Program::destroy_snode_tree(SNodeTree *snode_tree) {
   TI_ASSERT(arch_uses_llvm(config.arch) || config.arch == Arch::vulkan);
+  if (precompile_workers_) {
+    precompile_workers_->flush();
+  }
   program_impl_->destroy_snode_tree(snode_tree);
 }
 
 SNodeTree *Program::add_snode_tree(std::unique_ptr<SNode> root,
                                    bool compile_only) {
+  // The workers read the struct module that this replaces.
+  if (precompile_workers_) {
+    precompile_workers_->flush();
+  }
   const int id = snode_trees_.size();
   auto tree = std::make_unique<SNodeTree>(id, std::move(root));
   tree->root()->set_snode_tree_id(id);
@@ -440,6 +544,8 @@ uint64 Program::fetch_result_uint64(int i) {
 }
 
 void Program::finalize() {
+  // Joins the workers before the kernels they compile are destroyed.
+  precompile_workers_ = nullptr;
   synchronize();
   if (async_engine)
     async_engine = nullptr;  // Finalize the async engine threads before
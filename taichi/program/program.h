@@ -3,8 +3,10 @@
 #pragma once
 
 #include <functional>
+#include <list>
 #include <optional>
 #include <atomic>
+#include <mutex>
 
 #define TI_RUNTIME_HOST
 #include "taichi/ir/ir.h"
@@ -13,6 +15,7 @@
 #include "taichi/lang_util.h"
 #include "taichi/program/program_impl.h"
 #include "taichi/program/callable.h"
+#include "taichi/program/compile_profiler.h"
 #include "taichi/program/aot_module_builder.h"
 #include "taichi/program/function.h"
 #include "taichi/program/kernel.h"
@@ -83,6 +86,7 @@ TI_FORCE_INLINE Program &get_current_program() {
 class StructCompiler;
 class LlvmProgramImpl;
 class AsyncEngine;
+class ParallelExecutor;
 
 /**
  * Note [Backend-specific ProgramImpl]
@@ -100,7 +104,9 @@ class AsyncEngine;
 class Program {
  public:
   using Kernel = taichi::lang::Kernel;
-  Callable *current_callable{nullptr};
+  // Thread local so that precompile() can lower kernels on its workers while
+  // the frontend builds other kernels.
+  static thread_local Callable *current_callable;
   CompileConfig config;
   bool sync{false};  // device/host synchronized?
 
@@ -112,6 +118,9 @@ class Program {
 
   std::unique_ptr<KernelProfilerBase> profiler{nullptr};
 
+  // Only created when config.compile_profiler is on.
+  std::unique_ptr<CompileProfiler> compile_profiler{nullptr};
+
   std::unordered_map<JITEvaluatorId, std::unique_ptr<Kernel>>
       jit_evaluator_cache;
   std::mutex jit_evaluator_cache_mut;
@@ -191,6 +200,45 @@ class Program {
   // future.
   FunctionType compile(Kernel &kernel, OffloadedStmt *offloaded = nullptr);
 
+  /**
+   * Compiles |kernels| on background threads. Each launch only waits for the
+   * kernel it runs, so the compilation overlaps with whatever the caller does
+   * in between.
+   *
+   * Only the LLVM CPU backends compile in the background; the others compile
+   * |kernels| right away.
+   *
+   * @param kernels: The kernels to compile. Kernels that have been compiled
+   * are skipped.
+   */
+  void precompile(const std::vector<Kernel *> &kernels);
+
+  // The threads that precompile() and tiered compilation compile kernels on.
+  // Only the LLVM CPU backends may use them.
+  ParallelExecutor *get_precompile_workers();
+
+  /**
+   * Deletes |kernel|, which must have been created by this program, and
+   * releases its machine code.
+   */
+  void delete_kernel(Kernel *kernel);
+
+  /**
+   * Marks |kernel| as the most recently launched. Releases the machine code of
+   * the least recently launched kernels beyond config.max_compiled_kernels.
+   */
+  void touch_compiled_kernel(Kernel *kernel);
+
+  /**
+   * Waits for precompile() and reports where the time of each kernel it
+   * compiled went.
+   *
+   * @return The names and timings of the kernels, in the order they were
+   * passed to precompile().
+   */
+  std::vector<std::pair<std::string, Kernel::PrecompileTiming>>
+  query_precompile_info();
+
   void check_runtime_error();
 
   Kernel &get_snode_reader(SNode *snode);
@@ -315,7 +363,16 @@ class Program {
   std::unordered_map<FunctionKey, Function *> function_map_;
 
   std::unique_ptr<ProgramImpl> program_impl_;
+  // Guards |total_compilation_time_|, which the precompile workers add to.
+  std::mutex compilation_time_mut_;
   float64 total_compilation_time_{0.0};
+  std::unique_ptr<ParallelExecutor> precompile_workers_;
+  std::vector<Kernel *> precompiled_kernels_;
+  // The compiled kernels, the most recently launched first. Only maintained
+  // when config.max_compiled_kernels is set.
+  std::list<Kernel *> compiled_kernels_;
+  std::unordered_map<Kernel *, std::list<Kernel *>::iterator>
+      compiled_kernel_positions_;
   static std::atomic<int> num_instances_;
   bool finalized_{false};
 
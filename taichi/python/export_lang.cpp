@@ -37,6 +37,10 @@
 #include "taichi/backends/cuda/cuda_context.h"
 #endif
 
+#if TI_WITH_LLVM
+#include "taichi/backends/cpu/aot_module_loader.h"
+#endif
+
 TI_NAMESPACE_BEGIN
 bool test_threading();
 
@@ -150,6 +154,32 @@ void export_lang(py::module &m) {
       .def_readwrite("print_kernel_llvm_ir_optimized",
                      &CompileConfig::print_kernel_llvm_ir_optimized)
       .def_readwrite("print_kernel_nvptx", &CompileConfig::print_kernel_nvptx)
+      .def_readwrite("offline_cache", &CompileConfig::offline_cache)
+      .def_readwrite("offline_cache_file_path",
+                     &CompileConfig::offline_cache_file_path)
+      .def_readwrite("offline_cache_max_size_mb",
+                     &CompileConfig::offline_cache_max_size_mb)
+      .def_readwrite("num_compile_threads",
+                     &CompileConfig::num_compile_threads)
+      .def_readwrite("max_compiled_kernels",
+                     &CompileConfig::max_compiled_kernels)
+      .def_readwrite("tiered_compilation", &CompileConfig::tiered_compilation)
+      .def_readwrite("tiered_compilation_threshold",
+                     &CompileConfig::tiered_compilation_threshold)
+      .def_readwrite("arg_specialization", &CompileConfig::arg_specialization)
+      .def_readwrite("max_arg_specializations",
+                     &CompileConfig::max_arg_specializations)
+      .def_readwrite("arg_specialization_threshold",
+                     &CompileConfig::arg_specialization_threshold)
+      .def_readwrite("slp_vectorize", &CompileConfig::slp_vectorize)
+      .def_readwrite("cpu_loop_vectorize", &CompileConfig::cpu_loop_vectorize)
+      .def_readwrite("cpu_range_for_tasks", &CompileConfig::cpu_range_for_tasks)
+      .def_readwrite("cpu_nontemporal_store",
+                     &CompileConfig::cpu_nontemporal_store)
+      .def_readwrite("cpu_struct_for_prefetch",
+                     &CompileConfig::cpu_struct_for_prefetch)
+      .def_readwrite("cpu_aot_target", &CompileConfig::cpu_aot_target)
+      .def_readwrite("simd_width", &CompileConfig::simd_width)
       .def_readwrite("simplify_before_lower_access",
                      &CompileConfig::simplify_before_lower_access)
       .def_readwrite("simplify_after_lower_access",
@@ -165,6 +195,9 @@ void export_lang(py::module &m) {
       .def_readwrite("saturating_grid_dim", &CompileConfig::saturating_grid_dim)
       .def_readwrite("max_block_dim", &CompileConfig::max_block_dim)
       .def_readwrite("cpu_max_num_threads", &CompileConfig::cpu_max_num_threads)
+      .def_readwrite("cpu_work_stealing", &CompileConfig::cpu_work_stealing)
+      .def_readwrite("cpu_numa_aware", &CompileConfig::cpu_numa_aware)
+      .def_readwrite("cpu_spin_count", &CompileConfig::cpu_spin_count)
       .def_readwrite("random_seed", &CompileConfig::random_seed)
       .def_readwrite("verbose_kernel_launches",
                      &CompileConfig::verbose_kernel_launches)
@@ -173,6 +206,7 @@ void export_lang(py::module &m) {
                      &CompileConfig::demote_dense_struct_fors)
       .def_readwrite("kernel_profiler", &CompileConfig::kernel_profiler)
       .def_readwrite("timeline", &CompileConfig::timeline)
+      .def_readwrite("compile_profiler", &CompileConfig::compile_profiler)
       .def_readwrite("default_fp", &CompileConfig::default_fp)
       .def_readwrite("default_ip", &CompileConfig::default_ip)
       .def_readwrite("device_memory_GB", &CompileConfig::device_memory_GB)
@@ -191,6 +225,10 @@ void export_lang(py::module &m) {
       .def_readwrite("ndarray_use_torch", &CompileConfig::ndarray_use_torch)
       .def_readwrite("ndarray_use_cached_allocator",
                      &CompileConfig::ndarray_use_cached_allocator)
+      .def_readwrite("snode_tree_buffer_prezero",
+                     &CompileConfig::snode_tree_buffer_prezero)
+      .def_readwrite("snode_tree_buffer_rezero",
+                     &CompileConfig::snode_tree_buffer_rezero)
       .def_readwrite("cc_compile_cmd", &CompileConfig::cc_compile_cmd)
       .def_readwrite("cc_link_cmd", &CompileConfig::cc_link_cmd)
       .def_readwrite("async_opt_passes", &CompileConfig::async_opt_passes)
@@ -242,6 +280,21 @@ void export_lang(py::module &m) {
       .def_readwrite("max", &Program::KernelProfilerQueryResult::max)
       .def_readwrite("avg", &Program::KernelProfilerQueryResult::avg);
 
+  py::class_<CompilePassRecord>(m, "CompilePassRecord")
+      .def_readonly("kernel_name", &CompilePassRecord::kernel_name)
+      .def_readonly("pass_name", &CompilePassRecord::pass_name)
+      .def_readonly("time", &CompilePassRecord::time)
+      .def_readonly("num_statements_before",
+                    &CompilePassRecord::num_statements_before)
+      .def_readonly("num_statements_after",
+                    &CompilePassRecord::num_statements_after)
+      .def_readonly("iteration", &CompilePassRecord::iteration);
+
+  py::class_<Kernel::PrecompileTiming>(m, "PrecompileTiming")
+      .def_readonly("queue_wait", &Kernel::PrecompileTiming::queue_wait)
+      .def_readonly("compile_time", &Kernel::PrecompileTiming::compile_time)
+      .def_readonly("launch_wait", &Kernel::PrecompileTiming::launch_wait);
+
   py::class_<KernelProfileTracedRecord>(m, "KernelProfileTracedRecord")
       .def_readwrite("register_per_thread",
                      &KernelProfileTracedRecord::register_per_thread)
@@ -288,9 +341,32 @@ void export_lang(py::module &m) {
            [](Program *, const std::string &fn) {
              Timelines::get_instance().save(fn);
            })
+      .def("get_compile_profiler_records",
+           [](Program *program) {
+             if (!program->compile_profiler) {
+               return std::vector<CompilePassRecord>();
+             }
+             return program->compile_profiler->get_records();
+           })
+      .def("compile_profiler_clear",
+           [](Program *program) {
+             if (program->compile_profiler) {
+               program->compile_profiler->clear();
+             }
+           })
+      .def("compile_profiler_save",
+           [](Program *program, const std::string &fn) {
+             TI_ERROR_IF(!program->compile_profiler,
+                         "The compile profiler is off. Please set "
+                         "ti.init(compile_profiler=True).");
+             program->compile_profiler->save(fn);
+           })
       .def("print_memory_profiler_info", &Program::print_memory_profiler_info)
       .def("finalize", &Program::finalize)
       .def("get_total_compilation_time", &Program::get_total_compilation_time)
+      .def("precompile", &Program::precompile)
+      .def("delete_kernel", &Program::delete_kernel)
+      .def("query_precompile_info", &Program::query_precompile_info)
       .def("visualize_layout", &Program::visualize_layout)
       .def("get_snode_num_dynamically_allocated",
            &Program::get_snode_num_dynamically_allocated)
@@ -312,6 +388,31 @@ void export_lang(py::module &m) {
       .def("add_kernel_template", &AotModuleBuilder::add_kernel_template)
       .def("dump", &AotModuleBuilder::dump);
 
+#if TI_WITH_LLVM
+  // Runs the kernels of a saved CPU AOT module without a Program, like a C++
+  // application would. Only kernels without arguments can be launched.
+  py::class_<cpu::AotModuleLoader>(m, "CpuAotModuleLoader")
+      .def(py::init<const std::string &, int>(), py::arg("module_dir"),
+           py::arg("num_threads") = 0)
+      .def("has_kernel", &cpu::AotModuleLoader::has_kernel)
+      .def("launch_kernel",
+           [](cpu::AotModuleLoader *loader, const std::string &name) {
+             RuntimeContext ctx{};
+             loader->launch_kernel(name, ctx);
+           })
+      .def("get_field_ptr",
+           [](cpu::AotModuleLoader *loader, const std::string &name) {
+             return (uint64)loader->get_field_ptr(name);
+           })
+      .def("get_field_element_stride",
+           [](cpu::AotModuleLoader *loader, const std::string &name) {
+             const auto *field = loader->get_field(name);
+             TI_ERROR_IF(field == nullptr, "AOT: field \"{}\" not found",
+                         name);
+             return field->element_stride;
+           });
+#endif
+
   m.def("get_current_program", get_current_program,
         py::return_value_policy::reference);
 
@@ -445,6 +546,11 @@ void export_lang(py::module &m) {
       .def("get_ret_int", &Kernel::get_ret_int)
       .def("get_ret_float", &Kernel::get_ret_float)
       .def("make_launch_context", &Kernel::make_launch_context)
+      .def("wait_for_tier_up",
+           [](Kernel *kernel) {
+             py::gil_scoped_release release;
+             return kernel->wait_for_tier_up();
+           })
       .def("__call__",
            [](Kernel *kernel, Kernel::LaunchContextBuilder &launch_ctx) {
              py::gil_scoped_release release;
@@ -987,6 +1093,7 @@ void export_lang(py::module &m) {
       .value("block_local", SNodeAccessFlag::block_local)
       .value("read_only", SNodeAccessFlag::read_only)
       .value("mesh_local", SNodeAccessFlag::mesh_local)
+      .value("write_only", SNodeAccessFlag::write_only)
       .export_values();
 
   m.def("insert_snode_access_flag", insert_snode_access_flag);
@@ -83,7 +83,7 @@ i32 test_node_allocator(RuntimeContext *context) {
     taichi_printf(runtime, "ptr %p\n", ptrs[i]);
     nodes->recycle(ptrs[i]);
   }
-  nodes->gc_serial();
+  node_manager_gc_cpu(runtime, nodes, /*num_threads=*/1);
   for (int i = 19; i < 24; i++) {
     taichi_printf(runtime, "allocating %d\n", i);
     ptrs[i] = nodes->allocate();
@@ -121,7 +121,7 @@ i32 test_node_allocator_gc_cpu(RuntimeContext *context) {
     nodes->recycle(ptrs[i]);
   }
   TI_TEST_CHECK(nodes->free_list->size() == 0, runtime);
-  nodes->gc_serial();
+  node_manager_gc_cpu(runtime, nodes, /*num_threads=*/1);
   // After the first round GC, |free_list| should have |kN| items.
   TI_TEST_CHECK(nodes->free_list->size() == kN, runtime);
 
@@ -137,7 +137,7 @@ i32 test_node_allocator_gc_cpu(RuntimeContext *context) {
     taichi_printf(runtime, "[2] ptr %p\n", ptrs[i]);
     nodes->recycle(ptrs[i]);
   }
-  nodes->gc_serial();
+  node_manager_gc_cpu(runtime, nodes, /*num_threads=*/1);
   // After GC, all items should be returned to |free_list|.
   taichi_printf(runtime, "free_list_size=%d\n", nodes->free_list->size());
   TI_TEST_CHECK(nodes->free_list->size() == kN, runtime);
@@ -145,6 +145,82 @@ i32 test_node_allocator_gc_cpu(RuntimeContext *context) {
   return 0;
 }
 
+// Allocates nodes over many chunks of the data list, recycles half of them
+// and checks that GC hands exactly those out again, at valid addresses.
+i32 check_node_allocator_chunks(RuntimeContext *context, i32 element_size) {
+  auto runtime = context->runtime;
+  constexpr int kN = 100;
+  // 8 nodes per chunk
+  auto nodes = context->runtime->create<NodeManager>(runtime, element_size, 8);
+  Ptr ptrs[kN];
+  bool reused[kN];
+  for (int i = 0; i < kN; i++) {
+    ptrs[i] = nodes->allocate(context);
+    reused[i] = false;
+    auto idx = nodes->locate(ptrs[i]);
+    TI_TEST_CHECK(nodes->get_node_ptr(idx) == ptrs[i], runtime);
+    if (element_size % 8 == 0) {
+      TI_TEST_CHECK((u64)ptrs[i] % 8 == 0, runtime);
+    }
+    for (int k = 0; k < element_size; k++) {
+      ptrs[i][k] = (u8)(i + 1);
+    }
+  }
+  for (int i = 0; i < kN; i++) {
+    for (int j = 0; j < i; j++) {
+      TI_TEST_CHECK(nodes->locate(ptrs[i]) != nodes->locate(ptrs[j]),
+                    runtime);
+    }
+  }
+  TI_TEST_CHECK(nodes->get_num_allocated() == kN, runtime);
+
+  for (int i = 1; i < kN; i += 2) {
+    nodes->recycle(ptrs[i]);
+  }
+  node_manager_gc_cpu(runtime, nodes, /*num_threads=*/1);
+  TI_TEST_CHECK(nodes->free_list->size() == kN / 2, runtime);
+  TI_TEST_CHECK(nodes->get_num_allocated() == kN, runtime);
+
+  // The kept nodes are untouched
+  for (int i = 0; i < kN; i += 2) {
+    TI_TEST_CHECK(nodes->get_node_ptr(nodes->locate(ptrs[i])) == ptrs[i],
+                  runtime);
+    for (int k = 0; k < element_size; k++) {
+      TI_TEST_CHECK(ptrs[i][k] == (u8)(i + 1), runtime);
+    }
+  }
+  // Each recycled node comes back once, zero-filled
+  for (int n = 0; n < kN / 2; n++) {
+    auto ptr = nodes->allocate(context);
+    int i = -1;
+    for (int j = 1; j < kN; j += 2) {
+      if (ptrs[j] == ptr) {
+        i = j;
+      }
+    }
+    TI_TEST_CHECK(i != -1 && !reused[i], runtime);
+    reused[i] = true;
+    TI_TEST_CHECK(nodes->get_node_ptr(nodes->locate(ptr)) == ptr, runtime);
+    for (int k = 0; k < element_size; k++) {
+      TI_TEST_CHECK(ptr[k] == 0, runtime);
+    }
+  }
+  TI_TEST_CHECK(nodes->get_num_allocated() == kN, runtime);
+
+  // Then fresh nodes follow
+  auto ptr = nodes->allocate(context);
+  TI_TEST_CHECK(nodes->locate(ptr) >= kN, runtime);
+  TI_TEST_CHECK(nodes->get_num_allocated() == kN + 1, runtime);
+  return 0;
+}
+
+i32 test_node_allocator_chunks(RuntimeContext *context) {
+  // With a 4-byte and an 8-byte node header
+  check_node_allocator_chunks(context, 12);
+  check_node_allocator_chunks(context, 16);
+  return 0;
+}
+
 i32 test_active_mask(RuntimeContext *context) {
   auto rt = context->runtime;
   taichi_printf(rt, "%d activemask %x\n", thread_idx(), cuda_active_mask());
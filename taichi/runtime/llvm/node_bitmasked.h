@@ -17,7 +17,11 @@ void Bitmasked_activate(Ptr meta, Ptr node, int i) {
   auto num_elements = Bitmasked_get_num_elements(meta, node);
   auto data_section_size = element_size * num_elements;
   auto mask_begin = (u32 *)(node + data_section_size);
-  atomic_or_u32(&mask_begin[i / 32], 1UL << (i % 32));
+  u32 bit = 1UL << (i % 32);
+  if (!(atomic_or_u32(&mask_begin[i / 32], bit) & bit)) {
+    mark_snode_modified(smeta);
+    log_cell_change(smeta, node, i, nullptr);
+  }
 }
 
 void Bitmasked_deactivate(Ptr meta, Ptr node, int i) {
@@ -26,7 +30,11 @@ void Bitmasked_deactivate(Ptr meta, Ptr node, int i) {
   auto num_elements = Bitmasked_get_num_elements(meta, node);
   auto data_section_size = element_size * num_elements;
   auto mask_begin = (u32 *)(node + data_section_size);
-  atomic_and_u32(&mask_begin[i / 32], ~(1UL << (i % 32)));
+  u32 bit = 1UL << (i % 32);
+  if (atomic_and_u32(&mask_begin[i / 32], ~bit) & bit) {
+    mark_snode_modified(smeta);
+    log_cell_change(smeta, node, i, node + element_size * i);
+  }
 }
 
 i32 Bitmasked_is_active(Ptr meta, Ptr node, int i) {
@@ -38,6 +46,31 @@ i32 Bitmasked_is_active(Ptr meta, Ptr node, int i) {
   return i32(bool((mask_begin[i / 8] >> (i % 8)) & 1));
 }
 
+// Instead of testing the cells one by one, the mask is scanned a 32-bit word
+// at a time and the position of the lowest set bit is taken with
+// count-trailing-zeros. Empty ranges cost one load per 32 cells.
+i32 Bitmasked_find_next_active(Ptr meta, Ptr node, int begin, int end) {
+  if (begin >= end) {
+    return end;
+  }
+  auto smeta = (StructMeta *)meta;
+  auto element_size = StructMeta_get_element_size(smeta);
+  auto num_elements = Bitmasked_get_num_elements(meta, node);
+  auto data_section_size = element_size * num_elements;
+  auto mask_begin = (u32 *)(node + data_section_size);
+  int w = begin / 32;
+  int w_end = (end + 31) / 32;
+  // Drop the bits below begin in the first word
+  u32 word = mask_begin[w] & (~0u << (begin % 32));
+  while (word == 0) {
+    if (++w == w_end) {
+      return end;
+    }
+    word = mask_begin[w];
+  }
+  return std::min(w * 32 + __builtin_ctz(word), end);
+}
+
 Ptr Bitmasked_lookup_element(Ptr meta, Ptr node, int i) {
   return node + ((StructMeta *)meta)->element_size * i;
 }
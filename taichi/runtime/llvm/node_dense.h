@@ -19,6 +19,10 @@ i32 Dense_is_active(Ptr meta, Ptr node, int i) {
   return 1;
 }
 
+i32 Dense_find_next_active(Ptr meta, Ptr node, int begin, int end) {
+  return begin;
+}
+
 Ptr Dense_lookup_element(Ptr meta, Ptr node, int i) {
   return node + ((StructMeta *)meta)->element_size * i;
 }
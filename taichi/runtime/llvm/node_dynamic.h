@@ -1,5 +1,17 @@
 #pragma once
 
+// Elements of a dynamic node are stored in chunks of chunk_size elements.
+// Every chunk starts with a pointer-sized header. The node points to the first
+// chunk, whose header points to the second chunk, so short lists need no
+// extra allocation. The header of the second chunk points to the chunk
+// directory, a radix tree of pages whose leaves point to chunks 2, 3, ....
+// Its depth is fixed per SNode and chosen so that the tree covers
+// max_num_elements, so locating any chunk takes a bounded number of steps
+// regardless of the index.
+//
+// Directory pages are allocated from the same NodeManager as the chunks, and
+// are recycled together with them when the node is deactivated.
+
 struct DynamicNode {
   i32 lock;
   i32 n;
@@ -9,35 +21,100 @@ struct DynamicNode {
 // Specialized Attributes and functions
 struct DynamicMeta : public StructMeta {
   int chunk_size;
+  // Number of chunk pointers a directory page holds
+  int directory_fanout;
+  // Number of chunks covered by a subtree at the top level of the directory
+  int directory_top_span;
 };
 
 STRUCT_FIELD(DynamicMeta, chunk_size);
+STRUCT_FIELD(DynamicMeta, directory_fanout);
+STRUCT_FIELD(DynamicMeta, directory_top_span);
+
+// Returns the address where the pointer to chunk c is stored, or nullptr if
+// the directory does not reach it yet. When alloc is not null, missing
+// directory pages are allocated on the way; the node lock must be held.
+Ptr *Dynamic_get_chunk_ptr(DynamicMeta *meta,
+                           DynamicNode *node,
+                           int c,
+                           NodeManager *alloc) {
+  // The first two chunks form a linked list
+  auto p_chunk_ptr = &node->ptr;
+  for (int k = 0; k < 2; k++) {
+    if (c == k) {
+      return p_chunk_ptr;
+    }
+    if (*p_chunk_ptr == nullptr) {
+      if (alloc == nullptr)
+        return nullptr;
+      *p_chunk_ptr = alloc->allocate(meta->context);
+    }
+    p_chunk_ptr = (Ptr *)*p_chunk_ptr;
+  }
+  i64 fanout = meta->directory_fanout;
+  i64 span = meta->directory_top_span;
+  i64 offset = c - 2;
+  auto p_page = p_chunk_ptr;
+  while (true) {
+    if (*p_page == nullptr) {
+      if (alloc == nullptr)
+        return nullptr;
+      *p_page = alloc->allocate(meta->context);
+    }
+    auto p_entry = (Ptr *)*p_page + offset / span;
+    if (span == 1) {
+      return p_entry;
+    }
+    offset %= span;
+    span /= fanout;
+    p_page = p_entry;
+  }
+}
+
+// Makes sure the chunk holding element i is allocated and returns it.
+Ptr Dynamic_touch_chunk(DynamicMeta *meta, DynamicNode *node, int i) {
+  auto c = i / meta->chunk_size;
+  auto p_chunk_ptr = Dynamic_get_chunk_ptr(meta, node, c, nullptr);
+  if (p_chunk_ptr == nullptr || *(Ptr volatile *)p_chunk_ptr == nullptr) {
+    locked_task(Ptr(&node->lock), [&] {
+      auto rt = meta->context->runtime;
+      auto alloc = rt->node_allocators[meta->snode_id];
+      p_chunk_ptr = Dynamic_get_chunk_ptr(meta, node, c, alloc);
+      if (*p_chunk_ptr == nullptr) {
+        *p_chunk_ptr = alloc->allocate(meta->context);
+      }
+    });
+  }
+  return *p_chunk_ptr;
+}
+
+void Dynamic_recycle_directory(NodeManager *alloc,
+                               Ptr page,
+                               i64 fanout,
+                               i64 span) {
+  for (int k = 0; k < fanout; k++) {
+    auto entry = ((Ptr *)page)[k];
+    if (entry == nullptr)
+      continue;
+    if (span == 1) {
+      alloc->recycle(entry);
+    } else {
+      Dynamic_recycle_directory(alloc, entry, fanout, span / fanout);
+    }
+  }
+  alloc->recycle(page);
+}
 
 void Dynamic_activate(Ptr meta_, Ptr node_, int i) {
   auto meta = (DynamicMeta *)(meta_);
   auto node = (DynamicNode *)(node_);
   // We need to not only update node->n, but also make sure the chunk containing
   // element i is allocated.
-  atomic_max_i32(&node->n, i + 1);
-  int chunk_start = 0;
-  auto p_chunk_ptr = &node->ptr;
-  auto chunk_size = meta->chunk_size;
-  while (true) {
-    if (*p_chunk_ptr == nullptr) {
-      locked_task(Ptr(&node->lock), [&] {
-        if (*p_chunk_ptr == nullptr) {
-          auto rt = meta->context->runtime;
-          auto alloc = rt->node_allocators[meta->snode_id];
-          *p_chunk_ptr = alloc->allocate();
-        }
-      });
-    }
-    if (i < chunk_start + chunk_size) {
-      return;
-    }
-    p_chunk_ptr = (Ptr *)*p_chunk_ptr;
-    chunk_start += chunk_size;
+  if (*(volatile i32 *)&node->n <= i) {
+    mark_snode_modified(meta);
   }
+  atomic_max_i32(&node->n, i + 1);
+  Dynamic_touch_chunk(meta, node, i);
 }
 
 void Dynamic_deactivate(Ptr meta_, Ptr node_) {
@@ -46,13 +123,21 @@ void Dynamic_deactivate(Ptr meta_, Ptr node_) {
   if (node->n > 0) {
     locked_task(Ptr(&node->lock), [&] {
       node->n = 0;
-      auto p_chunk_ptr = &node->ptr;
+      mark_snode_modified(meta);
+      if (node->ptr == nullptr)
+        return;
       auto rt = meta->context->runtime;
       auto alloc = rt->node_allocators[meta->snode_id];
-      while (*p_chunk_ptr) {
-        alloc->recycle(*p_chunk_ptr);
-        p_chunk_ptr = (Ptr *)*p_chunk_ptr;
+      auto second_chunk = *(Ptr *)node->ptr;
+      if (second_chunk) {
+        auto directory = *(Ptr *)second_chunk;
+        if (directory) {
+          Dynamic_recycle_directory(alloc, directory, meta->directory_fanout,
+                                    meta->directory_top_span);
+        }
+        alloc->recycle(second_chunk);
       }
+      alloc->recycle(node->ptr);
       node->ptr = nullptr;
     });
   }
@@ -63,26 +148,10 @@ i32 Dynamic_append(Ptr meta_, Ptr node_, i32 data) {
   auto node = (DynamicNode *)(node_);
   auto chunk_size = meta->chunk_size;
   auto i = atomic_add_i32(&node->n, 1);
-  int chunk_start = 0;
-  auto p_chunk_ptr = &node->ptr;
-  while (true) {
-    if (*p_chunk_ptr == nullptr) {
-      locked_task(Ptr(&node->lock), [&] {
-        if (*p_chunk_ptr == nullptr) {
-          auto rt = meta->context->runtime;
-          auto alloc = rt->node_allocators[meta->snode_id];
-          *p_chunk_ptr = alloc->allocate();
-        }
-      });
-    }
-    if (i < chunk_start + chunk_size) {
-      *(i32 *)(*p_chunk_ptr + sizeof(Ptr) +
-               (i - chunk_start) * meta->element_size) = data;
-      break;
-    }
-    p_chunk_ptr = (Ptr *)(*p_chunk_ptr);
-    chunk_start += chunk_size;
-  }
+  mark_snode_modified(meta);
+  auto chunk_ptr = Dynamic_touch_chunk(meta, node, i);
+  *(i32 *)(chunk_ptr + sizeof(Ptr) + (i % chunk_size) * meta->element_size) =
+      data;
   return i;
 }
 
@@ -91,25 +160,25 @@ i32 Dynamic_is_active(Ptr meta_, Ptr node_, int i) {
   return i32(i < node->n);
 }
 
+i32 Dynamic_find_next_active(Ptr meta_, Ptr node_, int begin, int end) {
+  auto node = (DynamicNode *)(node_);
+  return begin < node->n ? begin : end;
+}
+
 Ptr Dynamic_lookup_element(Ptr meta_, Ptr node_, int i) {
   auto meta = (DynamicMeta *)(meta_);
   auto node = (DynamicNode *)(node_);
   if (Dynamic_is_active(meta_, node_, i)) {
-    int chunk_start = 0;
-    auto chunk_ptr = node->ptr;
     auto chunk_size = meta->chunk_size;
-    while (true) {
-      if (i < chunk_start + chunk_size) {
-        auto addr =
-            chunk_ptr + sizeof(Ptr) + (i - chunk_start) * meta->element_size;
-        return addr;
-      }
-      chunk_ptr = *(Ptr *)chunk_ptr;
-      chunk_start += chunk_size;
+    // The chunk may not be allocated yet while another thread appends to it
+    auto p_chunk_ptr =
+        Dynamic_get_chunk_ptr(meta, node, i / chunk_size, nullptr);
+    if (p_chunk_ptr != nullptr && *p_chunk_ptr != nullptr) {
+      return *p_chunk_ptr + sizeof(Ptr) +
+             (i % chunk_size) * meta->element_size;
     }
-  } else {
-    return (meta->context->runtime)->ambient_elements[meta->snode_id];
   }
+  return (meta->context->runtime)->ambient_elements[meta->snode_id];
 }
 
 i32 Dynamic_get_num_elements(Ptr meta_, Ptr node_) {
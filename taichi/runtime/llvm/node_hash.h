@@ -0,0 +1,296 @@
+#pragma once
+
+// A hash SNode maps the (linearized) index of a cell to a pointer to its
+// child, so memory usage is proportional to the number of active cells rather
+// than to the size of the index space.
+//
+// Slots live in a chain of open-addressing tables, table t holding
+// (table_size << t) slots. A key is stored in the first table in which its
+// probe window contains either the key itself or an empty slot. Within a
+// kernel, keys are never removed (deactivation only releases the child and
+// leaves the key behind as a tombstone), so every thread agrees on where a
+// key lives and insertion only needs a CAS on the key. The node lock is taken
+// only when a new table has to be allocated.
+//
+// The first deactivation in a node queues it in the hash compaction list of
+// its SNode. Garbage collection then drops the tombstones of the queued nodes
+// and reinserts their live keys, which shrinks num_tables back to the tables
+// the live keys need.
+//
+// For element list generation and struct-fors, a hash node is viewed as a
+// "slot space" of get_num_elements() slots instead of its index space. The
+// Hash_slot_* functions below translate slots back to indices.
+
+struct HashSlot {
+  u32 key;  // index + 1, 0 for empty slots
+  i32 lock;
+  Ptr data;
+};
+
+struct HashNode {
+  i32 lock;
+  i32 num_tables;
+  // Number of deactivations since the last compaction
+  i32 num_dead_keys;
+  Ptr tables[taichi_hash_max_num_tables];
+};
+
+// An entry of LLVMRuntime::hash_compaction_lists
+struct HashCompactionItem {
+  HashNode *node;
+  i32 table_size;
+};
+
+// Specialized Attributes and functions
+struct HashMeta : public StructMeta {
+  int table_size;
+};
+
+STRUCT_FIELD(HashMeta, table_size);
+
+constexpr int hash_probe_length = 16;
+
+u32 hash_slot_hash(u32 key) {
+  // MurmurHash3 finalizer
+  key ^= key >> 16;
+  key *= 0x85ebca6bu;
+  key ^= key >> 13;
+  key *= 0xc2b2ae35u;
+  key ^= key >> 16;
+  return key;
+}
+
+HashSlot *Hash_get_table(HashMeta *meta, HashNode *node, int t, bool create) {
+  auto table = *(HashSlot *volatile *)&node->tables[t];
+  if (table == nullptr && create) {
+    locked_task(
+        &node->lock,
+        [&] {
+          auto rt = meta->context->runtime;
+          auto size = sizeof(HashSlot) * ((std::size_t)meta->table_size << t);
+          auto allocated = (u64)rt->request_allocate_aligned(size, 4096);
+          atomic_exchange_u64((u64 *)&node->tables[t], allocated);
+        },
+        [&]() { return node->tables[t] == nullptr; });
+    table = *(HashSlot *volatile *)&node->tables[t];
+  }
+  return table;
+}
+
+HashSlot *Hash_find_slot(Ptr meta_, Ptr node_, int i, bool insert) {
+  auto meta = (HashMeta *)meta_;
+  auto node = (HashNode *)node_;
+  u32 key = (u32)i + 1u;
+  auto h = hash_slot_hash(key);
+  for (int t = 0; t < taichi_hash_max_num_tables; t++) {
+    auto table = Hash_get_table(meta, node, t, insert);
+    if (table == nullptr)
+      return nullptr;
+    u32 mask = ((u32)meta->table_size << t) - 1;
+    auto window = std::min(mask + 1, (u32)hash_probe_length);
+    for (u32 p = 0; p < window; p++) {
+      auto slot = &table[(h + p) & mask];
+      u32 k = *(volatile u32 *)&slot->key;
+      if (k == 0) {
+        if (!insert)
+          return nullptr;
+        u32 expected = 0;
+        if (__atomic_compare_exchange_n(&slot->key, &expected, key, false,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+          // Compaction may leave allocated tables beyond num_tables.
+          if (t >= *(volatile i32 *)&node->num_tables) {
+            atomic_max_i32(&node->num_tables, t + 1);
+          }
+          return slot;
+        }
+        k = expected;
+      }
+      if (k == key)
+        return slot;
+    }
+  }
+  taichi_assert_runtime(meta->context->runtime, false,
+                        "Hash SNode out of slot tables.");
+  return nullptr;
+}
+
+i32 Hash_get_num_elements(Ptr meta_, Ptr node_) {
+  auto meta = (HashMeta *)meta_;
+  auto node = (HashNode *)node_;
+  // Slots beyond the range of i32 cannot be iterated over.
+  auto num_slots = (i64)meta->table_size * (((i64)1 << node->num_tables) - 1);
+  return (i32)std::min(num_slots, (i64)INT32_MAX);
+}
+
+void Hash_activate(Ptr meta_, Ptr node, int i) {
+  auto meta = (HashMeta *)meta_;
+  auto slot = Hash_find_slot(meta_, node, i, true);
+  if (slot == nullptr) {
+    // Out of slot tables, which has been reported by Hash_find_slot
+    return;
+  }
+  volatile Ptr *data_ptr = &slot->data;
+  if (*data_ptr == nullptr) {
+    // The cuda_ calls will return 0 or do noop on CPUs
+    u32 mask = cuda_active_mask();
+    if (is_representative(mask, (u64)slot)) {
+      locked_task(
+          &slot->lock,
+          [&] {
+            auto rt = meta->context->runtime;
+            auto alloc = rt->node_allocators[meta->snode_id];
+            auto allocated = (u64)alloc->allocate(meta->context);
+            atomic_exchange_u64((u64 *)data_ptr, allocated);
+            mark_snode_modified(meta);
+          },
+          [&]() { return *data_ptr == nullptr; });
+    }
+    warp_barrier(mask);
+  }
+}
+
+void Hash_deactivate(Ptr meta_, Ptr node_, int i) {
+  auto slot = Hash_find_slot(meta_, node_, i, false);
+  if (slot != nullptr && slot->data != nullptr) {
+    locked_task(&slot->lock, [&] {
+      if (slot->data != nullptr) {
+        auto meta = (HashMeta *)meta_;
+        auto node = (HashNode *)node_;
+        auto rt = meta->context->runtime;
+        auto alloc = rt->node_allocators[meta->snode_id];
+        alloc->recycle(slot->data);
+        slot->data = nullptr;
+        mark_snode_modified(meta);
+        auto compaction_list = rt->hash_compaction_lists[meta->snode_id];
+        if (atomic_add_i32(&node->num_dead_keys, 1) == 0 &&
+            compaction_list != nullptr) {
+          HashCompactionItem item;
+          item.node = node;
+          item.table_size = meta->table_size;
+          compaction_list->append(&item);
+        }
+      }
+    });
+  }
+}
+
+i32 Hash_is_active(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i, false);
+  return slot != nullptr && slot->data != nullptr;
+}
+
+Ptr Hash_lookup_element(Ptr meta, Ptr node, int i) {
+  auto slot = Hash_find_slot(meta, node, i, false);
+  if (slot == nullptr || slot->data == nullptr) {
+    auto smeta = (StructMeta *)meta;
+    return (smeta->context->runtime)->ambient_elements[smeta->snode_id];
+  }
+  return slot->data;
+}
+
+// Slot space accessors. Slot s lives in the table t satisfying
+// table_size * (2^t - 1) <= s < table_size * (2^(t+1) - 1).
+HashSlot *Hash_get_slot(Ptr meta_, Ptr node_, int s) {
+  auto meta = (HashMeta *)meta_;
+  auto node = (HashNode *)node_;
+  int t = 0;
+  i64 table_begin = 0;
+  while (s >= table_begin + ((i64)meta->table_size << t)) {
+    table_begin += (i64)meta->table_size << t;
+    t++;
+  }
+  return &((HashSlot *)node->tables[t])[s - table_begin];
+}
+
+i32 Hash_slot_is_active(Ptr meta, Ptr node, int s) {
+  return Hash_get_slot(meta, node, s)->data != nullptr;
+}
+
+i32 Hash_slot_get_index(Ptr meta, Ptr node, int s) {
+  return (i32)(Hash_get_slot(meta, node, s)->key - 1u);
+}
+
+Ptr Hash_slot_lookup_element(Ptr meta, Ptr node, int s) {
+  return Hash_get_slot(meta, node, s)->data;
+}
+
+// Like the element lists, walks slot space: returns the first slot in
+// [begin, end) that holds an active cell, or end.
+i32 Hash_find_next_active(Ptr meta, Ptr node, int begin, int end) {
+  int num_slots = std::min(end, Hash_get_num_elements(meta, node));
+  while (begin < num_slots && !Hash_slot_is_active(meta, node, begin)) {
+    begin++;
+  }
+  return begin < num_slots ? begin : end;
+}
+
+// Drops the tombstones of |node| and reinserts its live keys. Only called by
+// garbage collection, when no kernel accesses the node.
+//
+// The live slots are first marked as pending through their (otherwise unused)
+// lock. Each pending entry is then taken out of its slot and stored at the
+// first slot of its probe sequence that is empty or still pending. In the
+// latter case the pending entry found there is carried on instead. Every
+// step places one entry for good, and no placed entry ever has an empty slot
+// in front of it in its probe sequence, which is what Hash_find_slot relies
+// on.
+void Hash_compact(LLVMRuntime *runtime, HashNode *node, i32 table_size) {
+  auto num_tables = node->num_tables;
+  for (int t = 0; t < num_tables; t++) {
+    auto table = (HashSlot *)node->tables[t];
+    for (i64 s = 0; s < ((i64)table_size << t); s++) {
+      if (table[s].data == nullptr) {
+        table[s].key = 0;
+      } else {
+        table[s].lock = 1;
+      }
+    }
+  }
+  i32 new_num_tables = 0;
+  for (int t = 0; t < num_tables; t++) {
+    auto table = (HashSlot *)node->tables[t];
+    for (i64 s = 0; s < ((i64)table_size << t); s++) {
+      if (table[s].lock == 0) {
+        // Empty or already reinserted
+        continue;
+      }
+      HashSlot entry = table[s];
+      table[s].key = 0;
+      table[s].lock = 0;
+      table[s].data = nullptr;
+      while (entry.key != 0) {
+        auto h = hash_slot_hash(entry.key);
+        HashSlot *target = nullptr;
+        for (int t2 = 0; target == nullptr && t2 < taichi_hash_max_num_tables;
+             t2++) {
+          if (node->tables[t2] == nullptr) {
+            node->tables[t2] = runtime->request_allocate_aligned(
+                sizeof(HashSlot) * ((std::size_t)table_size << t2), 4096);
+          }
+          auto table2 = (HashSlot *)node->tables[t2];
+          u32 mask = ((u32)table_size << t2) - 1;
+          auto window = std::min(mask + 1, (u32)hash_probe_length);
+          for (u32 p = 0; p < window; p++) {
+            auto slot = &table2[(h + p) & mask];
+            if (slot->key == 0 || slot->lock != 0) {
+              target = slot;
+              new_num_tables = std::max(new_num_tables, t2 + 1);
+              break;
+            }
+          }
+        }
+        if (target == nullptr) {
+          taichi_assert_runtime(runtime, false,
+                                "Hash SNode out of slot tables.");
+          return;
+        }
+        HashSlot displaced = *target;
+        *target = entry;
+        target->lock = 0;
+        entry = displaced;
+      }
+    }
+  }
+  node->num_tables = new_num_tables;
+  node->num_dead_keys = 0;
+}
@@ -53,10 +53,12 @@ void Pointer_activate(Ptr meta_, Ptr node, int i) {
           [&] {
             auto rt = meta->context->runtime;
             auto alloc = rt->node_allocators[meta->snode_id];
-            auto allocated = (u64)alloc->allocate();
+            auto allocated = (u64)alloc->allocate(meta->context);
             // TODO: Not sure if we really need atomic_exchange here,
             // just to be safe.
             atomic_exchange_u64((u64 *)data_ptr, allocated);
+            mark_snode_modified(meta);
+            log_cell_change(meta, node, i, nullptr);
           },
           [&]() { return *data_ptr == nullptr; });
     }
@@ -74,8 +76,10 @@ void Pointer_deactivate(Ptr meta, Ptr node, int i) {
         auto smeta = (StructMeta *)meta;
         auto rt = smeta->context->runtime;
         auto alloc = rt->node_allocators[smeta->snode_id];
+        log_cell_change(smeta, node, i, data_ptr);
         alloc->recycle(data_ptr);
         data_ptr = nullptr;
+        mark_snode_modified(smeta);
       }
     });
   }
@@ -87,6 +91,15 @@ i32 Pointer_is_active(Ptr meta, Ptr node, int i) {
   return data_ptr != nullptr;
 }
 
+i32 Pointer_find_next_active(Ptr meta, Ptr node, int begin, int end) {
+  auto num_elements = Pointer_get_num_elements(meta, node);
+  auto data_ptrs = (Ptr *)(node + 8 * num_elements);
+  while (begin < end && data_ptrs[begin] == nullptr) {
+    begin++;
+  }
+  return begin;
+}
+
 Ptr Pointer_lookup_element(Ptr meta, Ptr node, int i) {
   auto num_elements = Pointer_get_num_elements(meta, node);
   auto data_ptr = *(Ptr *)(node + 8 * (num_elements + i));
@@ -13,6 +13,10 @@ i32 Root_is_active(Ptr meta, Ptr node, int i) {
   return 1;
 }
 
+i32 Root_find_next_active(Ptr meta, Ptr node, int begin, int end) {
+  return begin;
+}
+
 Ptr Root_lookup_element(Ptr meta, Ptr node, int i) {
   // only one element
   return node;
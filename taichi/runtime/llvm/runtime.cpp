@@ -35,6 +35,10 @@ using host_vsnprintf_type = int (*)(char *,
                                     std::va_list);
 using vm_allocator_type = void *(*)(void *, std::size_t, std::size_t);
 using RangeForTaskFunc = void(RuntimeContext *, const char *tls, int i);
+using RangeForBlockTaskFunc = void(RuntimeContext *,
+                                   const char *tls,
+                                   int begin,
+                                   int end);
 using MeshForTaskFunc = void(RuntimeContext *, const char *tls, uint32_t i);
 using parallel_for_type = void (*)(void *thread_pool,
                                    int splits,
@@ -353,6 +357,15 @@ int32 RuntimeContext_get_extra_args(RuntimeContext *ctx, int32 i, int32 j) {
   return ctx->extra_args[i][j];
 }
 
+// The context of a kernel on a CPU thread, for the tasks that read
+// linear_thread_idx()
+void RuntimeContext_copy_for_thread(RuntimeContext *ctx,
+                                    RuntimeContext *src,
+                                    int32 thread_id) {
+  *ctx = *src;
+  ctx->cpu_thread_id = thread_id;
+}
+
 #include "taichi/runtime/llvm/atomic.h"
 
 // These structures are accessible by both the LLVM backend and this C++ runtime
@@ -372,6 +385,9 @@ struct StructMeta {
 
   i32 (*is_active)(Ptr, Ptr, int i);
 
+  // Returns the first active index in [begin, end), or end if there is none
+  i32 (*find_next_active)(Ptr, Ptr, int begin, int end);
+
   i32 (*get_num_elements)(Ptr, Ptr);
 
   void (*refine_coordinates)(PhysicalCoordinates *inp_coord,
@@ -389,6 +405,7 @@ STRUCT_FIELD(StructMeta, lookup_element);
 STRUCT_FIELD(StructMeta, from_parent_element);
 STRUCT_FIELD(StructMeta, refine_coordinates);
 STRUCT_FIELD(StructMeta, is_active);
+STRUCT_FIELD(StructMeta, find_next_active);
 STRUCT_FIELD(StructMeta, context);
 
 struct LLVMRuntime;
@@ -397,6 +414,7 @@ constexpr bool enable_assert = true;
 
 void taichi_assert(RuntimeContext *context, i32 test, const char *msg);
 void taichi_assert_runtime(LLVMRuntime *runtime, i32 test, const char *msg);
+i32 linear_thread_idx(RuntimeContext *context);
 #define TI_ASSERT_INFO(x, msg) taichi_assert(context, (int)(x), msg)
 #define TI_ASSERT(x) TI_ASSERT_INFO(x, #x)
 
@@ -451,6 +469,16 @@ struct ListManager {
     return i;
   }
 
+  // Reserves n consecutive elements and returns the index of the first one.
+  i32 reserve_new_elements(i32 n) {
+    auto i = atomic_add_i32(&num_elements, n);
+    for (int c = i >> log2chunk_num_elements;
+         c <= (i + n - 1) >> log2chunk_num_elements; c++) {
+      touch_chunk(c);
+    }
+    return i;
+  }
+
   template <typename T>
   void push_back(const T &t) {
     this->append((void *)&t);
@@ -494,18 +522,6 @@ struct ListManager {
   i32 size() {
     return num_elements;
   }
-
-  i32 ptr2index(Ptr ptr) {
-    auto chunk_size = max_num_elements_per_chunk * element_size;
-    for (int i = 0; i < max_num_chunks; i++) {
-      taichi_assert_runtime(runtime, chunks[i] != nullptr, "ptr not found.");
-      if (chunks[i] <= ptr && ptr < chunks[i] + chunk_size) {
-        return (i << log2chunk_num_elements) +
-               i32((ptr - chunks[i]) / element_size);
-      }
-    }
-    return -1;
-  }
 };
 
 extern "C" {
@@ -520,6 +536,30 @@ STRUCT_FIELD(Element, element);
 STRUCT_FIELD(Element, pcoord);
 STRUCT_FIELD_ARRAY(Element, loop_bounds);
 
+// An entry of LLVMRuntime::snode_cell_logs: cell |cell| of container |node|
+// has been activated or deactivated. |old_cell| is the element of the cell
+// before it was deactivated, nullptr for activations.
+struct SNodeCellChange {
+  Ptr node;
+  Ptr old_cell;
+  i32 cell;
+};
+
+struct ElementIndexSlot {
+  Ptr container;
+  i32 position;
+};
+
+// An open addressing table from the containers of an element list to the
+// position of their first element in the list.
+struct ElementIndex {
+  ElementIndexSlot *slots;
+  i32 capacity;
+  i32 num_used;  // including deleted slots
+  i32 requested;
+  i32 valid;
+};
+
 struct RandState {
   u32 x;
   u32 y;
@@ -558,7 +598,28 @@ struct LLVMRuntime {
   Ptr thread_pool;
   parallel_for_type parallel_for;
   ListManager *element_lists[taichi_max_num_snodes];
+  // Element lists are only regenerated when the structure they were built
+  // from has changed since. See clear_list.
+  i32 snode_modified[taichi_max_num_snodes];
+  i64 snode_epochs[taichi_max_num_snodes];
+  i64 element_list_versions[taichi_max_num_snodes];
+  i64 element_list_signatures[taichi_max_num_snodes];
+  i32 element_list_update_modes[taichi_max_num_snodes];
+  // On CPUs, the lists of the children of pointer and bitmasked SNodes are
+  // updated from the cells toggled since instead. See
+  // element_list_apply_cell_log.
+  ListManager *snode_cell_logs[taichi_max_num_snodes];
+  i32 snode_cell_log_overflowed[taichi_max_num_snodes];
+  i64 snode_cell_log_generations[taichi_max_num_snodes];
+  i64 element_list_parent_versions[taichi_max_num_snodes];
+  i64 element_list_log_generations[taichi_max_num_snodes];
+  i32 element_list_log_cursors[taichi_max_num_snodes];
+  i32 element_list_num_tombstones[taichi_max_num_snodes];
+  ElementIndex element_list_indices[taichi_max_num_snodes];
   NodeManager *node_allocators[taichi_max_num_snodes];
+  // Hash containers with tombstones, compacted by the next gc. See
+  // node_hash.h.
+  ListManager *hash_compaction_lists[taichi_max_num_snodes];
   Ptr ambient_elements[taichi_max_num_snodes];
   Ptr temporaries;
   RandState *rand_states;
@@ -613,25 +674,55 @@ STRUCT_FIELD(LLVMRuntime, profiler);
 STRUCT_FIELD(LLVMRuntime, profiler_start);
 STRUCT_FIELD(LLVMRuntime, profiler_stop);
 
+// A small cache of free nodes owned by one CPU thread or one GPU warp. Each
+// magazine takes whole cache lines, so that the threads do not share them.
+constexpr int node_magazine_capacity = 16;
+
+struct alignas(64) NodeMagazine {
+  i32 lock;
+  i32 size;
+  // items[0, num_fresh) are nodes that have never been handed out
+  i32 num_fresh;
+  i32 items[node_magazine_capacity];
+};
+
 // NodeManager of node S (hash, pointer) managers the memory allocation of S_ch
 // It makes use of three ListManagers.
+//
+// Each node in data_list is preceded by a header storing its index in
+// data_list, so that recycling a node does not need to search the chunks.
+// The header is 8 bytes if the node may need 8-byte alignment, 4 bytes
+// otherwise.
+//
+// allocate(context) serves nodes from a magazine private to the calling CPU
+// thread (or GPU warp), which is refilled in batches from free_list and
+// data_list. This keeps the shared counters off the activation fast path.
+// Recycled nodes are preferred over fresh ones, and only recycled nodes are
+// flushed back to free_list during garbage collection, so that fresh nodes
+// still cached in magazines are not counted as allocated.
 struct NodeManager {
   LLVMRuntime *runtime;
   i32 lock;
 
   i32 element_size;
+  i32 header_size;
   i32 chunk_num_elements;
   i32 free_list_used;
 
   ListManager *free_list, *recycled_list, *data_list;
   i32 recycle_list_size_backup;
 
+  NodeMagazine *magazines;
+  i32 num_magazines;
+  i32 magazine_refill_size;
+
   using list_data_type = i32;
 
   NodeManager(LLVMRuntime *runtime,
               i32 element_size,
               i32 chunk_num_elements = -1)
       : runtime(runtime), element_size(element_size) {
+    header_size = element_size % 8 == 0 ? 8 : 4;
     // 128K elements per chunk, by default
     if (chunk_num_elements == -1) {
       chunk_num_elements = 128 * 1024;
@@ -647,8 +738,24 @@ struct NodeManager {
                                              chunk_num_elements);
     recycled_list = runtime->create<ListManager>(
         runtime, sizeof(list_data_type), chunk_num_elements);
-    data_list =
-        runtime->create<ListManager>(runtime, element_size, chunk_num_elements);
+    data_list = runtime->create<ListManager>(
+        runtime, element_size + header_size, chunk_num_elements);
+
+    // One magazine per CPU thread or GPU warp. Large nodes are refilled in
+    // smaller batches, so that magazines do not hold on to too much memory.
+#if ARCH_cuda
+    num_magazines = runtime->num_rand_states / warp_size();
+#else
+    num_magazines = runtime->num_rand_states;
+#endif
+    magazines = (NodeMagazine *)runtime->request_allocate_aligned(
+        sizeof(NodeMagazine) * num_magazines, 64);
+    magazine_refill_size =
+        max_i32(1, min_i32(node_magazine_capacity, 16384 / element_size));
+  }
+
+  Ptr get_node_ptr(i32 i) {
+    return data_list->get_element_ptr(i) + header_size;
   }
 
   Ptr allocate() {
@@ -657,40 +764,89 @@ struct NodeManager {
     if (old_cursor >= free_list->size()) {
       // running out of free list. allocate new.
       l = data_list->reserve_new_element();
+      *(list_data_type *)data_list->get_element_ptr(l) = l;
     } else {
       // reuse
       l = free_list->get<list_data_type>(old_cursor);
     }
-    return data_list->get_element_ptr(l);
+    return get_node_ptr(l);
   }
 
-  i32 locate(Ptr ptr) {
-    return data_list->ptr2index(ptr);
+  // Called when the magazine holds no recycled nodes.
+  void refill_magazine(NodeMagazine *magazine) {
+    auto n = min_i32(magazine_refill_size,
+                     node_magazine_capacity - magazine->size);
+    if (n > 0 && free_list_used < free_list->size()) {
+      auto old_cursor = atomic_add_i32(&free_list_used, n);
+      auto num_reused = max_i32(min_i32(free_list->size() - old_cursor, n), 0);
+      for (int k = 0; k < num_reused; k++) {
+        magazine->items[magazine->size++] =
+            free_list->get<list_data_type>(old_cursor + k);
+      }
+    }
+    if (magazine->size == 0) {
+      n = magazine_refill_size;
+      auto l = data_list->reserve_new_elements(n);
+      // Items are popped from the back, so store them in reverse order.
+      for (int k = 0; k < n; k++) {
+        *(list_data_type *)data_list->get_element_ptr(l + k) = l + k;
+        magazine->items[n - 1 - k] = l + k;
+      }
+      magazine->size = n;
+      magazine->num_fresh = n;
+    }
   }
 
-  void recycle(Ptr ptr) {
-    auto index = locate(ptr);
-    recycled_list->append(&index);
+  i32 pop_magazine(NodeMagazine *magazine) {
+    if (magazine->size == magazine->num_fresh)
+      refill_magazine(magazine);
+    auto l = magazine->items[--magazine->size];
+    magazine->num_fresh = min_i32(magazine->num_fresh, magazine->size);
+    return l;
   }
 
-  void gc_serial() {
-    // compact free list
-    for (int i = free_list_used; i < free_list->size(); i++) {
-      free_list->get<list_data_type>(i - free_list_used) =
-          free_list->get<list_data_type>(i);
+  Ptr allocate(RuntimeContext *context) {
+    i32 l;
+#if ARCH_cuda
+    auto magazine = &magazines[linear_thread_idx(context) / warp_size()];
+    // Lanes of a warp share the magazine
+    locked_task(&magazine->lock, [&] { l = pop_magazine(magazine); });
+#else
+    l = pop_magazine(&magazines[linear_thread_idx(context)]);
+#endif
+    return get_node_ptr(l);
+  }
+
+  // The number of nodes that have ever been handed out
+  i32 get_num_allocated() {
+    i32 n = data_list->size();
+    for (int m = 0; m < num_magazines; m++) {
+      n -= magazines[m].num_fresh;
     }
-    const i32 num_unused = max_i32(free_list->size() - free_list_used, 0);
-    free_list_used = 0;
-    free_list->resize(num_unused);
+    return n;
+  }
 
-    // zero-fill recycled and push to free list
-    for (int i = 0; i < recycled_list->size(); i++) {
-      auto idx = recycled_list->get<list_data_type>(i);
-      auto ptr = data_list->get_element_ptr(idx);
-      std::memset(ptr, 0, element_size);
-      free_list->push_back(idx);
+  i32 locate(Ptr ptr) {
+    return *(list_data_type *)(ptr - header_size);
+  }
+
+  // Returns the recycled nodes cached in a magazine to free_list.
+  void flush_magazine(NodeMagazine *magazine) {
+    for (int k = magazine->num_fresh; k < magazine->size; k++) {
+      free_list->push_back(magazine->items[k]);
     }
-    recycled_list->clear();
+    magazine->size = magazine->num_fresh;
+  }
+
+  void flush_magazines() {
+    for (int m = 0; m < num_magazines; m++) {
+      flush_magazine(&magazines[m]);
+    }
+  }
+
+  void recycle(Ptr ptr) {
+    auto index = locate(ptr);
+    recycled_list->append(&index);
   }
 };
 
@@ -700,6 +856,14 @@ void LLVMRuntime_store_result(LLVMRuntime *runtime, u64 ret) {
   runtime->set_result(taichi_result_buffer_ret_value_id, ret);
 }
 
+void RuntimeContext_store_result(RuntimeContext *context, u64 ret) {
+  if (context->result_buffer) {
+    context->result_buffer[taichi_result_buffer_ret_value_id] = ret;
+  } else {
+    LLVMRuntime_store_result(context->runtime, ret);
+  }
+}
+
 void LLVMRuntime_profiler_start(LLVMRuntime *runtime, Ptr kernel_name) {
   runtime->profiler_start(runtime->profiler, kernel_name);
 }
@@ -743,6 +907,12 @@ RUNTIME_STRUCT_FIELD(NodeManager, recycled_list);
 RUNTIME_STRUCT_FIELD(NodeManager, data_list);
 RUNTIME_STRUCT_FIELD(NodeManager, free_list_used);
 
+void runtime_NodeManager_get_num_allocated(LLVMRuntime *runtime,
+                                           NodeManager *node_manager) {
+  runtime->set_result(taichi_result_buffer_runtime_query_id,
+                      node_manager->get_num_allocated());
+}
+
 RUNTIME_STRUCT_FIELD(ListManager, num_elements);
 RUNTIME_STRUCT_FIELD(ListManager, max_num_elements_per_chunk);
 RUNTIME_STRUCT_FIELD(ListManager, element_size);
@@ -951,6 +1121,9 @@ void runtime_initialize_snodes(LLVMRuntime *runtime,
     // TODO: some SNodes do not actually need an element list.
     runtime->element_lists[i] =
         runtime->create<ListManager>(runtime, sizeof(Element), 1024 * 64);
+    runtime->element_list_signatures[i] = -1;
+    runtime->element_list_indices[i].valid = 0;
+    runtime->snode_cell_logs[i] = nullptr;
   }
   Element elem;
   elem.loop_bounds[0] = 0;
@@ -1133,9 +1306,174 @@ DEFINE_REDUCTION(xor, i32);
 
 // "Element", "component" are different concepts
 
-void clear_list(LLVMRuntime *runtime, StructMeta *parent, StructMeta *child) {
-  auto child_list = runtime->element_lists[child->snode_id];
-  child_list->clear();
+// Called whenever the set of active cells of an SNode, or the number of cells
+// of a dynamic or hash container, changes.
+void mark_snode_modified(StructMeta *meta) {
+  volatile i32 *flag = &meta->context->runtime->snode_modified[meta->snode_id];
+  if (*flag == 0) {
+    *flag = 1;
+  }
+}
+
+i64 update_snode_epoch(LLVMRuntime *runtime, int snode_id) {
+  if (runtime->snode_modified[snode_id]) {
+    runtime->snode_modified[snode_id] = 0;
+    runtime->snode_epochs[snode_id]++;
+  }
+  return runtime->snode_epochs[snode_id];
+}
+
+// Up to this many cell changes are logged per SNode between two listgens.
+// More of them make the lists regenerate anyway.
+constexpr i32 snode_cell_log_max_size = 1 << 16;
+
+// Called with the cell locked, for pointer and bitmasked SNodes. See
+// element_list_apply_cell_log.
+void log_cell_change(StructMeta *meta, Ptr node, int i, Ptr old_cell) {
+  auto runtime = meta->context->runtime;
+  auto log = runtime->snode_cell_logs[meta->snode_id];
+  if (log == nullptr) {
+    return;
+  }
+  if (log->size() >= snode_cell_log_max_size) {
+    runtime->snode_cell_log_overflowed[meta->snode_id] = 1;
+    return;
+  }
+  SNodeCellChange change;
+  change.node = node;
+  change.old_cell = old_cell;
+  change.cell = i;
+  log->append(&change);
+}
+
+// Values of LLVMRuntime::element_list_update_modes, set by clear_list
+constexpr i32 element_list_regenerate = 0;
+constexpr i32 element_list_up_to_date = 1;
+constexpr i32 element_list_apply_log = 2;
+
+// Marks the deleted slots of an ElementIndex
+Ptr const element_index_deleted = (Ptr)1;
+
+u32 element_index_hash(Ptr container) {
+  auto h = (u64)container * 0x9E3779B97F4A7C15ull;
+  return (u32)(h >> 32);
+}
+
+// Empties |index| and makes room for |num_containers| containers, plus as
+// many incremental insertions.
+void element_index_reset(LLVMRuntime *runtime,
+                         ElementIndex *index,
+                         i32 num_containers) {
+  i32 capacity = 1024;
+  while (capacity < num_containers * 4) {
+    capacity *= 2;
+  }
+  if (index->capacity < capacity) {
+    index->slots = (ElementIndexSlot *)runtime->request_allocate_aligned(
+        sizeof(ElementIndexSlot) * capacity, 4096);
+    index->capacity = capacity;
+  }
+  std::memset(index->slots, 0, sizeof(ElementIndexSlot) * index->capacity);
+  index->num_used = 0;
+  index->valid = 0;
+}
+
+// Thread safe, so that listgen can fill the index in parallel.
+void element_index_insert(ElementIndex *index, Ptr container, i32 position) {
+  u32 mask = index->capacity - 1;
+  for (u32 h = element_index_hash(container);; h++) {
+    auto slot = &index->slots[h & mask];
+    Ptr expected = nullptr;
+    if (__atomic_compare_exchange_n(&slot->container, &expected, container,
+                                    false, __ATOMIC_SEQ_CST,
+                                    __ATOMIC_SEQ_CST)) {
+      slot->position = position;
+      atomic_add_i32(&index->num_used, 1);
+      return;
+    }
+  }
+}
+
+// Returns the slot of |container|, or nullptr if it is not listed.
+ElementIndexSlot *element_index_find(ElementIndex *index, Ptr container) {
+  u32 mask = index->capacity - 1;
+  for (u32 h = element_index_hash(container);; h++) {
+    auto slot = &index->slots[h & mask];
+    if (slot->container == container) {
+      return slot;
+    }
+    if (slot->container == nullptr) {
+      return nullptr;
+    }
+  }
+}
+
+// Clears the list of the child, which the following listgen regenerates.
+void start_element_list_regeneration(LLVMRuntime *runtime,
+                                     int parent_id,
+                                     int child_id) {
+  runtime->element_lists[child_id]->clear();
+  runtime->element_list_num_tombstones[child_id] = 0;
+  runtime->element_list_indices[child_id].valid = 0;
+  runtime->element_list_parent_versions[child_id] =
+      runtime->element_list_versions[parent_id];
+  if (auto log = runtime->snode_cell_logs[parent_id]) {
+    runtime->element_list_log_generations[child_id] =
+        runtime->snode_cell_log_generations[parent_id];
+    runtime->element_list_log_cursors[child_id] = log->size();
+  }
+}
+
+// The element list of the child only depends on the list of the parent, the
+// active cells of the parent, and, if child_size_varies, the number of cells
+// of the child containers. All of them only grow their version or epoch, so
+// their sum tells whether anything changed since the list was generated. If
+// nothing did, the list is kept and the following listgen returns right away.
+//
+// If only the active cells of the parent changed, and update_incrementally
+// is set, the listgen applies the logged cell changes to the list instead of
+// regenerating it. If index_list is set, listgen indexes the containers of
+// the list for such updates of the list itself or of the lists of its
+// children.
+void clear_list(LLVMRuntime *runtime,
+                StructMeta *parent,
+                StructMeta *child,
+                i32 child_size_varies,
+                i32 update_incrementally,
+                i32 index_list) {
+  auto parent_id = parent->snode_id;
+  auto child_id = child->snode_id;
+  runtime->element_list_indices[child_id].requested = index_list;
+  auto signature = runtime->element_list_versions[parent_id] +
+                   update_snode_epoch(runtime, parent_id);
+  if (child_size_varies) {
+    signature += update_snode_epoch(runtime, child_id);
+  }
+  if (signature == runtime->element_list_signatures[child_id]) {
+    runtime->element_list_update_modes[child_id] = element_list_up_to_date;
+    return;
+  }
+  runtime->element_list_signatures[child_id] = signature;
+  runtime->element_list_versions[child_id]++;
+  auto log = runtime->snode_cell_logs[parent_id];
+  if (log != nullptr && runtime->snode_cell_log_overflowed[parent_id]) {
+    // Changes have been dropped. The lists of all children regenerate.
+    log->clear();
+    runtime->snode_cell_log_overflowed[parent_id] = 0;
+    runtime->snode_cell_log_generations[parent_id]++;
+  }
+  if (update_incrementally && log != nullptr &&
+      runtime->element_list_parent_versions[child_id] ==
+          runtime->element_list_versions[parent_id] &&
+      runtime->element_list_log_generations[child_id] ==
+          runtime->snode_cell_log_generations[parent_id] &&
+      runtime->element_list_indices[parent_id].valid &&
+      runtime->element_list_indices[child_id].valid) {
+    runtime->element_list_update_modes[child_id] = element_list_apply_log;
+    return;
+  }
+  runtime->element_list_update_modes[child_id] = element_list_regenerate;
+  start_element_list_regeneration(runtime, parent_id, child_id);
 }
 
 /*
@@ -1148,6 +1486,10 @@ void clear_list(LLVMRuntime *runtime, StructMeta *parent, StructMeta *child) {
 void element_listgen_root(LLVMRuntime *runtime,
                           StructMeta *parent,
                           StructMeta *child) {
+  if (runtime->element_list_update_modes[child->snode_id] ==
+      element_list_up_to_date) {
+    return;
+  }
   // If there's just one element in the parent list, we need to use the blocks
   // (instead of threads) to split the parent container
   auto parent_list = runtime->element_lists[parent->snode_id];
@@ -1181,6 +1523,15 @@ void element_listgen_root(LLVMRuntime *runtime,
   auto ch_element_size =
       std::min(ch_num_elements, taichi_listgen_max_element_size);
 
+#if !ARCH_cuda
+  // The number of child elements is known up front. Reserve them at once
+  // instead of appending one by one.
+  int base = 0;
+  if (ch_element_size > 0) {
+    base = child_list->reserve_new_elements(
+        (ch_num_elements + ch_element_size - 1) / ch_element_size);
+  }
+#endif
   // Here is a grid-stride loop.
   for (int c = c_start; c * ch_element_size < ch_num_elements; c += c_step) {
     Element elem;
@@ -1190,13 +1541,31 @@ void element_listgen_root(LLVMRuntime *runtime,
     // There is no need to refine coordinates for root listgen, since its
     // num_bits is always zero
     elem.pcoord = element.pcoord;
+#if ARCH_cuda
     child_list->append(&elem);
+#else
+    child_list->get<Element>(base + c) = elem;
+#endif
   }
+#if !ARCH_cuda
+  auto index = &runtime->element_list_indices[child->snode_id];
+  if (index->requested) {
+    element_index_reset(runtime, index, 1);
+    if (ch_element_size > 0) {
+      element_index_insert(index, ch_element, base);
+    }
+    index->valid = 1;
+  }
+#endif
 }
 
 void element_listgen_nonroot(LLVMRuntime *runtime,
                              StructMeta *parent,
                              StructMeta *child) {
+  if (runtime->element_list_update_modes[child->snode_id] ==
+      element_list_up_to_date) {
+    return;
+  }
   auto parent_list = runtime->element_lists[parent->snode_id];
   int num_parent_elements = parent_list->size();
   auto child_list = runtime->element_lists[child->snode_id];
@@ -1248,6 +1617,253 @@ void element_listgen_nonroot(LLVMRuntime *runtime,
   }
 }
 
+// Listgen of non-root SNodes on CPU, using all threads. The parent elements
+// are split into blocks. Each block first counts the child elements it
+// produces. An exclusive prefix sum over the counts gives every block its range
+// in the child list, which the block fills in a second pass. The child list
+// ends up in the same order as with the serial listgen, and no element needs
+// an atomic append.
+constexpr int cpu_listgen_min_block_size = 16;
+constexpr int cpu_listgen_max_num_blocks = 1024;
+
+struct cpu_listgen_context {
+  StructMeta *parent;
+  StructMeta *child;
+  ListManager *parent_list;
+  ListManager *child_list;
+  // Indexes the child containers if not nullptr
+  ElementIndex *child_index;
+  i32 num_parent_elements;
+  i32 block_size;
+  // Number of child elements, and then offset in the child list, per block
+  i32 offsets[cpu_listgen_max_num_blocks];
+};
+
+// Counts the child elements of a block, or writes them if fill is true.
+void cpu_listgen_block(cpu_listgen_context *ctx, int block_id, bool fill) {
+  auto parent = ctx->parent;
+  auto child = ctx->child;
+  auto parent_refine_coordinates = parent->refine_coordinates;
+  auto parent_find_next_active = parent->find_next_active;
+  auto parent_lookup_element = parent->lookup_element;
+  auto child_get_num_elements = child->get_num_elements;
+  auto child_from_parent_element = child->from_parent_element;
+  int begin = block_id * ctx->block_size;
+  int end = std::min(begin + ctx->block_size, ctx->num_parent_elements);
+  int k = fill ? ctx->offsets[block_id] : 0;
+  for (int i = begin; i < end; i++) {
+    auto element = ctx->parent_list->get<Element>(i);
+    auto node = element.element;
+    int j_end = element.loop_bounds[1];
+    // Jump from one active parent cell to the next, so that bitmasked
+    // parents skip their empty ranges a mask word at a time.
+    for (int j = parent_find_next_active((Ptr)parent, node,
+                                         element.loop_bounds[0], j_end);
+         j < j_end;
+         j = parent_find_next_active((Ptr)parent, node, j + 1, j_end)) {
+      auto ch_element = parent_lookup_element((Ptr)parent, node, j);
+      ch_element = child_from_parent_element((Ptr)ch_element);
+      auto ch_num_elements = child_get_num_elements((Ptr)child, ch_element);
+      auto ch_element_size =
+          std::min(ch_num_elements, taichi_listgen_max_element_size);
+      if (!fill) {
+        if (ch_element_size > 0) {
+          k += (ch_num_elements + ch_element_size - 1) / ch_element_size;
+        }
+        continue;
+      }
+      PhysicalCoordinates refined_coord;
+      parent_refine_coordinates(&element.pcoord, &refined_coord, j);
+      if (ctx->child_index != nullptr && ch_num_elements > 0) {
+        element_index_insert(ctx->child_index, ch_element, k);
+      }
+      for (int ch_lower = 0; ch_lower < ch_num_elements;
+           ch_lower += ch_element_size) {
+        auto &elem = ctx->child_list->get<Element>(k++);
+        elem.element = ch_element;
+        elem.loop_bounds[0] = ch_lower;
+        elem.loop_bounds[1] =
+            std::min(ch_lower + ch_element_size, ch_num_elements);
+        elem.pcoord = refined_coord;
+      }
+    }
+  }
+  if (!fill) {
+    ctx->offsets[block_id] = k;
+  }
+}
+
+void cpu_listgen_count_task(void *listgen_context, int thread_id, int task_id) {
+  cpu_listgen_block((cpu_listgen_context *)listgen_context, task_id, false);
+}
+
+void cpu_listgen_fill_task(void *listgen_context, int thread_id, int task_id) {
+  cpu_listgen_block((cpu_listgen_context *)listgen_context, task_id, true);
+}
+
+// Brings the list of the child up to date with the cells of the parent that
+// have been toggled since the last listgen, at a cost proportional to their
+// number. The elements of deactivated cells are kept as empty tombstones, and
+// the elements of activated cells are appended. The child containers must
+// have a fixed number of cells.
+//
+// The changes are applied in two passes, removals first, and each addition
+// checks the current state of its cell. This way the order of the changes
+// does not matter, even though the cells of bitmasked SNodes are not locked,
+// and even if a deactivated child container has been reused by a later
+// activation.
+//
+// Returns false if the list should rather be regenerated.
+bool element_list_apply_cell_log(LLVMRuntime *runtime,
+                                 StructMeta *parent,
+                                 StructMeta *child) {
+  auto parent_id = parent->snode_id;
+  auto child_id = child->snode_id;
+  auto log = runtime->snode_cell_logs[parent_id];
+  auto parent_list = runtime->element_lists[parent_id];
+  auto child_list = runtime->element_lists[child_id];
+  auto parent_index = &runtime->element_list_indices[parent_id];
+  auto child_index = &runtime->element_list_indices[child_id];
+  auto parent_lookup_element = parent->lookup_element;
+  auto child_get_num_elements = child->get_num_elements;
+  auto child_from_parent_element = child->from_parent_element;
+  int begin = runtime->element_list_log_cursors[child_id];
+  int end = log->size();
+  runtime->element_list_log_cursors[child_id] = end;
+  auto &num_tombstones = runtime->element_list_num_tombstones[child_id];
+
+  auto num_list_elements = [&](Ptr ch_element) {
+    auto ch_num_elements = child_get_num_elements((Ptr)child, ch_element);
+    auto ch_element_size =
+        std::min(ch_num_elements, taichi_listgen_max_element_size);
+    return ch_element_size > 0
+               ? (ch_num_elements + ch_element_size - 1) / ch_element_size
+               : 0;
+  };
+
+  for (int k = begin; k < end; k++) {
+    auto &change = log->get<SNodeCellChange>(k);
+    if (change.old_cell == nullptr) {
+      continue;
+    }
+    auto ch_element = child_from_parent_element(change.old_cell);
+    auto slot = element_index_find(child_index, ch_element);
+    if (slot == nullptr) {
+      continue;
+    }
+    auto position = slot->position;
+    for (int e = 0; e < num_list_elements(ch_element); e++) {
+      auto &elem = child_list->get<Element>(position + e);
+      elem.loop_bounds[1] = elem.loop_bounds[0];
+      num_tombstones++;
+    }
+    slot->container = element_index_deleted;
+  }
+
+  for (int k = begin; k < end; k++) {
+    auto &change = log->get<SNodeCellChange>(k);
+    auto node = change.node;
+    auto j = change.cell;
+    if (!parent->is_active((Ptr)parent, node, j)) {
+      continue;
+    }
+    auto ch_element = parent_lookup_element((Ptr)parent, node, j);
+    ch_element = child_from_parent_element(ch_element);
+    if (element_index_find(child_index, ch_element) != nullptr) {
+      continue;
+    }
+    auto parent_slot = element_index_find(parent_index, node);
+    if (parent_slot == nullptr ||
+        (child_index->num_used + 1) * 2 > child_index->capacity) {
+      return false;
+    }
+    PhysicalCoordinates refined_coord;
+    parent->refine_coordinates(
+        &parent_list->get<Element>(parent_slot->position).pcoord,
+        &refined_coord, j);
+    auto ch_num_elements = child_get_num_elements((Ptr)child, ch_element);
+    auto ch_element_size =
+        std::min(ch_num_elements, taichi_listgen_max_element_size);
+    auto n = num_list_elements(ch_element);
+    if (n == 0) {
+      continue;
+    }
+    auto position = child_list->reserve_new_elements(n);
+    element_index_insert(child_index, ch_element, position);
+    for (int e = 0; e < n; e++) {
+      auto &elem = child_list->get<Element>(position + e);
+      elem.element = ch_element;
+      elem.loop_bounds[0] = e * ch_element_size;
+      elem.loop_bounds[1] =
+          std::min((e + 1) * ch_element_size, ch_num_elements);
+      elem.pcoord = refined_coord;
+    }
+  }
+  // Struct-fors still go over the tombstones.
+  return num_tombstones * 2 <= child_list->size();
+}
+
+void element_listgen_nonroot_cpu(LLVMRuntime *runtime,
+                                 StructMeta *parent,
+                                 StructMeta *child,
+                                 int num_threads) {
+  auto mode = runtime->element_list_update_modes[child->snode_id];
+  if (mode == element_list_up_to_date) {
+    return;
+  }
+  if (mode == element_list_apply_log) {
+    if (element_list_apply_cell_log(runtime, parent, child)) {
+      return;
+    }
+    start_element_list_regeneration(runtime, parent->snode_id,
+                                    child->snode_id);
+  }
+  cpu_listgen_context ctx;
+  ctx.parent = parent;
+  ctx.child = child;
+  ctx.parent_list = runtime->element_lists[parent->snode_id];
+  ctx.child_list = runtime->element_lists[child->snode_id];
+  ctx.child_index = nullptr;
+  ctx.num_parent_elements = ctx.parent_list->size();
+  ctx.block_size =
+      max_i32(cpu_listgen_min_block_size,
+              (ctx.num_parent_elements + cpu_listgen_max_num_blocks - 1) /
+                  cpu_listgen_max_num_blocks);
+  int num_blocks =
+      (ctx.num_parent_elements + ctx.block_size - 1) / ctx.block_size;
+  auto run = [&](void (*task)(void *, int, int)) {
+    if (num_blocks > 1 && num_threads > 1) {
+      runtime->parallel_for(runtime->thread_pool, num_blocks, num_threads,
+                            &ctx, task);
+    } else {
+      for (int b = 0; b < num_blocks; b++) {
+        task(&ctx, 0, b);
+      }
+    }
+  };
+  run(cpu_listgen_count_task);
+  int total = 0;
+  for (int b = 0; b < num_blocks; b++) {
+    auto count = ctx.offsets[b];
+    ctx.offsets[b] = total;
+    total += count;
+  }
+  auto index = &runtime->element_list_indices[child->snode_id];
+  if (index->requested) {
+    // There are at most as many child containers as elements.
+    element_index_reset(runtime, index, total);
+    ctx.child_index = index;
+  }
+  if (total > 0) {
+    auto base = ctx.child_list->reserve_new_elements(total);
+    for (int b = 0; b < num_blocks; b++) {
+      ctx.offsets[b] += base;
+    }
+    run(cpu_listgen_fill_task);
+  }
+  index->valid = index->requested;
+}
+
 using BlockTask = void(RuntimeContext *, char *, Element *, int, int);
 
 struct cpu_block_task_helper_context {
@@ -1257,8 +1873,20 @@ struct cpu_block_task_helper_context {
   int element_size;
   int element_split;
   std::size_t tls_buffer_size;
+  int num_elements;
+  int num_threads;
+  int prefetch_bytes;
 };
 
+// Prefetches the |num_bytes| bytes at |ptr| into the caches of this core.
+void prefetch_memory(Ptr ptr, int num_bytes) {
+#if !ARCH_cuda
+  for (int i = 0; i < num_bytes; i += taichi_cpu_cache_line_size) {
+    __builtin_prefetch(ptr + i);
+  }
+#endif
+}
+
 // TODO: To enforce inlining, we need to create in LLVM a new function that
 // calls block_helper and the BLS xlogues, and pass that function to the
 // scheduler.
@@ -1269,13 +1897,28 @@ struct cpu_block_task_helper_context {
 void cpu_struct_for_block_helper(void *ctx_, int thread_id, int i) {
   auto ctx = (cpu_block_task_helper_context *)(ctx_);
   int element_id = i / ctx->element_split;
-  int part_size = ctx->element_size / ctx->element_split;
+  // Rounded up, so that the parts cover elements of any size
+  int part_size =
+      (ctx->element_size + ctx->element_split - 1) / ctx->element_split;
   int part_id = i % ctx->element_split;
   auto &e = ctx->list->get<Element>(element_id);
   int lower = e.loop_bounds[0] + part_id * part_size;
   int upper = e.loop_bounds[0] + (part_id + 1) * part_size;
   upper = std::min(upper, e.loop_bounds[1]);
-  alignas(8) char tls_buffer[ctx->tls_buffer_size];
+  // make_block_local() keeps the BLS buffers in here within
+  // taichi_cpu_max_tls_buffer_size
+  alignas(taichi_cpu_bls_alignment) char tls_buffer[ctx->tls_buffer_size];
+
+  // The thread pool hands out the tasks in order, so the next task of this
+  // thread is about one task per thread ahead. Its container is fetched
+  // while this one runs.
+  if (ctx->prefetch_bytes > 0 && part_id == 0) {
+    int next_element_id = (i + ctx->num_threads) / ctx->element_split;
+    if (next_element_id < ctx->num_elements) {
+      prefetch_memory(ctx->list->get<Element>(next_element_id).element,
+                      ctx->prefetch_bytes);
+    }
+  }
 
   RuntimeContext this_thread_context = *ctx->context;
   this_thread_context.cpu_thread_id = thread_id;
@@ -1291,7 +1934,8 @@ void parallel_struct_for(RuntimeContext *context,
                          int element_split,
                          BlockTask *task,
                          std::size_t tls_buffer_size,
-                         int num_threads) {
+                         int num_threads,
+                         int prefetch_bytes) {
   auto list = (context->runtime)->element_lists[snode_id];
   auto list_tail = list->size();
 #if ARCH_cuda
@@ -1323,6 +1967,9 @@ void parallel_struct_for(RuntimeContext *context,
   ctx.element_size = element_size;
   ctx.element_split = element_split;
   ctx.tls_buffer_size = tls_buffer_size;
+  ctx.num_elements = list_tail;
+  ctx.num_threads = num_threads;
+  ctx.prefetch_bytes = prefetch_bytes;
   auto runtime = context->runtime;
   runtime->parallel_for(runtime->thread_pool, list_tail * element_split,
                         num_threads, &ctx, cpu_struct_for_block_helper);
@@ -1334,10 +1981,23 @@ using mesh_for_xlogue = void (*)(RuntimeContext *,
                                  /*TLS*/ char *tls_base,
                                  uint32_t patch_idx);
 
+// Splits a range-for of |num_items| iterations into tasks of |block_dim|
+// iterations, or of an adaptive number of them if |block_dim| is 0.
+int cpu_range_for_block_dim(int num_items, int num_threads, int block_dim) {
+  if (block_dim == 0) {
+    // ensure each thread has at least ~32 tasks for load balancing
+    // and each task has at least 512 items to amortize scheduler overhead
+    block_dim = std::min(512, std::max(1, num_items / (num_threads * 32)));
+  }
+  return block_dim;
+}
+
 struct range_task_helper_context {
   RuntimeContext *context;
   range_for_xlogue prologue{nullptr};
   RangeForTaskFunc *body{nullptr};
+  // Loops over the indices of a block itself, instead of |body|
+  RangeForBlockTaskFunc *block_body{nullptr};
   range_for_xlogue epilogue{nullptr};
   std::size_t tls_size{1};
   int begin;
@@ -1357,7 +2017,11 @@ void cpu_parallel_range_for_task(void *range_context,
 
   RuntimeContext this_thread_context = *ctx.context;
   this_thread_context.cpu_thread_id = thread_id;
-  if (ctx.step == 1) {
+  if (ctx.block_body) {
+    int block_start = ctx.begin + task_id * ctx.block_size;
+    int block_end = std::min(block_start + ctx.block_size, ctx.end);
+    ctx.block_body(&this_thread_context, tls_ptr, block_start, block_end);
+  } else if (ctx.step == 1) {
     int block_start = ctx.begin + task_id * ctx.block_size;
     int block_end = std::min(block_start + ctx.block_size, ctx.end);
     for (int i = block_start; i < block_end; i++) {
@@ -1374,6 +2038,18 @@ void cpu_parallel_range_for_task(void *range_context,
     ctx.epilogue(ctx.context, tls_ptr);
 }
 
+void cpu_parallel_range_for_launch(range_task_helper_context &ctx,
+                                   int num_threads,
+                                   int block_dim) {
+  ctx.block_size =
+      cpu_range_for_block_dim(ctx.end - ctx.begin, num_threads, block_dim);
+  auto runtime = ctx.context->runtime;
+  runtime->parallel_for(runtime->thread_pool,
+                        (ctx.end - ctx.begin + ctx.block_size - 1) /
+                            ctx.block_size,
+                        num_threads, &ctx, cpu_parallel_range_for_task);
+}
+
 void cpu_parallel_range_for(RuntimeContext *context,
                             int num_threads,
                             int begin,
@@ -1397,18 +2073,64 @@ void cpu_parallel_range_for(RuntimeContext *context,
     taichi_printf(context->runtime, "step must not be %d\n", step);
     exit(-1);
   }
-  if (block_dim == 0) {
-    // adaptive block dim
-    auto num_items = (ctx.end - ctx.begin) / std::abs(step);
-    // ensure each thread has at least ~32 tasks for load balancing
-    // and each task has at least 512 items to amortize scheduler overhead
-    block_dim = std::min(512, std::max(1, num_items / (num_threads * 32)));
-  }
-  ctx.block_size = block_dim;
+  cpu_parallel_range_for_launch(ctx, num_threads, block_dim);
+}
+
+// The same as cpu_parallel_range_for() with step 1, but |body| is called once
+// per block of indices.
+void cpu_parallel_range_for_blocks(RuntimeContext *context,
+                                   int num_threads,
+                                   int begin,
+                                   int end,
+                                   int block_dim,
+                                   range_for_xlogue prologue,
+                                   RangeForBlockTaskFunc *body,
+                                   range_for_xlogue epilogue,
+                                   std::size_t tls_size) {
+  range_task_helper_context ctx;
+  ctx.context = context;
+  ctx.prologue = prologue;
+  ctx.tls_size = tls_size;
+  ctx.block_body = body;
+  ctx.epilogue = epilogue;
+  ctx.begin = begin;
+  ctx.end = end;
+  ctx.step = 1;
+  cpu_parallel_range_for_launch(ctx, num_threads, block_dim);
+}
+
+// The argument of the task functions that CodeGenLLVMCPU generates for
+// range-fors, which run the loop body of a block of indices inlined instead
+// of calling it through a function pointer.
+struct RangeForTaskContext {
+  RuntimeContext *context;
+  int begin;
+  int end;
+  int block_size;
+};
+
+STRUCT_FIELD(RangeForTaskContext, context);
+STRUCT_FIELD(RangeForTaskContext, begin);
+STRUCT_FIELD(RangeForTaskContext, end);
+STRUCT_FIELD(RangeForTaskContext, block_size);
+
+void cpu_parallel_range_for_tasks(RuntimeContext *context,
+                                  int num_threads,
+                                  int begin,
+                                  int end,
+                                  int block_dim,
+                                  void (*task)(void *,
+                                               int thread_id,
+                                               int task_id)) {
+  RangeForTaskContext ctx;
+  ctx.context = context;
+  ctx.begin = begin;
+  ctx.end = end;
+  ctx.block_size = cpu_range_for_block_dim(end - begin, num_threads, block_dim);
   auto runtime = context->runtime;
   runtime->parallel_for(runtime->thread_pool,
-                        (end - begin + block_dim - 1) / block_dim, num_threads,
-                        &ctx, cpu_parallel_range_for_task);
+                        (end - begin + ctx.block_size - 1) / ctx.block_size,
+                        num_threads, &ctx, task);
 }
 
 void gpu_parallel_range_for(RuntimeContext *context,
@@ -1445,7 +2167,7 @@ void cpu_parallel_mesh_for_task(void *range_context,
                                 int thread_id,
                                 int task_id) {
   auto ctx = *(mesh_task_helper_context *)range_context;
-  alignas(8) char tls_buffer[ctx.tls_size];
+  alignas(taichi_cpu_bls_alignment) char tls_buffer[ctx.tls_size];
   auto tls_ptr = &tls_buffer[0];
 
   RuntimeContext this_thread_context = *ctx.context;
@@ -1521,6 +2243,93 @@ i32 linear_thread_idx(RuntimeContext *context) {
 #include "node_pointer.h"
 #include "node_root.h"
 #include "node_bitmasked.h"
+#include "node_hash.h"
+
+// Hash containers are iterated in slot space, i.e. the loop bounds of their
+// elements index slots instead of cells. Only active slots emit children.
+void element_listgen_hash(LLVMRuntime *runtime,
+                          StructMeta *parent,
+                          StructMeta *child) {
+  if (runtime->element_list_update_modes[child->snode_id] ==
+      element_list_up_to_date) {
+    return;
+  }
+  auto parent_list = runtime->element_lists[parent->snode_id];
+  int num_parent_elements = parent_list->size();
+  auto child_list = runtime->element_lists[child->snode_id];
+  auto parent_refine_coordinates = parent->refine_coordinates;
+  auto child_get_num_elements = child->get_num_elements;
+  auto child_from_parent_element = child->from_parent_element;
+#if ARCH_cuda
+  int i_start = block_idx();
+  int i_step = grid_dim();
+  int j_start = thread_idx();
+  int j_step = block_dim();
+#else
+  int i_start = 0;
+  int i_step = 1;
+  int j_start = 0;
+  int j_step = 1;
+#endif
+  for (int i = i_start; i < num_parent_elements; i += i_step) {
+    auto element = parent_list->get<Element>(i);
+    int j_lower = element.loop_bounds[0] + j_start;
+    int j_higher = element.loop_bounds[1];
+    for (int j = j_lower; j < j_higher; j += j_step) {
+      auto slot = Hash_get_slot((Ptr)parent, element.element, j);
+      if (slot->data == nullptr)
+        continue;
+      PhysicalCoordinates refined_coord;
+      parent_refine_coordinates(&element.pcoord, &refined_coord,
+                                (i32)(slot->key - 1u));
+      auto ch_element = child_from_parent_element(slot->data);
+      auto ch_num_elements = child_get_num_elements((Ptr)child, ch_element);
+      auto ch_element_size =
+          std::min(ch_num_elements, taichi_listgen_max_element_size);
+      for (int ch_lower = 0; ch_lower < ch_num_elements;
+           ch_lower += ch_element_size) {
+        Element elem;
+        elem.element = ch_element;
+        elem.loop_bounds[0] = ch_lower;
+        elem.loop_bounds[1] =
+            std::min(ch_lower + ch_element_size, ch_num_elements);
+        elem.pcoord = refined_coord;
+        child_list->append(&elem);
+      }
+    }
+  }
+}
+
+void runtime_initialize_cell_log(LLVMRuntime *runtime, int snode_id) {
+#if !ARCH_cuda
+  runtime->snode_cell_logs[snode_id] = runtime->create<ListManager>(
+      runtime, sizeof(SNodeCellChange), 4096);
+#endif
+}
+
+void runtime_Hash_initialize(LLVMRuntime *runtime, int snode_id) {
+  runtime->hash_compaction_lists[snode_id] = runtime->create<ListManager>(
+      runtime, sizeof(HashCompactionItem), 4096);
+}
+
+void hash_compaction_task(void *compaction_list, int thread_id, int i) {
+  auto list = (ListManager *)compaction_list;
+  auto item = list->get<HashCompactionItem>(i);
+  Hash_compact(list->runtime, item.node, item.table_size);
+}
+
+// Compacts the hash containers of |snode_id| that have tombstones, split
+// among the CPU threads.
+void hash_gc_cpu(LLVMRuntime *runtime, int snode_id, int num_threads) {
+  auto list = runtime->hash_compaction_lists[snode_id];
+  if (list == nullptr || list->size() == 0) {
+    return;
+  }
+  runtime->parallel_for(runtime->thread_pool, list->size(), num_threads, list,
+                        hash_compaction_task);
+  list->clear();
+  runtime->snode_modified[snode_id] = 1;
+}
 
 void ListManager::touch_chunk(int chunk_id) {
   taichi_assert_runtime(runtime, chunk_id < max_num_chunks,
@@ -1548,10 +2357,6 @@ Ptr ListManager::allocate() {
   return get_element_ptr(i);
 }
 
-void node_gc(LLVMRuntime *runtime, int snode_id) {
-  runtime->node_allocators[snode_id]->gc_serial();
-}
-
 void gc_parallel_0(RuntimeContext *context, int snode_id) {
   LLVMRuntime *runtime = context->runtime;
   auto allocator = runtime->node_allocators[snode_id];
@@ -1560,6 +2365,15 @@ void gc_parallel_0(RuntimeContext *context, int snode_id) {
   auto free_list_used = allocator->free_list_used;
   using T = NodeManager::list_data_type;
 
+  // Compact the hash containers with tombstones, one per thread
+  auto hash_compaction_list = runtime->hash_compaction_lists[snode_id];
+  if (hash_compaction_list != nullptr) {
+    for (int j = linear_thread_idx(context); j < hash_compaction_list->size();
+         j += grid_dim() * block_dim()) {
+      hash_compaction_task(hash_compaction_list, 0, j);
+    }
+  }
+
   // Move unused elements to the beginning of the free_list
   int i = linear_thread_idx(context);
   if (free_list_used * 2 > free_list_size) {
@@ -1592,6 +2406,12 @@ void gc_parallel_1(RuntimeContext *context, int snode_id) {
   allocator->free_list_used = 0;
   allocator->recycle_list_size_backup = allocator->recycled_list->size();
   allocator->recycled_list->clear();
+
+  auto hash_compaction_list = runtime->hash_compaction_lists[snode_id];
+  if (hash_compaction_list != nullptr && hash_compaction_list->size() > 0) {
+    hash_compaction_list->clear();
+    runtime->snode_modified[snode_id] = 1;
+  }
 }
 
 void gc_parallel_2(RuntimeContext *context, int snode_id) {
@@ -1600,13 +2420,19 @@ void gc_parallel_2(RuntimeContext *context, int snode_id) {
   auto elements = allocator->recycle_list_size_backup;
   auto free_list = allocator->free_list;
   auto recycled_list = allocator->recycled_list;
-  auto data_list = allocator->data_list;
   auto element_size = allocator->element_size;
   using T = NodeManager::list_data_type;
+
+  // Return the recycled nodes cached in the magazines to the free list
+  for (int m = block_idx() * block_dim() + thread_idx();
+       m < allocator->num_magazines; m += grid_dim() * block_dim()) {
+    allocator->flush_magazine(&allocator->magazines[m]);
+  }
+
   auto i = block_idx();
   while (i < elements) {
     auto idx = recycled_list->get<T>(i);
-    auto ptr = data_list->get_element_ptr(idx);
+    auto ptr = allocator->get_node_ptr(idx);
     if (thread_idx() == 0) {
       free_list->push_back(idx);
     }
@@ -1634,6 +2460,92 @@ void gc_parallel_2(RuntimeContext *context, int snode_id) {
     i += grid_dim();
   }
 }
+
+// The CPU counterpart of gc_parallel_0/1/2, which splits the free list
+// compaction and the zero-filling of recycled nodes among the CPU threads.
+constexpr int cpu_gc_block_size = 1024;
+
+struct cpu_gc_context {
+  NodeManager *allocator;
+  i32 num_items;
+  i32 src_begin;  // where the unused part of free_list is moved from
+  i32 dst_begin;  // where recycled nodes are appended to free_list
+};
+
+void cpu_gc_compact_task(void *gc_context, int thread_id, int task_id) {
+  auto ctx = (cpu_gc_context *)gc_context;
+  auto free_list = ctx->allocator->free_list;
+  using T = NodeManager::list_data_type;
+  int begin = task_id * cpu_gc_block_size;
+  int end = std::min(begin + cpu_gc_block_size, ctx->num_items);
+  for (int i = begin; i < end; i++) {
+    free_list->get<T>(i) = free_list->get<T>(ctx->src_begin + i);
+  }
+}
+
+void cpu_gc_zero_fill_task(void *gc_context, int thread_id, int task_id) {
+  auto ctx = (cpu_gc_context *)gc_context;
+  auto allocator = ctx->allocator;
+  using T = NodeManager::list_data_type;
+  int begin = task_id * cpu_gc_block_size;
+  int end = std::min(begin + cpu_gc_block_size, ctx->num_items);
+  for (int i = begin; i < end; i++) {
+    auto idx = allocator->recycled_list->get<T>(i);
+    std::memset(allocator->get_node_ptr(idx), 0, allocator->element_size);
+    allocator->free_list->get<T>(ctx->dst_begin + i) = idx;
+  }
+}
+
+void cpu_gc_run(LLVMRuntime *runtime,
+                int num_threads,
+                cpu_gc_context *ctx,
+                void (*task)(void *, int, int)) {
+  int num_tasks = (ctx->num_items + cpu_gc_block_size - 1) / cpu_gc_block_size;
+  if (num_tasks > 1) {
+    runtime->parallel_for(runtime->thread_pool, num_tasks, num_threads, ctx,
+                          task);
+  } else if (num_tasks == 1) {
+    task(ctx, 0, 0);
+  }
+}
+
+// Returns the nodes recycled since the last GC to the free list of
+// |allocator|.
+void node_manager_gc_cpu(LLVMRuntime *runtime,
+                         NodeManager *allocator,
+                         int num_threads) {
+  auto free_list = allocator->free_list;
+  auto recycled_list = allocator->recycled_list;
+  cpu_gc_context ctx;
+  ctx.allocator = allocator;
+
+  // Move unused elements to the beginning of the free_list. Only the part
+  // that does not already lie in the destination range needs to move.
+  auto free_list_size = free_list->size();
+  auto free_list_used = min_i32(allocator->free_list_used, free_list_size);
+  auto num_unused = free_list_size - free_list_used;
+  ctx.num_items = min_i32(num_unused, free_list_used);
+  ctx.src_begin = free_list_size - ctx.num_items;
+  cpu_gc_run(runtime, num_threads, &ctx, cpu_gc_compact_task);
+  allocator->free_list_used = 0;
+  free_list->resize(num_unused);
+  allocator->flush_magazines();
+
+  // Zero-fill recycled nodes and push them to the free list
+  ctx.num_items = recycled_list->size();
+  if (ctx.num_items > 0) {
+    ctx.dst_begin = free_list->reserve_new_elements(ctx.num_items);
+    cpu_gc_run(runtime, num_threads, &ctx, cpu_gc_zero_fill_task);
+  }
+  recycled_list->clear();
+}
+
+void gc_parallel_cpu(RuntimeContext *context, int snode_id, int num_threads) {
+  LLVMRuntime *runtime = context->runtime;
+  hash_gc_cpu(runtime, snode_id, num_threads);
+  node_manager_gc_cpu(runtime, runtime->node_allocators[snode_id],
+                      num_threads);
+}
 }
 
 extern "C" {
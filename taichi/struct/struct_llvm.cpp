@@ -128,11 +128,26 @@ void StructCompilerLLVM::generate_types(SNode &snode) {
     body_type = llvm::ArrayType::get(llvm::PointerType::getInt8PtrTy(*ctx),
                                      snode.max_num_elements());
   } else if (type == SNodeType::dynamic) {
-    // mutex and n (number of elements)
+    // mutex and n (number of elements). The body points to the first chunk.
+    // Each chunk starts with a pointer-sized header: the first chunk's points
+    // to the second chunk, and the second chunk's to the radix tree of chunk
+    // directory pages indexing the remaining chunks. Chunks and directory
+    // pages have the same size,
+    // max(sizeof(Ptr) + chunk_size * cell_size, 2 * sizeof(Ptr)).
+    // See runtime/llvm/node_dynamic.h.
     aux_type =
         llvm::StructType::get(*ctx, {llvm::PointerType::getInt32Ty(*ctx),
                                      llvm::PointerType::getInt32Ty(*ctx)});
     body_type = llvm::PointerType::getInt8PtrTy(*ctx);
+  } else if (type == SNodeType::hash) {
+    // lock, number of slot tables and number of dead keys
+    aux_type =
+        llvm::StructType::get(*ctx, {llvm::PointerType::getInt32Ty(*ctx),
+                                     llvm::PointerType::getInt32Ty(*ctx),
+                                     llvm::PointerType::getInt32Ty(*ctx)});
+    // slot tables, allocated on demand
+    body_type = llvm::ArrayType::get(llvm::PointerType::getInt8PtrTy(*ctx),
+                                     taichi_hash_max_num_tables);
   } else {
     TI_P(snode.type_name());
     TI_NOT_IMPLEMENTED;
@@ -1,5 +1,7 @@
 #include "memory_pool.h"
 #include "taichi/system/timer.h"
+#include "taichi/system/virtual_memory.h"
+#include "taichi/math/arithmetic.h"
 #include "taichi/backends/cuda/cuda_driver.h"
 #include "taichi/backends/cuda/cuda_device.h"
 
@@ -33,23 +35,255 @@ void MemoryPool::set_queue(MemRequestQueue *queue) {
   this->queue = queue;
 }
 
+namespace {
+
+constexpr int kFreeListTagShift = 48;
+constexpr uint64 kFreeListPtrMask = (uint64(1) << kFreeListTagShift) - 1;
+
+uint8 *free_list_ptr(uint64 head) {
+  return (uint8 *)(head & kFreeListPtrMask);
+}
+
+uint64 free_list_head(uint8 *ptr, uint64 old_head) {
+  auto tag = (old_head >> kFreeListTagShift) + 1;
+  return (uint64)ptr | (tag << kFreeListTagShift);
+}
+
+std::atomic<uint64> &free_list_next(uint8 *block) {
+  return *reinterpret_cast<std::atomic<uint64> *>(block);
+}
+
+}  // namespace
+
+int MemoryPool::get_size_class(std::size_t size, std::size_t alignment) {
+  auto n = std::max({size, alignment, min_size_class});
+  if (n > max_size_class) {
+    return -1;
+  }
+  int c = 0;
+  while ((min_size_class << c) < n) {
+    c++;
+  }
+  return c;
+}
+
 void *MemoryPool::allocate(std::size_t size, std::size_t alignment) {
+  num_allocations_++;
+  auto size_class = get_size_class(size, alignment);
+  if (size_class != -1) {
+    return allocate_small(size_class);
+  }
+  size = iroundup(size, page_size);
+  alignment = std::max(alignment, page_size);
+  uint8 *ret;
+  bool dirty = false;
+  {
+    std::lock_guard<std::mutex> _(mut_allocators);
+    ret = allocate_committed_pages(size, alignment);
+    if (ret) {
+      dirty = true;
+    } else {
+      ret = allocate_pages(size, alignment);
+    }
+  }
+  if (dirty) {
+    std::memset(ret, 0, size);
+  }
+  add_used_bytes(size);
+  return ret;
+}
+
+void MemoryPool::release(void *ptr, std::size_t size, std::size_t alignment) {
+  if (ptr == nullptr) {
+    return;
+  }
+  num_releases_++;
+  auto size_class = get_size_class(size, alignment);
+  if (size_class != -1) {
+    release_small(ptr, size_class);
+    return;
+  }
+  size = iroundup(size, page_size);
+  used_bytes_ -= size;
+  {
+    std::lock_guard<std::mutex> _(mut_allocators);
+    if (committed_cache_bytes_ + size <= max_committed_cache_bytes) {
+      committed_pages_.emplace(size, (uint8 *)ptr);
+      committed_cache_bytes_ += size;
+      return;
+    }
+  }
+  // Decommit before the pages become visible to other threads
+  VirtualMemoryAllocator::decommit(ptr, size);
   std::lock_guard<std::mutex> _(mut_allocators);
-  void *ret = nullptr;
+  decommitted_bytes_ += size;
+  cached_large_bytes_ += size;
+  insert_free_pages((uint8 *)ptr, size);
+}
+
+void *MemoryPool::allocate_small(int size_class) {
+  auto &sc = size_classes_[size_class];
+  auto block_size = min_size_class << size_class;
+  add_used_bytes(block_size);
+
+  // Fast path: pop a released block
+  auto head = sc.free_head.load(std::memory_order_acquire);
+  while (auto block = free_list_ptr(head)) {
+    auto next = free_list_next(block).load(std::memory_order_relaxed);
+    if (sc.free_head.compare_exchange_weak(head,
+                                           free_list_head((uint8 *)next, head),
+                                           std::memory_order_acq_rel)) {
+      cached_small_bytes_ -= block_size;
+      std::memset(block, 0, block_size);
+      return block;
+    }
+  }
+
+  // Slow path: carve a fresh (hence zero) block from the slab of this class
+  std::lock_guard<std::mutex> _(sc.mut);
+  if (sc.slab_head + block_size > sc.slab_tail) {
+    auto slab_size = std::max(block_size * 16, max_size_class);
+    std::lock_guard<std::mutex> __(mut_allocators);
+    sc.slab_head = allocate_pages(slab_size, block_size);
+    sc.slab_tail = sc.slab_head + slab_size;
+  }
+  auto ret = sc.slab_head;
+  sc.slab_head += block_size;
+  return ret;
+}
+
+void MemoryPool::release_small(void *ptr, int size_class) {
+  auto &sc = size_classes_[size_class];
+  auto block_size = min_size_class << size_class;
+  auto block = (uint8 *)ptr;
+  TI_ASSERT(((uint64)block & ~kFreeListPtrMask) == 0);
+  used_bytes_ -= block_size;
+  cached_small_bytes_ += block_size;
+  auto head = sc.free_head.load(std::memory_order_relaxed);
+  do {
+    free_list_next(block).store(head & kFreeListPtrMask,
+                                std::memory_order_relaxed);
+  } while (!sc.free_head.compare_exchange_weak(
+      head, free_list_head(block, head), std::memory_order_release,
+      std::memory_order_relaxed));
+}
+
+uint8 *MemoryPool::allocate_pages(std::size_t size, std::size_t alignment) {
+  // Best fit among the released pages. They are either decommitted or never
+  // touched, and therefore zero.
+  auto padding = alignment > page_size ? alignment - page_size : 0;
+  auto it = free_pages_by_size_.lower_bound(
+      std::make_pair(size + padding, (uint8 *)nullptr));
+  if (it != free_pages_by_size_.end()) {
+    auto [block_size, block] = *it;
+    erase_free_pages(block, block_size);
+    auto ret = (uint8 *)iroundup((std::size_t)block, alignment);
+    if (ret != block) {
+      insert_free_pages(block, ret - block);
+    }
+    if (ret + size != block + block_size) {
+      insert_free_pages(ret + size, block + block_size - (ret + size));
+    }
+    cached_large_bytes_ -= size;
+    return ret;
+  }
+
+  uint8 *ret = nullptr;
   if (!allocators.empty()) {
-    ret = allocators.back()->allocate(size, alignment);
+    ret = (uint8 *)allocators.back()->allocate(size, alignment);
   }
   if (!ret) {
     // allocation have failed
-    auto new_buffer_size = std::max(size, default_allocator_size);
+    if (!allocators.empty()) {
+      // Keep the unused tail of the current arena for later requests
+      auto &arena = allocators.back();
+      auto tail_begin = (uint8 *)iroundup((std::size_t)arena->head, page_size);
+      if (tail_begin < arena->tail) {
+        cached_large_bytes_ += arena->tail - tail_begin;
+        insert_free_pages(tail_begin, arena->tail - tail_begin);
+        arena->head = arena->tail;
+      }
+    }
+    auto new_buffer_size = std::max(size + padding, default_allocator_size);
     allocators.emplace_back(
         std::make_unique<UnifiedAllocator>(new_buffer_size, arch_, device_));
-    ret = allocators.back()->allocate(size, alignment);
+    arena_begins_.insert(allocators.back()->data);
+    reserved_bytes_ += new_buffer_size;
+    ret = (uint8 *)allocators.back()->allocate(size, alignment);
   }
   TI_ASSERT(ret);
   return ret;
 }
 
+uint8 *MemoryPool::allocate_committed_pages(std::size_t size,
+                                            std::size_t alignment) {
+  // Blocks over twice the size are left for larger requests
+  for (auto it = committed_pages_.lower_bound(size);
+       it != committed_pages_.end() && it->first <= size * 2; ++it) {
+    auto [block_size, block] = *it;
+    if ((std::size_t)block % alignment != 0) {
+      continue;
+    }
+    committed_pages_.erase(it);
+    committed_cache_bytes_ -= size;
+    if (block_size != size) {
+      committed_pages_.emplace(block_size - size, block + size);
+    }
+    return block;
+  }
+  return nullptr;
+}
+
+void MemoryPool::insert_free_pages(uint8 *ptr, std::size_t size) {
+  // Merge with the neighbouring blocks unless they belong to another arena
+  auto right = free_pages_.find(ptr + size);
+  if (right != free_pages_.end() && !arena_begins_.count(ptr + size)) {
+    auto right_size = right->second;
+    erase_free_pages(ptr + size, right_size);
+    size += right_size;
+  }
+  auto left = free_pages_.lower_bound(ptr);
+  if (left != free_pages_.begin() && !arena_begins_.count(ptr)) {
+    --left;
+    if (left->first + left->second == ptr) {
+      auto left_ptr = left->first;
+      size += left->second;
+      erase_free_pages(left_ptr, left->second);
+      ptr = left_ptr;
+    }
+  }
+  free_pages_by_size_.insert(std::make_pair(size, ptr));
+  free_pages_[ptr] = size;
+}
+
+void MemoryPool::erase_free_pages(uint8 *ptr, std::size_t size) {
+  free_pages_by_size_.erase(std::make_pair(size, ptr));
+  free_pages_.erase(ptr);
+}
+
+void MemoryPool::add_used_bytes(std::size_t size) {
+  auto used = used_bytes_ += size;
+  auto peak = peak_used_bytes_.load(std::memory_order_relaxed);
+  while (peak < used && !peak_used_bytes_.compare_exchange_weak(peak, used)) {
+  }
+}
+
+MemoryPool::Stats MemoryPool::get_stats() {
+  Stats stats;
+  stats.used_bytes = used_bytes_;
+  stats.peak_used_bytes = peak_used_bytes_;
+  stats.cached_small_bytes = cached_small_bytes_;
+  stats.num_allocations = num_allocations_;
+  stats.num_releases = num_releases_;
+  std::lock_guard<std::mutex> _(mut_allocators);
+  stats.num_arenas = allocators.size();
+  stats.reserved_bytes = reserved_bytes_;
+  stats.cached_large_bytes = cached_large_bytes_;
+  stats.committed_cache_bytes = committed_cache_bytes_;
+  stats.decommitted_bytes = decommitted_bytes_;
+  return stats;
+}
+
 template <typename T>
 T MemoryPool::fetch(volatile void *ptr) {
   T ret;
@@ -4,7 +4,10 @@
 #define TI_RUNTIME_HOST
 #include "taichi/runtime/llvm/mem_request.h"
 #include "taichi/backends/device.h"
+#include <atomic>
+#include <map>
 #include <mutex>
+#include <set>
 #include <vector>
 #include <memory>
 #include <thread>
@@ -12,12 +15,49 @@
 TLANG_NAMESPACE_BEGIN
 
 // A memory pool that runs on the host
+//
+// Memory is carved from large arenas (UnifiedAllocator). Small requests are
+// rounded up to power-of-two size classes, each with a lock-free free list of
+// released blocks. Larger requests are rounded up to whole pages and served
+// best-fit from a free map that coalesces neighbouring blocks. Released large
+// blocks stay committed for reuse up to max_committed_cache_bytes in total,
+// so that alloc/free churn does not decommit and fault in the same pages over
+// and over. Beyond that, their pages are decommitted, so that freed memory
+// does not count towards the RSS of the process.
+//
+// Memory returned by allocate() is always zero-filled.
 
 class MemoryPool {
  public:
+  struct Stats {
+    std::size_t num_arenas{0};
+    // Virtual address space held by the arenas
+    std::size_t reserved_bytes{0};
+    // Handed out and not released yet, including size class rounding
+    std::size_t used_bytes{0};
+    std::size_t peak_used_bytes{0};
+    // Released blocks waiting for reuse in the size class free lists
+    std::size_t cached_small_bytes{0};
+    // Released (and decommitted) pages waiting for reuse in the free map
+    std::size_t cached_large_bytes{0};
+    // Released large blocks that are still committed
+    std::size_t committed_cache_bytes{0};
+    // Total bytes returned to the OS so far
+    std::size_t decommitted_bytes{0};
+    uint64 num_allocations{0};
+    uint64 num_releases{0};
+  };
+
   std::vector<std::unique_ptr<UnifiedAllocator>> allocators;
   static constexpr std::size_t default_allocator_size =
       1 << 30;  // 1 GB per allocator
+  static constexpr std::size_t page_size = 4096;
+  // Requests (after rounding up to their alignment) no larger than
+  // max_size_class are served from size classes.
+  static constexpr std::size_t min_size_class = 16;
+  static constexpr std::size_t max_size_class = 64 << 10;
+  static constexpr int num_size_classes = 13;
+  static constexpr std::size_t max_committed_cache_bytes = 64 << 20;
   bool terminating, killed;
   std::mutex mut;
   std::mutex mut_allocators;
@@ -39,6 +79,12 @@ class MemoryPool {
 
   void *allocate(std::size_t size, std::size_t alignment);
 
+  // Gives back memory obtained from allocate(). size and alignment must be
+  // the ones passed to allocate().
+  void release(void *ptr, std::size_t size, std::size_t alignment);
+
+  Stats get_stats();
+
   void set_queue(MemRequestQueue *queue);
 
   void daemon();
@@ -48,9 +94,56 @@ class MemoryPool {
   ~MemoryPool();
 
  private:
+  struct SizeClass {
+    // Top of a Treiber stack of released blocks. Each free block stores the
+    // next one in its first 8 bytes. The upper 16 bits hold a counter bumped
+    // on every update to rule out ABA.
+    std::atomic<uint64> free_head{0};
+    // Guards the slab the class carves fresh blocks from
+    std::mutex mut;
+    uint8 *slab_head{nullptr};
+    uint8 *slab_tail{nullptr};
+  };
+
+  static int get_size_class(std::size_t size, std::size_t alignment);
+
+  void *allocate_small(int size_class);
+
+  void release_small(void *ptr, int size_class);
+
+  // The following functions require mut_allocators to be held.
+  uint8 *allocate_pages(std::size_t size, std::size_t alignment);
+
+  // Returns nullptr if no committed block fits. The block is not zero.
+  uint8 *allocate_committed_pages(std::size_t size, std::size_t alignment);
+
+  void insert_free_pages(uint8 *ptr, std::size_t size);
+
+  void erase_free_pages(uint8 *ptr, std::size_t size);
+
+  void add_used_bytes(std::size_t size);
+
   static constexpr bool use_cuda_stream = false;
   Arch arch_;
   Device *device_;
+
+  SizeClass size_classes_[num_size_classes];
+  std::atomic<std::size_t> used_bytes_{0};
+  std::atomic<std::size_t> peak_used_bytes_{0};
+  std::atomic<std::size_t> cached_small_bytes_{0};
+  std::atomic<uint64> num_allocations_{0};
+  std::atomic<uint64> num_releases_{0};
+
+  // Guarded by mut_allocators
+  std::set<std::pair<std::size_t, uint8 *>> free_pages_by_size_;
+  std::map<uint8 *, std::size_t> free_pages_;
+  std::set<uint8 *> arena_begins_;
+  std::size_t reserved_bytes_{0};
+  std::size_t cached_large_bytes_{0};
+  std::size_t decommitted_bytes_{0};
+  // Released large blocks that are still committed, by size
+  std::multimap<std::size_t, uint8 *> committed_pages_;
+  std::size_t committed_cache_bytes_{0};
 };
 
 TLANG_NAMESPACE_END
@@ -3,6 +3,10 @@
 #ifdef TI_WITH_LLVM
 #include "taichi/llvm/llvm_program.h"
 #endif
+#if defined(TI_WITH_CUDA)
+#include "taichi/backends/cuda/cuda_driver.h"
+#endif
+#include "taichi/math/arithmetic.h"
 
 TLANG_NAMESPACE_BEGIN
 
@@ -11,12 +15,23 @@ SNodeTreeBufferManager::SNodeTreeBufferManager(ProgramImpl *prog)
   TI_TRACE("SNode tree buffer manager created.");
 }
 
-void SNodeTreeBufferManager::merge_and_insert(Ptr ptr, std::size_t size) {
+std::size_t SNodeTreeBufferManager::get_slab_size(std::size_t size) {
+  std::size_t pot = 1;
+  while (pot * 2 <= size) {
+    pot *= 2;
+  }
+  return iroundup(size, std::max(pot / 8, (std::size_t)taichi_page_size));
+}
+
+void SNodeTreeBufferManager::merge_and_insert(Ptr ptr,
+                                              std::size_t size,
+                                              bool dirty) {
   // merge with right block
-  if (ptr_map_[ptr + size]) {
-    std::size_t tmp = ptr_map_[ptr + size];
-    size_set_.erase(std::make_pair(tmp, ptr + size));
-    ptr_map_.erase(ptr + size);
+  auto right = ptr_map_.find(ptr + size);
+  if (right != ptr_map_.end()) {
+    std::size_t tmp = right->second;
+    dirty |= dirty_set_.count(ptr + size) > 0;
+    erase(ptr + size, tmp);
     size += tmp;
   }
   // merge with left block
@@ -24,14 +39,35 @@ void SNodeTreeBufferManager::merge_and_insert(Ptr ptr, std::size_t size) {
   if (map_it != ptr_map_.begin()) {
     auto x = *--map_it;
     if (x.first + x.second == ptr) {
-      size_set_.erase(std::make_pair(x.second, x.first));
-      ptr_map_.erase(x.first);
+      dirty |= dirty_set_.count(x.first) > 0;
+      erase(x.first, x.second);
       ptr = x.first;
       size += x.second;
     }
   }
   size_set_.insert(std::make_pair(size, ptr));
   ptr_map_[ptr] = size;
+  if (dirty) {
+    dirty_set_.insert(ptr);
+  }
+}
+
+void SNodeTreeBufferManager::erase(Ptr ptr, std::size_t size) {
+  size_set_.erase(std::make_pair(size, ptr));
+  ptr_map_.erase(ptr);
+  dirty_set_.erase(ptr);
+}
+
+void SNodeTreeBufferManager::zero_fill(Ptr ptr, std::size_t size) {
+  if (prog_->config->arch == Arch::cuda) {
+#if defined(TI_WITH_CUDA)
+    CUDADriver::get_instance().memset(ptr, 0, size);
+#else
+    TI_NOT_IMPLEMENTED
+#endif
+  } else {
+    std::memset(ptr, 0, size);
+  }
 }
 
 Ptr SNodeTreeBufferManager::allocate(JITModule *runtime_jit,
@@ -45,8 +81,11 @@ Ptr SNodeTreeBufferManager::allocate(JITModule *runtime_jit,
   TI_ASSERT_INFO(snode_tree_id < kMaxNumSnodeTreesLlvm,
                  "LLVM backend supports up to {} snode trees",
                  kMaxNumSnodeTreesLlvm);
+  size = get_slab_size(size);
+  // Best fit: the smallest free block that is large enough
   auto set_it = size_set_.lower_bound(std::make_pair(size, nullptr));
   if (set_it == size_set_.end()) {
+    // Fresh memory from the runtime is zero
     runtime_jit->call<void *, std::size_t, std::size_t>(
         "runtime_memory_allocate_aligned", runtime, size, alignment);
     LlvmProgramImpl *llvm_prog = static_cast<LlvmProgramImpl *>(prog_);
@@ -56,17 +95,23 @@ Ptr SNodeTreeBufferManager::allocate(JITModule *runtime_jit,
     sizes_[snode_tree_id] = size;
     return ptr;
   } else {
-    auto x = *set_it;
-    size_set_.erase(x);
-    ptr_map_.erase(x.second);
-    if (x.first - size > 0) {
-      size_set_.insert(std::make_pair(x.first - size, x.second + size));
-      ptr_map_[x.second + size] = x.first - size;
+    auto [block_size, ptr] = *set_it;
+    bool dirty = dirty_set_.count(ptr) > 0;
+    erase(ptr, block_size);
+    // Splitting off a sliver would only fragment the free blocks. Hand out
+    // the whole block instead.
+    if (block_size - size >= size / 8) {
+      merge_and_insert(ptr + size, block_size - size, dirty);
+    } else {
+      size = block_size;
+    }
+    if (dirty && prog_->config->snode_tree_buffer_rezero) {
+      zero_fill(ptr, size);
     }
-    TI_ASSERT(x.second);
-    roots_[snode_tree_id] = x.second;
+    TI_ASSERT(ptr);
+    roots_[snode_tree_id] = ptr;
     sizes_[snode_tree_id] = size;
-    return x.second;
+    return ptr;
   }
 #else
   TI_ERROR("Llvm disabled");
@@ -82,7 +127,23 @@ void SNodeTreeBufferManager::destroy(SNodeTree *snode_tree) {
     return;
   }
   Ptr ptr = roots_[snode_tree_id];
-  merge_and_insert(ptr, size);
+  sizes_[snode_tree_id] = 0;
+#ifdef TI_WITH_LLVM
+  // On CPUs the roots come from the MemoryPool, which caches them for reuse
+  // and zero-fills them again itself
+  auto *memory_pool = static_cast<LlvmProgramImpl *>(prog_)->get_memory_pool();
+  if (arch_is_cpu(prog_->config->arch) && memory_pool) {
+    memory_pool->release(ptr, size, taichi_page_size);
+    TI_DEBUG("SNode tree {} destroyed.", snode_tree_id);
+    return;
+  }
+#endif
+  bool dirty = true;
+  if (prog_->config->snode_tree_buffer_prezero) {
+    zero_fill(ptr, size);
+    dirty = false;
+  }
+  merge_and_insert(ptr, size, dirty);
   TI_DEBUG("SNode tree {} destroyed.", snode_tree_id);
 }
 
@@ -12,11 +12,22 @@ TLANG_NAMESPACE_BEGIN
 
 class ProgramImpl;
 
+// Keeps the root buffers of destroyed SNode trees for reuse. On CPUs they are
+// returned to the MemoryPool instead.
+//
+// Buffer sizes are rounded up to slab sizes, i.e. multiples of 1/8 of the
+// largest power of two not exceeding them, so that a tree rebuilt with a
+// slightly different size usually fits exactly into the buffer of the old
+// one. Free buffers are handed out best-fit and coalesced with their
+// neighbours when released.
 class SNodeTreeBufferManager {
  public:
   SNodeTreeBufferManager(ProgramImpl *prog);
 
-  void merge_and_insert(Ptr ptr, std::size_t size);
+  static std::size_t get_slab_size(std::size_t size);
+
+  // |dirty| tells whether the block may contain non-zero bytes.
+  void merge_and_insert(Ptr ptr, std::size_t size, bool dirty);
 
   Ptr allocate(JITModule *runtime_jit,
                void *runtime,
@@ -28,11 +39,17 @@ class SNodeTreeBufferManager {
   void destroy(SNodeTree *snode_tree);
 
  private:
+  void erase(Ptr ptr, std::size_t size);
+
+  void zero_fill(Ptr ptr, std::size_t size);
+
   std::set<std::pair<std::size_t, Ptr>> size_set_;
   std::map<Ptr, std::size_t> ptr_map_;
+  // Free blocks (by their beginning) that are not known to be zero
+  std::set<Ptr> dirty_set_;
   ProgramImpl *prog_;
-  Ptr roots_[kMaxNumSnodeTreesLlvm];
-  std::size_t sizes_[kMaxNumSnodeTreesLlvm];
+  Ptr roots_[kMaxNumSnodeTreesLlvm]{};
+  std::size_t sizes_[kMaxNumSnodeTreesLlvm]{};
 };
 
 TLANG_NAMESPACE_END
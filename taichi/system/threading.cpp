@@ -7,11 +7,92 @@
 
 #include <algorithm>
 #include <condition_variable>
+#include <fstream>
+#include <sstream>
 #include <thread>
 #include <vector>
 
+#if defined(TI_PLATFORM_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 TI_NAMESPACE_BEGIN
 
+namespace {
+
+constexpr uint64 kGateClosed = 1ULL << 31;
+constexpr uint64 kGateCountMask = kGateClosed - 1;
+
+inline uint32 gate_epoch(uint64 gate) {
+  return uint32(gate >> 32);
+}
+
+inline uint64 pack_range(int begin, int end) {
+  return (uint64(uint32(begin)) << 32) | uint64(uint32(end));
+}
+
+inline int range_begin(uint64 range) {
+  return int(range >> 32);
+}
+
+inline int range_end(uint64 range) {
+  return int(range & 0xFFFFFFFFULL);
+}
+
+inline void cpu_relax() {
+#if defined(TI_ARCH_x64) && !defined(_MSC_VER)
+  __builtin_ia32_pause();
+#else
+  std::this_thread::yield();
+#endif
+}
+
+// Parses Linux cpu lists such as "0-15,32-47".
+std::vector<int> parse_cpu_list(const std::string &list) {
+  std::vector<int> ret;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty())
+      continue;
+    auto dash = item.find('-');
+    int first = std::stoi(item.substr(0, dash));
+    int last =
+        dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+    for (int i = first; i <= last; i++) {
+      ret.push_back(i);
+    }
+  }
+  return ret;
+}
+
+// Returns the CPUs of each online NUMA node, or an empty vector if the
+// topology is unavailable.
+std::vector<std::vector<int>> detect_numa_nodes() {
+  std::vector<std::vector<int>> nodes;
+#if defined(TI_PLATFORM_LINUX)
+  auto read_line = [](const std::string &fn) {
+    std::ifstream fs(fn);
+    std::string line;
+    std::getline(fs, line);
+    return line;
+  };
+  auto online = read_line("/sys/devices/system/node/online");
+  if (online.empty())
+    return nodes;
+  for (auto node : parse_cpu_list(online)) {
+    auto cpus = parse_cpu_list(read_line(
+        fmt::format("/sys/devices/system/node/node{}/cpulist", node)));
+    if (!cpus.empty())
+      nodes.push_back(std::move(cpus));
+  }
+#endif
+  return nodes;
+}
+
+}  // namespace
+
 bool test_threading() {
   auto tp = ThreadPool(20);
   for (int j = 0; j < 100; j++) {
@@ -136,4 +217,215 @@ ThreadPool::~ThreadPool() {
     th.join();
 }
 
+WorkStealingThreadPool::WorkStealingThreadPool(int max_num_threads,
+                                               int spin_count,
+                                               bool numa_aware)
+    : max_num_threads_(std::max(max_num_threads, 1)),
+      spin_count_(std::max(spin_count, 0)) {
+  ranges_ = std::make_unique<TaskRange[]>(max_num_threads_);
+  setup_numa_topology(numa_aware);
+  // The calling thread acts as worker 0.
+  for (int i = 1; i < max_num_threads_; i++) {
+    threads_.emplace_back([this, i] { this->target(i); });
+#if defined(TI_PLATFORM_LINUX)
+    if (!worker_cpus_.empty()) {
+      cpu_set_t cpu_set;
+      CPU_ZERO(&cpu_set);
+      for (auto cpu : worker_cpus_[i]) {
+        CPU_SET(cpu, &cpu_set);
+      }
+      if (pthread_setaffinity_np(threads_.back().native_handle(),
+                                 sizeof(cpu_set), &cpu_set) != 0) {
+        TI_WARN("Failed to pin CPU worker {} to its NUMA node.", i);
+      }
+    }
+#endif
+  }
+}
+
+void WorkStealingThreadPool::setup_numa_topology(bool numa_aware) {
+  std::vector<int> node_of(max_num_threads_, 0);
+  if (numa_aware) {
+    auto nodes = detect_numa_nodes();
+    if (nodes.size() > 1) {
+      num_numa_nodes_ = (int)nodes.size();
+      worker_cpus_.resize(max_num_threads_);
+      // Fill the nodes one after another, so that launches with fewer threads
+      // than max_num_threads stay on as few nodes as possible.
+      int node = 0, used = 0;
+      for (int i = 0; i < max_num_threads_; i++) {
+        if (used == (int)nodes[node].size()) {
+          node = (node + 1) % num_numa_nodes_;
+          used = 0;
+        }
+        node_of[i] = node;
+        worker_cpus_[i] = nodes[node];
+        used++;
+      }
+      TI_TRACE("CPU thread pool spans {} NUMA nodes", num_numa_nodes_);
+    }
+  }
+  victims_.resize(max_num_threads_);
+  for (int i = 0; i < max_num_threads_; i++) {
+    for (int same_node = 1; same_node >= 0; same_node--) {
+      for (int j = 1; j < max_num_threads_; j++) {
+        int victim = (i + j) % max_num_threads_;
+        if ((node_of[victim] == node_of[i]) == (bool)same_node)
+          victims_[i].push_back(victim);
+      }
+    }
+  }
+}
+
+void WorkStealingThreadPool::run(int splits,
+                                 int desired_num_threads,
+                                 void *range_for_task_context,
+                                 RangeForTaskFunc *func) {
+  TI_ASSERT(desired_num_threads > 0);
+  int num_workers =
+      std::min({desired_num_threads, max_num_threads_, std::max(splits, 1)});
+  if (num_workers == 1) {
+    // Not worth waking up anyone.
+    for (int i = 0; i < splits; i++) {
+      func(range_for_task_context, 0, i);
+    }
+    return;
+  }
+
+  func_ = func;
+  range_for_task_context_ = range_for_task_context;
+  num_workers_.store(num_workers, std::memory_order_relaxed);
+  pending_tasks_.store(splits, std::memory_order_relaxed);
+  for (int i = 0; i < max_num_threads_; i++) {
+    int begin = i < num_workers ? int(int64(splits) * i / num_workers) : 0;
+    int end = i < num_workers ? int(int64(splits) * (i + 1) / num_workers) : 0;
+    ranges_[i].range.store(pack_range(begin, end), std::memory_order_relaxed);
+  }
+
+  // Publish the launch. The seq_cst store pairs with the increment of
+  // num_parked_ in wait_for_launch(), so a worker either sees the new epoch
+  // before parking or gets notified below.
+  epoch_++;
+  gate_.store(uint64(epoch_) << 32);
+  if (num_parked_.load() > 0) {
+    { std::lock_guard<std::mutex> _(mutex_); }
+    cv_.notify_all();
+  }
+
+  execute_tasks(0);
+  while (pending_tasks_.load(std::memory_order_acquire) != 0) {
+    cpu_relax();
+  }
+  // Close the launch so that late workers do not join, then wait for those
+  // that already joined to leave before the per-launch state is reused.
+  gate_.fetch_or(kGateClosed);
+  while ((gate_.load(std::memory_order_acquire) & kGateCountMask) != 0) {
+    cpu_relax();
+  }
+}
+
+uint64 WorkStealingThreadPool::wait_for_launch(uint32 last_epoch) {
+  for (int i = 0; i < spin_count_; i++) {
+    auto gate = gate_.load(std::memory_order_acquire);
+    if (gate_epoch(gate) != last_epoch || exiting_.load())
+      return gate;
+    cpu_relax();
+  }
+  num_parked_.fetch_add(1);
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this, last_epoch] {
+      return gate_epoch(gate_.load()) != last_epoch || exiting_.load();
+    });
+  }
+  num_parked_.fetch_sub(1);
+  return gate_.load(std::memory_order_acquire);
+}
+
+void WorkStealingThreadPool::target(int thread_id) {
+  uint32 last_epoch = 0;
+  while (true) {
+    auto gate = wait_for_launch(last_epoch);
+    if (exiting_.load())
+      break;
+    last_epoch = gate_epoch(gate);
+    // Not needed by this launch. The read may be stale, which only means that
+    // this worker's share gets stolen by the others.
+    if (thread_id >= num_workers_.load(std::memory_order_relaxed))
+      continue;
+    bool joined = false;
+    while (!(gate & kGateClosed) && gate_epoch(gate) == last_epoch) {
+      if (gate_.compare_exchange_weak(gate, gate + 1,
+                                      std::memory_order_acq_rel)) {
+        joined = true;
+        break;
+      }
+    }
+    if (!joined)
+      continue;
+    if (thread_id < num_workers_.load(std::memory_order_relaxed))
+      execute_tasks(thread_id);
+    gate_.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+void WorkStealingThreadPool::execute_tasks(int thread_id) {
+  int64 num_done = 0;
+  int task_id;
+  while (pop_task(thread_id, task_id) || steal_task(thread_id, task_id)) {
+    func_(range_for_task_context_, thread_id, task_id);
+    num_done++;
+  }
+  if (num_done)
+    pending_tasks_.fetch_sub(num_done, std::memory_order_acq_rel);
+}
+
+bool WorkStealingThreadPool::pop_task(int thread_id, int &task_id) {
+  auto &range = ranges_[thread_id].range;
+  auto r = range.load(std::memory_order_relaxed);
+  while (range_begin(r) < range_end(r)) {
+    if (range.compare_exchange_weak(
+            r, pack_range(range_begin(r) + 1, range_end(r)),
+            std::memory_order_relaxed)) {
+      task_id = range_begin(r);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool WorkStealingThreadPool::steal_task(int thread_id, int &task_id) {
+  int num_workers = num_workers_.load(std::memory_order_relaxed);
+  for (auto victim : victims_[thread_id]) {
+    if (victim >= num_workers)
+      continue;
+    auto &range = ranges_[victim].range;
+    auto r = range.load(std::memory_order_relaxed);
+    while (range_begin(r) < range_end(r)) {
+      int begin = range_begin(r), end = range_end(r);
+      int mid = end - (end - begin + 1) / 2;
+      if (range.compare_exchange_weak(r, pack_range(begin, mid),
+                                      std::memory_order_relaxed)) {
+        // Our own range is empty at this point, so nobody else can be
+        // modifying it.
+        task_id = mid;
+        ranges_[thread_id].range.store(pack_range(mid + 1, end),
+                                       std::memory_order_relaxed);
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() {
+  {
+    std::lock_guard<std::mutex> _(mutex_);
+    exiting_ = true;
+  }
+  cv_.notify_all();
+  for (auto &th : threads_)
+    th.join();
+}
+
 TI_NAMESPACE_END
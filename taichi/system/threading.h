@@ -10,6 +10,7 @@
 #include <atomic>
 #include <condition_variable>
 #include <functional>
+#include <memory>
 #include <thread>
 
 TI_NAMESPACE_BEGIN
@@ -59,4 +60,73 @@ class ThreadPool {
   ~ThreadPool();
 };
 
+// A drop-in alternative to ThreadPool for the LLVM runtime's parallel_for.
+//
+// Each participating worker owns a contiguous range of task ids, which it
+// consumes from the front. A worker whose range is empty steals the upper half
+// of another worker's range, preferring victims on the same NUMA node. The
+// calling thread participates as worker 0, and idle workers spin for a while
+// before parking, so back-to-back launches avoid the condition variable
+// handshake altogether.
+class WorkStealingThreadPool {
+ public:
+  WorkStealingThreadPool(int max_num_threads, int spin_count, bool numa_aware);
+
+  void run(int splits,
+           int desired_num_threads,
+           void *range_for_task_context,
+           RangeForTaskFunc *func);
+
+  static void static_run(WorkStealingThreadPool *pool,
+                         int splits,
+                         int desired_num_threads,
+                         void *range_for_task_context,
+                         RangeForTaskFunc *func) {
+    return pool->run(splits, desired_num_threads, range_for_task_context, func);
+  }
+
+  int get_num_numa_nodes() const {
+    return num_numa_nodes_;
+  }
+
+  ~WorkStealingThreadPool();
+
+ private:
+  // [begin, end) of the task ids owned by a worker, packed into one word so
+  // that both the owner and thieves can update it with a single CAS.
+  struct alignas(64) TaskRange {
+    std::atomic<uint64> range{0};
+  };
+
+  void target(int thread_id);
+  uint64 wait_for_launch(uint32 last_epoch);
+  void execute_tasks(int thread_id);
+  bool pop_task(int thread_id, int &task_id);
+  bool steal_task(int thread_id, int &task_id);
+  void setup_numa_topology(bool numa_aware);
+
+  int max_num_threads_;
+  int spin_count_;
+  int num_numa_nodes_{1};
+  std::vector<std::thread> threads_;
+  std::unique_ptr<TaskRange[]> ranges_;
+  // Victims of each worker, ordered by NUMA distance.
+  std::vector<std::vector<int>> victims_;
+  // CPUs each worker is pinned to; empty when pinning is disabled.
+  std::vector<std::vector<int>> worker_cpus_;
+
+  // Launch gate: [epoch (32 bits) | closed (1 bit) | joined workers (31 bits)]
+  std::atomic<uint64> gate_{0};
+  uint32 epoch_{0};
+  std::atomic<int64> pending_tasks_{0};
+  std::atomic<int> num_workers_{0};
+  std::atomic<int> num_parked_{0};
+  std::atomic<bool> exiting_{false};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+
+  RangeForTaskFunc *func_{nullptr};
+  void *range_for_task_context_{nullptr};
+};
+
 TI_NAMESPACE_END
@@ -37,17 +37,22 @@ class UnifiedAllocator {
         head + alignment - 1 - ((std::size_t)head + alignment - 1) % alignment;
     TI_TRACE("UM [data={}] allocate() request={} remain={}", (intptr_t)data,
              size, (tail - head));
-    head = ret + size;
-    if (head > tail) {
-      // allocation failed
+    if (ret + size > tail) {
+      // allocation failed. Leave head untouched so that the rest of the arena
+      // can still be handed out.
       return nullptr;
     } else {
       // success
+      head = ret + size;
       TI_ASSERT((std::size_t)ret % alignment == 0);
       return ret;
     }
   }
 
+  std::size_t size() const {
+    return size_;
+  }
+
   void memset(unsigned char val);
 
   bool initialized() const {
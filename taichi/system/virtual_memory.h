@@ -57,6 +57,29 @@ class VirtualMemoryAllocator {
 #endif
       TI_ERROR("Failed to free virtual memory ({} B)", size);
   }
+
+  // Returns the physical pages backing [ptr, ptr + size) to the OS while
+  // keeping the address range reserved. Both ptr and size must be multiples of
+  // page_size. The pages read as zero when touched again.
+  static void decommit(void *ptr, std::size_t size) {
+#if defined(TI_PLATFORM_LINUX) || defined(TI_PLATFORM_ANDROID)
+    // Private anonymous pages are zero-filled on the next access
+    TI_ERROR_IF(madvise(ptr, size, MADV_DONTNEED) != 0,
+                "Failed to decommit virtual memory ({} B)", size);
+#elif defined(TI_PLATFORM_UNIX)
+    // MADV_DONTNEED does not guarantee zero pages on BSD. Map fresh pages over
+    // the range instead.
+    auto ret = mmap(ptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    TI_ERROR_IF(ret == MAP_FAILED, "Failed to decommit virtual memory ({} B)",
+                size);
+#else
+    TI_ERROR_IF(!VirtualFree(ptr, size, MEM_DECOMMIT),
+                "Failed to decommit virtual memory ({} B)", size);
+    TI_ERROR_IF(VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE) == nullptr,
+                "Failed to recommit virtual memory ({} B)", size);
+#endif
+  }
 };
 
 float64 get_memory_usage_gb(int pid = -1);
@@ -4,28 +4,65 @@
 #include "taichi/ir/pass.h"
 #include "taichi/ir/visitors.h"
 #include "taichi/program/compile_config.h"
+#include "taichi/program/compile_profiler.h"
 #include "taichi/program/extension.h"
 #include "taichi/program/function.h"
 #include "taichi/program/kernel.h"
+#include "taichi/program/program.h"
 
 TLANG_NAMESPACE_BEGIN
 
 namespace irpass {
 namespace {
 
-std::function<void(const std::string &)>
-make_pass_printer(bool verbose, const std::string &kernel_name, IRNode *ir) {
-  if (!verbose) {
-    return [](const std::string &) {};
+// Prints the IR at the checkpoints in verbose mode, and records each pass
+// into the compile profiler of the program if it is enabled.
+class PassTracker {
+ public:
+  PassTracker(bool verbose,
+              const std::string &kernel_name,
+              IRNode *ir,
+              Program *program)
+      : verbose_(verbose),
+        kernel_name_(kernel_name),
+        ir_(ir),
+        recorder_(kernel_name,
+                  ir,
+                  program ? program->compile_profiler.get() : nullptr) {
+  }
+
+  // Runs one pass and records it as |pass_name|.
+  template <typename Func>
+  auto run(const std::string &pass_name, Func &&pass) -> decltype(pass()) {
+    return recorder_.run(pass_name, std::forward<Func>(pass));
+  }
+
+  // Prints the IR in verbose mode.
+  void after(const std::string &checkpoint) {
+    if (verbose_) {
+      TI_INFO("[{}] {}:", kernel_name_, checkpoint);
+      std::cout << std::flush;
+      irpass::re_id(ir_);
+      irpass::print(ir_);
+      std::cout << std::flush;
+    }
+  }
+
+  void verify() {
+    irpass::analysis::verify(ir_);
   }
-  return [ir, kernel_name](const std::string &pass) {
-    TI_INFO("[{}] {}:", kernel_name, pass);
-    std::cout << std::flush;
-    irpass::re_id(ir);
-    irpass::print(ir);
-    std::cout << std::flush;
-  };
-}
+
+  // Records the passes run by full_simplify().
+  CompilePassRecorder *recorder() {
+    return &recorder_;
+  }
+
+ private:
+  bool verbose_;
+  std::string kernel_name_;
+  IRNode *ir_;
+  CompilePassRecorder recorder_;
+};
 
 }  // namespace
 
@@ -39,110 +76,124 @@ void compile_to_offloads(IRNode *ir,
                          bool start_from_ast) {
   TI_AUTO_PROF;
 
-  auto print = make_pass_printer(verbose, kernel->get_name(), ir);
-  print("Initial IR");
+  PassTracker tracker(verbose, kernel->get_name(), ir, kernel->program);
+  tracker.after("Initial IR");
 
   if (grad) {
-    irpass::reverse_segments(ir);
-    print("Segment reversed (for autodiff)");
+    tracker.run("reverse_segments", [&] { irpass::reverse_segments(ir); });
+    tracker.after("Segment reversed (for autodiff)");
   }
 
   if (start_from_ast) {
-    irpass::lower_ast(ir);
-    print("Lowered");
+    tracker.run("lower_ast", [&] { irpass::lower_ast(ir); });
+    tracker.after("Lowered");
   }
 
-  irpass::type_check(ir, config);
-  print("Typechecked");
-  irpass::analysis::verify(ir);
+  tracker.run("type_check", [&] { irpass::type_check(ir, config); });
+  tracker.after("Typechecked");
+  tracker.verify();
 
   if (kernel->is_evaluator) {
     TI_ASSERT(!grad);
 
-    irpass::demote_operations(ir, config);
-    print("Operations demoted");
+    tracker.run("demote_operations",
+                [&] { irpass::demote_operations(ir, config); });
+    tracker.after("Operations demoted");
 
-    irpass::offload(ir, config);
-    print("Offloaded");
-    irpass::analysis::verify(ir);
+    tracker.run("offload", [&] { irpass::offload(ir, config); });
+    tracker.after("Offloaded");
+    tracker.verify();
     return;
   }
 
   if (vectorize) {
-    irpass::loop_vectorize(ir, config);
-    print("Loop Vectorized");
-    irpass::analysis::verify(ir);
-
-    irpass::vector_split(ir, config.max_vector_width, config.serial_schedule);
-    print("Loop Split");
-    irpass::analysis::verify(ir);
+    tracker.run("loop_vectorize", [&] { irpass::loop_vectorize(ir, config); });
+    tracker.after("Loop Vectorized");
+    tracker.verify();
+
+    tracker.run("vector_split", [&] {
+      irpass::vector_split(ir, config.max_vector_width, config.serial_schedule);
+    });
+    tracker.after("Loop Split");
+    tracker.verify();
   }
 
   // TODO: strictly enforce bit vectorization for x86 cpu and CUDA now
   //       create a separate CompileConfig flag for the new pass
   if (arch_is_cpu(config.arch) || config.arch == Arch::cuda) {
-    irpass::bit_loop_vectorize(ir);
-    irpass::type_check(ir, config);
-    print("Bit Loop Vectorized");
-    irpass::analysis::verify(ir);
+    tracker.run("bit_loop_vectorize", [&] { irpass::bit_loop_vectorize(ir); });
+    tracker.run("type_check", [&] { irpass::type_check(ir, config); });
+    tracker.after("Bit Loop Vectorized");
+    tracker.verify();
   }
 
-  irpass::full_simplify(ir, config, {false, kernel->program});
-  print("Simplified I");
-  irpass::analysis::verify(ir);
+  irpass::full_simplify(ir, config,
+                        {false, kernel->program, tracker.recorder()});
+  tracker.after("Simplified I");
+  tracker.verify();
 
-  if (irpass::inlining(ir, config, {})) {
-    print("Functions inlined");
-    irpass::analysis::verify(ir);
+  if (tracker.run("inlining",
+                  [&] { return irpass::inlining(ir, config, {}); })) {
+    tracker.after("Functions inlined");
+    tracker.verify();
   }
 
   if (is_extension_supported(config.arch, Extension::mesh)) {
-    irpass::analysis::gather_meshfor_relation_types(ir);
+    tracker.run("gather_meshfor_relation_types",
+                [&] { irpass::analysis::gather_meshfor_relation_types(ir); });
   }
 
   if (grad) {
     // Remove local atomics here so that we don't have to handle their gradients
-    irpass::demote_atomics(ir, config);
-
-    irpass::full_simplify(ir, config, {false, kernel->program});
-    irpass::auto_diff(ir, config, ad_use_stack);
-    irpass::full_simplify(ir, config, {false, kernel->program});
-    print("Gradient");
-    irpass::analysis::verify(ir);
+    tracker.run("demote_atomics", [&] { irpass::demote_atomics(ir, config); });
+
+    irpass::full_simplify(ir, config,
+                          {false, kernel->program, tracker.recorder()});
+    tracker.run("auto_diff",
+                [&] { irpass::auto_diff(ir, config, ad_use_stack); });
+    irpass::full_simplify(ir, config,
+                          {false, kernel->program, tracker.recorder()});
+    tracker.after("Gradient");
+    tracker.verify();
   }
 
   if (config.check_out_of_bound) {
-    irpass::check_out_of_bound(ir, config, {kernel->get_name()});
-    print("Bound checked");
-    irpass::analysis::verify(ir);
+    tracker.run("check_out_of_bound", [&] {
+      irpass::check_out_of_bound(ir, config, {kernel->get_name()});
+    });
+    tracker.after("Bound checked");
+    tracker.verify();
   }
 
-  irpass::flag_access(ir);
-  print("Access flagged I");
-  irpass::analysis::verify(ir);
+  tracker.run("flag_access", [&] { irpass::flag_access(ir); });
+  tracker.after("Access flagged I");
+  tracker.verify();
 
-  irpass::full_simplify(ir, config, {false, kernel->program});
-  print("Simplified II");
-  irpass::analysis::verify(ir);
+  irpass::full_simplify(ir, config,
+                        {false, kernel->program, tracker.recorder()});
+  tracker.after("Simplified II");
+  tracker.verify();
 
-  irpass::offload(ir, config);
-  print("Offloaded");
-  irpass::analysis::verify(ir);
+  tracker.run("offload", [&] { irpass::offload(ir, config); });
+  tracker.after("Offloaded");
+  tracker.verify();
 
   // TODO: This pass may be redundant as cfg_optimization() is already called
   //  in full_simplify().
   if (config.opt_level > 0 && config.cfg_optimization) {
-    irpass::cfg_optimization(ir, false);
-    print("Optimized by CFG");
-    irpass::analysis::verify(ir);
+    tracker.run("cfg_optimization",
+                [&] { irpass::cfg_optimization(ir, false); });
+    tracker.after("Optimized by CFG");
+    tracker.verify();
   }
 
-  irpass::flag_access(ir);
-  print("Access flagged II");
+  tracker.run("flag_access", [&] { irpass::flag_access(ir); });
+  tracker.after("Access flagged II");
 
-  irpass::full_simplify(ir, config, {false, kernel->program});
-  print("Simplified III");
-  irpass::analysis::verify(ir);
+  irpass::full_simplify(ir, config,
+                        {false, kernel->program, tracker.recorder()});
+  tracker.after("Simplified III");
+  tracker.verify();
 }
 
 void offload_to_executable(IRNode *ir,
@@ -155,7 +206,7 @@ void offload_to_executable(IRNode *ir,
                            bool make_block_local) {
   TI_AUTO_PROF;
 
-  auto print = make_pass_printer(verbose, kernel->get_name(), ir);
+  PassTracker tracker(verbose, kernel->get_name(), ir, kernel->program);
 
   // TODO: This is just a proof that we can demote struct-fors after offloading.
   // Eventually we might want the order to be TLS/BLS -> demote struct-for.
@@ -164,108 +215,142 @@ void offload_to_executable(IRNode *ir,
 
   auto amgr = std::make_unique<AnalysisManager>();
 
-  print("Start offload_to_executable");
-  irpass::analysis::verify(ir);
+  tracker.after("Start offload_to_executable");
+  tracker.verify();
 
   if (config.detect_read_only) {
-    irpass::detect_read_only(ir);
-    print("Detect read-only accesses");
+    tracker.run("detect_read_only",
+                [&] { irpass::detect_read_only(ir, config); });
+    tracker.after("Detect read-only accesses");
   }
 
-  irpass::demote_atomics(ir, config);
-  print("Atomics demoted I");
-  irpass::analysis::verify(ir);
+  tracker.run("demote_atomics", [&] { irpass::demote_atomics(ir, config); });
+  tracker.after("Atomics demoted I");
+  tracker.verify();
 
   if (config.demote_dense_struct_fors) {
-    irpass::demote_dense_struct_fors(ir, config.packed);
-    irpass::type_check(ir, config);
-    print("Dense struct-for demoted");
-    irpass::analysis::verify(ir);
+    tracker.run("demote_dense_struct_fors", [&] {
+      irpass::demote_dense_struct_fors(ir, config.packed);
+    });
+    tracker.run("type_check", [&] { irpass::type_check(ir, config); });
+    tracker.after("Dense struct-for demoted");
+    tracker.verify();
   }
 
   if (is_extension_supported(config.arch, Extension::mesh) &&
       config.demote_no_access_mesh_fors) {
-    irpass::demote_no_access_mesh_fors(ir);
-    irpass::type_check(ir, config);
-    print("No-access mesh-for demoted");
-    irpass::analysis::verify(ir);
+    tracker.run("demote_no_access_mesh_fors",
+                [&] { irpass::demote_no_access_mesh_fors(ir); });
+    tracker.run("type_check", [&] { irpass::type_check(ir, config); });
+    tracker.after("No-access mesh-for demoted");
+    tracker.verify();
   }
 
   if (make_thread_local) {
-    irpass::make_thread_local(ir, config);
-    print("Make thread local");
+    tracker.run("make_thread_local",
+                [&] { irpass::make_thread_local(ir, config); });
+    tracker.after("Make thread local");
   }
 
   if (is_extension_supported(config.arch, Extension::mesh)) {
-    irpass::make_mesh_thread_local(ir, config, {kernel->get_name()});
-    print("Make mesh thread local");
+    tracker.run("make_mesh_thread_local", [&] {
+      irpass::make_mesh_thread_local(ir, config, {kernel->get_name()});
+    });
+    tracker.after("Make mesh thread local");
     if (config.make_mesh_block_local) {
-      irpass::make_mesh_block_local(ir, config, {kernel->get_name()});
-      print("Make mesh block local");
-      irpass::full_simplify(ir, config, {false, kernel->program});
-      print("Simplified X");
+      tracker.run("make_mesh_block_local", [&] {
+        irpass::make_mesh_block_local(ir, config, {kernel->get_name()});
+      });
+      tracker.after("Make mesh block local");
+      irpass::full_simplify(ir, config,
+                            {false, kernel->program, tracker.recorder()});
+      tracker.after("Simplified X");
     }
   }
 
   if (make_block_local) {
-    irpass::make_block_local(ir, config, {kernel->get_name()});
-    print("Make block local");
+    tracker.run("make_block_local", [&] {
+      irpass::make_block_local(ir, config, {kernel->get_name()});
+    });
+    tracker.after("Make block local");
   }
 
   if (is_extension_supported(config.arch, Extension::mesh)) {
-    irpass::demote_mesh_statements(ir, config, {kernel->get_name()});
-    print("Demote mesh statements");
+    tracker.run("demote_mesh_statements", [&] {
+      irpass::demote_mesh_statements(ir, config, {kernel->get_name()});
+    });
+    tracker.after("Demote mesh statements");
   }
 
-  irpass::demote_atomics(ir, config);
-  print("Atomics demoted II");
-  irpass::analysis::verify(ir);
+  tracker.run("demote_atomics", [&] { irpass::demote_atomics(ir, config); });
+  tracker.after("Atomics demoted II");
+  tracker.verify();
 
   if (is_extension_supported(config.arch, Extension::quant) &&
       ir->get_config().quant_opt_atomic_demotion) {
-    irpass::analysis::gather_uniquely_accessed_bit_structs(ir, amgr.get());
+    tracker.run("gather_uniquely_accessed_bit_structs", [&] {
+      irpass::analysis::gather_uniquely_accessed_bit_structs(ir, amgr.get());
+    });
   }
 
-  irpass::remove_range_assumption(ir);
-  print("Remove range assumption");
+  tracker.run("remove_range_assumption",
+              [&] { irpass::remove_range_assumption(ir); });
+  tracker.after("Remove range assumption");
 
-  irpass::remove_loop_unique(ir);
-  print("Remove loop_unique");
-  irpass::analysis::verify(ir);
+  tracker.run("remove_loop_unique", [&] { irpass::remove_loop_unique(ir); });
+  tracker.after("Remove loop_unique");
+  tracker.verify();
 
   if (lower_global_access) {
-    irpass::lower_access(ir, config, {kernel->no_activate, true});
-    print("Access lowered");
-    irpass::analysis::verify(ir);
-
-    irpass::die(ir);
-    print("DIE");
-    irpass::analysis::verify(ir);
-
-    irpass::flag_access(ir);
-    print("Access flagged III");
-    irpass::analysis::verify(ir);
+    tracker.run("lower_access", [&] {
+      irpass::lower_access(ir, config, {kernel->no_activate, true});
+    });
+    tracker.after("Access lowered");
+    tracker.verify();
+
+    tracker.run("die", [&] { irpass::die(ir); });
+    tracker.after("DIE");
+    tracker.verify();
+
+    tracker.run("flag_access", [&] { irpass::flag_access(ir); });
+    tracker.after("Access flagged III");
+    tracker.verify();
   }
 
-  irpass::demote_operations(ir, config);
-  print("Operations demoted");
+  tracker.run("demote_operations",
+              [&] { irpass::demote_operations(ir, config); });
+  tracker.after("Operations demoted");
 
-  irpass::full_simplify(ir, config, {lower_global_access, kernel->program});
-  print("Simplified IV");
+  irpass::full_simplify(
+      ir, config, {lower_global_access, kernel->program, tracker.recorder()});
+  tracker.after("Simplified IV");
 
   if (determine_ad_stack_size) {
-    irpass::determine_ad_stack_size(ir, config);
-    print("Autodiff stack size determined");
+    tracker.run("determine_ad_stack_size",
+                [&] { irpass::determine_ad_stack_size(ir, config); });
+    tracker.after("Autodiff stack size determined");
   }
 
   if (is_extension_supported(config.arch, Extension::quant)) {
-    irpass::optimize_bit_struct_stores(ir, config, amgr.get());
-    print("Bit struct stores optimized");
+    tracker.run("optimize_bit_struct_stores", [&] {
+      irpass::optimize_bit_struct_stores(ir, config, amgr.get());
+    });
+    tracker.after("Bit struct stores optimized");
   }
 
   // Final field registration correctness & type checking
-  irpass::type_check(ir, config);
-  irpass::analysis::verify(ir);
+  tracker.run("type_check", [&] { irpass::type_check(ir, config); });
+  tracker.after("Typechecked");
+  tracker.verify();
+
+  // Vector types are only understood by the LLVM codegen, so this must be
+  // the last pass.
+  if (config.slp_vectorize && arch_is_cpu(kernel->arch) &&
+      arch_uses_llvm(kernel->arch)) {
+    tracker.run("slp_vectorize", [&] { irpass::slp_vectorize(ir, config); });
+    tracker.after("SLP vectorized");
+    tracker.verify();
+  }
 }
 
 void compile_to_executable(IRNode *ir,
@@ -298,25 +383,26 @@ void compile_inline_function(IRNode *ir,
                              bool start_from_ast) {
   TI_AUTO_PROF;
 
-  auto print = make_pass_printer(verbose, func->get_name(), ir);
-  print("Initial IR");
+  PassTracker tracker(verbose, func->get_name(), ir, func->program);
+  tracker.after("Initial IR");
 
   if (grad) {
-    irpass::reverse_segments(ir);
-    print("Segment reversed (for autodiff)");
+    tracker.run("reverse_segments", [&] { irpass::reverse_segments(ir); });
+    tracker.after("Segment reversed (for autodiff)");
   }
 
   if (start_from_ast) {
-    irpass::lower_ast(ir);
-    print("Lowered");
+    tracker.run("lower_ast", [&] { irpass::lower_ast(ir); });
+    tracker.after("Lowered");
   }
 
-  irpass::type_check(ir, config);
-  print("Typechecked");
+  tracker.run("type_check", [&] { irpass::type_check(ir, config); });
+  tracker.after("Typechecked");
 
-  irpass::full_simplify(ir, config, {false, func->program});
-  print("Simplified");
-  irpass::analysis::verify(ir);
+  irpass::full_simplify(ir, config,
+                        {false, func->program, tracker.recorder()});
+  tracker.after("Simplified");
+  tracker.verify();
 }
 
 }  // namespace irpass
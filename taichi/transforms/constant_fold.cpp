@@ -71,6 +71,21 @@ class ConstantFold : public BasicStmtVisitor {
     return ker_ptr;
   }
 
+  int64 launch_evaluator(Kernel *ker, Kernel::LaunchContextBuilder &ctx) {
+    std::lock_guard<std::mutex> _(program->jit_evaluator_cache_mut);
+    if (arch_uses_llvm(ker->arch) && arch_is_cpu(ker->arch)) {
+      // The main thread may launch kernels at the same time, see precompile().
+      // Write the result to a buffer of this evaluator instead of the shared
+      // result buffer.
+      uint64 result_buffer[taichi_result_buffer_entries]{};
+      ctx.get_context().result_buffer = result_buffer;
+      (*ker)(ctx);
+      return (int64)result_buffer[taichi_result_buffer_ret_value_id];
+    }
+    (*ker)(ctx);
+    return program->fetch_result<int64>(taichi_result_buffer_ret_value_id);
+  }
+
   static bool is_good_type(DataType dt) {
     // ConstStmt of `bad` types like `i8` is not supported by LLVM.
     // Discussion:
@@ -102,11 +117,7 @@ class ConstantFold : public BasicStmtVisitor {
     auto launch_ctx = ker->make_launch_context();
     launch_ctx.set_arg_raw(0, lhs.val_u64);
     launch_ctx.set_arg_raw(1, rhs.val_u64);
-    {
-      std::lock_guard<std::mutex> _(program->jit_evaluator_cache_mut);
-      (*ker)(launch_ctx);
-      ret.val_i64 = program->fetch_result<int64_t>(0);
-    }
+    ret.val_i64 = launch_evaluator(ker, launch_ctx);
     return true;
   }
 
@@ -124,11 +135,7 @@ class ConstantFold : public BasicStmtVisitor {
     auto *ker = get_jit_evaluator_kernel(id);
     auto launch_ctx = ker->make_launch_context();
     launch_ctx.set_arg_raw(0, operand.val_u64);
-    {
-      std::lock_guard<std::mutex> _(program->jit_evaluator_cache_mut);
-      (*ker)(launch_ctx);
-      ret.val_i64 = program->fetch_result<int64_t>(0);
-    }
+    ret.val_i64 = launch_evaluator(ker, launch_ctx);
     return true;
   }
 
@@ -224,11 +231,9 @@ class ConstantFold : public BasicStmtVisitor {
     ConstantFold folder(program);
     bool modified = false;
 
-    auto program_compile_config_org = program->config;
-    program->config.advanced_optimization = false;
-    program->config.constant_folding = false;
-    program->config.external_optimization_level = 0;
-
+    // The evaluators are lowered without advanced optimizations, see
+    // Kernel::lower(), so |program->config| is left untouched here. It is
+    // read concurrently by the precompile workers.
     while (true) {
       node->accept(&folder);
       if (folder.modifier.modify_ir()) {
@@ -238,8 +243,6 @@ class ConstantFold : public BasicStmtVisitor {
       }
     }
 
-    program->config = program_compile_config_org;
-
     return modified;
   }
 };
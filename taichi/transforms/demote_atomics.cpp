@@ -35,6 +35,11 @@ class DemoteAtomics : public BasicStmtVisitor {
       if (stmt->dest->is<ThreadLocalPtrStmt>()) {
         demote = true;
       }
+      // The BLS buffers of a CPU thread are in its TLS buffer.
+      if (arch_is_cpu(current_offloaded->device) &&
+          stmt->dest->is<BlockLocalPtrStmt>()) {
+        demote = true;
+      }
       if (current_offloaded->task_type == OffloadedTaskType::serial) {
         demote = true;
       }
@@ -12,7 +12,7 @@ namespace irpass {
 
 namespace {
 
-void detect_read_only_in_task(OffloadedStmt *offload) {
+void detect_read_only_in_task(OffloadedStmt *offload, bool detect_write_only) {
   auto accessed = irpass::analysis::gather_snode_read_writes(offload);
   for (auto snode : accessed.first) {
     if (accessed.second.count(snode) == 0) {
@@ -20,6 +20,15 @@ void detect_read_only_in_task(OffloadedStmt *offload) {
       offload->mem_access_opt.add_flag(snode, SNodeAccessFlag::read_only);
     }
   }
+  if (!detect_write_only) {
+    return;
+  }
+  for (auto snode : accessed.second) {
+    if (accessed.first.count(snode) == 0) {
+      // write-only SNode
+      offload->mem_access_opt.add_flag(snode, SNodeAccessFlag::write_only);
+    }
+  }
 }
 
 class ExternalPtrAccessVisitor : public BasicStmtVisitor {
@@ -72,13 +81,17 @@ class ExternalPtrAccessVisitor : public BasicStmtVisitor {
 
 }  // namespace
 
-void detect_read_only(IRNode *root) {
+void detect_read_only(IRNode *root, const CompileConfig &config) {
+  // Only the non-temporal stores of x64 codegen use write-only SNodes
+  const bool detect_write_only =
+      config.arch == Arch::x64 && config.cpu_nontemporal_store;
   if (root->is<Block>()) {
     for (auto &offload : root->as<Block>()->statements) {
-      detect_read_only_in_task(offload->as<OffloadedStmt>());
+      detect_read_only_in_task(offload->as<OffloadedStmt>(),
+                               detect_write_only);
     }
   } else {
-    detect_read_only_in_task(root->as<OffloadedStmt>());
+    detect_read_only_in_task(root->as<OffloadedStmt>(), detect_write_only);
   }
 }
 
@@ -6,6 +6,7 @@
 #include "taichi/ir/visitors.h"
 #include "taichi/system/profiler.h"
 
+#include <unordered_map>
 #include <unordered_set>
 
 TLANG_NAMESPACE_BEGIN
@@ -13,54 +14,60 @@ TLANG_NAMESPACE_BEGIN
 // Dead Instruction Elimination
 class DIE : public IRVisitor {
  public:
-  std::unordered_set<int> used;
-  int phase;  // 0: mark usage 1: eliminate
+  // The number of operands that refer to each statement, by instance id
+  std::unordered_map<int, int> num_uses;
+  // The statements that can be eliminated if unused, in visiting order
+  std::vector<Stmt *> eliminable;
   DelayedIRModifier modifier;
   bool modified_ir;
 
   DIE(IRNode *node) {
     allow_undefined_visitor = true;
     invoke_default_visitor = true;
-    modified_ir = false;
-    while (true) {
-      bool modified = false;
-      phase = 0;
-      used.clear();
-      node->accept(this);
-      phase = 1;
-      while (true) {
-        node->accept(this);
-        if (modifier.modify_ir()) {
-          modified = true;
-          modified_ir = true;
-          continue;
+    node->accept(this);
+    // Erasing a statement may leave its operands unused. Instead of traversing
+    // the IR again to find them, follow the operands of the erased statements.
+    std::unordered_set<Stmt *> eliminable_set(eliminable.begin(),
+                                              eliminable.end());
+    std::unordered_set<Stmt *> dead;
+    std::vector<Stmt *> worklist;
+    for (auto *stmt : eliminable) {
+      if (num_uses[stmt->instance_id] == 0) {
+        dead.insert(stmt);
+        worklist.push_back(stmt);
+      }
+    }
+    while (!worklist.empty()) {
+      auto *stmt = worklist.back();
+      worklist.pop_back();
+      for (auto *op : stmt->get_operands()) {
+        if (op && --num_uses[op->instance_id] == 0 &&
+            eliminable_set.count(op) && dead.insert(op).second) {
+          worklist.push_back(op);
         }
-        break;
       }
-      if (!modified)
-        break;
     }
+    for (auto *stmt : eliminable) {
+      if (dead.count(stmt)) {
+        modifier.erase(stmt);
+      }
+    }
+    modified_ir = modifier.modify_ir();
   }
 
   void register_usage(Stmt *stmt) {
     for (auto op : stmt->get_operands()) {
       if (op) {  // might be nullptr
-        if (used.find(op->instance_id) == used.end()) {
-          used.insert(op->instance_id);
-        }
+        num_uses[op->instance_id]++;
       }
     }
   }
 
   void visit(Stmt *stmt) override {
     TI_ASSERT(!stmt->erased);
-    if (phase == 0) {
-      register_usage(stmt);
-    } else {
-      if (stmt->dead_instruction_eliminable() &&
-          used.find(stmt->instance_id) == used.end()) {
-        modifier.erase(stmt);
-      }
+    register_usage(stmt);
+    if (stmt->dead_instruction_eliminable()) {
+      eliminable.push_back(stmt);
     }
   }
 
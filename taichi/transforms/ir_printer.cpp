@@ -453,6 +453,19 @@ class IRPrinter : public IRVisitor {
           }));
   }
 
+  void visit(VectorPackStmt *stmt) override {
+    std::string values;
+    for (int i = 0; i < (int)stmt->values.size(); i++) {
+      values += fmt::format(i == 0 ? "{}" : ", {}", stmt->values[i]->name());
+    }
+    print("{}{} = pack [{}]", stmt->type_hint(), stmt->name(), values);
+  }
+
+  void visit(VectorExtractStmt *stmt) override {
+    print("{}{} = extract {}[{}]", stmt->type_hint(), stmt->name(),
+          stmt->input->name(), stmt->index);
+  }
+
   void visit(RangeAssumptionStmt *stmt) override {
     print("{}{} = assume_in_range({}{:+d} <= {} < {}{:+d})", stmt->type_hint(),
           stmt->name(), stmt->base->name(), stmt->low, stmt->input->name(),
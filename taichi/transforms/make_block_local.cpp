@@ -3,6 +3,7 @@
 #include "taichi/ir/transforms.h"
 #include "taichi/ir/analysis.h"
 #include "taichi/ir/scratch_pad.h"
+#include "taichi/math/arithmetic.h"
 #include "taichi/transforms/make_block_local.h"
 
 TLANG_NAMESPACE_BEGIN
@@ -19,7 +20,28 @@ void make_block_local_offload(OffloadedStmt *offload,
 
   auto pads = irpass::initialize_scratch_pad(offload);
 
-  std::size_t bls_offset_in_bytes = 0;
+  // On CPUs, the BLS buffers are placed in the TLS buffer of the thread that
+  // runs the block, after the thread-local variables.
+  const bool on_cpu = arch_is_cpu(config.arch);
+  std::size_t bls_offset_in_bytes =
+      on_cpu ? iroundup(offload->tls_size, taichi_cpu_bls_alignment) : 0;
+
+  if (on_cpu) {
+    std::size_t tls_size = bls_offset_in_bytes;
+    for (auto &pad : pads->pads) {
+      auto dtype_size = data_type_size(pad.first->dt.ptr_removed());
+      tls_size = iroundup(tls_size, (std::size_t)dtype_size) +
+                 dtype_size * pad.second.pad_size_linear();
+    }
+    if (tls_size > taichi_cpu_max_tls_buffer_size) {
+      TI_WARN(
+          "[{}] The BLS buffers of this struct-for need {} bytes, more than "
+          "the {} bytes a CPU thread can hold. BLS is skipped. Use a smaller "
+          "block_dim to enable it.",
+          kernel_name, tls_size, taichi_cpu_max_tls_buffer_size);
+      return;
+    }
+  }
 
   for (auto &pad : pads->pads) {
     auto snode = pad.first;
@@ -68,6 +90,77 @@ void make_block_local_offload(OffloadedStmt *offload,
             block = std::make_unique<Block>();
             block->parent_stmt = offload;
           }
+
+          // Applies |operation| to the element |bls_element_id| of the BLS
+          // buffer.
+          auto create_element_access = [&](Block *element_block,
+                                           Stmt *bls_element_id) {
+            auto bls_element_offset_bytes =
+                element_block->push_back<BinaryOpStmt>(
+                    BinaryOpType::mul, bls_element_id,
+                    element_block->push_back<ConstStmt>(
+                        TypedConstant(dtype_size)));
+
+            bls_element_offset_bytes = element_block->push_back<BinaryOpStmt>(
+                BinaryOpType::add, bls_element_offset_bytes,
+                element_block->push_back<ConstStmt>(
+                    TypedConstant((int32)bls_offset_in_bytes)));
+
+            std::vector<Stmt *> global_indices(dim);
+
+            // Convert bls_element_id to global indices
+            // via a series of % and /.
+            auto bls_element_id_partial = bls_element_id;
+            for (int i = dim - 1; i >= 0; i--) {
+              auto pad_size_stmt = element_block->push_back<ConstStmt>(
+                  TypedConstant(pad.second.pad_size[i]));
+
+              auto bls_coord = element_block->push_back<BinaryOpStmt>(
+                  BinaryOpType::mod, bls_element_id_partial, pad_size_stmt);
+              bls_element_id_partial = element_block->push_back<BinaryOpStmt>(
+                  BinaryOpType::div, bls_element_id_partial, pad_size_stmt);
+
+              auto global_index_this_dim =
+                  element_block->push_back<BinaryOpStmt>(
+                      BinaryOpType::add, bls_coord,
+                      element_block->push_back<ConstStmt>(
+                          TypedConstant(pad.second.bounds[i].low)));
+
+              auto block_corner =
+                  element_block->push_back<BlockCornerIndexStmt>(offload, i);
+              if (pad.second.coefficients[i] > 1) {
+                block_corner = element_block->push_back<BinaryOpStmt>(
+                    BinaryOpType::mul, block_corner,
+                    element_block->push_back<ConstStmt>(
+                        TypedConstant(pad.second.coefficients[i])));
+              }
+
+              global_index_this_dim = element_block->push_back<BinaryOpStmt>(
+                  BinaryOpType::add, global_index_this_dim, block_corner);
+
+              global_indices[i] = global_index_this_dim;
+            }
+
+            operation(element_block, global_indices, bls_element_offset_bytes);
+            // TODO: do not use GlobalStore for BLS ptr.
+          };
+
+          if (on_cpu) {
+            // A CPU thread runs the whole block, so it goes through all the
+            // elements of the BLS buffer in a serial loop.
+            auto loop = block->push_back<RangeForStmt>(
+                block->push_back<ConstStmt>(TypedConstant(0)),
+                block->push_back<ConstStmt>(TypedConstant(bls_num_elements)),
+                std::make_unique<Block>(), /*vectorize=*/1,
+                /*bit_vectorize=*/1, /*num_cpu_threads=*/1, /*block_dim=*/0,
+                /*strictly_serialized=*/true);
+            auto element_block = loop->as<RangeForStmt>()->body.get();
+            auto bls_element_id =
+                element_block->push_back<LoopIndexStmt>(loop, 0);
+            create_element_access(element_block, bls_element_id);
+            return;
+          }
+
           // Equivalent to CUDA threadIdx
           Stmt *thread_idx_stmt =
               block->push_back<LoopLinearIndexStmt>(offload);
@@ -112,15 +205,6 @@ void make_block_local_offload(OffloadedStmt *offload,
             auto bls_element_id_this_iteration = block->push_back<BinaryOpStmt>(
                 BinaryOpType::add, loop_offset_stmt, thread_idx_stmt);
 
-            auto bls_element_offset_bytes = block->push_back<BinaryOpStmt>(
-                BinaryOpType::mul, bls_element_id_this_iteration,
-                block->push_back<ConstStmt>(TypedConstant(dtype_size)));
-
-            bls_element_offset_bytes = block->push_back<BinaryOpStmt>(
-                BinaryOpType::add, bls_element_offset_bytes,
-                block->push_back<ConstStmt>(
-                    TypedConstant((int32)bls_offset_in_bytes)));
-
             if (loop_offset + block_dim > bls_num_elements) {
               // Need to create an IfStmt to safeguard since bls size may not be
               // a multiple of block_size, and this iteration some threads may
@@ -138,43 +222,8 @@ void make_block_local_offload(OffloadedStmt *offload,
               element_block = block.get();
             }
 
-            std::vector<Stmt *> global_indices(dim);
-
-            // Convert bls_element_id to global indices
-            // via a series of % and /.
-            auto bls_element_id_partial = bls_element_id_this_iteration;
-            for (int i = dim - 1; i >= 0; i--) {
-              auto pad_size_stmt = element_block->push_back<ConstStmt>(
-                  TypedConstant(pad.second.pad_size[i]));
-
-              auto bls_coord = element_block->push_back<BinaryOpStmt>(
-                  BinaryOpType::mod, bls_element_id_partial, pad_size_stmt);
-              bls_element_id_partial = element_block->push_back<BinaryOpStmt>(
-                  BinaryOpType::div, bls_element_id_partial, pad_size_stmt);
-
-              auto global_index_this_dim =
-                  element_block->push_back<BinaryOpStmt>(
-                      BinaryOpType::add, bls_coord,
-                      element_block->push_back<ConstStmt>(
-                          TypedConstant(pad.second.bounds[i].low)));
-
-              auto block_corner =
-                  element_block->push_back<BlockCornerIndexStmt>(offload, i);
-              if (pad.second.coefficients[i] > 1) {
-                block_corner = element_block->push_back<BinaryOpStmt>(
-                    BinaryOpType::mul, block_corner,
-                    element_block->push_back<ConstStmt>(
-                        TypedConstant(pad.second.coefficients[i])));
-              }
-
-              global_index_this_dim = element_block->push_back<BinaryOpStmt>(
-                  BinaryOpType::add, global_index_this_dim, block_corner);
-
-              global_indices[i] = global_index_this_dim;
-            }
-
-            operation(element_block, global_indices, bls_element_offset_bytes);
-            // TODO: do not use GlobalStore for BLS ptr.
+            create_element_access(element_block,
+                                  bls_element_id_this_iteration);
 
             loop_offset += block_dim;
           }
@@ -331,7 +380,11 @@ void make_block_local_offload(OffloadedStmt *offload,
     bls_offset_in_bytes += dtype_size * bls_num_elements;
   }  // for (auto &pad : pads->pads)
 
-  offload->bls_size = std::max(std::size_t(1), bls_offset_in_bytes);
+  if (!on_cpu) {
+    offload->bls_size = std::max(std::size_t(1), bls_offset_in_bytes);
+  } else if (!pads->pads.empty()) {
+    offload->tls_size = bls_offset_in_bytes;
+  }
 }
 
 }  // namespace
@@ -2,6 +2,7 @@
 #include "taichi/ir/statements.h"
 #include "taichi/ir/transforms.h"
 #include "taichi/ir/analysis.h"
+#include "taichi/math/arithmetic.h"
 #include "taichi/transforms/make_mesh_block_local.h"
 
 namespace taichi {
@@ -125,7 +126,7 @@ void MakeMeshBlockLocal::replace_global_ptrs(SNode *snode) {
   }
 
   // in the cpu backend, atomic op in body block could be demoted to non-atomic
-  if (config.arch != Arch::x64) {
+  if (!arch_is_cpu(config.arch)) {
     return;
   }
   std::vector<AtomicOpStmt *> atomic_ops;
@@ -163,7 +164,7 @@ Stmt *MakeMeshBlockLocal::create_xlogue(
   [[maybe_unused]] Stmt *init_val =
       block->push_back<LocalStoreStmt>(idx, start_val);
   Stmt *block_dim_val;
-  if (config.arch == Arch::x64) {
+  if (arch_is_cpu(config.arch)) {
     block_dim_val = block->push_back<ConstStmt>(TypedConstant(1));
   } else {
     block_dim_val = block->push_back<ConstStmt>(
@@ -321,7 +322,7 @@ void MakeMeshBlockLocal::fetch_mapping(
     std::function<void(Block *body, Stmt *idx_val, Stmt *mapping_val)>
         attr_callback_handler) {
   Stmt *thread_idx_stmt;
-  if (config.arch == Arch::x64) {
+  if (arch_is_cpu(config.arch)) {
     thread_idx_stmt = block->push_back<ConstStmt>(TypedConstant(0));
   } else {
     thread_idx_stmt = block->push_back<LoopLinearIndexStmt>(
@@ -434,7 +435,13 @@ MakeMeshBlockLocal::MakeMeshBlockLocal(OffloadedStmt *offload,
   };
 
   // Step 3: Cache the mappings and the attributes
-  bls_offset_in_bytes = offload->bls_size;
+  // On CPUs, the BLS buffers are placed in the TLS buffer of the thread that
+  // runs the patch, after the thread-local variables.
+  if (arch_is_cpu(config.arch)) {
+    bls_offset_in_bytes = iroundup(offload->tls_size, taichi_cpu_bls_alignment);
+  } else {
+    bls_offset_in_bytes = offload->bls_size;
+  }
   if (offload->bls_prologue == nullptr) {
     offload->bls_prologue = std::make_unique<Block>();
     offload->bls_prologue->parent_stmt = offload;
@@ -575,7 +582,16 @@ MakeMeshBlockLocal::MakeMeshBlockLocal(OffloadedStmt *offload,
         });
   }
 
-  offload->bls_size = std::max(std::size_t(1), bls_offset_in_bytes);
+  if (arch_is_cpu(config.arch)) {
+    TI_ERROR_IF(bls_offset_in_bytes > taichi_cpu_max_tls_buffer_size,
+                "The cached mesh attributes and mappings of this mesh-for need "
+                "{} bytes, more than the {} bytes a CPU thread can hold. Use "
+                "smaller patches or ti.init(make_mesh_block_local=False).",
+                bls_offset_in_bytes, taichi_cpu_max_tls_buffer_size);
+    offload->tls_size = bls_offset_in_bytes;
+  } else {
+    offload->bls_size = std::max(std::size_t(1), bls_offset_in_bytes);
+  }
 }
 
 void MakeMeshBlockLocal::run(OffloadedStmt *offload,
@@ -4,9 +4,12 @@
 #include "taichi/ir/analysis.h"
 #include "taichi/ir/visitors.h"
 #include "taichi/transforms/simplify.h"
+#include "taichi/program/compile_profiler.h"
 #include "taichi/program/kernel.h"
 #include "taichi/program/program.h"
+#include <functional>
 #include <set>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 
@@ -635,55 +638,125 @@ bool simplify(IRNode *root, const CompileConfig &config) {
   return modified;
 }
 
+namespace {
+
+// Runs a pass of full_simplify, and records it if |recorder| is not nullptr.
+bool run_pass(CompilePassRecorder *recorder,
+              const std::string &name,
+              const std::function<bool()> &pass) {
+  if (recorder) {
+    return recorder->run("full_simplify/" + name, pass);
+  }
+  return pass();
+}
+
+// Skips the passes of a fixed-point iteration that cannot change the IR. The
+// passes are deterministic, so a pass that made no changes makes none again
+// until another pass modifies the IR.
+class FixedPointPassRunner {
+ public:
+  explicit FixedPointPassRunner(CompilePassRecorder *recorder)
+      : recorder_(recorder) {
+  }
+
+  // Runs |pass| unless that is known to be a no-op. Returns whether it
+  // modified the IR.
+  bool run(const std::string &name, const std::function<bool()> &pass) {
+    auto it = unmodified_at_.find(name);
+    if (it != unmodified_at_.end() && it->second == num_modifications_) {
+      return false;
+    }
+    if (run_pass(recorder_, name, pass)) {
+      num_modifications_++;
+      return true;
+    }
+    unmodified_at_[name] = num_modifications_;
+    return false;
+  }
+
+ private:
+  CompilePassRecorder *recorder_;
+  int num_modifications_{0};
+  // The value of |num_modifications_| when each pass last made no changes
+  std::unordered_map<std::string, int> unmodified_at_;
+};
+
+}  // namespace
+
 void full_simplify(IRNode *root,
                    const CompileConfig &config,
                    const FullSimplifyPass::Args &args) {
   TI_AUTO_PROF;
   if (config.advanced_optimization) {
+    FixedPointPassRunner runner(args.recorder);
     bool first_iteration = true;
+    int iteration = 0;
     while (true) {
+      if (args.recorder) {
+        args.recorder->set_iteration(++iteration);
+      }
       bool modified = false;
-      if (extract_constant(root, config))
+      if (runner.run("extract_constant",
+                     [&]() { return extract_constant(root, config); }))
         modified = true;
-      if (unreachable_code_elimination(root))
+      if (runner.run("unreachable_code_elimination",
+                     [&]() { return unreachable_code_elimination(root); }))
         modified = true;
-      if (binary_op_simplify(root, config))
+      if (runner.run("binary_op_simplify",
+                     [&]() { return binary_op_simplify(root, config); }))
         modified = true;
       if (config.constant_folding &&
-          constant_fold(root, config, {args.program}))
+          runner.run("constant_fold", [&]() {
+            return constant_fold(root, config, {args.program});
+          }))
         modified = true;
-      if (die(root))
+      if (runner.run("die", [&]() { return die(root); }))
         modified = true;
-      if (alg_simp(root, config))
+      if (runner.run("alg_simp", [&]() { return alg_simp(root, config); }))
         modified = true;
-      if (loop_invariant_code_motion(root, config))
+      if (runner.run("loop_invariant_code_motion", [&]() {
+            return loop_invariant_code_motion(root, config);
+          }))
         modified = true;
-      if (die(root))
+      if (runner.run("die", [&]() { return die(root); }))
         modified = true;
-      if (simplify(root, config))
+      if (runner.run("simplify", [&]() { return simplify(root, config); }))
         modified = true;
-      if (die(root))
+      if (runner.run("die", [&]() { return die(root); }))
         modified = true;
-      if (config.opt_level > 0 && whole_kernel_cse(root))
+      if (config.opt_level > 0 &&
+          runner.run("whole_kernel_cse",
+                     [&]() { return whole_kernel_cse(root); }))
         modified = true;
       // Don't do this time-consuming optimization pass again if the IR is
       // not modified.
       if (config.opt_level > 0 && (first_iteration || modified) &&
-          config.cfg_optimization &&
-          cfg_optimization(root, args.after_lower_access))
+          config.cfg_optimization && runner.run("cfg_optimization", [&]() {
+            return cfg_optimization(root, args.after_lower_access);
+          }))
         modified = true;
       first_iteration = false;
       if (!modified)
         break;
     }
+    if (args.recorder) {
+      args.recorder->set_iteration(0);
+    }
     return;
   }
+  if (args.recorder) {
+    args.recorder->set_iteration(1);
+  }
   if (config.constant_folding) {
-    constant_fold(root, config, {args.program});
-    die(root);
+    run_pass(args.recorder, "constant_fold",
+             [&]() { return constant_fold(root, config, {args.program}); });
+    run_pass(args.recorder, "die", [&]() { return die(root); });
+  }
+  run_pass(args.recorder, "simplify", [&]() { return simplify(root, config); });
+  run_pass(args.recorder, "die", [&]() { return die(root); });
+  if (args.recorder) {
+    args.recorder->set_iteration(0);
   }
-  simplify(root, config);
-  die(root);
 }
 
 }  // namespace irpass
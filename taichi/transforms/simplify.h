@@ -5,6 +5,8 @@
 namespace taichi {
 namespace lang {
 
+class CompilePassRecorder;
+
 class FullSimplifyPass : public Pass {
  public:
   static const PassID id;
@@ -12,6 +14,8 @@ class FullSimplifyPass : public Pass {
   struct Args {
     bool after_lower_access;
     Program *program;
+    // If not nullptr, records each pass that full_simplify runs.
+    CompilePassRecorder *recorder{nullptr};
   };
 };
 
@@ -0,0 +1,376 @@
+#include <algorithm>
+#include <climits>
+#include <functional>
+#include <map>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/ir/type_utils.h"
+#include "taichi/ir/visitors.h"
+#include "taichi/program/compile_config.h"
+#include "taichi/system/profiler.h"
+#include "taichi/util/statistics.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+// Whether the codegen can emit |stmt| as a vector instruction.
+bool is_vectorizable(BinaryOpStmt *stmt) {
+  auto dt = stmt->ret_type;
+  if (!dt->is<PrimitiveType>() || dt->is_primitive(PrimitiveTypeID::f16) ||
+      stmt->lhs->ret_type != dt || stmt->rhs->ret_type != dt) {
+    return false;
+  }
+  switch (stmt->op_type) {
+    case BinaryOpType::add:
+    case BinaryOpType::sub:
+    case BinaryOpType::mul:
+      return is_real(dt) || is_integral(dt);
+    case BinaryOpType::div:
+    case BinaryOpType::max:
+    case BinaryOpType::min:
+      return is_real(dt);
+    default:
+      return false;
+  }
+}
+
+// Packs the isomorphic BinaryOpStmts of a block into vector operations.
+//
+// The statements of a pack have the same operation and type, and the same
+// depth in the dependence graph of the block, so none of them depends on
+// another. The vector operation is inserted after the last of them, so none
+// of them may be used before that. The lanes of a pack follow the program
+// order, which lines up the operands of chained packs.
+class SLPVectorizer {
+ public:
+  SLPVectorizer(Block *block, int simd_width)
+      : block_(block), simd_width_(simd_width) {
+  }
+
+  // Returns the number of statements that were vectorized.
+  int run() {
+    analyze();
+    form_packs();
+    if (packs_.empty()) {
+      return 0;
+    }
+    match_operands();
+    select_profitable_packs();
+    return vectorize();
+  }
+
+ private:
+  struct Pack {
+    std::vector<BinaryOpStmt *> lanes;
+    // The position of the last lane, where the vector operation goes
+    int anchor{0};
+    // The packs whose lanes are the operands in the same order, or -1
+    int lhs_pack{-1};
+    int rhs_pack{-1};
+    bool selected{false};
+  };
+
+  void analyze() {
+    for (int i = 0; i < (int)block_->statements.size(); i++) {
+      auto *stmt = block_->statements[i].get();
+      position_[stmt] = i;
+      int depth = 0;
+      for (auto *op : stmt->get_operands()) {
+        auto it = depth_.find(op);
+        if (op && it != depth_.end()) {
+          depth = std::max(depth, it->second + 1);
+        }
+      }
+      depth_[stmt] = depth;
+
+      std::vector<Stmt *> subtree{stmt};
+      if (stmt->is_container_statement()) {
+        auto inner = irpass::analysis::gather_statements(
+            stmt, [](Stmt *) { return true; });
+        subtree.insert(subtree.end(), inner.begin(), inner.end());
+      }
+      for (auto *user : subtree) {
+        for (auto *op : user->get_operands()) {
+          if (op && position_.count(op)) {
+            users_[op].push_back(user);
+            first_use_.emplace(op, i);
+          }
+        }
+      }
+    }
+  }
+
+  int first_use(Stmt *stmt) const {
+    auto it = first_use_.find(stmt);
+    return it == first_use_.end() ? INT_MAX : it->second;
+  }
+
+  void form_packs() {
+    std::map<std::tuple<int, const Type *, int>, std::vector<BinaryOpStmt *>>
+        groups;
+    for (auto &s : block_->statements) {
+      auto *stmt = s->cast<BinaryOpStmt>();
+      if (stmt && is_vectorizable(stmt)) {
+        const Type *dt = stmt->ret_type;
+        groups[{(int)stmt->op_type, dt, depth_[stmt]}].push_back(stmt);
+      }
+    }
+    for (auto &group : groups) {
+      auto dt = group.second[0]->ret_type;
+      const int max_lanes = std::max(2, simd_width_ * 32 / data_type_bits(dt));
+      std::vector<BinaryOpStmt *> lanes;
+      int min_first_use = INT_MAX;
+      for (auto *stmt : group.second) {
+        if (!lanes.empty() && ((int)lanes.size() == max_lanes ||
+                               min_first_use <= position_[stmt])) {
+          add_pack(std::move(lanes));
+          lanes.clear();
+          min_first_use = INT_MAX;
+        }
+        lanes.push_back(stmt);
+        min_first_use = std::min(min_first_use, first_use(stmt));
+      }
+      add_pack(std::move(lanes));
+    }
+    std::sort(packs_.begin(), packs_.end(),
+              [](const Pack &a, const Pack &b) { return a.anchor < b.anchor; });
+  }
+
+  void add_pack(std::vector<BinaryOpStmt *> &&lanes) {
+    if (lanes.size() < 2) {
+      return;
+    }
+    Pack pack;
+    pack.anchor = position_[lanes.back()];
+    pack.lanes = std::move(lanes);
+    packs_.push_back(std::move(pack));
+  }
+
+  void match_operands() {
+    std::map<std::vector<Stmt *>, int> pack_by_lanes;
+    for (int i = 0; i < (int)packs_.size(); i++) {
+      auto &pack = packs_[i];
+      pack.lhs_pack = find(pack_by_lanes, lhs_of(pack));
+      pack.rhs_pack = find(pack_by_lanes, rhs_of(pack));
+      pack_by_lanes[lanes_of(pack)] = i;
+      for (auto *lane : pack.lanes) {
+        pack_of_[lane] = i;
+      }
+    }
+  }
+
+  static int find(const std::map<std::vector<Stmt *>, int> &packs,
+                  const std::vector<Stmt *> &lanes) {
+    auto it = packs.find(lanes);
+    return it == packs.end() ? -1 : it->second;
+  }
+
+  static std::vector<Stmt *> lanes_of(const Pack &pack) {
+    return std::vector<Stmt *>(pack.lanes.begin(), pack.lanes.end());
+  }
+
+  static std::vector<Stmt *> lhs_of(const Pack &pack) {
+    std::vector<Stmt *> ret;
+    for (auto *lane : pack.lanes) {
+      ret.push_back(lane->lhs);
+    }
+    return ret;
+  }
+
+  static std::vector<Stmt *> rhs_of(const Pack &pack) {
+    std::vector<Stmt *> ret;
+    for (auto *lane : pack.lanes) {
+      ret.push_back(lane->rhs);
+    }
+    return ret;
+  }
+
+  // The instructions it takes to build a vector out of |values|
+  static int gather_cost(const std::vector<Stmt *> &values) {
+    if (std::all_of(values.begin(), values.end(),
+                    [](Stmt *v) { return v->is<ConstStmt>(); })) {
+      return 0;
+    }
+    if (std::all_of(values.begin(), values.end(),
+                    [&](Stmt *v) { return v == values[0]; })) {
+      return 1;
+    }
+    return (int)values.size();
+  }
+
+  // Packs are selected by connected components of the operand matches: the
+  // gathers at the start of a chain and the extracts at its end are only
+  // worth it if the chain is long enough.
+  void select_profitable_packs() {
+    std::vector<int> component(packs_.size());
+    std::iota(component.begin(), component.end(), 0);
+    std::function<int(int)> root = [&](int i) {
+      return component[i] == i ? i : component[i] = root(component[i]);
+    };
+    for (int i = 0; i < (int)packs_.size(); i++) {
+      for (int j : {packs_[i].lhs_pack, packs_[i].rhs_pack}) {
+        if (j >= 0) {
+          component[root(i)] = root(j);
+        }
+      }
+    }
+
+    std::unordered_map<int, int> scalar_cost, vector_cost;
+    std::map<std::vector<Stmt *>, int> gathered;
+    for (int i = 0; i < (int)packs_.size(); i++) {
+      const auto &pack = packs_[i];
+      const int c = root(i);
+      scalar_cost[c] += (int)pack.lanes.size();
+      int cost = 1;
+      for (auto [matched, values] :
+           {std::make_pair(pack.lhs_pack, lhs_of(pack)),
+            std::make_pair(pack.rhs_pack, rhs_of(pack))}) {
+        // Identical gathers are only built once.
+        if (matched < 0 && gathered.emplace(values, c).second) {
+          cost += gather_cost(values);
+        }
+      }
+      for (auto *lane : pack.lanes) {
+        for (auto *user : users_[lane]) {
+          if (!uses_as_vector(user, i)) {
+            cost++;
+            break;
+          }
+        }
+      }
+      vector_cost[c] += cost;
+    }
+    for (int i = 0; i < (int)packs_.size(); i++) {
+      const int c = root(i);
+      packs_[i].selected = vector_cost[c] < scalar_cost[c];
+    }
+  }
+
+  // Whether |user| is a lane of a pack that takes pack |i| as an operand.
+  bool uses_as_vector(Stmt *user, int i) const {
+    auto it = pack_of_.find(user);
+    if (it == pack_of_.end()) {
+      return false;
+    }
+    const auto &pack = packs_[it->second];
+    return pack.lhs_pack == i || pack.rhs_pack == i;
+  }
+
+  int vectorize() {
+    DelayedIRModifier modifier;
+    // The vector operation of each selected pack
+    std::unordered_map<int, Stmt *> vector_of;
+    std::unordered_map<Stmt *, Stmt *> extracted;
+    std::map<std::vector<Stmt *>, Stmt *> gathered;
+    int num_vectorized = 0;
+    for (int i = 0; i < (int)packs_.size(); i++) {
+      const auto &pack = packs_[i];
+      if (!pack.selected) {
+        continue;
+      }
+      VecStatement new_stmts;
+      auto operand = [&](int matched, std::vector<Stmt *> values) -> Stmt * {
+        if (matched >= 0 && vector_of.count(matched)) {
+          return vector_of[matched];
+        }
+        for (auto &v : values) {
+          auto it = extracted.find(v);
+          if (it != extracted.end()) {
+            v = it->second;
+          }
+        }
+        auto it = gathered.find(values);
+        if (it != gathered.end()) {
+          return it->second;
+        }
+        auto *gather = new_stmts.push_back<VectorPackStmt>(values);
+        gathered[values] = gather;
+        return gather;
+      };
+      auto *lhs = operand(pack.lhs_pack, lhs_of(pack));
+      auto *rhs = operand(pack.rhs_pack, rhs_of(pack));
+      auto *vec = new_stmts.push_back<BinaryOpStmt>(pack.lanes[0]->op_type,
+                                                    lhs, rhs);
+      vec->ret_type = lhs->ret_type;
+      vector_of[i] = vec;
+      for (int j = 0; j < (int)pack.lanes.size(); j++) {
+        extracted[pack.lanes[j]] =
+            new_stmts.push_back<VectorExtractStmt>(vec, j);
+      }
+      modifier.insert_after(pack.lanes.back(), std::move(new_stmts));
+      num_vectorized += (int)pack.lanes.size();
+    }
+    if (num_vectorized == 0) {
+      return 0;
+    }
+    modifier.modify_ir();
+
+    for (auto &[lane, extract] : extracted) {
+      for (auto *user : users_[lane]) {
+        user->replace_operand_with(lane, extract);
+      }
+      modifier.erase(lane);
+    }
+    modifier.modify_ir();
+    return num_vectorized;
+  }
+
+  Block *block_;
+  int simd_width_;
+  std::unordered_map<Stmt *, int> position_;
+  // The length of the longest chain of operands within the block
+  std::unordered_map<Stmt *, int> depth_;
+  // The position of the first statement of the block that uses a statement,
+  // or contains a statement that does
+  std::unordered_map<Stmt *, int> first_use_;
+  std::unordered_map<Stmt *, std::vector<Stmt *>> users_;
+  std::vector<Pack> packs_;
+  std::unordered_map<Stmt *, int> pack_of_;
+};
+
+class SLPVectorize : public BasicStmtVisitor {
+ public:
+  using BasicStmtVisitor::visit;
+
+  explicit SLPVectorize(const CompileConfig &config) : config_(config) {
+  }
+
+  void visit(Block *block) override {
+    // Inner blocks first, so that the uses in them are final.
+    BasicStmtVisitor::visit(block);
+    num_vectorized += SLPVectorizer(block, config_.simd_width).run();
+  }
+
+  int num_vectorized{0};
+
+ private:
+  const CompileConfig &config_;
+};
+
+}  // namespace
+
+namespace irpass {
+
+bool slp_vectorize(IRNode *root, const CompileConfig &config) {
+  TI_AUTO_PROF;
+  SLPVectorize pass(config);
+  root->accept(&pass);
+  if (pass.num_vectorized == 0) {
+    return false;
+  }
+  stat.add("slp_vectorized_statements", pass.num_vectorized);
+  // The extracts of the lanes that are only used as vectors
+  die(root);
+  return true;
+}
+
+}  // namespace irpass
+
+TLANG_NAMESPACE_END
@@ -0,0 +1,54 @@
+#include "taichi/ir/ir.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/ir/visitors.h"
+#include "taichi/system/profiler.h"
+
+TLANG_NAMESPACE_BEGIN
+
+namespace {
+
+// Replace the loads of the specialized scalar arguments with their values.
+
+class SpecializeArgs : public BasicStmtVisitor {
+ public:
+  using BasicStmtVisitor::visit;
+  const std::unordered_map<int, TypedConstant> &values;
+  DelayedIRModifier modifier;
+
+  explicit SpecializeArgs(const std::unordered_map<int, TypedConstant> &values)
+      : values(values) {
+  }
+
+  void visit(ArgLoadStmt *stmt) override {
+    if (stmt->is_ptr)
+      return;
+    auto it = values.find(stmt->arg_id);
+    if (it == values.end())
+      return;
+    TI_ASSERT(it->second.dt == stmt->ret_type);
+    modifier.replace_with(stmt, Stmt::make<ConstStmt>(
+                                    LaneAttribute<TypedConstant>(it->second)));
+  }
+
+  static bool run(IRNode *node,
+                  const std::unordered_map<int, TypedConstant> &values) {
+    SpecializeArgs pass(values);
+    node->accept(&pass);
+    return pass.modifier.modify_ir();
+  }
+};
+
+}  // namespace
+
+namespace irpass {
+
+bool specialize_args(IRNode *root,
+                     const std::unordered_map<int, TypedConstant> &values) {
+  TI_AUTO_PROF;
+  return SpecializeArgs::run(root, values);
+}
+
+}  // namespace irpass
+
+TLANG_NAMESPACE_END
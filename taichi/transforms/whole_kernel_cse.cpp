@@ -46,8 +46,8 @@ class MarkUndone : public BasicStmtVisitor {
 class WholeKernelCSE : public BasicStmtVisitor {
  private:
   std::unordered_set<int> visited_;
-  // each scope corresponds to an unordered_set
-  std::vector<std::unordered_map<std::type_index, std::unordered_set<Stmt *>>>
+  // each scope corresponds to an unordered_set, bucketed by cse_hash()
+  std::vector<std::unordered_map<std::size_t, std::unordered_set<Stmt *>>>
       visible_stmts_;
   DelayedIRModifier modifier_;
 
@@ -67,6 +67,22 @@ class WholeKernelCSE : public BasicStmtVisitor {
     visited_.insert(stmt->instance_id);
   }
 
+  static std::size_t cse_hash(Stmt *stmt) {
+    // Statements that may be eliminable have the same hash.
+    auto ret = std::type_index(typeid(*stmt)).hash_code();
+    if (stmt->is<GlobalPtrStmt>() || stmt->is<LoopUniqueStmt>()) {
+      // Not compared by their fields, see common_statement_eliminable().
+      return ret;
+    }
+    // Same as same_statements() without an id_map
+    ret = hash_combine(ret, stmt->field_manager.hash());
+    for (int i = 0; i < stmt->num_operands(); i++) {
+      auto *operand = stmt->operand(i);
+      ret = hash_combine(ret, operand ? operand->id : -1);
+    }
+    return ret;
+  }
+
   static bool common_statement_eliminable(Stmt *this_stmt, Stmt *prev_stmt) {
     // Is this_stmt eliminable given that prev_stmt appears before it and has
     // the same type with it?
@@ -96,12 +112,17 @@ class WholeKernelCSE : public BasicStmtVisitor {
     if (!stmt->common_statement_eliminable())
       return;
     // Generic visitor for all CSE-able statements.
+    auto hash = cse_hash(stmt);
     if (is_done(stmt)) {
-      visible_stmts_.back()[std::type_index(typeid(*stmt))].insert(stmt);
+      visible_stmts_.back()[hash].insert(stmt);
       return;
     }
     for (auto &scope : visible_stmts_) {
-      for (auto &prev_stmt : scope[std::type_index(typeid(*stmt))]) {
+      auto it = scope.find(hash);
+      if (it == scope.end()) {
+        continue;
+      }
+      for (auto &prev_stmt : it->second) {
         if (common_statement_eliminable(stmt, prev_stmt)) {
           MarkUndone::run(&visited_, stmt);
           stmt->replace_usages_with(prev_stmt);
@@ -110,7 +131,7 @@ class WholeKernelCSE : public BasicStmtVisitor {
         }
       }
     }
-    visible_stmts_.back()[std::type_index(typeid(*stmt))].insert(stmt);
+    visible_stmts_.back()[hash].insert(stmt);
     set_done(stmt);
   }
 
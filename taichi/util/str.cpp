@@ -34,6 +34,35 @@ std::string c_quoted(std::string const &str) {
   return ss.str();
 }
 
+std::string json_quoted(std::string const &str) {
+  std::stringstream ss;
+  ss << '"';
+  for (auto const &c : str) {
+    switch (c) {
+#define REG_ESC(x, y) \
+  case x:             \
+    ss << "\\" y;     \
+    break;
+      REG_ESC('\n', "n");
+      REG_ESC('\r', "r");
+      REG_ESC('\b', "b");
+      REG_ESC('\t', "t");
+      REG_ESC('\f', "f");
+      REG_ESC('\"', "\"");
+      REG_ESC('\\', "\\");
+      default:
+        if ((unsigned char)c < 0x20) {
+          ss << fmt::format("\\u{:04x}", (int)c);
+        } else {
+          ss << c;
+        }
+    }
+  }
+#undef REG_ESC
+  ss << '"';
+  return ss.str();
+}
+
 std::string format_error_message(const std::string &error_message_template,
                                  const std::function<uint64(int)> &fetcher) {
   std::string error_message_formatted;
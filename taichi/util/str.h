@@ -12,6 +12,9 @@ TLANG_NAMESPACE_BEGIN
 // Quote |str| with a pair of ". Escape special characters like \n, \t etc.
 std::string c_quoted(std::string const &str);
 
+// Quote |str| as a JSON string.
+std::string json_quoted(std::string const &str);
+
 std::string format_error_message(const std::string &error_message_template,
                                  const std::function<uint64(int)> &fetcher);
 
@@ -0,0 +1,129 @@
+#include "gtest/gtest.h"
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/system/timer.h"
+#include "taichi/util/testing.h"
+
+namespace taichi {
+namespace lang {
+
+namespace {
+// Appends |n| chains of arithmetic on global temporaries to |block|.
+void build_large_block(Block *block, int n, int constant) {
+  for (int i = 0; i < n; i++) {
+    auto load_addr = block->push_back<GlobalTemporaryStmt>(
+        i * 4, TypeFactory::create_vector_or_scalar_type(1, PrimitiveType::i32));
+    auto load = block->push_back<GlobalLoadStmt>(load_addr);
+    auto c = block->push_back<ConstStmt>(TypedConstant(constant));
+    auto if_stmt = block->push_back<IfStmt>(load)->as<IfStmt>();
+    auto true_clause = std::make_unique<Block>();
+    auto add =
+        true_clause->push_back<BinaryOpStmt>(BinaryOpType::add, load, c);
+    true_clause->push_back<GlobalStoreStmt>(load_addr, add);
+    if_stmt->set_true_statements(std::move(true_clause));
+  }
+}
+}  // namespace
+
+TEST(HashIR, TestSameStructure) {
+  auto a = std::make_unique<Block>();
+  build_large_block(a.get(), 3, 1);
+  auto b = std::make_unique<Block>();
+  build_large_block(b.get(), 3, 1);
+  irpass::type_check(a.get(), CompileConfig());
+  irpass::type_check(b.get(), CompileConfig());
+
+  // The ids differ, but the structures are the same.
+  irpass::re_id(a.get());
+  EXPECT_EQ(irpass::analysis::hash_ir(a.get()),
+            irpass::analysis::hash_ir(b.get()));
+
+  auto cloned = irpass::analysis::clone(a.get());
+  EXPECT_EQ(irpass::analysis::hash_ir(a.get()),
+            irpass::analysis::hash_ir(cloned.get()));
+}
+
+TEST(HashIR, TestDifferentStructure) {
+  auto base = std::make_unique<Block>();
+  build_large_block(base.get(), 3, 1);
+  irpass::type_check(base.get(), CompileConfig());
+  auto hash = irpass::analysis::hash_ir(base.get());
+
+  // A different field
+  auto other_constant = std::make_unique<Block>();
+  build_large_block(other_constant.get(), 3, 2);
+  irpass::type_check(other_constant.get(), CompileConfig());
+  EXPECT_NE(hash, irpass::analysis::hash_ir(other_constant.get()));
+
+  // A different operand
+  auto other_operand = irpass::analysis::clone(base.get());
+  auto *block = other_operand->as<Block>();
+  auto *add = block->statements[3]
+                  ->as<IfStmt>()
+                  ->true_statements->statements[0]
+                  ->as<BinaryOpStmt>();
+  add->rhs = add->lhs;
+  EXPECT_NE(hash, irpass::analysis::hash_ir(other_operand.get()));
+
+  // The same statements, nested differently
+  auto moved = irpass::analysis::clone(base.get());
+  auto *if_stmt = moved->as<Block>()->statements[3]->as<IfStmt>();
+  if_stmt->set_false_statements(std::move(if_stmt->true_statements));
+  EXPECT_NE(hash, irpass::analysis::hash_ir(moved.get()));
+}
+
+TEST(HashIR, TestLargeIR) {
+  auto block = std::make_unique<Block>();
+  build_large_block(block.get(), 10000, 1);
+  irpass::type_check(block.get(), CompileConfig());
+  auto hash = irpass::analysis::hash_ir(block.get());
+
+  irpass::re_id(block.get());
+  EXPECT_EQ(hash, irpass::analysis::hash_ir(block.get()));
+  auto cloned = irpass::analysis::clone(block.get());
+  EXPECT_EQ(hash, irpass::analysis::hash_ir(cloned.get()));
+
+  // A single different constant among 60k statements
+  auto *last_if = cloned->as<Block>()->statements.back()->as<IfStmt>();
+  auto *add = last_if->true_statements->statements[0]->as<BinaryOpStmt>();
+  add->rhs->as<ConstStmt>()->val[0] = TypedConstant(2);
+  EXPECT_NE(hash, irpass::analysis::hash_ir(cloned.get()));
+}
+
+TEST(HashIR, BenchmarkLargeIR) {
+  auto block = std::make_unique<Block>();
+  build_large_block(block.get(), 10000, 1);
+  irpass::type_check(block.get(), CompileConfig());
+  constexpr int kRepeats = 10;
+
+  const auto expected_hash = irpass::analysis::hash_ir(block.get());
+  bool same_hash = true;
+  auto t = Time::get_time();
+  for (int i = 0; i < kRepeats; i++) {
+    same_hash &= irpass::analysis::hash_ir(block.get()) == expected_hash;
+  }
+  auto hash_time = (Time::get_time() - t) / kRepeats;
+
+  // What hashing used to cost: a clone with fresh ids, printed
+  std::size_t printed_size = 0;
+  t = Time::get_time();
+  for (int i = 0; i < kRepeats; i++) {
+    auto copy = block->clone();
+    irpass::re_id(copy.get());
+    std::string printed;
+    irpass::print(copy.get(), &printed);
+    printed_size += printed.size();
+  }
+  auto print_time = (Time::get_time() - t) / kRepeats;
+
+  TI_INFO("Hashing {} statements: {:.2f} ms, printing them: {:.2f} ms",
+          irpass::analysis::count_statements(block.get()), hash_time * 1000,
+          print_time * 1000);
+  EXPECT_TRUE(same_hash);
+  EXPECT_GT(printed_size, 0u);
+}
+
+}  // namespace lang
+}  // namespace taichi
@@ -47,10 +47,12 @@ TEST(StmtFieldManager, TestStmtFieldManager) {
   auto b = Stmt::make<TestStmt>(nullptr, 1, 2.0f);
 
   EXPECT_EQ(a->field_manager.equal(b->field_manager), true);
+  EXPECT_EQ(a->field_manager.hash(), b->field_manager.hash());
 
   auto c = Stmt::make<TestStmt>(nullptr, 2, 2.1f);
 
   EXPECT_EQ(a->field_manager.equal(c->field_manager), false);
+  EXPECT_NE(a->field_manager.hash(), c->field_manager.hash());
   // To test two statements are equal: 1) same Stmt type 2) same operands 3)
   // same field_manager
 }
@@ -0,0 +1,122 @@
+#include "gtest/gtest.h"
+
+#include "taichi/system/memory_pool.h"
+#ifdef TI_WITH_LLVM
+#include "taichi/backends/cpu/cpu_device.h"
+#endif
+
+namespace taichi {
+namespace lang {
+
+#ifdef TI_WITH_LLVM
+
+TEST(MemoryPool, SmallBlocksAreReusedZeroed) {
+  cpu::CpuDevice device;
+  MemoryPool pool(Arch::x64, &device);
+  auto a = (uint8 *)pool.allocate(100, 8);
+  a[0] = 1;
+  a[99] = 2;
+  pool.release(a, 100, 8);
+  // Same size class
+  auto b = (uint8 *)pool.allocate(120, 16);
+  EXPECT_EQ(a, b);
+  EXPECT_EQ(b[0], 0);
+  EXPECT_EQ(b[99], 0);
+
+  auto c = pool.allocate(8, MemoryPool::page_size);
+  EXPECT_EQ((std::size_t)c % MemoryPool::page_size, 0u);
+  pool.release(b, 120, 16);
+  pool.release(c, 8, MemoryPool::page_size);
+
+  auto stats = pool.get_stats();
+  EXPECT_EQ(stats.used_bytes, 0u);
+  EXPECT_EQ(stats.num_allocations, 3u);
+  EXPECT_EQ(stats.num_releases, 3u);
+}
+
+TEST(MemoryPool, LargeBlocksAreCachedCommitted) {
+  cpu::CpuDevice device;
+  MemoryPool pool(Arch::x64, &device);
+  constexpr std::size_t size = 4 << 20;
+  auto a = (uint8 *)pool.allocate(size, MemoryPool::page_size);
+  std::memset(a, 1, size);
+  pool.release(a, size, MemoryPool::page_size);
+
+  auto stats = pool.get_stats();
+  EXPECT_EQ(stats.committed_cache_bytes, size);
+  EXPECT_EQ(stats.decommitted_bytes, 0u);
+
+  // A smaller request takes the front of the cached block, zero-filled
+  auto b = (uint8 *)pool.allocate(size / 2 + 1, MemoryPool::page_size);
+  EXPECT_EQ(b, a);
+  for (std::size_t i = 0; i < size / 2 + 1; i++) {
+    ASSERT_EQ(b[i], 0);
+  }
+  auto c = (uint8 *)pool.allocate(size / 4, MemoryPool::page_size);
+  EXPECT_EQ(c, a + size / 2 + MemoryPool::page_size);
+  pool.release(b, size / 2 + 1, MemoryPool::page_size);
+  pool.release(c, size / 4, MemoryPool::page_size);
+
+  stats = pool.get_stats();
+  EXPECT_EQ(stats.used_bytes, 0u);
+  EXPECT_EQ(stats.committed_cache_bytes, size);
+  EXPECT_EQ(stats.decommitted_bytes, 0u);
+}
+
+TEST(MemoryPool, LargeBlocksAreCoalescedAndDecommitted) {
+  cpu::CpuDevice device;
+  MemoryPool pool(Arch::x64, &device);
+  // Too large to be kept committed
+  constexpr std::size_t size =
+      MemoryPool::max_committed_cache_bytes + MemoryPool::page_size;
+  auto a = (uint8 *)pool.allocate(size, MemoryPool::page_size);
+  auto b = (uint8 *)pool.allocate(size, MemoryPool::page_size);
+  std::memset(a, 1, size);
+  std::memset(b, 1, size);
+  pool.release(a, size, MemoryPool::page_size);
+  pool.release(b, size, MemoryPool::page_size);
+
+  auto stats = pool.get_stats();
+  EXPECT_EQ(stats.used_bytes, 0u);
+  EXPECT_EQ(stats.peak_used_bytes, 2 * size);
+  EXPECT_EQ(stats.decommitted_bytes, 2 * size);
+
+  // The two neighbouring blocks are merged, so a request spanning both is
+  // served without growing the pool.
+  auto c = (uint8 *)pool.allocate(2 * size, MemoryPool::page_size);
+  EXPECT_EQ(c, std::min(a, b));
+  for (std::size_t i = 0; i < 2 * size; i += MemoryPool::page_size) {
+    ASSERT_EQ(c[i], 0);
+  }
+  EXPECT_EQ(pool.get_stats().num_arenas, 1u);
+  pool.release(c, 2 * size, MemoryPool::page_size);
+}
+
+TEST(MemoryPool, ConcurrentAllocateRelease) {
+  cpu::CpuDevice device;
+  MemoryPool pool(Arch::x64, &device);
+  std::vector<std::thread> threads;
+  std::atomic<std::size_t> errors{0};
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 10000; i++) {
+        auto p = (uint64 *)pool.allocate(64, 8);
+        if (*p != 0) {
+          errors++;
+        }
+        *p = 1;
+        pool.release(p, 64, 8);
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(errors.load(), 0u);
+  EXPECT_EQ(pool.get_stats().used_bytes, 0u);
+}
+
+#endif
+
+}  // namespace lang
+}  // namespace taichi
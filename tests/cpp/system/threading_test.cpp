@@ -0,0 +1,55 @@
+#include "gtest/gtest.h"
+
+#include "taichi/system/threading.h"
+
+namespace taichi {
+
+namespace {
+
+struct Counters {
+  std::vector<std::atomic<int>> hits;
+  std::atomic<int> max_thread_id{0};
+
+  explicit Counters(int n) : hits(n) {
+  }
+};
+
+void count_task(void *context, int thread_id, int i) {
+  auto counters = (Counters *)context;
+  counters->hits[i]++;
+  int prev = counters->max_thread_id.load();
+  while (prev < thread_id &&
+         !counters->max_thread_id.compare_exchange_weak(prev, thread_id)) {
+  }
+}
+
+}  // namespace
+
+TEST(WorkStealingThreadPool, EveryTaskRunsOnce) {
+  WorkStealingThreadPool pool(8, /*spin_count=*/16, /*numa_aware=*/false);
+  for (int splits : {0, 1, 2, 7, 100, 12345}) {
+    for (int num_threads : {1, 3, 8, 16}) {
+      Counters counters(splits);
+      pool.run(splits, num_threads, &counters, count_task);
+      for (int i = 0; i < splits; i++) {
+        EXPECT_EQ(counters.hits[i].load(), 1);
+      }
+      EXPECT_LT(counters.max_thread_id.load(), std::min(num_threads, 8));
+    }
+  }
+}
+
+TEST(WorkStealingThreadPool, BackToBackLaunches) {
+  // No spinning, so that workers park between launches.
+  WorkStealingThreadPool pool(4, /*spin_count=*/0, /*numa_aware=*/true);
+  constexpr int kSplits = 64;
+  for (int launch = 0; launch < 1000; launch++) {
+    Counters counters(kSplits);
+    pool.run(kSplits, 4, &counters, count_task);
+    for (int i = 0; i < kSplits; i++) {
+      ASSERT_EQ(counters.hits[i].load(), 1);
+    }
+  }
+}
+
+}  // namespace taichi
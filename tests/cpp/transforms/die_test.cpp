@@ -0,0 +1,42 @@
+#include "gtest/gtest.h"
+
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+
+namespace taichi {
+namespace lang {
+
+TEST(DIE, EliminatesDeadChainsInOneRun) {
+  auto block = std::make_unique<Block>();
+
+  auto *one = block->push_back<ConstStmt>(TypedConstant(1));
+  Stmt *live = one;
+  for (int i = 0; i < 50; i++) {
+    live = block->push_back<BinaryOpStmt>(BinaryOpType::add, live, one);
+  }
+  auto *addr = block->push_back<GlobalTemporaryStmt>(
+      0, TypeFactory::create_vector_or_scalar_type(1, PrimitiveType::i32));
+  block->push_back<GlobalStoreStmt>(addr, live);
+  // Only used by each other
+  Stmt *dead = live;
+  for (int i = 0; i < 50; i++) {
+    dead = block->push_back<BinaryOpStmt>(BinaryOpType::mul, dead, one);
+  }
+  EXPECT_EQ(block->size(), 103);
+
+  EXPECT_TRUE(irpass::die(block.get()));
+  // The constant, the live chain, the address and the store
+  EXPECT_EQ(block->size(), 53);
+  EXPECT_EQ(block->back()->as<GlobalStoreStmt>()->val, live);
+  for (int i = 1; i <= 50; i++) {
+    auto *add = (*block)[i]->as<BinaryOpStmt>();
+    EXPECT_EQ(add->op_type, BinaryOpType::add);
+    EXPECT_EQ(add->rhs, one);
+  }
+
+  EXPECT_FALSE(irpass::die(block.get()));
+  EXPECT_EQ(block->size(), 53);
+}
+
+}  // namespace lang
+}  // namespace taichi
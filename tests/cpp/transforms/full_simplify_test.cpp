@@ -0,0 +1,224 @@
+#include "gtest/gtest.h"
+
+#include <functional>
+#include <unordered_set>
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/ir_builder.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/ir/visitors.h"
+#include "tests/cpp/program/test_program.h"
+
+namespace taichi {
+namespace lang {
+
+namespace {
+
+// Dead instruction elimination as it was before it followed operands with a
+// worklist: traverse the IR again after every round of erasures.
+class ReferenceDIE : public BasicStmtVisitor {
+ public:
+  using BasicStmtVisitor::visit;
+
+  static bool run(IRNode *root) {
+    bool modified = false;
+    while (true) {
+      ReferenceDIE die;
+      root->accept(&die);
+      die.phase_ = 1;
+      root->accept(&die);
+      if (!die.modifier_.modify_ir()) {
+        return modified;
+      }
+      modified = true;
+    }
+  }
+
+  void preprocess_container_stmt(Stmt *stmt) override {
+    if (phase_ == 0) {
+      register_usage(stmt);
+    }
+  }
+
+  void visit(Stmt *stmt) override {
+    if (phase_ == 0) {
+      register_usage(stmt);
+    } else if (stmt->dead_instruction_eliminable() &&
+               used_.count(stmt->instance_id) == 0) {
+      modifier_.erase(stmt);
+    }
+  }
+
+ private:
+  ReferenceDIE() {
+    allow_undefined_visitor = true;
+    invoke_default_visitor = true;
+  }
+
+  void register_usage(Stmt *stmt) {
+    for (auto *op : stmt->get_operands()) {
+      if (op) {
+        used_.insert(op->instance_id);
+      }
+    }
+  }
+
+  int phase_{0};  // 0: mark usage 1: eliminate
+  std::unordered_set<int> used_;
+  DelayedIRModifier modifier_;
+};
+
+// full_simplify as a plain fixed-point loop that runs every pass in every
+// iteration.
+void reference_full_simplify(IRNode *root,
+                             const CompileConfig &config,
+                             Program *program) {
+  bool first_iteration = true;
+  while (true) {
+    bool modified = false;
+    modified |= irpass::extract_constant(root, config);
+    modified |= irpass::unreachable_code_elimination(root);
+    modified |= irpass::binary_op_simplify(root, config);
+    if (config.constant_folding) {
+      modified |= irpass::constant_fold(root, config, {program});
+    }
+    modified |= ReferenceDIE::run(root);
+    modified |= irpass::alg_simp(root, config);
+    modified |= irpass::loop_invariant_code_motion(root, config);
+    modified |= ReferenceDIE::run(root);
+    modified |= irpass::simplify(root, config);
+    modified |= ReferenceDIE::run(root);
+    if (config.opt_level > 0) {
+      modified |= irpass::whole_kernel_cse(root);
+    }
+    if (config.opt_level > 0 && (first_iteration || modified) &&
+        config.cfg_optimization) {
+      modified |= irpass::cfg_optimization(root, false);
+    }
+    first_iteration = false;
+    if (!modified) {
+      break;
+    }
+  }
+}
+
+// Arithmetic on an argument, with constants to fold and dead chains
+void build_arithmetic(IRBuilder &builder) {
+  auto *x = builder.create_arg_load(0, PrimitiveType::i32, false);
+  auto *product = builder.create_mul(x, builder.get_int32(32));
+  auto *shifted = builder.create_shl(product, builder.get_int32(3));
+  auto *folded =
+      builder.create_add(builder.get_int32(40), builder.get_int32(2));
+  Stmt *dead = shifted;
+  for (int i = 0; i < 10; i++) {
+    dead = builder.create_mul(dead, folded);
+  }
+  auto *zero = builder.create_sub(x, x);
+  builder.create_return(builder.create_add(shifted, zero));
+}
+
+// A range-for with loop invariants, local variables and an unreachable branch
+void build_loop(IRBuilder &builder) {
+  auto *n = builder.create_arg_load(0, PrimitiveType::i32, false);
+  auto *var = builder.create_local_var(PrimitiveType::i32);
+  builder.create_local_store(var, builder.get_int32(0));
+  auto *loop = builder.create_range_for(builder.get_int32(0), n);
+  {
+    auto _ = builder.get_loop_guard(loop);
+    auto *i = builder.get_loop_index(loop, 0);
+    auto *invariant = builder.create_mul(n, builder.get_int32(3));
+    auto *sum = builder.create_add(builder.create_local_load(var),
+                                   builder.create_add(i, invariant));
+    builder.create_local_store(var, sum);
+    auto *never = builder.create_if(
+        builder.create_cmp_lt(builder.get_int32(1), builder.get_int32(0)));
+    {
+      auto _ = builder.get_if_guard(never, true);
+      builder.create_local_store(var, builder.get_int32(7));
+    }
+  }
+  builder.create_return(builder.create_local_load(var));
+}
+
+// Branches with common subexpressions
+void build_branches(IRBuilder &builder) {
+  auto *x = builder.create_arg_load(0, PrimitiveType::i32, false);
+  auto *y = builder.create_arg_load(1, PrimitiveType::i32, false);
+  auto *var = builder.create_local_var(PrimitiveType::i32);
+  auto *cond = builder.create_cmp_gt(x, y);
+  auto *if_stmt = builder.create_if(cond);
+  {
+    auto _ = builder.get_if_guard(if_stmt, true);
+    auto *a = builder.create_add(x, y);
+    auto *b = builder.create_add(x, y);
+    builder.create_local_store(var, builder.create_mul(a, b));
+  }
+  {
+    auto _ = builder.get_if_guard(if_stmt, false);
+    auto *a = builder.create_sub(x, y);
+    auto *inner = builder.create_if(builder.create_cmp_gt(x, y));
+    {
+      auto _ = builder.get_if_guard(inner, true);
+      builder.create_local_store(var, builder.get_int32(1));
+    }
+    builder.create_local_store(var, builder.create_mul(a, a));
+  }
+  builder.create_return(builder.create_local_load(var));
+}
+
+}  // namespace
+
+class FullSimplifyTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    tp_.setup();
+  }
+
+  // Returns the IR that |build| generates, simplified by full_simplify() or by
+  // the reference fixed-point loop, and printed with fresh ids.
+  std::string simplify(const std::function<void(IRBuilder &)> &build,
+                       bool reference,
+                       uint64 *hash) {
+    IRBuilder builder;
+    build(builder);
+    auto ir = builder.extract_ir();
+    auto kernel = std::make_unique<Kernel>(*tp_.prog(), []() {}, "fake");
+    ir->kernel = kernel.get();
+    const auto &config = tp_.prog()->config;
+    irpass::type_check(ir.get(), config);
+    if (reference) {
+      reference_full_simplify(ir.get(), config, tp_.prog());
+    } else {
+      irpass::full_simplify(ir.get(), config,
+                            {/*after_lower_access=*/false, tp_.prog()});
+    }
+    irpass::re_id(ir.get());
+    *hash = irpass::analysis::hash_ir(ir.get());
+    std::string printed;
+    irpass::print(ir.get(), &printed);
+    return printed;
+  }
+
+  void expect_same_as_reference(
+      const std::function<void(IRBuilder &)> &build) {
+    uint64 hash, reference_hash;
+    auto printed = simplify(build, /*reference=*/false, &hash);
+    auto reference_printed = simplify(build, /*reference=*/true,
+                                      &reference_hash);
+    EXPECT_EQ(printed, reference_printed);
+    EXPECT_EQ(hash, reference_hash);
+  }
+
+  TestProgram tp_;
+};
+
+TEST_F(FullSimplifyTest, SameAsFixedPointLoop) {
+  ASSERT_TRUE(tp_.prog()->config.advanced_optimization);
+  expect_same_as_reference(build_arithmetic);
+  expect_same_as_reference(build_loop);
+  expect_same_as_reference(build_branches);
+}
+
+}  // namespace lang
+}  // namespace taichi
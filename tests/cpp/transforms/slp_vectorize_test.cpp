@@ -0,0 +1,93 @@
+#include "gtest/gtest.h"
+
+#include "taichi/ir/analysis.h"
+#include "taichi/ir/statements.h"
+#include "taichi/ir/transforms.h"
+#include "taichi/program/compile_config.h"
+
+namespace taichi {
+namespace lang {
+
+namespace {
+
+// Builds |x_i = (x_i * a_i + a_i) * a_i + ...| for 4 lanes, and stores the
+// results in global temporaries.
+std::unique_ptr<Block> build_chains(int length, bool store_early) {
+  auto block = std::make_unique<Block>();
+  auto f32 = PrimitiveType::f32;
+  std::vector<Stmt *> args, x;
+  for (int i = 0; i < 4; i++) {
+    args.push_back(block->push_back<ArgLoadStmt>(i, f32));
+  }
+  x = args;
+  for (int k = 0; k < length; k++) {
+    for (int i = 0; i < 4; i++) {
+      x[i] = block->push_back<BinaryOpStmt>(
+          k % 2 ? BinaryOpType::add : BinaryOpType::mul, x[i], args[i]);
+      x[i]->ret_type = f32;
+      if (store_early && k == 0 && i == 0) {
+        auto *addr = block->push_back<GlobalTemporaryStmt>(16, f32);
+        block->push_back<GlobalStoreStmt>(addr, x[i]);
+      }
+    }
+  }
+  for (int i = 0; i < 4; i++) {
+    auto *addr = block->push_back<GlobalTemporaryStmt>(i * 4, f32);
+    block->push_back<GlobalStoreStmt>(addr, x[i]);
+  }
+  return block;
+}
+
+int count_vector_ops(Block *block) {
+  int count = 0;
+  for (auto &stmt : block->statements) {
+    if (stmt->is<BinaryOpStmt>() && stmt->ret_type->is<VectorType>()) {
+      count++;
+    }
+  }
+  return count;
+}
+
+}  // namespace
+
+TEST(SLPVectorize, PacksChains) {
+  auto block = build_chains(/*length=*/6, /*store_early=*/false);
+  CompileConfig config;
+  EXPECT_TRUE(irpass::slp_vectorize(block.get(), config));
+  irpass::analysis::verify(block.get());
+
+  EXPECT_EQ(count_vector_ops(block.get()), 6);
+  // The arguments are packed once, and shared by all the operations.
+  int num_packs = 0;
+  for (auto &stmt : block->statements) {
+    num_packs += stmt->is<VectorPackStmt>();
+  }
+  EXPECT_EQ(num_packs, 1);
+  for (auto &stmt : block->statements) {
+    if (auto *store = stmt->cast<GlobalStoreStmt>()) {
+      EXPECT_TRUE(store->val->is<VectorExtractStmt>());
+    }
+  }
+}
+
+TEST(SLPVectorize, SkipsUnprofitablePacks) {
+  // Packing the arguments and extracting the results costs more than the
+  // two operations save.
+  auto block = build_chains(/*length=*/2, /*store_early=*/false);
+  CompileConfig config;
+  EXPECT_FALSE(irpass::slp_vectorize(block.get(), config));
+  EXPECT_EQ(count_vector_ops(block.get()), 0);
+}
+
+TEST(SLPVectorize, RespectsEarlyUses) {
+  // The first lane of the first multiplication is stored before the others
+  // are computed, so it cannot be packed with them.
+  auto block = build_chains(/*length=*/6, /*store_early=*/true);
+  CompileConfig config;
+  EXPECT_TRUE(irpass::slp_vectorize(block.get(), config));
+  irpass::analysis::verify(block.get());
+  EXPECT_EQ(count_vector_ops(block.get()), 5);
+}
+
+}  // namespace lang
+}  // namespace taichi
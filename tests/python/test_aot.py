@@ -1,3 +1,4 @@
+import ctypes
 import json
 import os
 import sys
@@ -59,6 +60,99 @@ def test_save():
             json.load(json_file)
 
 
+@ti.test(arch=ti.cpu)
+def test_save_cpu():
+    density = ti.field(float, shape=(4, 4))
+
+    @ti.kernel
+    def init():
+        for i, j in density:
+            density[i, j] = 1
+
+    @ti.kernel
+    def foo(n: ti.template()):
+        for i in range(n):
+            density[0, 0] += 1
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        m = ti.aot.Module(ti.cpu)
+        m.add_field('density', density)
+        m.add_kernel(init)
+        with m.add_kernel_template(foo) as kt:
+            kt.instantiate(n=6)
+            kt.instantiate(n=8)
+        m.save(tmpdir, '')
+        with open(os.path.join(tmpdir, 'metadata.json')) as json_file:
+            aot_data = json.load(json_file)['aot_data']
+        lib = ctypes.CDLL(os.path.join(tmpdir, aot_data['library']))
+        # The runtime functions that the loader calls, and the tasks
+        assert hasattr(lib, 'runtime_initialize')
+        tasks = [
+            t for k in aot_data['kernels'].values()
+            for t in k['tasks']
+        ]
+        assert tasks
+        for t in tasks:
+            assert hasattr(lib, t)
+
+
+@ti.test(arch=ti.cpu)
+def test_save_and_load_cpu():
+    density = ti.field(ti.f32, shape=(4, 4))
+
+    @ti.kernel
+    def init():
+        for i, j in density:
+            density[i, j] = i + j
+
+    @ti.kernel
+    def foo(n: ti.template()):
+        for i in range(n):
+            density[0, 0] += 1
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        m = ti.aot.Module(ti.cpu)
+        m.add_field('density', density)
+        m.add_kernel(init)
+        with m.add_kernel_template(foo) as kt:
+            kt.instantiate(n=6)
+            kt.instantiate(n=8)
+        m.save(tmpdir, '')
+        with open(os.path.join(tmpdir, 'metadata.json')) as json_file:
+            aot_data = json.load(json_file)['aot_data']
+
+        # Runs the kernels without the program that compiled them
+        loader = ti.core.CpuAotModuleLoader(tmpdir)
+        loader.launch_kernel('init')
+        tmpl_names = list(aot_data['kernel_tmpls'].keys())
+        assert len(tmpl_names) == 2
+        for name in tmpl_names:
+            assert loader.has_kernel(name)
+            loader.launch_kernel(name)
+
+        stride = loader.get_field_element_stride('density')
+        ptr = loader.get_field_ptr('density')
+        for i in range(4):
+            for j in range(4):
+                value = ctypes.c_float.from_address(ptr + (i * 4 + j) *
+                                                    stride).value
+                expected = 6 + 8 if i == 0 and j == 0 else i + j
+                assert value == expected
+        # The program's own field is untouched
+        assert density[0, 0] == 0
+
+
+@ti.test(arch=ti.cpu)
+def test_nested_dense_field_cpu():
+    x = ti.field(ti.f32)
+    ti.root.dense(ti.i, 4).dense(ti.i, 4).place(x)
+
+    with pytest.raises(RuntimeError,
+                       match="field 'x' is not placed in a dense SNode"):
+        m = ti.aot.Module(ti.cpu)
+        m.add_field('x', x)
+
+
 @ti.test(arch=ti.opengl)
 def test_non_dense_snode():
     n = 8
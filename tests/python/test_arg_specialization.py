@@ -0,0 +1,96 @@
+import taichi as ti
+
+
+def num_specializations():
+    return ti.get_kernel_stats().get_counters().get('arg_specializations', 0)
+
+
+def num_fallbacks():
+    return ti.get_kernel_stats().get_counters().get(
+        'arg_specialization_fallbacks', 0)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda, ti.metal],
+         arg_specialization=True,
+         max_arg_specializations=2)
+def test_arg_specialization():
+    x = ti.field(ti.f32, shape=32)
+
+    @ti.kernel
+    def fill(n: ti.i32, stride: ti.i32, val: ti.f32):
+        for i in range(n):
+            x[i * stride] += val
+
+    ti.get_kernel_stats().clear()
+    fill(8, 2, 1.0)
+    fill(8, 2, 2.0)
+    assert num_specializations() == 1
+    fill(4, 4, 1.0)
+    assert num_specializations() == 2
+    # Beyond the bound, the generic kernel is launched.
+    fill(16, 1, 1.0)
+    fill(8, 2, 1.0)
+    assert num_specializations() == 2
+    assert num_fallbacks() == 1
+
+    expected = [0.0] * 32
+    for n, stride, val in [(8, 2, 1.0), (8, 2, 2.0), (4, 4, 1.0),
+                           (16, 1, 1.0), (8, 2, 1.0)]:
+        for i in range(n):
+            expected[i * stride] += val
+    for i in range(32):
+        assert x[i] == expected[i]
+
+
+@ti.test(arch=[ti.cpu, ti.cuda], arg_specialization=True)
+def test_arg_specialization_return():
+    @ti.kernel
+    def add(a: ti.i32, b: ti.i64) -> ti.i64:
+        return a + b
+
+    assert add(1, 2) == 3
+    assert add(-5, 1 << 40) == (1 << 40) - 5
+
+
+@ti.test(arch=[ti.cpu, ti.cuda, ti.metal], arg_specialization=True)
+def test_arg_specialization_skips_changing_args():
+    x = ti.field(ti.i32, shape=16)
+
+    @ti.kernel
+    def step(n: ti.i32, frame: ti.i32):
+        for i in range(n):
+            x[i] = frame
+
+    ti.get_kernel_stats().clear()
+    for frame in range(10):
+        step(16, frame)
+    # Only n is specialized, so a single variant serves all the frames.
+    assert num_specializations() == 1
+    assert num_fallbacks() == 0
+    for i in range(16):
+        assert x[i] == 9
+
+
+@ti.test(arch=ti.cpu, arg_specialization=True, max_compiled_kernels=8)
+def test_arg_specialization_delete_kernel():
+    x = ti.field(ti.i32, shape=8)
+
+    @ti.kernel
+    def fill(v: ti.i32):
+        for i in x:
+            x[i] = v
+
+    @ti.kernel
+    def inc():
+        for i in x:
+            x[i] += 1
+
+    fill(1)
+    fill(1)
+    assert num_specializations() == 1
+    # The variant is dropped from the compiled kernels with its parent.
+    ti.delete_kernel(fill)
+    for _ in range(10):
+        inc()
+    for i in range(8):
+        assert x[i] == 11
@@ -1,3 +1,5 @@
+import numpy as np
+
 import taichi as ti
 
 
@@ -170,6 +172,66 @@ def test_bls_large_block():
     foo()
 
 
-# TODO: BLS on CPU
+@ti.test(arch=ti.cpu, cpu_max_num_threads=8)
+def test_cpu_gather_2d():
+    stencil = [(0, 0), (0, -1), (0, 1), (1, 0), (-2, 1)]
+    _test_bls_stencil(2, 128, bs=16, stencil=stencil)
+
+
+@ti.test(arch=ti.cpu, cpu_max_num_threads=8)
+def test_cpu_gather_3d_block_dim():
+    stencil = [(-1, -1, -1), (0, 0, 0), (1, 0, 1)]
+    _test_bls_stencil(3, 64, bs=8, stencil=stencil, block_dim=64)
+
+
+@ti.test(arch=ti.cpu, cpu_max_num_threads=8)
+def test_cpu_scatter_2d():
+    stencil = [(0, 0), (0, -1), (0, 1), (1, 0), (2, -1)]
+    _test_bls_stencil(2, 128, bs=16, stencil=stencil, scatter=True)
+
+
+@ti.test(arch=ti.cpu, cpu_max_num_threads=8)
+def test_cpu_bls_with_tls():
+    # The BLS buffer goes after the thread-local sum in the TLS buffer
+    x, y = ti.field(ti.i32), ti.field(ti.i32)
+    total = ti.field(ti.i32, shape=())
+
+    N = 128
+    bs = 16
+
+    ti.root.pointer(ti.ij, N // bs).dense(ti.ij, bs).place(x, y)
+
+    @ti.kernel
+    def populate():
+        for i, j in ti.ndrange((bs, N - bs), (bs, N - bs)):
+            x[i, j] = i * 3 + j
+
+    @ti.kernel
+    def apply():
+        ti.block_local(x)
+        for i, j in x:
+            s = x[i - 1, j] + x[i + 1, j] + x[i, j]
+            y[i, j] = s
+            total[None] += s
+
+    populate()
+    apply()
+
+    xs = x.to_numpy()
+    expected = np.zeros_like(xs)
+    expected[1:-1, :] = xs[:-2, :] + xs[2:, :] + xs[1:-1, :]
+    expected[:bs, :] = expected[-bs:, :] = 0
+    expected[:, :bs] = expected[:, -bs:] = 0
+    np.testing.assert_array_equal(y.to_numpy(), expected)
+    assert total[None] == expected.sum()
+
+
+@ti.test(arch=ti.cpu)
+def test_cpu_bls_too_large():
+    # 36 * 36 * 36 * 4B of BLS do not fit in the TLS buffer of a CPU thread,
+    # so BLS is skipped
+    stencil = [(-4, 0, 0), (0, 0, 0), (0, 4, 4)]
+    _test_bls_stencil(3, 128, bs=32, stencil=stencil)
+
+
 # TODO: BLS boundary out of bound
-# TODO: BLS with TLS
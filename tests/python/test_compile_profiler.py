@@ -0,0 +1,78 @@
+import json
+import os
+import tempfile
+
+import taichi as ti
+
+
+@ti.test(compile_profiler=True)
+def test_compile_profiler():
+    x = ti.field(ti.i32, shape=8)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i * 2 + 1
+
+    fill()
+    records = [
+        r for r in ti.query_compile_profile()
+        if r['kernel_name'].startswith('fill')
+    ]
+    passes = [r['pass_name'] for r in records]
+    assert 'lower_ast' in passes
+    assert 'offload' in passes
+    # Recorded one by one
+    assert 'full_simplify/simplify' in passes
+    assert 'full_simplify/die' in passes
+    for r in records:
+        assert r['time'] >= 0
+        assert r['num_statements_after'] > 0
+    for prev, cur in zip(records, records[1:]):
+        if prev['kernel_name'] == cur['kernel_name']:
+            assert prev['num_statements_after'] == cur['num_statements_before']
+    for r in records:
+        if r['pass_name'].startswith('full_simplify/'):
+            assert r['iteration'] >= 1
+        else:
+            assert r['iteration'] == 0
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        filename = os.path.join(tmpdir, 'compile_profile.json')
+        ti.save_compile_profile(filename)
+        with open(filename) as f:
+            assert len(json.load(f)) == len(ti.query_compile_profile())
+
+    ti.clear_compile_profile()
+    assert ti.query_compile_profile() == []
+
+
+@ti.test()
+def test_compile_profiler_off():
+    @ti.kernel
+    def foo():
+        pass
+
+    foo()
+    assert ti.query_compile_profile() == []
+
+
+@ti.test(compile_profiler=True)
+def test_compile_profiler_save_escapes_names():
+    x = ti.field(ti.i32, shape=8)
+
+    def fill():
+        for i in x:
+            x[i] = i
+
+    fill.__name__ = 'fill_"quoted"_\\back\\slash'
+    ti.kernel(fill)()
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        filename = os.path.join(tmpdir, 'compile_profile.json')
+        ti.save_compile_profile(filename)
+        with open(filename) as f:
+            saved = json.load(f)
+    names = [r['kernel_name'] for r in ti.query_compile_profile()]
+    assert [r['kernel_name'] for r in saved] == names
+    assert any(name.startswith(fill.__name__) for name in names)
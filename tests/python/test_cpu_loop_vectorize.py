@@ -0,0 +1,165 @@
+import numpy as np
+import pytest
+
+import taichi as ti
+
+
+@pytest.mark.parametrize('n', [1, 7, 1000, 4099])
+@ti.test(arch=ti.cpu, cpu_loop_vectorize=True)
+def test_range_for_saxpy(n):
+    x = ti.field(ti.f32, shape=n)
+    y = ti.field(ti.f32, shape=n)
+
+    @ti.kernel
+    def saxpy(a: ti.f32):
+        for i in range(n):
+            y[i] = a * x[i] + y[i]
+
+    x_np = np.random.rand(n).astype(np.float32)
+    y_np = np.random.rand(n).astype(np.float32)
+    x.from_numpy(x_np)
+    y.from_numpy(y_np)
+    saxpy(2.5)
+    np.testing.assert_allclose(y.to_numpy(), 2.5 * x_np + y_np, rtol=1e-6)
+
+
+@ti.test(arch=ti.cpu, cpu_loop_vectorize=True)
+def test_range_for_gather():
+    n = 1023
+    x = ti.field(ti.i32, shape=n)
+    idx = ti.field(ti.i32, shape=n)
+    y = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def gather():
+        for i in range(n):
+            y[i] = x[idx[i]] * 3
+
+    x_np = np.arange(n, dtype=np.int32)
+    idx_np = np.random.permutation(n).astype(np.int32)
+    x.from_numpy(x_np)
+    idx.from_numpy(idx_np)
+    gather()
+    np.testing.assert_array_equal(y.to_numpy(), x_np[idx_np] * 3)
+
+
+@ti.test(arch=ti.cpu, cpu_loop_vectorize=True)
+def test_range_for_continue():
+    n = 100
+    x = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def fill():
+        for i in range(n):
+            if i % 3 == 0:
+                continue
+            x[i] = i
+
+    fill()
+    expected = np.array([0 if i % 3 == 0 else i for i in range(n)])
+    np.testing.assert_array_equal(x.to_numpy(), expected)
+
+
+@ti.test(arch=ti.cpu, cpu_loop_vectorize=True)
+def test_range_for_reduction():
+    n = 10000
+    x = ti.field(ti.i32, shape=n)
+    total = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def reduce():
+        for i in range(n):
+            total[None] += x[i]
+
+    x.from_numpy(np.arange(n, dtype=np.int32))
+    reduce()
+    assert total[None] == n * (n - 1) // 2
+
+
+@ti.test(arch=ti.cpu, cpu_loop_vectorize=True)
+def test_dense_struct_for_non_pot():
+    # The cells beyond the shape are masked out.
+    x = ti.field(ti.f32, shape=(37, 13))
+
+    @ti.kernel
+    def fill():
+        for i, j in x:
+            x[i, j] = i * 100 + j
+
+    fill()
+    i, j = np.meshgrid(np.arange(37), np.arange(13), indexing='ij')
+    np.testing.assert_array_equal(x.to_numpy(), i * 100 + j)
+
+
+@ti.test(arch=ti.cpu, cpu_loop_vectorize=True, cpu_range_for_tasks=True)
+def test_range_for_thread_context():
+    # ti.random() and dynamic appends read the thread id from the context.
+    n = 4096
+    x = ti.field(ti.f32, shape=n)
+    l = ti.field(ti.i32)
+    ti.root.dynamic(ti.i, n, chunk_size=32).place(l)
+    length = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def fill():
+        for i in range(n):
+            x[i] = ti.random()
+            ti.append(l.parent(), [], i)
+
+    @ti.kernel
+    def get_length():
+        length[None] = ti.length(l.parent(), [])
+
+    fill()
+    get_length()
+    x_np = x.to_numpy()
+    assert np.all((x_np >= 0) & (x_np < 1))
+    assert len(np.unique(x_np)) > n // 2
+    assert length[None] == n
+    assert sorted(l[i] for i in range(n)) == list(range(n))
+
+
+def _test_range_for_tasks_random_and_activate():
+    # Both pick per-thread state through the thread id: the random states and
+    # the node allocator magazines.
+    n = 64 * 1024
+    x = ti.field(ti.f32)
+    blk = ti.root.pointer(ti.i, n // 16)
+    blk.dense(ti.i, 16).place(x)
+    num_active = ti.field(ti.i32, shape=())
+
+    @ti.kernel
+    def fill():
+        for i in range(n):
+            if i // 16 % 3 != 1:
+                x[i] = ti.random() + 1
+
+    @ti.kernel
+    def count():
+        for b in range(n // 16):
+            if ti.is_active(blk, [b * 16]):
+                num_active[None] += 1
+
+    fill()
+    count()
+    x_np = x.to_numpy()
+    active = (np.arange(n) // 16 % 3) != 1
+    assert np.all((x_np[active] >= 1) & (x_np[active] < 2))
+    assert np.all(x_np[~active] == 0)
+    assert len(np.unique(x_np[active])) > n // 2
+    assert num_active[None] == np.sum(active) // 16
+
+
+@ti.test(arch=ti.cpu, cpu_range_for_tasks=True)
+def test_range_for_tasks_random_and_activate():
+    _test_range_for_tasks_random_and_activate()
+
+
+@ti.test(arch=ti.cpu, cpu_loop_vectorize=True, cpu_range_for_tasks=True)
+def test_range_for_tasks_random_and_activate_vectorized():
+    _test_range_for_tasks_random_and_activate()
+
+
+@ti.test(arch=ti.cpu, cpu_loop_vectorize=True, cpu_range_for_tasks=False)
+def test_range_for_blocks_random_and_activate():
+    _test_range_for_tasks_random_and_activate()
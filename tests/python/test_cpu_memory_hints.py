@@ -0,0 +1,85 @@
+import numpy as np
+
+import taichi as ti
+
+
+def num_nontemporal_stores():
+    return ti.get_kernel_stats().get_counters().get(
+        'codegen_nontemporal_stores', 0)
+
+
+def num_struct_for_prefetches():
+    return ti.get_kernel_stats().get_counters().get(
+        'codegen_struct_for_prefetches', 0)
+
+
+def _test_write_only_large_field():
+    # Large enough for the stores to bypass the caches
+    n = 1024 * 1024 * 9 + 3
+    x = ti.field(ti.f32, shape=n)
+    total = ti.field(ti.f64, shape=())
+
+    @ti.kernel
+    def fill():
+        for i in range(n):
+            x[i] = i % 7
+
+    @ti.kernel
+    def reduce():
+        for i in x:
+            total[None] += x[i]
+
+    ti.get_kernel_stats().clear()
+    fill()
+    reduce()
+    assert total[None] == np.sum(np.arange(n) % 7)
+
+
+@ti.test(arch=ti.x64,
+         cpu_loop_vectorize=True,
+         cpu_range_for_tasks=True,
+         cpu_nontemporal_store=True)
+def test_write_only_large_field():
+    _test_write_only_large_field()
+    assert num_nontemporal_stores() > 0
+
+
+@ti.test(arch=ti.cpu, cpu_nontemporal_store=False)
+def test_write_only_large_field_no_nontemporal_store():
+    _test_write_only_large_field()
+    assert num_nontemporal_stores() == 0
+
+
+def _test_sparse_struct_for():
+    x = ti.field(ti.i32)
+    ti.root.pointer(ti.ij, 64).dense(ti.ij, 8).place(x)
+
+    @ti.kernel
+    def activate():
+        for i, j in ti.ndrange(512, 512):
+            if (i // 8 + j // 8) % 3 == 0:
+                x[i, j] = 1
+
+    @ti.kernel
+    def increment():
+        for i, j in x:
+            x[i, j] += i + j
+
+    ti.get_kernel_stats().clear()
+    activate()
+    increment()
+    i, j = np.meshgrid(np.arange(512), np.arange(512), indexing='ij')
+    expected = np.where((i // 8 + j // 8) % 3 == 0, 1 + i + j, 0)
+    np.testing.assert_array_equal(x.to_numpy(), expected)
+
+
+@ti.test(arch=ti.cpu, cpu_struct_for_prefetch=True)
+def test_sparse_struct_for_prefetch():
+    _test_sparse_struct_for()
+    assert num_struct_for_prefetches() > 0
+
+
+@ti.test(arch=ti.cpu, cpu_struct_for_prefetch=False)
+def test_sparse_struct_for_no_prefetch():
+    _test_sparse_struct_for()
+    assert num_struct_for_prefetches() == 0
@@ -0,0 +1,41 @@
+import taichi as ti
+
+
+@ti.test(arch=ti.cpu, cpu_work_stealing=True)
+def test_work_stealing_range_for():
+    n = 1024 * 32
+    s = ti.field(dtype=ti.i32, shape=n)
+
+    @ti.kernel
+    def fill():
+        for i in range(n):
+            s[i] += i
+
+    for _ in range(10):
+        fill()
+
+    for i in range(n):
+        assert s[i] == i * 10
+
+
+@ti.test(arch=ti.cpu, cpu_work_stealing=True, cpu_spin_count=0)
+def test_work_stealing_struct_for():
+    n = 1024
+    x = ti.field(dtype=ti.i32)
+    ti.root.pointer(ti.i, n // 16).dense(ti.i, 16).place(x)
+    total = ti.field(dtype=ti.i32, shape=())
+
+    @ti.kernel
+    def activate():
+        for i in range(n):
+            if i % 3 == 0:
+                x[i] = 1
+
+    @ti.kernel
+    def reduce():
+        for i in x:
+            total[None] += x[i]
+
+    activate()
+    reduce()
+    assert total[None] == (n + 2) // 3
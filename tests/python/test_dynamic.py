@@ -1,3 +1,4 @@
+import numpy as np
 import pytest
 
 import taichi as ti
@@ -84,6 +85,43 @@ def test_append():
         assert elements[i] == i
 
 
+@ti.test(require=ti.extension.sparse)
+def test_append_deep_directory():
+    # 3 chunks per directory page, so the directory of 4096 / 4 chunks is
+    # several levels deep
+    x = ti.field(ti.i32)
+    y = ti.field(ti.i32, shape=())
+    n = 4096
+    m = 3000
+
+    ti.root.dynamic(ti.i, n, chunk_size=4).place(x)
+
+    @ti.kernel
+    def fill():
+        for i in range(m):
+            ti.append(x.parent(), [], i * 3)
+
+    @ti.kernel
+    def get_len():
+        y[None] = ti.length(x.parent(), [])
+
+    @ti.kernel
+    def clear():
+        ti.deactivate(x.parent(), [])
+
+    for _ in range(2):
+        fill()
+        get_len()
+        assert y[None] == m
+        values = x.to_numpy()
+        np.testing.assert_array_equal(np.sort(values[:m]), np.arange(m) * 3)
+        # Beyond the length, lookups read the ambient element
+        assert (values[m:] == 0).all()
+        clear()
+        get_len()
+        assert y[None] == 0
+
+
 @ti.test(require=ti.extension.sparse)
 def test_length():
     x = ti.field(ti.i32)
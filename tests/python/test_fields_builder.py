@@ -174,3 +174,23 @@ def test_fields_builder_destroy():
         A(5)
     B(2)
     A(4)
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_fields_builder_destroy_reuse_zeroed():
+    n = 1000
+
+    def build():
+        fb = ti.FieldsBuilder()
+        a = ti.field(ti.i32)
+        fb.dense(ti.i, n).place(a)
+        c = fb.finalize()
+        return a, c
+
+    a, c = build()
+    a.fill(1)
+    c.destroy()
+    # The new tree reuses the root buffer of the destroyed one
+    b, d = build()
+    assert b.to_numpy().sum() == 0
+    d.destroy()
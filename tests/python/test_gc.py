@@ -132,3 +132,45 @@ def test_fuse_allocator_state():
     for i, y in enumerate(ys):
         expected = N if i == N else 0
         assert y == expected
+
+
+@ti.test(arch=ti.cpu, cpu_max_num_threads=8)
+def test_pointer_gc_from_many_threads():
+    N = 256
+    x = ti.field(ti.i32)
+    blk = ti.root.pointer(ti.i, N)
+    blk.dense(ti.i, 4).place(x)
+
+    @ti.kernel
+    def activate(r: ti.i32):
+        for i in range(N * 4):
+            if (i // 4 + r) % 3 != 0:
+                x[i] = i + r
+
+    @ti.kernel
+    def deactivate(r: ti.i32):
+        for b in range(N):
+            if (b + r) % 2 == 0:
+                ti.deactivate(blk, [b * 4])
+
+    @ti.kernel
+    def count() -> ti.i32:
+        n = 0
+        for b in range(N):
+            if ti.is_active(blk, [b * 4]):
+                n += 1
+        return n
+
+    active = set()
+    for r in range(20):
+        activate(r)
+        active |= {b for b in range(N) if (b + r) % 3 != 0}
+        deactivate(r)
+        active -= {b for b in range(N) if (b + r) % 2 == 0}
+        assert count() == len(active)
+        for b in active:
+            if (b + r) % 3 != 0:
+                assert x[b * 4 + 1] == b * 4 + 1 + r
+    # Deactivated nodes are reused. Only the magazines of the 8 threads may
+    # hold recycled nodes that another thread could not take.
+    assert blk.num_dynamically_allocated <= N + 16 * 8
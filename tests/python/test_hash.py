@@ -0,0 +1,196 @@
+import pytest
+
+import taichi as ti
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_basic():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+
+    n = 1 << 20
+
+    ti.root.hash(ti.i, n).place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def activate():
+        for i in range(1000):
+            x[i * 997] = i
+
+    @ti.kernel
+    def func():
+        for i in x:
+            s[None] += 1
+
+    activate()
+    func()
+    assert s[None] == 1000
+    assert x[997 * 999] == 999
+    assert x[997 * 3] == 3
+    assert x[1] == 0
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_dense_leaves():
+    x = ti.field(ti.f32)
+    s = ti.field(ti.i32)
+
+    n = 4096
+
+    ti.root.hash(ti.ij, n).dense(ti.ij, 8).place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def func():
+        for i, j in x:
+            s[None] += 1
+
+    x[0, 0] = 1
+    x[8 * 1000, 8 * 3000] = 1
+    x[8 * 4095 + 7, 7] = 1
+
+    func()
+    assert s[None] == 64 * 3
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_is_active():
+    x = ti.field(ti.f32)
+    s = ti.field(ti.i32)
+
+    n = 1 << 16
+
+    blk = ti.root.hash(ti.i, n)
+    blk.place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def func():
+        for i in range(n):
+            s[None] += ti.is_active(blk, i)
+
+    x[5] = 1
+    x[40000] = 1
+
+    func()
+    assert s[None] == 2
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_deactivate():
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+
+    n = 1 << 16
+
+    blk = ti.root.hash(ti.i, n)
+    blk.place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def activate():
+        for i in range(n // 4):
+            x[i * 4] = 1
+
+    @ti.kernel
+    def deactivate_odd():
+        for i in x:
+            if i % 8 == 4:
+                ti.deactivate(blk, i)
+
+    @ti.kernel
+    def count():
+        for i in x:
+            s[None] += x[i]
+
+    activate()
+    deactivate_odd()
+    count()
+    assert s[None] == n // 8
+
+    # Reactivated cells are zero-initialized.
+    s[None] = 0
+    activate()
+    count()
+    assert s[None] == n // 4
+
+    blk.deactivate_all()
+    s[None] = 0
+    count()
+    assert s[None] == 0
+
+
+@pytest.mark.parametrize('n', [100, 128])
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_full(n):
+    # Filling the index space spills keys into a second slot table, beyond
+    # the first max_num_elements slots.
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+
+    ti.root.hash(ti.i, n).place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def activate():
+        for i in range(n):
+            x[i] = i + 1
+
+    @ti.kernel
+    def count():
+        for i in x:
+            s[None] += x[i]
+
+    activate()
+    count()
+    assert s[None] == n * (n + 1) // 2
+
+
+@ti.test(arch=[ti.cpu, ti.cuda])
+def test_hash_moving_window():
+    # Deactivated keys are compacted away by gc, while the surviving keys
+    # stay reachable after being reinserted.
+    x = ti.field(ti.i32)
+    s = ti.field(ti.i32)
+
+    n = 1 << 20
+    window = 3000
+    num_rounds = 20
+
+    blk = ti.root.hash(ti.i, n)
+    blk.place(x)
+    ti.root.place(s)
+
+    @ti.kernel
+    def activate(begin: ti.i32):
+        for i in range(begin, begin + window):
+            x[i] = i + 1
+
+    @ti.kernel
+    def deactivate(begin: ti.i32):
+        for i in x:
+            if i >= begin and i % 10 != 0:
+                ti.deactivate(blk, i)
+
+    @ti.kernel
+    def count():
+        for i in x:
+            s[None] += 1
+
+    @ti.kernel
+    def check(end: ti.i32) -> ti.i32:
+        num_errors = 0
+        for i in range(end):
+            expected = 1 if i % 10 == 0 else 0
+            if ti.is_active(blk, i) != expected or x[i] != expected * (i + 1):
+                num_errors += 1
+        return num_errors
+
+    for r in range(num_rounds):
+        activate(r * window)
+        deactivate(r * window)
+        s[None] = 0
+        count()
+        assert s[None] == (r + 1) * window // 10
+    assert check(num_rounds * window) == 0
@@ -0,0 +1,49 @@
+import taichi as ti
+from taichi.lang import impl
+
+
+@ti.test()
+def test_delete_kernel():
+    x = ti.field(ti.i32, shape=4)
+
+    @ti.kernel
+    def fill(v: ti.i32):
+        for i in x:
+            x[i] = v
+
+    fill(1)
+    num_compiled = impl.get_runtime().get_num_compiled_functions()
+    ti.delete_kernel(fill)
+    assert impl.get_runtime().get_num_compiled_functions() == num_compiled - 1
+
+    # Compiled again
+    fill(2)
+    for i in range(4):
+        assert x[i] == 2
+
+
+@ti.test(arch=ti.cpu, max_compiled_kernels=2)
+def test_max_compiled_kernels():
+    x = ti.field(ti.i32, shape=4)
+
+    def make_add(k):
+        @ti.kernel
+        def add():
+            for i in x:
+                x[i] += k
+
+        return add
+
+    adds = [make_add(k) for k in range(5)]
+    # The machine code of the least recently launched kernels is released and
+    # compiled again.
+    for _ in range(3):
+        for add in adds:
+            add()
+    for i in range(4):
+        assert x[i] == 3 * sum(range(5))
+
+
+@ti.test(exclude=[ti.cpu], max_compiled_kernels=2)
+def test_max_compiled_kernels_cpu_only():
+    assert impl.get_runtime().prog.config.max_compiled_kernels == 0
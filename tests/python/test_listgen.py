@@ -59,3 +59,201 @@ def test_nested_3d():
     for _ in range(1000):
         i, j, k = randrange(n), randrange(n), randrange(n)
         assert x[i, j, k] == (i * n + j) * n + k
+
+
+@ti.test(require=ti.extension.sparse)
+def test_listgen_sparse_many_blocks():
+    x = ti.field(ti.i32)
+    n = 1024
+
+    ti.root.pointer(ti.ij, 16).pointer(ti.ij, 8).bitmasked(ti.ij,
+                                                           8).place(x)
+
+    @ti.kernel
+    def activate():
+        for i, j in ti.ndrange(n, n):
+            if (i * 7 + j * 3) % 5 == 0:
+                x[i, j] = 1
+
+    @ti.kernel
+    def count() -> ti.i32:
+        s = 0
+        for i, j in x:
+            s += x[i, j]
+        return s
+
+    activate()
+    expected = sum(1 for i in range(n) for j in range(n)
+                   if (i * 7 + j * 3) % 5 == 0)
+    assert count() == expected
+
+
+@ti.test(require=ti.extension.sparse)
+def test_listgen_reused_until_structure_changes():
+    x = ti.field(ti.i32)
+    y = ti.field(ti.i32)
+    n = 256
+
+    block = ti.root.pointer(ti.i, n // 16)
+    block.bitmasked(ti.i, 16).place(x)
+    ti.root.dynamic(ti.i, n, chunk_size=8).place(y)
+
+    @ti.kernel
+    def count_x() -> ti.i32:
+        s = 0
+        for i in x:
+            s += 1
+        return s
+
+    @ti.kernel
+    def count_y() -> ti.i32:
+        s = 0
+        for i in y:
+            s += 1
+        return s
+
+    @ti.kernel
+    def activate(begin: ti.i32, end: ti.i32):
+        for i in range(begin, end):
+            x[i] = 1
+            ti.append(y.parent(), [], i)
+
+    @ti.kernel
+    def deactivate(begin: ti.i32, end: ti.i32):
+        for i in range(begin, end):
+            ti.deactivate(x.parent(), i)
+
+    activate(0, 100)
+    for _ in range(2):
+        assert count_x() == 100
+        assert count_y() == 100
+    # Cells in existing blocks only
+    deactivate(10, 20)
+    assert count_x() == 90
+    # A new block of the pointer SNode
+    activate(200, 210)
+    assert count_x() == 100
+    assert count_y() == 110
+    block.deactivate_all()
+    assert count_x() == 0
+    activate(0, 5)
+    assert count_x() == 5
+
+
+@ti.test(require=ti.extension.sparse)
+def test_listgen_bitmasked_word_boundaries():
+    x = ti.field(ti.i32)
+    y = ti.field(ti.i32)
+    n = 4096
+
+    # Bitmasked as a parent container and as the leaf block of struct-fors
+    ti.root.bitmasked(ti.i, n).dense(ti.i, 2).place(x)
+    ti.root.dense(ti.i, 2).bitmasked(ti.i, n).place(y)
+
+    active = [0, 1, 30, 31, 32, 63, 64, 1000, 2047, 2048, n - 33, n - 1]
+
+    @ti.kernel
+    def activate(i: ti.i32):
+        x[i * 2 + 1] = i
+        y[n + i] = i
+
+    @ti.kernel
+    def sum_x() -> ti.i32:
+        s = 0
+        for i in x:
+            s += x[i]
+        return s
+
+    @ti.kernel
+    def count_y() -> ti.i32:
+        s = 0
+        for i in y:
+            s += 1
+        return s
+
+    @ti.kernel
+    def sum_y() -> ti.i32:
+        s = 0
+        for i in y:
+            s += y[i]
+        return s
+
+    assert count_y() == 0
+    for i in active:
+        activate(i)
+    assert sum_x() == sum(active)
+    assert count_y() == len(active)
+    assert sum_y() == sum(active)
+
+
+def run_listgen_incremental(leaf_block_type):
+    # Toggles a few leaf blocks per step, so that the element list of the leaf
+    # blocks is updated from the logged cell changes instead of regenerated.
+    x = ti.field(ti.i32)
+    n = 256
+    num_blocks = n // 4
+
+    block = ti.root.pointer(ti.i, num_blocks // 8)
+    cell = getattr(block, leaf_block_type)(ti.i, 8)
+    cell.dense(ti.i, 4).place(x)
+
+    @ti.kernel
+    def toggle(begin: ti.i32, end: ti.i32, stride: ti.i32):
+        for k in range(begin, end):
+            b = k * stride % num_blocks
+            if ti.is_active(cell, b):
+                ti.deactivate(cell, b)
+            else:
+                x[b * 4] = 1
+
+    @ti.kernel
+    def flip_twice(b: ti.i32):
+        ti.deactivate(cell, b)
+        x[b * 4] = 1
+
+    @ti.kernel
+    def total() -> ti.i32:
+        s = 0
+        for i in x:
+            s += i + 1
+        return s
+
+    active = set()
+
+    def apply_toggle(begin, end, stride):
+        toggle(begin, end, stride)
+        for k in range(begin, end):
+            active.symmetric_difference_update({k * stride % num_blocks})
+
+    def check():
+        assert total() == sum(
+            b * 4 + d + 1 for b in active for d in range(4))
+
+    # Every block of the pointer SNode stays active
+    apply_toggle(0, num_blocks, 1)
+    apply_toggle(0, num_blocks // 2, 2)
+    check()
+    for step in range(40):
+        apply_toggle(step, step + 3, 7)
+        check()
+        if step % 10 == 0:
+            b = step % num_blocks
+            flip_twice(b)
+            active.add(b)
+            check()
+
+
+@ti.test(require=ti.extension.sparse)
+def test_listgen_incremental_pointer():
+    run_listgen_incremental('pointer')
+
+
+@ti.test(require=ti.extension.sparse)
+def test_listgen_incremental_bitmasked():
+    run_listgen_incremental('bitmasked')
+
+
+@ti.test(require=[ti.extension.sparse, ti.extension.async_mode],
+         async_mode=True)
+def test_listgen_incremental_async():
+    run_listgen_incremental('pointer')
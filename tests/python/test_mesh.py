@@ -89,6 +89,13 @@ def test_mesh_for():
     _test_mesh_for(False, True)
 
 
+@ti.test(arch=ti.cpu, require=ti.extension.mesh, cpu_max_num_threads=8)
+def test_mesh_for_cpu_bls():
+    # The localized mappings live in the TLS buffers of the CPU threads
+    _test_mesh_for(False, False)
+    _test_mesh_for(True, True)
+
+
 @ti.test(require=ti.extension.mesh, optimize_mesh_reordered_mapping=False)
 def test_mesh_reordered_opt():
     _test_mesh_for(True, True, False)
@@ -190,8 +197,7 @@ def test_multiple_meshes():
         assert out[i] == i**2
 
 
-@ti.test(require=ti.extension.mesh)
-def test_mesh_local():
+def _test_mesh_local():
     mesh_builder = ti.Mesh.Tet()
     mesh_builder.verts.place({'a': ti.i32})
     mesh_builder.faces.link(mesh_builder.verts)
@@ -224,3 +230,14 @@ def test_mesh_local():
         assert res1[i] == res2[i]
         assert res1[i] == res3[i]
         assert res1[i] == res4[i]
+
+
+@ti.test(require=ti.extension.mesh)
+def test_mesh_local():
+    _test_mesh_local()
+
+
+@ti.test(arch=ti.cpu, require=ti.extension.mesh, cpu_max_num_threads=8)
+def test_mesh_local_cpu_bls():
+    # The cached attributes accumulate in the TLS buffers of the CPU threads
+    _test_mesh_local()
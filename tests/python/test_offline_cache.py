@@ -0,0 +1,85 @@
+import os
+import subprocess
+import sys
+
+import taichi as ti
+
+
+def cache_counter(name):
+    return ti.get_kernel_stats().get_counters().get(f'offline_cache_{name}',
+                                                    0)
+
+
+def run_kernels(cache_path):
+    ti.init(arch=ti.cpu,
+            offline_cache=True,
+            offline_cache_file_path=str(cache_path))
+    ti.get_kernel_stats().clear()
+    x = ti.field(ti.i32)
+    ti.root.pointer(ti.i, 4).dense(ti.i, 4).place(x)
+
+    @ti.kernel
+    def fill(c: ti.i32):
+        for i in range(12):
+            x[i] = i * c
+
+    @ti.kernel
+    def total() -> ti.i32:
+        s = 0
+        for i in x:
+            s += x[i]
+        return s
+
+    fill(3)
+    result = total()
+    ti.reset()
+    return result
+
+
+def test_offline_cache_reused(tmp_path):
+    expected = sum(i * 3 for i in range(12))
+    assert run_kernels(tmp_path) == expected
+    assert cache_counter('hits') == 0
+    assert cache_counter('misses') > 0
+    files = sorted(os.listdir(tmp_path))
+    assert len(files) > 0
+    # The second run loads every kernel from the cache.
+    assert run_kernels(tmp_path) == expected
+    assert cache_counter('hits') > 0
+    assert cache_counter('misses') == 0
+    assert sorted(os.listdir(tmp_path)) == files
+
+
+def test_offline_cache_reused_across_processes(tmp_path):
+    # The keys do not depend on addresses or type ids of the process.
+    script = ('import sys; sys.path.insert(0, sys.argv[1]); '
+              'from test_offline_cache import run_kernels; '
+              'run_kernels(sys.argv[2])')
+    test_dir = os.path.dirname(os.path.abspath(__file__))
+    subprocess.run([sys.executable, '-c', script, test_dir,
+                    str(tmp_path)],
+                   check=True)
+    files = sorted(os.listdir(tmp_path))
+    assert len(files) > 0
+    assert run_kernels(tmp_path) == sum(i * 3 for i in range(12))
+    assert cache_counter('hits') > 0
+    assert cache_counter('misses') == 0
+    assert sorted(os.listdir(tmp_path)) == files
+
+
+def test_offline_cache_evicted(tmp_path):
+    ti.init(arch=ti.cpu,
+            offline_cache=True,
+            offline_cache_file_path=str(tmp_path),
+            offline_cache_max_size_mb=0)
+    x = ti.field(ti.i32, shape=4)
+
+    @ti.kernel
+    def fill():
+        for i in x:
+            x[i] = i
+
+    fill()
+    assert x.to_numpy().tolist() == [0, 1, 2, 3]
+    assert os.listdir(tmp_path) == []
+    ti.reset()
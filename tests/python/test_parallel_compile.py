@@ -0,0 +1,36 @@
+import taichi as ti
+
+
+def run_many_offloads():
+    n = 16
+    x = ti.field(ti.i32, shape=n)
+    y = ti.field(ti.i32)
+    ti.root.pointer(ti.i, 4).dense(ti.i, 4).place(y)
+
+    @ti.kernel
+    def many_offloads() -> ti.i32:
+        for i in x:
+            x[i] = i
+        for i in range(n // 2):
+            y[i * 2] = x[i * 2] + 1
+        s = 0
+        for i in y:
+            s += y[i]
+        for i in x:
+            x[i] += s
+        return s
+
+    s = sum(i * 2 + 1 for i in range(n // 2))
+    assert many_offloads() == s
+    for i in range(n):
+        assert x[i] == i + s
+
+
+@ti.test(arch=ti.cpu, num_compile_threads=4)
+def test_parallel_compile():
+    run_many_offloads()
+
+
+@ti.test(arch=ti.cpu, num_compile_threads=1)
+def test_serial_compile():
+    run_many_offloads()
@@ -0,0 +1,106 @@
+import taichi as ti
+
+
+@ti.test()
+def test_precompile():
+    n = 16
+    x = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def fill(v: ti.i32):
+        for i in x:
+            x[i] = v + i
+
+    @ti.kernel
+    def total() -> ti.i32:
+        s = 0
+        for i in x:
+            s += x[i]
+        return s
+
+    ti.precompile((fill, 0), total)
+    fill(3)
+    assert total() == sum(3 + i for i in range(n))
+
+    info = ti.query_precompile_info()
+    assert [k['name'].split('_c')[0] for k in info] == ['fill', 'total']
+    for k in info:
+        assert k['queue_wait'] >= 0
+        assert k['launch_wait'] >= 0
+
+
+@ti.test(arch=ti.cpu, num_compile_threads=4)
+def test_precompile_templates():
+    x = ti.field(ti.f32, shape=8)
+    y = ti.field(ti.f32, shape=8)
+
+    @ti.kernel
+    def scale(a: ti.template(), k: ti.f32):
+        for i in a:
+            a[i] = i * k
+
+    ti.precompile((scale, x, 1.0), (scale, y, 1.0))
+    # Already being compiled
+    ti.precompile((scale, x, 1.0))
+    assert len(ti.query_precompile_info()) == 2
+
+    scale(x, 2.0)
+    scale(y, 3.0)
+    for i in range(8):
+        assert x[i] == i * 2
+        assert y[i] == i * 3
+    for k in ti.query_precompile_info():
+        assert k['compile_time'] > 0
+
+
+@ti.test(arch=ti.cpu, num_compile_threads=4)
+def test_precompile_many_offloads():
+    # The offloads of the kernels below are compiled on the shared compile
+    # workers by several precompile workers at once.
+    n = 16
+    fields = [ti.field(ti.i32, shape=n) for _ in range(6)]
+
+    @ti.kernel
+    def offloads(a: ti.template(), k: ti.i32) -> ti.i32:
+        for i in a:
+            a[i] = i * k
+        s = 0
+        for i in a:
+            s += a[i]
+        for i in a:
+            a[i] += s
+        return s
+
+    kernels = [(offloads, a, k + 1) for k, a in enumerate(fields)]
+    ti.precompile(*kernels)
+    assert len(ti.query_precompile_info()) == len(fields)
+    for _, a, k in kernels:
+        s = sum(i * k for i in range(n))
+        assert offloads(a, k) == s
+        for i in range(n):
+            assert a[i] == i * k + s
+
+
+@ti.test(arch=ti.cpu, num_compile_threads=4)
+def test_precompile_constant_fold():
+    # The precompile workers launch JIT evaluators for the constant
+    # expressions below, while the main thread fetches its return values.
+    x = ti.field(ti.i32, shape=4)
+
+    @ti.kernel
+    def folded(a: ti.template(), k: ti.template()):
+        for i in a:
+            c = ti.cast(k, ti.i32)
+            a[i] = (c * 3 + 1) // 2 - (c << 2) + i
+
+    @ti.kernel
+    def identity(v: ti.i32) -> ti.i32:
+        return v
+
+    kernels = [(folded, x, k) for k in range(1, 9)]
+    ti.precompile(*kernels)
+    for v in range(1000):
+        assert identity(v) == v
+    for _, a, k in kernels:
+        folded(a, k)
+        assert a[1] == (k * 3 + 1) // 2 - (k << 2) + 1
@@ -0,0 +1,42 @@
+import numpy as np
+
+import taichi as ti
+
+
+@ti.test(arch=ti.cpu, slp_vectorize=True)
+def test_slp_vectorize_matmul():
+    n = 16
+    a = ti.Matrix.field(3, 3, ti.f32, shape=n)
+    b = ti.Matrix.field(3, 3, ti.f32, shape=n)
+    c = ti.Matrix.field(3, 3, ti.f32, shape=n)
+
+    @ti.kernel
+    def compute():
+        for i in a:
+            c[i] = a[i] @ b[i] @ a[i] + b[i] * 2.0 - a[i]
+
+    a_np = np.random.rand(n, 3, 3).astype(np.float32)
+    b_np = np.random.rand(n, 3, 3).astype(np.float32)
+    a.from_numpy(a_np)
+    b.from_numpy(b_np)
+    compute()
+    expected = a_np @ b_np @ a_np + b_np * 2.0 - a_np
+    np.testing.assert_allclose(c.to_numpy(), expected, rtol=1e-5)
+
+
+@ti.test(arch=ti.cpu, slp_vectorize=True)
+def test_slp_vectorize_svd():
+    n = 16
+    F = ti.Matrix.field(3, 3, ti.f32, shape=n)
+    G = ti.Matrix.field(3, 3, ti.f32, shape=n)
+
+    @ti.kernel
+    def reconstruct():
+        for i in F:
+            U, sig, V = ti.svd(F[i])
+            G[i] = U @ sig @ V.transpose()
+
+    F_np = np.random.rand(n, 3, 3).astype(np.float32)
+    F.from_numpy(F_np)
+    reconstruct()
+    np.testing.assert_allclose(G.to_numpy(), F_np, atol=1e-4)
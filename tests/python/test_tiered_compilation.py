@@ -0,0 +1,36 @@
+import taichi as ti
+
+
+@ti.test(arch=ti.cpu,
+         tiered_compilation=True,
+         tiered_compilation_threshold=2)
+def test_tiered_compilation():
+    n = 16
+    x = ti.field(ti.i32, shape=n)
+
+    @ti.kernel
+    def inc():
+        for i in x:
+            x[i] += i
+
+    def num_swaps():
+        return ti.get_kernel_stats().get_counters().get(
+            'tiered_compilation_swaps', 0)
+
+    inc()
+    kernel_cpp = inc._primal.kernel_cpp
+    assert not kernel_cpp.wait_for_tier_up()
+    # Reaches the threshold and starts the optimized compilation
+    inc()
+    assert kernel_cpp.wait_for_tier_up()
+    assert num_swaps() == 0
+    # Swapped in by the next launch
+    inc()
+    assert num_swaps() == 1
+    assert not kernel_cpp.wait_for_tier_up()
+
+    # The optimized tier computes the same results.
+    for _ in range(3):
+        inc()
+    for i in range(n):
+        assert x[i] == i * 6